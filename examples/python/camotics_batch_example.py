@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+#
+# CAMotics is an Open-Source simulation and CAM software.
+# Copyright (C) 2011-2021 Joseph Coffland <joseph@cauldrondevelopment.com>
+#
+# This program is free software: you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation, either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# This file is an example showing how to run many CAMotics simulations
+# concurrently from one Python process.
+#
+# Usage: camotics_batch_example.py <project or GCode files>...
+
+
+import camotics
+import sys
+
+
+def done(sim, success):
+  # Called from a worker thread as each job finishes
+  if success: print('%s: %d triangles' % (
+      names[id(sim)], len(sim.get_surface_arrays()['indices'])))
+  else: print('%s: failed' % names[id(sim)])
+
+
+# All simulations share one thread pool, by default one thread per CPU
+batch = camotics.BatchSimulator(done = done)
+names = {}
+sims = []
+
+for filename in sys.argv[1:]:
+  s = camotics.Simulation()
+  s.open(filename)
+  s.set_resolution('low')
+
+  names[id(s)] = filename
+  sims.append(s)
+
+  # The tool path is computed by the batch if it has not been set
+  batch.add(s)
+
+# The GIL is released while waiting so the done callbacks can run
+batch.wait()
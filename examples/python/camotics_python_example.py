@@ -346,6 +346,12 @@ print('Total time %0.2fs' % total)
 # Alternatively, you can set the tool path with s.set_path(path) using
 # the same path format that get_path() returns.
 
+# Large paths are better accessed as columns.  get_path_arrays() returns
+# read-only buffers of positions, start_times, times, lines, tools and feeds
+# which NumPy can wrap without copying, e.g. numpy.asarray(arrays['times']).
+arrays = s.get_path_arrays()
+print('%d moves' % len(arrays['times']))
+
 # Start the simulation, passing a progress callback function
 s.start(callback, done = lambda x: print('success=%s' % x))
 
@@ -366,6 +372,11 @@ with open('test.stl', 'wb') as f:
 # Alternatively, write the STL directly to a file with s.write_surface().  This
 # will be much faster as it avoid converting the data.
 
+# The surface vertices, normals and triangle indices can also be accessed
+# without copying.  The buffers keep the surface alive.
+arrays = s.get_surface_arrays()
+print('%d triangles' % len(arrays['indices']))
+
 # Print some information about the simulation we just ran.
 print(s.is_metric())
 print(s.get_tools())
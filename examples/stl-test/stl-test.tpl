@@ -10,6 +10,7 @@ var end = bounds[0][2];
 var steps = 100;
 
 var contours = stl.contour({stl: data, start: start, end: end, steps: steps});
+stl.close({stl: data});
 
 feed(400);
 
@@ -0,0 +1,520 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include <camotics/Application.h>
+#include <camotics/sim/CutSim.h>
+#include <camotics/sim/ToolSweep.h>
+#include <camotics/sim/SweepKernels.h>
+#include <camotics/sim/Simulation.h>
+#include <camotics/contour/Surface.h>
+#include <camotics/Task.h>
+#include <camotics/project/Project.h>
+#include <camotics/MappedFile.h>
+
+#include <gcode/ToolPath.h>
+#include <gcode/Codes.h>
+#include <gcode/ControllerImpl.h>
+#include <gcode/parse/FastParser.h>
+#include <gcode/interp/Interpreter.h>
+#include <gcode/machine/MachinePipeline.h>
+#include <gcode/machine/MachineUnitAdapter.h>
+#include <gcode/machine/MachineLinearizer.h>
+#include <gcode/machine/MachineState.h>
+#include <gcode/plan/LinePlanner.h>
+#include <gcode/plan/LineCommand.h>
+#include <gcode/plan/PlannerConfig.h>
+#include <gcode/plan/SCurve.h>
+
+#include <cbang/Exception.h>
+#include <cbang/ApplicationMain.h>
+#include <cbang/String.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/SystemInfo.h>
+#include <cbang/time/Timer.h>
+#include <cbang/time/TimeInterval.h>
+#include <cbang/log/Logger.h>
+#include <cbang/config.h>
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <complex>
+
+#ifdef HAVE_V8
+#include <cbang/js/v8/JSImpl.h>
+#endif
+
+using namespace cb;
+using namespace std;
+using namespace CAMotics;
+
+
+namespace {
+  // The solvers LinePlanner used before the closed form versions in SCurve,
+  // kept as a reference for the planner benchmark.
+  complex<double> cbrt(complex<double> x) {
+    return x.real() < 0 ? -pow(-x, 1.0 / 3.0) : pow(x, 1.0 / 3.0);
+  }
+
+
+  double refPeakAccelFromLength(double Vi, double jerk, double length) {
+    using GCode::square;
+    using GCode::cube;
+
+    if (jerk < 0 && jerk <= -cube(Vi) / square(length))
+      return -square(Vi) / length;
+
+    complex<double> q = 0.5 * length * square(jerk);
+    complex<double> r = 2.0 / 3.0 * Vi * jerk;
+    complex<double> sqrtq2r3 = sqrt(square(q) + cube(r));
+
+    return (cbrt(q + sqrtq2r3) + cbrt(q - sqrtq2r3)).real();
+  }
+
+
+  double refPeakVelocity(double Vi, double Vt, double maxVel,
+                         double maxAccel, double maxJerk, double length) {
+    using GCode::SCurve::transitionLength;
+
+    double peakVel = maxVel;
+    double minVel = Vt;
+    int rounds = 0;
+
+    while (true) {
+      double headLen = transitionLength(Vi, peakVel, maxAccel, maxJerk);
+      double tailLen = transitionLength(Vt, peakVel, maxAccel, maxJerk);
+
+      if (headLen + tailLen <= length) {
+        if (0.99 * maxVel < peakVel || 16 < rounds) return peakVel;
+        rounds++;
+        minVel = peakVel;
+        peakVel = peakVel + (maxVel - peakVel) / 2;
+
+      } else {
+        maxVel = peakVel;
+        peakVel = minVel + (peakVel - minVel) / 2;
+        if (peakVel < minVel + 0.0001) return minVel;
+      }
+    }
+  }
+
+
+  class BlockProducer : public GCode::Producer {
+    const vector<SmartPointer<GCode::Block> > &blocks;
+    unsigned i = 0;
+
+  public:
+    BlockProducer(const vector<SmartPointer<GCode::Block> > &blocks) :
+      blocks(blocks) {}
+
+    // From GCode::Producer
+    bool hasMore() const {return i < blocks.size();}
+    SmartPointer<GCode::Block> next() {return blocks[i++];}
+  };
+}
+
+
+namespace CAMotics {
+  class BenchApp : public Application {
+    string tests = "sweep";
+    unsigned queries = 1000000;
+    unsigned seed = 1;
+
+    vector<string> inputs;
+    CutSim cutSim;
+
+  public:
+    BenchApp() : Application("CAMotics Benchmark") {
+      cmdLine.setUsageArgs("[OPTIONS] [project.camotics | input.gcode | "
+                           "input.tpl]...");
+
+      cmdLine.setAllowConfigAsFirstArg(false);
+      cmdLine.setAllowPositionalArgs(true);
+
+      cmdLine.addTarget("tests", tests, "Space separated list of benchmarks "
+                        "to run.  Valid values are 'sweep', 'reduce', "
+                        "'interp' and 'plan'.");
+      cmdLine.addTarget("queries", queries, "Number of queries per benchmark.");
+      cmdLine.addTarget("seed", seed, "Random number generator seed.");
+
+      Logger::instance().setLogTime(false);
+      Logger::instance().setLogNoInfoHeader(true);
+      Logger::instance().setScreenStream(cerr);
+    }
+
+
+    SmartPointer<GCode::ToolPath> loadPath(const string &input) {
+      Project::Project project;
+
+      string ext = SystemUtilities::extension(input);
+      if (ext == "xml" || ext == "camotics") project.load(input);
+      else project.addFile(input); // Assume TPL or G-Code
+
+      return cutSim.computeToolPath(project);
+    }
+
+
+    void benchReduce(const string &input) {
+      Project::Project project;
+
+      string ext = SystemUtilities::extension(input);
+      if (ext == "xml" || ext == "camotics") project.load(input);
+      else project.addFile(input); // Assume TPL or G-Code
+
+      SmartPointer<GCode::ToolPath> path = cutSim.computeToolPath(project);
+      if (path->empty()) return;
+
+      project.getWorkpiece().update(*path);
+      Rectangle3D bounds = project.getWorkpiece().getBounds();
+
+      Simulation sim(path, 0, 0, bounds, project.getResolution(),
+                     numeric_limits<double>::max(), RenderMode(),
+                     SystemInfo::instance().getCPUCount());
+      sim.cache = false;
+
+      SmartPointer<Surface> surface = cutSim.computeSurface(sim);
+      if (surface.isNull() || shouldQuit()) return;
+
+      for (unsigned i = 0; i < ReduceMode::getCount(); i++) {
+        ReduceMode mode = ReduceMode::getValue(i);
+        if (shouldQuit()) return;
+
+        // Reduce a copy so every mode starts from the same mesh
+        SmartPointer<Surface> copy = surface->copy();
+        uint64_t before = copy->getTriangleCount();
+
+        Task task;
+        double start = Timer::now();
+        copy->reduce(task, mode);
+        report(String("reduce ") + mode.toString(), input, before,
+               Timer::now() - start);
+
+        LOG_INFO(1, "Reduced " << before << " to "
+                 << copy->getTriangleCount() << " triangles with " << mode);
+      }
+    }
+
+
+    void benchInterp(const string &input) {
+      string ext = SystemUtilities::extension(input);
+      if (ext == "xml" || ext == "camotics" || ext == "tpl") return;
+
+      // Parse everything up front so interpretation is timed on its own
+      MappedFile file(input);
+      GCode::FastParser parser(file.getData(), file.getSize(), input);
+      vector<SmartPointer<GCode::Block> > blocks;
+
+      double start = Timer::now();
+      while (parser.hasMore()) blocks.push_back(parser.next());
+      report("parse", input, blocks.size(), Timer::now() - start);
+
+      // Code lookups, as done for every word of every block
+      const GCode::Code *tables[] =
+        {GCode::Codes::gcodes, GCode::Codes::mcodes};
+      vector<pair<char, double> > codes;
+      for (unsigned i = 0; i < 2; i++)
+        for (unsigned j = 0; tables[i][j].type; j++)
+          codes.push_back(make_pair(tables[i][j].type,
+                                    tables[i][j].number / 10.0));
+
+      unsigned found = 0;
+      start = Timer::now();
+      for (unsigned i = 0; i < queries; i++) {
+        const pair<char, double> &code = codes[i % codes.size()];
+        if (GCode::Codes::find(code.first, code.second)) found++;
+      }
+      report("code find", input, queries, Timer::now() - start);
+      if (found != queries) THROW("Code lookup failed");
+
+      // Interpret the parsed blocks through a machine pipeline without output
+      GCode::MachinePipeline pipeline;
+      pipeline.add(new GCode::MachineUnitAdapter);
+      pipeline.add(new GCode::MachineLinearizer);
+      pipeline.add(new GCode::MachineState);
+
+      GCode::ControllerImpl controller(pipeline);
+      GCode::Interpreter interp(controller);
+      interp.push(SmartPointer<GCode::Producer>(new BlockProducer(blocks)));
+
+      start = Timer::now();
+      pipeline.start();
+      unsigned errors = interp.run(blocks.size());
+      pipeline.end();
+      report("interp", input, blocks.size(), Timer::now() - start);
+
+      if (errors) LOG_WARNING(errors << " errors interpreting " << input);
+    }
+
+
+    void benchPlan(const string &input) {
+      string ext = SystemUtilities::extension(input);
+      if (ext == "xml" || ext == "camotics" || ext == "tpl") return;
+
+      MappedFile file(input);
+      GCode::FastParser parser(file.getData(), file.getSize(), input);
+      vector<SmartPointer<GCode::Block> > blocks;
+      while (parser.hasMore()) blocks.push_back(parser.next());
+
+      // Interpret and plan, recording the planned line commands
+      struct Profile {
+        double Vi, Vt, maxVel, maxAccel, maxJerk, length;
+      };
+      vector<Profile> profiles;
+
+      GCode::PlannerConfig config;
+      GCode::LinePlanner planner(config);
+
+      GCode::MachinePipeline pipeline;
+      pipeline.add(new GCode::MachineUnitAdapter);
+      pipeline.add(new GCode::MachineLinearizer);
+      pipeline.add(SmartPointer<GCode::LinePlanner>::Phony(&planner));
+
+      GCode::ControllerImpl controller(pipeline);
+      GCode::Interpreter interp(controller);
+      interp.push(SmartPointer<GCode::Producer>(new BlockProducer(blocks)));
+
+      auto drain = [&] () {
+        while (planner.hasMove()) {
+          const GCode::PlannerCommand &cmd = planner.next();
+          auto lc = dynamic_cast<const GCode::LineCommand *>(&cmd);
+
+          if (lc) {
+            Profile p;
+            p.Vi = std::min(lc->entryVel, lc->exitVel);
+            p.Vt = std::max(lc->entryVel, lc->exitVel);
+            p.maxVel = lc->maxVel;
+            p.maxAccel = lc->maxAccel;
+            p.maxJerk = lc->maxJerk;
+            p.length = lc->length;
+            profiles.push_back(p);
+          }
+
+          planner.setActive(cmd.getID());
+        }
+      };
+
+      double start = Timer::now();
+      pipeline.start();
+      unsigned errors = interp.run(blocks.size());
+      pipeline.end();
+      drain();
+      report("plan", input, profiles.size(), Timer::now() - start);
+
+      if (errors) LOG_WARNING(errors << " errors interpreting " << input);
+
+      // Replay the recorded profiles through the old and new solvers.  Sum
+      // results so the calls cannot be optimized away.
+      vector<double> oldAccel(profiles.size());
+      vector<double> newAccel(profiles.size());
+      vector<double> oldPeak(profiles.size());
+      vector<double> newPeak(profiles.size());
+      double sum = 0;
+
+      start = Timer::now();
+      for (unsigned i = 0; i < profiles.size(); i++) {
+        const Profile &p = profiles[i];
+        sum += oldAccel[i] = refPeakAccelFromLength(p.Vi, p.maxJerk, p.length);
+      }
+      report("peak accel complex", input, profiles.size(),
+             Timer::now() - start);
+
+      start = Timer::now();
+      for (unsigned i = 0; i < profiles.size(); i++) {
+        const Profile &p = profiles[i];
+        sum += newAccel[i] =
+          GCode::SCurve::peakAccelFromLength(p.Vi, p.maxJerk, p.length);
+      }
+      report("peak accel closed", input, profiles.size(),
+             Timer::now() - start);
+
+      start = Timer::now();
+      for (unsigned i = 0; i < profiles.size(); i++) {
+        const Profile &p = profiles[i];
+        sum += oldPeak[i] = refPeakVelocity
+          (p.Vi, p.Vt, p.maxVel, p.maxAccel, p.maxJerk, p.length);
+      }
+      report("peak vel bisect", input, profiles.size(),
+             Timer::now() - start);
+
+      start = Timer::now();
+      for (unsigned i = 0; i < profiles.size(); i++) {
+        const Profile &p = profiles[i];
+        sum += newPeak[i] = GCode::SCurve::peakVelocity
+          (p.Vi, p.Vt, p.maxVel, p.maxAccel, p.maxJerk, p.length);
+      }
+      report("peak vel newton", input, profiles.size(),
+             Timer::now() - start);
+
+      LOG_DEBUG(1, "Solver sum " << sum);
+
+      // Relative deviation from the old solvers
+      auto deviation = [] (const char *name, const vector<double> &a,
+                           const vector<double> &b) {
+        double maxDev = 0;
+        double totalDev = 0;
+
+        for (unsigned i = 0; i < a.size(); i++) {
+          double dev = a[i] ? fabs(b[i] - a[i]) / fabs(a[i]) : fabs(b[i]);
+          if (maxDev < dev) maxDev = dev;
+          totalDev += dev;
+        }
+
+        LOG_INFO(1, name << " deviation max=" << maxDev << " mean="
+                 << (a.empty() ? 0 : totalDev / a.size()));
+      };
+
+      deviation("Peak accel", oldAccel, newAccel);
+      deviation("Peak velocity", oldPeak, newPeak);
+    }
+
+
+    void report(const string &name, const string &input, double count,
+                double delta) {
+      cout << setw(24) << left << name << ' '
+           << setw(14) << right << fixed << setprecision(0)
+           << (delta ? count / delta : 0) << "/sec  " << TimeInterval(delta)
+           << "  " << SystemUtilities::basename(input) << endl;
+    }
+
+
+    void benchSweep(const string &input) {
+      SmartPointer<GCode::ToolPath> path = loadPath(input);
+      if (path->empty()) return;
+
+      // Sample points in and slightly around the tool path
+      Rectangle3D bounds = path->getBounds().grow(1);
+      mt19937 gen(seed);
+      uniform_real_distribution<double> x(bounds.rmin.x(), bounds.rmax.x());
+      uniform_real_distribution<double> y(bounds.rmin.y(), bounds.rmax.y());
+      uniform_real_distribution<double> z(bounds.rmin.z(), bounds.rmax.z());
+
+      vector<Vector3D> points(queries);
+      for (unsigned i = 0; i < queries; i++)
+        points[i] = Vector3D(x(gen), y(gen), z(gen));
+
+      // Rows of evenly spaced points, as sampled by VertexSlice
+      const unsigned rowLen = 64;
+      unsigned rows = queries / rowLen;
+      vector<double> rowXs(rowLen);
+      vector<double> rowPts(rowLen);
+      vector<double> rowOut(rowLen);
+      vector<Vector3D> rowStarts(rows);
+
+      double step = bounds.getDimensions().x() / 1024;
+      for (unsigned i = 0; i < rowLen; i++) rowXs[i] = step * i;
+      for (unsigned i = 0; i < rows; i++)
+        rowStarts[i] = Vector3D(x(gen), y(gen), z(gen));
+
+      for (unsigned i = 0; i < LookupMode::getCount(); i++) {
+        LookupMode mode = LookupMode::getValue(i);
+        if (shouldQuit()) return;
+
+        double start = Timer::now();
+        ToolSweep sweep(path, 0, numeric_limits<double>::max(), mode);
+        report(String("build ") + mode.toString(), input, path->size(),
+               Timer::now() - start);
+
+        // Sum results so the queries cannot be optimized away
+        double sum = 0;
+        start = Timer::now();
+        for (unsigned j = 0; j < queries; j++) sum += sweep.depth(points[j]);
+        report(String("depth ") + mode.toString(), input, queries,
+               Timer::now() - start);
+
+        start = Timer::now();
+        for (unsigned j = 0; j < rows; j++) {
+          Vector3D p = rowStarts[j];
+
+          for (unsigned k = 0; k < rowLen; k++) {
+            p.x() = rowStarts[j].x() + rowXs[k];
+            sum += sweep.depth(p);
+          }
+        }
+        report(String("row points ") + mode.toString(), input, rows * rowLen,
+               Timer::now() - start);
+
+        start = Timer::now();
+        for (unsigned j = 0; j < rows; j++) {
+          const Vector3D &p = rowStarts[j];
+
+          for (unsigned k = 0; k < rowLen; k++)
+            rowPts[k] = p.x() + rowXs[k];
+
+          sweep.depth(&rowPts[0], p.y(), p.z(), rowLen, &rowOut[0]);
+          sum += rowOut[0];
+        }
+        report(String("row batch ") + mode.toString(), input, rows * rowLen,
+               Timer::now() - start);
+
+        LOG_DEBUG(1, "Depth sum " << sum);
+      }
+    }
+
+
+    // From Application
+    int init(int argc, char *argv[]) {
+      int ret = Application::init(argc, argv);
+      if (ret == -1) return ret;
+
+      inputs = cmdLine.getPositionalArgs();
+
+      if (inputs.empty()) {
+        const char *examples[] = {
+          "examples/bear/bear.nc",
+          "examples/flower_mold/flower_mold.nc",
+          "examples/cameo/cameo.nc",
+          0,
+        };
+
+        for (unsigned i = 0; examples[i]; i++)
+          if (SystemUtilities::exists(examples[i]))
+            inputs.push_back(examples[i]);
+
+        if (inputs.empty()) THROW("No inputs and no examples found");
+      }
+
+      return 0;
+    }
+
+
+    void run() {
+      LOG_INFO(1, "Sweep kernels: " << SweepKernels::getInstructionSet());
+
+      vector<string> names;
+      String::tokenize(tests, names);
+
+      for (unsigned i = 0; i < names.size() && !shouldQuit(); i++)
+        for (unsigned j = 0; j < inputs.size() && !shouldQuit(); j++)
+          if (names[i] == "sweep") benchSweep(inputs[j]);
+          else if (names[i] == "reduce") benchReduce(inputs[j]);
+          else if (names[i] == "interp") benchInterp(inputs[j]);
+          else if (names[i] == "plan") benchPlan(inputs[j]);
+          else THROW("Unknown benchmark '" << names[i] << "'");
+    }
+  };
+}
+
+
+int main(int argc, char *argv[]) {
+#ifdef HAVE_V8
+  cb::gv8::JSImpl::init(0, 0);
+#endif
+  return doApplication<CAMotics::BenchApp>(argc, argv);
+}
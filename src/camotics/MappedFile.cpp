@@ -0,0 +1,112 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "MappedFile.h"
+
+#include <cbang/Exception.h>
+#include <cbang/os/SysError.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+MappedFile::MappedFile(const string &filename) :
+  filename(filename), data(0), size(0) {
+#ifdef _WIN32
+  mapping = 0;
+  file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+                     OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+  if (file == INVALID_HANDLE_VALUE)
+    THROW("Failed to open '" << filename << "': " << SysError());
+
+  LARGE_INTEGER length;
+  if (!GetFileSizeEx(file, &length)) {
+    close();
+    THROW("Failed to get size of '" << filename << "': " << SysError());
+  }
+  size = length.QuadPart;
+
+  // Empty files cannot be mapped
+  if (!size) return;
+
+  mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+  if (mapping)
+    data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+#else
+  fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) THROW("Failed to open '" << filename << "': " << SysError());
+
+  struct stat info;
+  if (fstat(fd, &info)) {
+    close();
+    THROW("Failed to stat '" << filename << "': " << SysError());
+  }
+  size = info.st_size;
+
+  // Empty files cannot be mapped
+  if (!size) return;
+
+  void *addr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr != MAP_FAILED) {
+    data = (const char *)addr;
+
+    // The file is read once from start to end
+    madvise(addr, size, MADV_SEQUENTIAL);
+  }
+#endif
+
+  if (!data) {
+    close();
+    THROW("Failed to map '" << filename << "': " << SysError());
+  }
+}
+
+
+MappedFile::~MappedFile() {close();}
+
+
+void MappedFile::close() {
+#ifdef _WIN32
+  if (data) UnmapViewOfFile(data);
+  if (mapping) CloseHandle(mapping);
+  if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+  mapping = 0;
+  file = INVALID_HANDLE_VALUE;
+
+#else
+  if (data) munmap((void *)data, size);
+  if (fd != -1) ::close(fd);
+  fd = -1;
+#endif
+
+  data = 0;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // Read only memory mapping of a whole file
+  class MappedFile {
+    std::string filename;
+    const char *data;
+    uint64_t size;
+
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+
+  public:
+    MappedFile(const std::string &filename);
+    MappedFile(const MappedFile &) = delete;
+    ~MappedFile();
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const std::string &getFilename() const {return filename;}
+    const char *getData() const {return data;}
+    uint64_t getSize() const {return size;}
+
+  protected:
+    void close();
+  };
+}
@@ -0,0 +1,161 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "ThreadPool.h"
+
+#include <cbang/Exception.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/Catch.h>
+#include <cbang/os/SystemInfo.h>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+ThreadPool::ThreadPool(unsigned threads) : active(0) {
+  queues.reserve(maxThreads);
+  reserve(threads ? threads : SystemInfo::instance().getCPUCount());
+}
+
+
+ThreadPool::~ThreadPool() {
+  try {
+    stop();
+  } CATCH_ERROR;
+}
+
+
+// Shared pool which is reused across simulation runs.  It is sized to the
+// CPU count on first use, static initialization is thread safe.
+ThreadPool &ThreadPool::instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+
+unsigned ThreadPool::getThreads() const {
+  SmartLock lock(this);
+  return workers.size();
+}
+
+
+// Grows the pool to at least the requested number of workers.  Safe to call
+// while jobs are running, workers are only ever added.
+void ThreadPool::reserve(unsigned threads) {
+  SmartLock lock(this);
+
+  if (!threads) threads = 1;
+  if (maxThreads < threads) threads = maxThreads;
+  if (shutdown || threads <= workers.size()) return;
+
+  unsigned first = workers.size();
+
+  // The queues were reserved up front so running workers never see them move
+  for (unsigned i = first; i < threads; i++) {
+    queues.push_back(new Queue);
+    workers.push_back(new Worker(*this, i));
+  }
+
+  active = threads;
+
+  for (unsigned i = first; i < threads; i++) workers[i]->start();
+}
+
+
+// Jobs added from a job should pass the current worker's index so they are
+// queued locally
+void ThreadPool::add(const job_t &job, int worker) {
+  SmartLock lock(this);
+
+  if (workers.empty()) THROW("Thread pool not started");
+
+  unsigned id = worker < 0 ? next++ % active : worker;
+  Queue &queue = *queues.at(id);
+
+  queue.lock();
+  queue.jobs.push_back(job);
+  queue.unlock();
+
+  pending++;
+  signal();
+}
+
+
+void ThreadPool::stop() {
+  lock();
+  shutdown = true;
+  broadcast();
+  unlock();
+
+  for (unsigned i = 0; i < workers.size(); i++) workers[i]->join();
+
+  SmartLock lock(this);
+  active = 0;
+  workers.clear();
+  queues.clear();
+}
+
+
+bool ThreadPool::pop(unsigned id, job_t &job) {
+  unsigned count = active;
+
+  for (unsigned i = 0; i < count; i++) {
+    Queue &queue = *queues[(id + i) % count];
+    SmartLock lock(&queue);
+
+    if (queue.jobs.empty()) continue;
+
+    // Own jobs newest first, stolen jobs oldest first
+    if (!i) {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+
+    } else {
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+
+void ThreadPool::work(unsigned id) {
+  while (true) {
+    job_t job;
+
+    if (pop(id, job)) {
+      lock();
+      pending--;
+      unlock();
+
+      TRY_CATCH_ERROR(job(id));
+      continue;
+    }
+
+    SmartLock lock(this);
+    if (shutdown) break;
+    if (!pending) Condition::wait();
+    if (shutdown) break;
+  }
+}
@@ -0,0 +1,90 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/os/Thread.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/os/Condition.h>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+
+
+namespace CAMotics {
+  // Persistent work-stealing thread pool.  Each worker has its own queue.
+  // Jobs added by a worker go to the back of its queue and are run LIFO,
+  // idle workers steal from the front of other queues.
+  //
+  // The pool is sized once when constructed and may grow but never shrinks
+  // or restarts while in use.
+  class ThreadPool : public cb::Condition {
+  public:
+    // Upper bound on workers, the queue array is never reallocated
+    static const unsigned maxThreads = 256;
+
+    // Jobs are passed the index of the worker running them
+    typedef std::function<void (unsigned worker)> job_t;
+
+  protected:
+    class Worker : public cb::Thread {
+      ThreadPool &pool;
+      unsigned id;
+
+    public:
+      Worker(ThreadPool &pool, unsigned id) : pool(pool), id(id) {}
+
+      // From Thread
+      void run() {pool.work(id);}
+    };
+
+    struct Queue : public cb::Mutex {
+      std::deque<job_t> jobs;
+    };
+
+    std::vector<cb::SmartPointer<Worker> > workers;
+    std::vector<cb::SmartPointer<Queue> > queues;
+    std::atomic<unsigned> active;
+
+    unsigned pending = 0;
+    unsigned next = 0;
+    bool shutdown = false;
+
+  public:
+    // Zero threads means one per CPU
+    ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    static ThreadPool &instance();
+
+    unsigned getThreads() const;
+    void reserve(unsigned threads);
+
+    void add(const job_t &job, int worker = -1);
+
+  protected:
+    void stop();
+    bool pop(unsigned id, job_t &job);
+    void work(unsigned id);
+  };
+}
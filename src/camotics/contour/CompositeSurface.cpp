@@ -49,6 +49,14 @@ SmartPointer<Surface> CompositeSurface::copy() const {
 }
 
 
+uint64_t CompositeSurface::getVertexCount() const {
+  uint64_t vertices = 0;
+  for (unsigned i = 0; i < surfaces.size(); i++)
+    vertices += surfaces[i]->getVertexCount();
+  return vertices;
+}
+
+
 uint64_t CompositeSurface::getTriangleCount() const {
   uint64_t triangles = 0;
   for (unsigned i = 0; i < surfaces.size(); i++)
@@ -76,9 +84,10 @@ void CompositeSurface::write(STL::Sink &sink, Task *task) const {
 }
 
 
-void CompositeSurface::reduce(Task &task) {
+void CompositeSurface::reduce(Task &task, ReduceMode mode) {
   consolidate();
-  for (unsigned i = 0; i < surfaces.size(); i++) surfaces[i]->reduce(task);
+  for (unsigned i = 0; i < surfaces.size(); i++)
+    surfaces[i]->reduce(task, mode);
 }
 
 
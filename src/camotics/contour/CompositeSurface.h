@@ -43,11 +43,12 @@ namespace CAMotics {
 
     // From Surface
     cb::SmartPointer<Surface> copy() const;
+    uint64_t getVertexCount() const;
     uint64_t getTriangleCount() const;
     cb::Rectangle3D getBounds() const;
     void getVertices(vert_cb_t cb) const;
     void write(STL::Sink &sink, Task *task = 0) const;
-    void reduce(Task &task);
+    void reduce(Task &task, ReduceMode mode);
 
     // From cb::JSON::Serializable
     void read(const cb::JSON::Value &value);
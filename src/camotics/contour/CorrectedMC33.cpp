@@ -58,20 +58,20 @@ void CorrectedMC33::doCell(GridTreeRef &tree, const CubeSlice &slice,
   if (!tiling) return;
 
   SmartPointer<GridTreeLeaf> leaf = new GridTreeLeaf;
-  Triangle t;
+  uint8_t e[3];
+  Vector3D v[3];
 
   // Draw the triangles that were found.  There can be up to five per cube.
   centerComputed = false;
   for (unsigned i = 0; i < count; i++) {
     for (unsigned j = 0; j < 3; j++) {
-      uint8_t edge = tiling[j + i * 3];
+      e[j] = tiling[j + i * 3];
 
-      if (edge == 12) t[j] = getCenter(index);
-      else t[j] = edges[edge].vertex;
+      if (e[j] == GridTreeLeaf::centerEdge) v[j] = getCenter(index);
+      else v[j] = edges[e[j]].vertex;
     }
 
-    t.updateNormal();
-    leaf->add(t);
+    leaf->add(e, v);
   }
 
   tree.insertLeaf(leaf.adopt(), offset);
@@ -27,18 +27,19 @@ using namespace cb;
 using namespace CAMotics;
 
 
-CubeSlice::CubeSlice(const GridTreeRef &grid) :
-  grid(grid), z(0), shifted(false) {}
+CubeSlice::CubeSlice(const GridTreeRef &grid, const GridBlocks &blocks,
+                     bool normals) :
+  grid(grid), blocks(blocks), z(0), shifted(false), normals(normals) {}
 
 
 void CubeSlice::compute(Task &task, FieldFunction &func) {
   // Vertices
   if (!shifted) {
-    left = new VertexSlice(grid, z);
+    left = new VertexSlice(grid, blocks, z);
     left->compute(func);
   }
 
-  right = new VertexSlice(grid, z + 1);
+  right = new VertexSlice(grid, blocks, z + 1);
   right->compute(func);
 
   // Edges
@@ -71,7 +72,8 @@ void CubeSlice::compute(Task &task, FieldFunction &func) {
 
       Vector3D a = p;
       double aDepth = left->depth(x, y);
-      bool cull = func.cull(a, 2.1 * resolution);
+      bool cull =
+        !blocks.isSurface(x, y, z) || func.cull(a, 2.1 * resolution);
 
       for (unsigned i = (cull || shifted) ? 2 : 0; i < 5; i++) {
         if (x == steps.x() && (i == 0 || i == 3)) continue;
@@ -80,13 +82,16 @@ void CubeSlice::compute(Task &task, FieldFunction &func) {
         Vector3D b = p + offsets[i];
         double bDepth = depth(x, y, vIndex[i]);
 
-        if ((aDepth < 0) != (bDepth < 0) && !cull)
-          edges[i][x][y] = func.getEdge(a, aDepth, b, bDepth);
+        if ((aDepth < 0) != (bDepth < 0) && !cull) {
+          Edge &e = edges[i][x][y] = func.getEdge(a, aDepth, b, bDepth);
+          if (normals) e.normal = func.normal(e.vertex, resolution / 16);
+        }
 
         if (i == 2) {
           a = b;
           aDepth = bDepth;
-          if (func.cull(a, 2.1 * resolution)) break;
+          if (!blocks.isSurface(x, y, z + 1) ||
+              func.cull(a, 2.1 * resolution)) break;
         }
       }
     }
@@ -35,6 +35,7 @@
 namespace CAMotics {
   class CubeSlice {
     const GridTreeRef &grid;
+    const GridBlocks &blocks;
     unsigned z;
 
     cb::SmartPointer<VertexSlice> left;
@@ -42,9 +43,11 @@ namespace CAMotics {
     std::vector<std::vector<Edge> > edges[5];
 
     bool shifted;
+    bool normals;
 
   public:
-    CubeSlice(const GridTreeRef &grid);
+    CubeSlice(const GridTreeRef &grid, const GridBlocks &blocks,
+              bool normals = false);
 
     const GridTreeRef &getGrid() const {return grid;}
     unsigned getZ() const {return z;}
@@ -0,0 +1,228 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "DualContouring.h"
+#include "CubeSlice.h"
+#include "GridTreeLeaf.h"
+#include "QEF.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  // Cube corners and edges as numbered in the marching cubes tables
+  const unsigned cornerOffsets[8][3] = {
+    {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+    {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1},
+  };
+
+  const unsigned edgeCorners[12][2] = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6}, {6, 7}, {7, 4},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+  };
+
+
+  bool crosses(uint8_t flags, unsigned edge) {
+    return !(flags & (1 << edgeCorners[edge][0])) !=
+      !(flags & (1 << edgeCorners[edge][1]));
+  }
+}
+
+
+DualContouring::DualContouring() : func(0), z(0), current(0) {}
+
+
+Vector3D DualContouring::solve(const Edge edges[12], uint8_t flags,
+                               const Rectangle3D &bounds) {
+  // Solve relative to the mass point of the intersections for stability
+  Vector3D mass;
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < 12; i++)
+    if (crosses(flags, i)) {
+      mass += edges[i].vertex;
+      count++;
+    }
+
+  if (!count) return bounds.getCenter();
+  mass /= count;
+
+  double mat[12][3];
+  double vec[12];
+  int rows = 0;
+
+  for (unsigned i = 0; i < 12; i++) {
+    if (!crosses(flags, i)) continue;
+
+    const Vector3D &n = edges[i].normal;
+    if (!n.isReal() || !n.length()) continue;
+
+    for (unsigned j = 0; j < 3; j++) mat[rows][j] = n[j];
+    vec[rows++] = n.dot(edges[i].vertex - mass);
+  }
+
+  Vector3D v = mass;
+  if (rows) v += QEF::evaluate(mat, vec, rows);
+
+  // Keep the vertex in its cell
+  for (unsigned i = 0; i < 3; i++)
+    v[i] = min(max(v[i], bounds.rmin[i]), bounds.rmax[i]);
+
+  return v;
+}
+
+
+void DualContouring::doSlice(FieldFunction &func, const CubeSlice &slice,
+                             unsigned z) {
+  this->func = &func;
+  this->z = z;
+
+  const Vector3U &steps = slice.getGrid().getSteps();
+  unsigned size = steps.x() * steps.y();
+
+  // The current slice becomes the previous one
+  current = !current;
+  vertices[current].resize(size);
+  computed[current].assign(size, false);
+  if (!z) computed[!current].assign(size, false);
+}
+
+
+void DualContouring::doCell(GridTreeRef &tree, const CubeSlice &slice,
+                            unsigned x, unsigned y) {
+  uint8_t flags = slice.getEdges(x, y, edges);
+
+  // This cell's vertex
+  unsigned index = x * tree.getSteps().y() + y;
+  vertices[current][index] =
+    solve(edges, flags, getCellBounds(tree, x, y, z));
+  computed[current][index] = true;
+
+  SmartPointer<GridTreeLeaf> leaf = new GridTreeLeaf;
+  Vector3U origin = tree.getOrigin() + Vector3U(x, y, z);
+
+  // Edges leaving the lower corner along x, y and z and their other corner
+  static const unsigned ends[3] = {1, 3, 4};
+
+  for (unsigned a = 0; a < 3; a++) {
+    bool outside0 = flags & 1;
+    bool outside1 = flags & (1 << ends[a]);
+    if (outside0 == outside1) continue;
+
+    // The four cells around the edge, counter-clockwise about axis a
+    unsigned b = (a + 1) % 3;
+    unsigned c = (a + 2) % 3;
+    if (!origin[b] || !origin[c]) continue; // Outside the root grid
+
+    static const int around[4][2] = {{1, 1}, {0, 1}, {0, 0}, {1, 0}};
+    Vector3D v[4];
+    uint8_t e[4];
+
+    for (unsigned i = 0; i < 4; i++) {
+      unsigned d[3] = {0, 0, 0};
+      d[b] = around[i][0];
+      d[c] = around[i][1];
+
+      v[i] = getVertex(tree, x - d[0], y - d[1], z - d[2]);
+      e[i] = GridTreeLeaf::neighborCenter(d[0], d[1], d[2]);
+    }
+
+    // Face outward, towards the outside end of the edge
+    if (outside0) {
+      swap(v[1], v[3]);
+      swap(e[1], e[3]);
+    }
+
+    uint8_t e0[3] = {e[0], e[1], e[2]};
+    uint8_t e1[3] = {e[0], e[2], e[3]};
+    Vector3D v0[3] = {v[0], v[1], v[2]};
+    Vector3D v1[3] = {v[0], v[2], v[3]};
+
+    leaf->add(e0, v0);
+    leaf->add(e1, v1);
+  }
+
+  tree.insertLeaf(leaf.adopt(), Vector3U(x, y, z));
+}
+
+
+Rectangle3D DualContouring::getCellBounds(const GridTreeRef &grid, int x,
+                                          int y, int z) const {
+  double resolution = grid.getResolution();
+  Vector3D p = grid.getOffset() + Vector3D(x, y, z) * resolution;
+  return Rectangle3D(p, p + Vector3D(resolution, resolution, resolution));
+}
+
+
+Vector3D DualContouring::getVertex(const GridTreeRef &grid, int x, int y,
+                                   int z) {
+  const Vector3U &steps = grid.getSteps();
+
+  // Cells of this grid in the current or previous slice are cached.  Cells
+  // outside the grid or which were not contoured are sampled directly.
+  bool cached = 0 <= x && 0 <= y && (unsigned)x < steps.x() &&
+    (unsigned)y < steps.y() && 0 <= z && (unsigned)z + 1 >= this->z;
+
+  if (!cached) return sampleVertex(grid, x, y, z);
+
+  unsigned slice = (unsigned)z == this->z ? current : !current;
+  unsigned index = x * steps.y() + y;
+
+  if (!computed[slice][index]) {
+    vertices[slice][index] = sampleVertex(grid, x, y, z);
+    computed[slice][index] = true;
+  }
+
+  return vertices[slice][index];
+}
+
+
+Vector3D DualContouring::sampleVertex(const GridTreeRef &grid, int x, int y,
+                                      int z) {
+  Rectangle3D bounds = getCellBounds(grid, x, y, z);
+  double resolution = grid.getResolution();
+
+  Vector3D corners[8];
+  double depths[8];
+  uint8_t flags = 0;
+
+  for (unsigned i = 0; i < 8; i++) {
+    const unsigned *o = cornerOffsets[i];
+    corners[i] = bounds.rmin + Vector3D(o[0], o[1], o[2]) * resolution;
+    depths[i] = func->depth(corners[i]);
+    if (depths[i] < 0) flags |= 1 << i;
+  }
+
+  Edge edges[12];
+  for (unsigned i = 0; i < 12; i++)
+    if (crosses(flags, i)) {
+      unsigned a = edgeCorners[i][0];
+      unsigned b = edgeCorners[i][1];
+
+      edges[i] = func->getEdge(corners[a], depths[a], corners[b], depths[b]);
+      edges[i].normal = func->normal(edges[i].vertex, resolution / 16);
+    }
+
+  return solve(edges, flags, bounds);
+}
@@ -0,0 +1,63 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+#pragma once
+
+#include "SliceContourGenerator.h"
+
+#include <cbang/geom/Rectangle.h>
+
+#include <vector>
+
+
+namespace CAMotics {
+  // Dual contouring places one vertex in each cell the surface passes
+  // through, at the point which best fits the planes given by the edge
+  // intersections and their normals, so sharp edges and corners are kept.
+  // Each cell then joins the vertices of the four cells around each of the
+  // crossed edges leaving its lower corner.
+  class DualContouring : public SliceContourGenerator {
+    FieldFunction *func;
+    unsigned z;
+    Edge edges[12];
+
+    // Cell vertices of the current and previous slices
+    std::vector<cb::Vector3D> vertices[2];
+    std::vector<bool> computed[2];
+    unsigned current;
+
+  public:
+    DualContouring();
+
+    static cb::Vector3D solve(const Edge edges[12], uint8_t flags,
+                              const cb::Rectangle3D &bounds);
+
+    // From SliceContourGenerator
+    bool needsNormals() const {return true;}
+    void doSlice(FieldFunction &func, const CubeSlice &slice, unsigned z);
+    void doCell(GridTreeRef &tree, const CubeSlice &slice, unsigned x,
+                unsigned y);
+
+  protected:
+    cb::Rectangle3D getCellBounds(const GridTreeRef &grid, int x, int y,
+                                  int z) const;
+    cb::Vector3D getVertex(const GridTreeRef &grid, int x, int y, int z);
+    cb::Vector3D sampleVertex(const GridTreeRef &grid, int x, int y, int z);
+  };
+}
@@ -65,11 +65,36 @@ Vector3D FieldFunction::findNormal(Vector3D &a, double aDepth,
 }
 
 
+// Outward surface normal at p from the central differences of depth.  Only
+// meaningful if depth() varies smoothly, subclasses whose depth is just a
+// sign must override this.
+Vector3D FieldFunction::normal(const Vector3D &p, double offset) const {
+  Vector3D gradient;
+
+  for (unsigned i = 0; i < 3; i++) {
+    Vector3D a = p;
+    Vector3D b = p;
+    a[i] -= offset;
+    b[i] += offset;
+
+    gradient[i] = depth(a) - depth(b); // Depth decreases outward
+  }
+
+  return gradient.normalize();
+}
+
+
 bool FieldFunction::cull(const Vector3D &p, double offset) const {
   return cull(Rectangle3D(p, p).grow(offset));
 }
 
 
+void FieldFunction::depth(const double *xs, double y, double z, unsigned n,
+                          double *out) const {
+  for (unsigned i = 0; i < n; i++) out[i] = depth(Vector3D(xs[i], y, z));
+}
+
+
 Edge FieldFunction::getEdge(const Vector3D &v1, double depth1,
                             const Vector3D &v2, double depth2) {
   Vector3D a = v1;
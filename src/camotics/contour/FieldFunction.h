@@ -31,17 +31,29 @@
 namespace CAMotics {
   class FieldFunction {
   public:
+    typedef enum {
+      BLOCK_SURFACE, // May contain part of the surface
+      BLOCK_UNCUT,   // Culled, nothing is computed here
+      BLOCK_AIR,     // Entirely outside, contains no surface
+      BLOCK_SOLID,   // Entirely inside, contains no surface
+    } block_t;
+
     virtual ~FieldFunction() {} // Compiler needs this
 
     cb::Vector3D linearIntersect(cb::Vector3D &a, double &aDepth,
                                  cb::Vector3D &b, double &bDepth);
     cb::Vector3D findNormal(cb::Vector3D &a, double aDepth, cb::Vector3D &b,
                             double bDepth);
+    virtual cb::Vector3D normal(const cb::Vector3D &p, double offset) const;
     bool contains(const cb::Vector3D &p) const {return 0 <= depth(p);}
     bool cull(const cb::Vector3D &p, double offset) const;
 
     virtual bool cull(const cb::Rectangle3D &r) const {return false;}
+    virtual block_t classify(const cb::Rectangle3D &r) const
+    {return cull(r) ? BLOCK_UNCUT : BLOCK_SURFACE;}
     virtual double depth(const cb::Vector3D &p) const = 0;
+    virtual void depth(const double *xs, double y, double z, unsigned n,
+                       double *out) const;
     virtual Edge getEdge(const cb::Vector3D &v1, double depth1,
                          const cb::Vector3D &v2, double depth2);
 
@@ -0,0 +1,103 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "GridBlocks.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+GridBlocks::GridBlocks(const Grid &grid) : grid(grid) {
+  const Vector3U &steps = grid.getSteps();
+
+  for (unsigned i = 0; i < 3; i++)
+    counts[i] = steps[i] ? (steps[i] + size - 1) / size : 1;
+
+  blocks.resize(counts.x() * counts.y() * counts.z(),
+                FieldFunction::BLOCK_SURFACE);
+}
+
+
+void GridBlocks::classify(const FieldFunction &func) {
+  if (!grid.isEmpty()) classify(func, Vector3U(), counts);
+}
+
+
+unsigned GridBlocks::getCount(FieldFunction::block_t type) const {
+  return std::count(blocks.begin(), blocks.end(), (uint8_t)type);
+}
+
+
+FieldFunction::block_t GridBlocks::get(unsigned x, unsigned y,
+                                       unsigned z) const {
+  // Vertices on the far edges belong to the last block
+  x = std::min(x / size, counts.x() - 1);
+  y = std::min(y / size, counts.y() - 1);
+  z = std::min(z / size, counts.z() - 1);
+
+  return (FieldFunction::block_t)blocks[index(x, y, z)];
+}
+
+
+void GridBlocks::classify(const FieldFunction &func, const Vector3U &start,
+                          const Vector3U &end) {
+  // Vertex bounds of the blocks in [start, end)
+  const Vector3U &steps = grid.getSteps();
+  Vector3D vMin, vMax;
+  for (unsigned i = 0; i < 3; i++) {
+    vMin[i] = start[i] * size;
+    vMax[i] = std::min(end[i] * size, steps[i]);
+  }
+
+  // Grown to cover the per vertex and per cell culling done when contouring
+  double resolution = grid.getResolution();
+  Rectangle3D bounds(grid.getOffset() + vMin * resolution,
+                     grid.getOffset() + vMax * resolution);
+  bounds = bounds.grow(2.2 * resolution);
+
+  FieldFunction::block_t type = func.classify(bounds);
+  Vector3U dims = end - start;
+
+  if (type == FieldFunction::BLOCK_SURFACE &&
+      (1 < dims.x() || 1 < dims.y() || 1 < dims.z())) {
+    // Split along the largest dimension
+    unsigned axis = 0;
+    if (dims[axis] < dims.y()) axis = 1;
+    if (dims[axis] < dims.z()) axis = 2;
+
+    Vector3U mid = end;
+    mid[axis] = start[axis] + dims[axis] / 2;
+    classify(func, start, mid);
+
+    mid = start;
+    mid[axis] = start[axis] + dims[axis] / 2;
+    classify(func, mid, end);
+
+    return;
+  }
+
+  for (unsigned z = start.z(); z < end.z(); z++)
+    for (unsigned y = start.y(); y < end.y(); y++)
+      for (unsigned x = start.x(); x < end.x(); x++)
+        blocks[index(x, y, z)] = type;
+}
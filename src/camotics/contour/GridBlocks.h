@@ -0,0 +1,63 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+
+#include "FieldFunction.h"
+
+#include <camotics/Grid.h>
+
+#include <vector>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // Coarse classification of a grid in to blocks of size^3 cells.  Blocks
+  // are tested hierarchically so large empty regions cost a single test.
+  // Only BLOCK_SURFACE blocks need to be sampled.
+  class GridBlocks {
+    const Grid &grid;
+    cb::Vector3U counts;
+    std::vector<uint8_t> blocks;
+
+  public:
+    static const unsigned size = 8;
+
+    GridBlocks(const Grid &grid);
+
+    void classify(const FieldFunction &func);
+
+    unsigned getTotal() const {return blocks.size();}
+    unsigned getCount(FieldFunction::block_t type) const;
+
+    FieldFunction::block_t get(unsigned x, unsigned y, unsigned z) const;
+    bool isSurface(unsigned x, unsigned y, unsigned z) const
+    {return get(x, y, z) == FieldFunction::BLOCK_SURFACE;}
+    bool isSolid(unsigned x, unsigned y, unsigned z) const
+    {return get(x, y, z) == FieldFunction::BLOCK_SOLID;}
+
+  protected:
+    void classify(const FieldFunction &func, const cb::Vector3U &start,
+                  const cb::Vector3U &end);
+    unsigned index(unsigned x, unsigned y, unsigned z) const
+    {return (z * counts.y() + y) * counts.x() + x;}
+  };
+}
@@ -20,18 +20,22 @@
 
 #include "GridTree.h"
 #include "GridTreeRef.h"
+#include "GridTreeLeaf.h"
 
 #include <camotics/sim/AABBTree.h>
 
+#include <cbang/Exception.h>
 #include <cbang/log/Logger.h>
 
+#include <cmath>
+
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
 
 
-GridTree::GridTree(const Grid &grid) :
-  GridTreeNode(grid.getSteps()), Grid(grid) {}
+GridTree::GridTree(const Grid &grid, const Vector3U &origin) :
+  GridTreeNode(grid.getSteps()), Grid(grid), origin(origin) {}
 
 
 GridTree::~GridTree() {}
@@ -43,38 +47,69 @@ void GridTree::partition(vector<GridTreeRef> &grids,
   if (isEmpty() || !bbox.intersects(bounds)) return;
 
   if (count < 2) {
-    Vector3U offset;
-    Vector3U steps(getSteps());
+    grids.push_back(getRef(bbox));
+    return;
+  }
 
-    Rectangle3D intersection = bbox.intersection(bounds);
-    if (intersection != bounds) {
-      intersection = (intersection - getOffset()) / getResolution();
+  split();
 
-      Rectangle3U iBounds(intersection.rmin.floor(),
-                          intersection.rmax.ceil());
-      offset = iBounds.rmin;
-      Vector3U dims = iBounds.getDimensions();
+  getLeft()->partition(grids, bbox, count / 2);
+  getRight()->partition(grids, bbox, count - count / 2);
+}
 
-      // Don't let new steps exceed old
-      for (unsigned i = 0; i < 3; i++)
-        if (steps[i] < offset[i] + dims[i]) steps[i] -= offset[i];
-        else steps[i] = dims[i];
-    }
 
-    grids.push_back(GridTreeRef(this, offset, steps));
-    return;
-  }
+bool GridTree::isSplit() const {
+  return left && right && getLeft() && getRight();
+}
+
+
+bool GridTree::canSplit() const {
+  // Nodes which already hold contour data cannot be split
+  return !left && !right && 1 < getSteps()[largestDim()];
+}
+
+
+void GridTree::split() {
+  if (isSplit()) return;
+  if (left || right) THROW("Cannot split populated grid tree");
 
   pair<Grid, Grid> parts = Grid::split(largestDim());
 
-  if (!left) left = new GridTree(parts.first);
-  if (!right) right = new GridTree(parts.second);
+  // Offsets are whole cells apart so rounding recovers the exact count
+  Vector3D delta = (parts.second.getOffset() - getOffset()) / getResolution();
+  Vector3U rOrigin(origin);
+  for (unsigned i = 0; i < 3; i++) rOrigin[i] += (unsigned)round(delta[i]);
+
+  left = new GridTree(parts.first, origin);
+  right = new GridTree(parts.second, rOrigin);
+}
+
+
+GridTreeRef GridTree::getRef(const Rectangle3D &bbox) {
+  Rectangle3D bounds = getBounds();
+  Vector3U offset;
+  Vector3U steps(getSteps());
+
+  Rectangle3D intersection = bbox.intersection(bounds);
+  if (intersection != bounds) {
+    intersection = (intersection - getOffset()) / getResolution();
+
+    Rectangle3U iBounds(intersection.rmin.floor(),
+                        intersection.rmax.ceil());
+    offset = iBounds.rmin;
+    Vector3U dims = iBounds.getDimensions();
+
+    // Don't let new steps exceed old
+    for (unsigned i = 0; i < 3; i++)
+      if (steps[i] < offset[i] + dims[i]) steps[i] -= offset[i];
+      else steps[i] = dims[i];
+  }
 
-  dynamic_cast<GridTree *>(left)->partition(grids, bbox, count / 2);
-  dynamic_cast<GridTree *>(right)->partition(grids, bbox, count - count / 2);
+  return GridTreeRef(this, offset, steps);
 }
 
 
 void GridTree::insertLeaf(GridTreeLeaf *leaf, const Vector3U &offset) {
+  leaf->setCell(origin + offset);
   GridTreeNode::insertLeaf(leaf, getSteps(), offset);
 }
@@ -30,13 +30,24 @@ namespace CAMotics {
   class GridTreeRef;
 
   class GridTree : public GridTreeNode, public Grid {
+    cb::Vector3U origin; // Offset in cells from the root grid
+
   public:
-    GridTree(const Grid &grid);
+    GridTree(const Grid &grid, const cb::Vector3U &origin = cb::Vector3U());
     ~GridTree();
 
     void partition(std::vector<GridTreeRef> &grids, const cb::Rectangle3D &bbox,
                    unsigned count);
 
+    const cb::Vector3U &getOrigin() const {return origin;}
+
+    bool isSplit() const;
+    bool canSplit() const;
+    void split();
+    GridTree *getLeft() const {return dynamic_cast<GridTree *>(left);}
+    GridTree *getRight() const {return dynamic_cast<GridTree *>(right);}
+    GridTreeRef getRef(const cb::Rectangle3D &bbox);
+
     using GridTreeNode::insertLeaf;
     void insertLeaf(GridTreeLeaf *leaf, const cb::Vector3U &offset);
   };
@@ -27,6 +27,7 @@
 
 namespace CAMotics {
   class GridTreeLeaf;
+  class VertexIndex;
 
   class GridTreeBase {
   public:
@@ -36,7 +37,6 @@ namespace CAMotics {
     virtual unsigned getCount() const = 0;
     virtual void insertLeaf(GridTreeLeaf *leaf, const cb::Vector3U &steps,
                             const cb::Vector3U &offset) {}
-    virtual void gather(std::vector<float> &vertices,
-                        std::vector<float> &normals) const = 0;
+    virtual void gather(VertexIndex &index) const = 0;
   };
 }
@@ -17,26 +17,65 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 \******************************************************************************/
-
 #include "GridTreeLeaf.h"
+#include "VertexIndex.h"
 
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
 
 
-void GridTreeLeaf::add(const Triangle &t) {
-  if (!t.normal.isReal()) return; // Degenerate, skip
-  triangles.push_back(t);
+namespace {
+  // Grid point offset and axis of each marching cubes edge followed by the
+  // centers of this and the neighboring cells in the negative directions
+  const int edgeOffsets[20][4] = {
+    {0, 0, 0, 0}, {1, 0, 0, 1}, {0, 1, 0, 0}, {0, 0, 0, 1},
+    {0, 0, 1, 0}, {1, 0, 1, 1}, {0, 1, 1, 0}, {0, 0, 1, 1},
+    {0, 0, 0, 2}, {1, 0, 0, 2}, {1, 1, 0, 2}, {0, 1, 0, 2},
+    {0, 0, 0, 3}, {-1, 0, 0, 3}, {0, -1, 0, 3}, {-1, -1, 0, 3},
+    {0, 0, -1, 3}, {-1, 0, -1, 3}, {0, -1, -1, 3}, {-1, -1, -1, 3},
+  };
 }
 
 
-void GridTreeLeaf::gather(vector<float> &vertices,
-                          vector<float> &normals) const {
-  for (unsigned i = 0; i < getCount(); i++)
-    for (unsigned j = 0; j < 3; j++)
-      for (unsigned k = 0; k < 3; k++) {
-        vertices.push_back(triangles[i][j][k]);
-        normals.push_back(triangles[i].normal[k]);
-      }
+void GridTreeLeaf::add(const uint8_t edges[3], const Vector3D vertices[3]) {
+  Vector3F v[3];
+  for (unsigned i = 0; i < 3; i++) v[i] = vertices[i];
+
+  // Skip degenerate triangles
+  Vector3F normal = (v[0] - v[1]).cross(v[1] - v[2]);
+  if (!normal.length() || !normal.isReal()) return;
+
+  for (unsigned i = 0; i < 3; i++) indices.push_back(getVertex(edges[i], v[i]));
+}
+
+
+void GridTreeLeaf::gather(VertexIndex &index) const {
+  uint32_t global[20];
+
+  for (unsigned i = 0; i < vertices.size(); i++) {
+    const int *o = edgeOffsets[vertices[i].edge];
+    Vector3U point(cell.x() + o[0], cell.y() + o[1], cell.z() + o[2]);
+    bool owner = vertices[i].edge <= centerEdge;
+    global[i] = index.get(point, o[3], vertices[i].position, owner);
+  }
+
+  for (unsigned i = 0; i < indices.size(); i += 3) {
+    uint32_t triangle[3] = {
+      global[indices[i]], global[indices[i + 1]], global[indices[i + 2]]};
+    index.add(triangle);
+  }
+}
+
+
+uint8_t GridTreeLeaf::getVertex(uint8_t edge, const Vector3F &position) {
+  for (unsigned i = 0; i < vertices.size(); i++)
+    if (vertices[i].edge == edge) return i;
+
+  Vertex v;
+  v.position = position;
+  v.edge = edge;
+  vertices.push_back(v);
+
+  return vertices.size() - 1;
 }
@@ -17,30 +17,48 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 \******************************************************************************/
-
 #pragma once
 
 
 #include "GridTreeBase.h"
-#include "Triangle.h"
 
 
 #include <vector>
+#include <cinttypes>
 
 
 namespace CAMotics {
+  // The triangles of one grid cell.  Vertices are identified by the cube
+  // edge they lie on, as numbered in the marching cubes tables, so they can
+  // be shared with neighboring cells when the tree is gathered.
   class GridTreeLeaf : public GridTreeBase {
-    std::vector<Triangle> triangles;
+    struct Vertex {
+      cb::Vector3F position;
+      uint8_t edge;
+    };
+
+    cb::Vector3U cell; // Position in the root grid
+    std::vector<Vertex> vertices;
+    std::vector<uint8_t> indices;
 
   public:
-    const std::vector<Triangle> &getTriangles() const {return triangles;}
+    static const uint8_t centerEdge = 12; // Vertex inside the cell
+
+    // Vertex inside the cell at -dx, -dy, -dz from this one
+    static uint8_t neighborCenter(unsigned dx, unsigned dy, unsigned dz)
+    {return centerEdge + (dx ? 1 : 0) + (dy ? 2 : 0) + (dz ? 4 : 0);}
 
-    void add(const Triangle &t);
+    const cb::Vector3U &getCell() const {return cell;}
+    void setCell(const cb::Vector3U &cell) {this->cell = cell;}
+
+    void add(const uint8_t edges[3], const cb::Vector3D vertices[3]);
 
     // From GridTreeBase
     bool isLeaf() const {return true;}
-    unsigned getCount() const {return triangles.size();}
-    void gather(std::vector<float> &vertices,
-                std::vector<float> &normals) const;
+    unsigned getCount() const {return indices.size() / 3;}
+    void gather(VertexIndex &index) const;
+
+  protected:
+    uint8_t getVertex(uint8_t edge, const cb::Vector3F &position);
   };
 }
@@ -91,8 +91,7 @@ void GridTreeNode::insertLeaf(GridTreeLeaf *leaf, const Vector3U &_steps,
 }
 
 
-void GridTreeNode::gather(vector<float> &vertices,
-                          vector<float> &normals) const {
-  if (left) left->gather(vertices, normals);
-  if (right) right->gather(vertices, normals);
+void GridTreeNode::gather(VertexIndex &index) const {
+  if (left) left->gather(index);
+  if (right) right->gather(index);
 }
@@ -43,8 +43,7 @@ namespace CAMotics {
     unsigned getCount() const {return count;}
     void insertLeaf(GridTreeLeaf *leaf, const cb::Vector3U &steps,
                     const cb::Vector3U &offset);
-    void gather(std::vector<float> &vertices,
-                std::vector<float> &normals) const;
+    void gather(VertexIndex &index) const;
   };
 }
 
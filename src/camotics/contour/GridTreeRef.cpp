@@ -46,7 +46,6 @@ void GridTreeRef::insertLeaf(GridTreeLeaf *leaf, const Vector3U &offset) {
 }
 
 
-void GridTreeRef::gather(vector<float> &vertices,
-                         vector<float> &normals) const {
+void GridTreeRef::gather(VertexIndex &index) const {
   THROW("Cannot call " << __func__ << " on GridTreeRef");
 }
@@ -33,12 +33,14 @@ namespace CAMotics {
     GridTreeRef(GridTree *ref, const cb::Vector3U &offset,
                 const cb::Vector3U &steps);
 
+    // Offset in cells from the root grid
+    cb::Vector3U getOrigin() const {return ref->getOrigin() + offset;}
+
     using GridTreeBase::insertLeaf;
     void insertLeaf(GridTreeLeaf *leaf, const cb::Vector3U &offset);
 
     // From GridTreeBase
     unsigned getCount() const;
-    void gather(std::vector<float> &vertices,
-                std::vector<float> &normals) const;
+    void gather(VertexIndex &index) const;
   };
 }
@@ -0,0 +1,145 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "IndexedMesh.h"
+
+#include <cbang/Exception.h>
+
+#include <unordered_map>
+#include <cmath>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  struct Cell {
+    int64_t x, y, z;
+
+    Cell(int64_t x, int64_t y, int64_t z) : x(x), y(y), z(z) {}
+
+    bool operator==(const Cell &o) const {
+      return x == o.x && y == o.y && z == o.z;
+    }
+  };
+
+
+  struct CellHash {
+    size_t operator()(const Cell &c) const {
+      return (size_t)(c.x * 73856093) ^ (size_t)(c.y * 19349663) ^
+        (size_t)(c.z * 83492791);
+    }
+  };
+
+
+  const uint32_t none = numeric_limits<uint32_t>::max();
+}
+
+
+void IndexedMesh::clear() {
+  xs.clear();
+  ys.clear();
+  zs.clear();
+  indices.clear();
+}
+
+
+void IndexedMesh::weld(const vector<float> &vertices, float threshold) {
+  if (threshold <= 0) THROW("Weld threshold must be positive");
+
+  clear();
+
+  unsigned count = vertices.size() / 3;
+  indices.reserve(count);
+
+  // Cells are twice the threshold wide so any vertex within the threshold
+  // is in the same cell or the neighbor on the nearer side of each axis
+  const double scale = 1 / (2.0 * threshold);
+
+  unordered_map<Cell, uint32_t, CellHash> cells(count);
+  vector<uint32_t> next; // Next vertex in the same cell
+
+  for (unsigned i = 0; i < count; i++) {
+    float x = vertices[i * 3 + 0];
+    float y = vertices[i * 3 + 1];
+    float z = vertices[i * 3 + 2];
+
+    double cx = x * scale;
+    double cy = y * scale;
+    double cz = z * scale;
+    Cell cell((int64_t)floor(cx), (int64_t)floor(cy), (int64_t)floor(cz));
+
+    int dx = cx - cell.x < 0.5 ? -1 : 1;
+    int dy = cy - cell.y < 0.5 ? -1 : 1;
+    int dz = cz - cell.z < 0.5 ? -1 : 1;
+
+    uint32_t match = none;
+
+    for (unsigned j = 0; j < 8 && match == none; j++) {
+      Cell c(cell.x + (j & 1 ? dx : 0), cell.y + (j & 2 ? dy : 0),
+             cell.z + (j & 4 ? dz : 0));
+
+      auto it = cells.find(c);
+      if (it == cells.end()) continue;
+
+      for (uint32_t v = it->second; v != none; v = next[v])
+        if (fabs(xs[v] - x) <= threshold && fabs(ys[v] - y) <= threshold &&
+            fabs(zs[v] - z) <= threshold) {
+          match = v;
+          break;
+        }
+    }
+
+    if (match == none) {
+      match = xs.size();
+      xs.push_back(x);
+      ys.push_back(y);
+      zs.push_back(z);
+
+      auto result = cells.insert(make_pair(cell, match));
+      next.push_back(result.second ? none : result.first->second);
+      result.first->second = match;
+    }
+
+    indices.push_back(match);
+  }
+}
+
+
+void IndexedMesh::getTriangles(vector<float> &vertices,
+                               vector<float> &normals) const {
+  vertices.clear();
+  normals.clear();
+
+  for (unsigned i = 0; i < indices.size(); i += 3) {
+    Vector3D v[3];
+    for (unsigned j = 0; j < 3; j++) v[j] = getVertex(indices[i + j]);
+
+    Vector3D normal = (v[0] - v[1]).cross(v[1] - v[2]).normalize();
+    if (!normal.isReal()) continue; // Degenerate, discard
+
+    for (unsigned j = 0; j < 3; j++)
+      for (unsigned k = 0; k < 3; k++) {
+        vertices.push_back(v[j][k]);
+        normals.push_back(normal[k]);
+      }
+  }
+}
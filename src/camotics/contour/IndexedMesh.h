@@ -0,0 +1,59 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/geom/Vector.h>
+
+#include <vector>
+#include <limits>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // Triangle mesh with shared vertices.  Vertex positions are stored as
+  // separate coordinate arrays and triangles as an index buffer.
+  class IndexedMesh {
+  public:
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+    std::vector<uint32_t> indices;
+
+    IndexedMesh() {}
+
+    unsigned getVertexCount() const {return xs.size();}
+    unsigned getTriangleCount() const {return indices.size() / 3;}
+    cb::Vector3D getVertex(unsigned i) const
+    {return cb::Vector3D(xs[i], ys[i], zs[i]);}
+
+    void clear();
+
+    // Build from unindexed triangle vertices, merging vertices which are
+    // no more than threshold apart on every axis
+    void weld(const std::vector<float> &vertices,
+              float threshold = std::numeric_limits<float>::epsilon() * 10);
+
+    // Expand to unindexed vertices with per face normals, skipping
+    // degenerate triangles
+    void getTriangles(std::vector<float> &vertices,
+                      std::vector<float> &normals) const;
+  };
+}
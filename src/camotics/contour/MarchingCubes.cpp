@@ -40,16 +40,17 @@ void MarchingCubes::doCell(GridTreeRef &tree, const CubeSlice &slice,
   SmartPointer<GridTreeLeaf> leaf = new GridTreeLeaf;
 
   // Draw the triangles that were found.  There can be up to five per cube.
-  Triangle t;
+  uint8_t e[3];
+  Vector3D v[3];
   for (int j = 0; j < 5; j++) {
     if (triangleConnectionTable[index][3 * j] < 0) break;
 
-    for (int i = 0; i < 3; i++)
-      t[i] = edges[triangleConnectionTable[index][3 * j + i]].vertex;
+    for (int i = 0; i < 3; i++) {
+      e[i] = triangleConnectionTable[index][3 * j + i];
+      v[i] = edges[e[i]].vertex;
+    }
 
-    t.updateNormal();
-
-    leaf->add(t);
+    leaf->add(e, v);
   }
 
   tree.insertLeaf(leaf.adopt(), offset);
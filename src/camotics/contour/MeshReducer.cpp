@@ -0,0 +1,362 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "MeshReducer.h"
+#include "IndexedMesh.h"
+
+#include <camotics/Task.h>
+#include <camotics/ThreadPool.h>
+
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/os/Condition.h>
+#include <cbang/util/SmartLock.h>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  const uint32_t none = numeric_limits<uint32_t>::max();
+  const unsigned maxPasses = 8;
+  const unsigned partsPerThread = 4;
+
+
+  unsigned countCommon(const vector<uint32_t> &a, const vector<uint32_t> &b) {
+    unsigned count = 0;
+
+    for (unsigned i = 0, j = 0; i < a.size() && j < b.size();)
+      if (a[i] == b[j]) {count++; i++; j++;}
+      else if (a[i] < b[j]) i++;
+      else j++;
+
+    return count;
+  }
+}
+
+
+MeshReducer::MeshReducer(IndexedMesh &mesh, double tolerance) :
+  mesh(mesh), tolerance(tolerance) {}
+
+
+unsigned MeshReducer::reduce(Task &task) {
+  ThreadPool &pool = ThreadPool::instance();
+
+  unsigned parts = pool.getThreads() * partsPerThread;
+
+  task.begin("Reducing mesh: building");
+  build(parts);
+
+  unsigned total = 0;
+  vector<Scratch> scratch(parts);
+
+  task.begin("Reducing mesh: collapsing vertices");
+
+  for (unsigned pass = 0; pass < maxPasses; pass++) {
+    // Reduce slabs in parallel
+    Condition done;
+    unsigned outstanding = parts;
+    unsigned collapsed = 0;
+
+    for (unsigned part = 0; part < parts; part++)
+      pool.add([&, part] (unsigned worker) {
+          unsigned count = 0;
+          TRY_CATCH_ERROR(count = reducePartition(task, part, scratch[part]));
+
+          SmartLock lock(&done);
+          collapsed += count;
+          outstanding--;
+          done.signal();
+        });
+
+    done.lock();
+    while (outstanding) done.timedWait(0.25);
+    done.unlock();
+
+    if (task.shouldQuit()) return total;
+
+    // Stitch along slab borders
+    for (unsigned part = 0; part < parts; part++) {
+      vector<uint32_t> &border = scratch[part].border;
+
+      for (unsigned i = 0; i < border.size(); i++)
+        if (collapse(border[i], -1, scratch[part])) collapsed++;
+
+      border.clear();
+    }
+
+    LOG_DEBUG(3, "Reduce pass " << pass << " collapsed " << collapsed);
+
+    total += collapsed;
+    if (!collapsed || !task.update((double)(pass + 1) / maxPasses)) break;
+  }
+
+  compact();
+
+  return total;
+}
+
+
+void MeshReducer::build(unsigned partitions) {
+  unsigned vertices = mesh.getVertexCount();
+  unsigned triangles = mesh.getTriangleCount();
+  const vector<uint32_t> &indices = mesh.indices;
+
+  // Vertex to triangle lists
+  triOffsets.assign(vertices + 1, 0);
+  for (unsigned i = 0; i < indices.size(); i++) triOffsets[indices[i] + 1]++;
+  for (unsigned i = 0; i < vertices; i++) triOffsets[i + 1] += triOffsets[i];
+
+  triList.resize(indices.size());
+  vector<uint32_t> fill(triOffsets.begin(), triOffsets.end() - 1);
+  for (unsigned i = 0; i < indices.size(); i++)
+    triList[fill[indices[i]]++] = i / 3;
+
+  chain.assign(vertices, none);
+  tail.resize(vertices);
+  for (unsigned i = 0; i < vertices; i++) tail[i] = i;
+
+  deletedVertex.assign(vertices, 0);
+  deletedTriangle.assign(triangles, 0);
+
+  // Triangles which repeat a vertex are degenerate
+  for (unsigned i = 0; i < triangles; i++) {
+    const uint32_t *t = &indices[i * 3];
+    if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) deletedTriangle[i] = 1;
+  }
+
+  // Slabs along the longest axis
+  const vector<float> *coords[3] = {&mesh.xs, &mesh.ys, &mesh.zs};
+  unsigned axis = 0;
+  float minC = 0;
+  float extent = 0;
+
+  for (unsigned i = 0; i < 3 && vertices; i++) {
+    const vector<float> &c = *coords[i];
+    auto r = minmax_element(c.begin(), c.end());
+
+    if (extent < *r.second - *r.first) {
+      axis = i;
+      minC = *r.first;
+      extent = *r.second - *r.first;
+    }
+  }
+
+  const vector<float> &c = *coords[axis];
+  partition.resize(vertices);
+  partOffsets.assign(partitions + 1, 0);
+
+  for (unsigned i = 0; i < vertices; i++) {
+    unsigned part = extent ? (c[i] - minC) / extent * partitions : 0;
+    partition[i] = std::min(part, partitions - 1);
+    partOffsets[partition[i] + 1]++;
+  }
+
+  for (unsigned i = 0; i < partitions; i++)
+    partOffsets[i + 1] += partOffsets[i];
+
+  partVertices.resize(vertices);
+  fill.assign(partOffsets.begin(), partOffsets.end() - 1);
+  for (unsigned i = 0; i < vertices; i++)
+    partVertices[fill[partition[i]]++] = i;
+}
+
+
+unsigned MeshReducer::reducePartition(Task &task, unsigned part, Scratch &s) {
+  unsigned count = 0;
+
+  for (unsigned i = partOffsets[part]; i < partOffsets[part + 1]; i++) {
+    if (!(i & 1023) && task.shouldQuit()) break;
+    if (collapse(partVertices[i], part, s)) count++;
+  }
+
+  return count;
+}
+
+
+void MeshReducer::gather(uint32_t v, vector<uint32_t> &tris) const {
+  tris.clear();
+
+  for (uint32_t c = v; c != none; c = chain[c])
+    for (unsigned i = triOffsets[c]; i < triOffsets[c + 1]; i++)
+      if (!deletedTriangle[triList[i]]) tris.push_back(triList[i]);
+}
+
+
+// Returns false if the triangles around v do not form a closed fan
+bool MeshReducer::getRing(uint32_t v, const vector<uint32_t> &tris,
+                          vector<uint32_t> &ring) const {
+  ring.clear();
+
+  for (unsigned i = 0; i < tris.size(); i++)
+    for (unsigned j = 0; j < 3; j++) {
+      uint32_t w = mesh.indices[tris[i] * 3 + j];
+      if (w != v) ring.push_back(w);
+    }
+
+  sort(ring.begin(), ring.end());
+
+  // In a closed fan every neighbor is shared by exactly two triangles
+  bool closed = true;
+  for (unsigned i = 0; i < ring.size() && closed; i += 2)
+    if (ring.size() <= i + 1 || ring[i] != ring[i + 1] ||
+        (i + 2 < ring.size() && ring[i + 2] == ring[i])) closed = false;
+
+  ring.erase(unique(ring.begin(), ring.end()), ring.end());
+
+  return closed;
+}
+
+
+// Unnormalized triangle normal with vertex v moved to u
+Vector3D MeshReducer::getNormal(uint32_t tri, uint32_t v, uint32_t u) const {
+  Vector3D p[3];
+
+  for (unsigned i = 0; i < 3; i++) {
+    uint32_t w = mesh.indices[tri * 3 + i];
+    p[i] = mesh.getVertex(w == v ? u : w);
+  }
+
+  return (p[0] - p[1]).cross(p[1] - p[2]);
+}
+
+
+// Collapse v on to one of its neighbors.  If part is not negative, only
+// vertices whose neighbors are all in that slab are collapsed and others are
+// added to the scratch border list.
+bool MeshReducer::collapse(uint32_t v, int part, Scratch &s) {
+  if (deletedVertex[v]) return false;
+
+  gather(v, s.tris);
+  if (s.tris.size() < 3 || !getRing(v, s.tris, s.ring)) return false;
+
+  if (0 <= part)
+    for (unsigned i = 0; i < s.ring.size(); i++)
+      if (partition[s.ring[i]] != (unsigned)part) {
+        s.border.push_back(v);
+        return false;
+      }
+
+  // The fan must lie in one plane or two planes meeting at a crease
+  s.normals.resize(s.tris.size());
+  Vector3D n0, n1;
+  bool crease = false;
+
+  for (unsigned i = 0; i < s.tris.size(); i++) {
+    Vector3D n = getNormal(s.tris[i], v, v).normalize();
+    if (!n.isReal()) return false;
+    s.normals[i] = n;
+
+    if (!i) n0 = n;
+    else if (1 - tolerance <= n.dot(n0)) continue;
+    else if (!crease) {n1 = n; crease = true;}
+    else if (n.dot(n1) < 1 - tolerance) return false;
+  }
+
+  Vector3D creaseDir = crease ? n0.cross(n1).normalize() : Vector3D();
+
+  // Choose the neighbor with the fewest neighbors
+  uint32_t best = none;
+  unsigned bestRing = numeric_limits<unsigned>::max();
+
+  for (unsigned i = 0; i < s.ring.size(); i++) {
+    uint32_t u = s.ring[i];
+
+    // On a crease, only collapse along the crease
+    if (crease) {
+      Vector3D dir = (mesh.getVertex(u) - mesh.getVertex(v)).normalize();
+      if (fabs(dir.dot(creaseDir)) < 1 - tolerance) continue;
+    }
+
+    // Keep the mesh manifold
+    gather(u, s.uTris);
+    getRing(u, s.uTris, s.uRing);
+    if (countCommon(s.ring, s.uRing) != 2) continue;
+    if (bestRing <= s.uRing.size()) continue;
+
+    // Remaining triangles must keep their orientation and plane
+    bool ok = true;
+    for (unsigned j = 0; j < s.tris.size() && ok; j++) {
+      const uint32_t *t = &mesh.indices[s.tris[j] * 3];
+      if (t[0] == u || t[1] == u || t[2] == u) continue;
+
+      Vector3D n = getNormal(s.tris[j], v, u).normalize();
+      if (!n.isReal() || n.dot(s.normals[j]) < 1 - tolerance) ok = false;
+    }
+
+    if (ok) {
+      best = u;
+      bestRing = s.uRing.size();
+    }
+  }
+
+  if (best == none) return false;
+
+  // Collapse
+  for (unsigned i = 0; i < s.tris.size(); i++) {
+    uint32_t *t = &mesh.indices[s.tris[i] * 3];
+
+    if (t[0] == best || t[1] == best || t[2] == best)
+      deletedTriangle[s.tris[i]] = 1;
+
+    else
+      for (unsigned j = 0; j < 3; j++)
+        if (t[j] == v) t[j] = best;
+  }
+
+  deletedVertex[v] = 1;
+  chain[tail[best]] = v;
+  tail[best] = tail[v];
+
+  return true;
+}
+
+
+void MeshReducer::compact() {
+  vector<uint32_t> remap(mesh.getVertexCount(), none);
+  IndexedMesh result;
+
+  for (unsigned i = 0; i < mesh.getTriangleCount(); i++) {
+    if (deletedTriangle[i]) continue;
+
+    for (unsigned j = 0; j < 3; j++) {
+      uint32_t v = mesh.indices[i * 3 + j];
+
+      if (remap[v] == none) {
+        remap[v] = result.xs.size();
+        result.xs.push_back(mesh.xs[v]);
+        result.ys.push_back(mesh.ys[v]);
+        result.zs.push_back(mesh.zs[v]);
+      }
+
+      result.indices.push_back(remap[v]);
+    }
+  }
+
+  swap(mesh.xs, result.xs);
+  swap(mesh.ys, result.ys);
+  swap(mesh.zs, result.zs);
+  swap(mesh.indices, result.indices);
+}
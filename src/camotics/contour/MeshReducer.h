@@ -0,0 +1,87 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/geom/Vector.h>
+
+#include <vector>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  class IndexedMesh;
+  class Task;
+
+  // Simplifies an IndexedMesh by collapsing vertices onto a neighbor where
+  // this does not change the shape of the surface, i.e. vertices inside
+  // flat regions or on straight creases between two flat regions.
+  //
+  // The mesh is split in to slabs along its longest axis which are reduced
+  // in parallel.  A vertex is only collapsed in parallel if all of its
+  // neighbors are in the same slab.  Collapses then only touch triangles
+  // owned by one slab.  The remaining vertices along slab borders are
+  // stitched in a final serial pass.
+  class MeshReducer {
+    IndexedMesh &mesh;
+    double tolerance;
+
+    // Vertex to triangle lists, in compressed row format
+    std::vector<uint32_t> triOffsets;
+    std::vector<uint32_t> triList;
+
+    // Vertices collapsed into a vertex are chained so their triangle lists
+    // are still reachable
+    std::vector<uint32_t> chain;
+    std::vector<uint32_t> tail;
+
+    std::vector<uint8_t> deletedVertex;
+    std::vector<uint8_t> deletedTriangle;
+
+    std::vector<uint32_t> partition;
+    std::vector<uint32_t> partOffsets;
+    std::vector<uint32_t> partVertices;
+
+    struct Scratch {
+      std::vector<uint32_t> tris;
+      std::vector<uint32_t> ring;
+      std::vector<uint32_t> uTris;
+      std::vector<uint32_t> uRing;
+      std::vector<cb::Vector3D> normals;
+      std::vector<uint32_t> border; // Vertices left for the stitch pass
+    };
+
+  public:
+    MeshReducer(IndexedMesh &mesh, double tolerance = 0.0001);
+
+    // Runs on the shared ThreadPool, returns the number of collapsed vertices
+    unsigned reduce(Task &task);
+
+  protected:
+    void build(unsigned partitions);
+    unsigned reducePartition(Task &task, unsigned part, Scratch &s);
+    void gather(uint32_t v, std::vector<uint32_t> &tris) const;
+    bool getRing(uint32_t v, const std::vector<uint32_t> &tris,
+                 std::vector<uint32_t> &ring) const;
+    cb::Vector3D getNormal(uint32_t tri, uint32_t v, uint32_t u) const;
+    bool collapse(uint32_t v, int part, Scratch &s);
+    void compact();
+  };
+}
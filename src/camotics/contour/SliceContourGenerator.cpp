@@ -20,6 +20,9 @@
 
 #include "SliceContourGenerator.h"
 #include "TriangleSurface.h"
+#include "GridBlocks.h"
+
+#include <cbang/log/Logger.h>
 
 using namespace cb;
 using namespace CAMotics;
@@ -32,7 +35,17 @@ void SliceContourGenerator::run(FieldFunction &func, GridTreeRef &grid) {
 
   // Compute slices
   const Vector3U &steps = grid.getSteps();
-  CubeSlice slice(grid);
+  // Classify blocks first so only the region near the surface is sampled
+  GridBlocks blocks(grid);
+  blocks.classify(func);
+
+  LOG_DEBUG(4, "Sampling " << blocks.getCount(FieldFunction::BLOCK_SURFACE)
+            << " of " << blocks.getTotal() << " blocks, skipped "
+            << blocks.getCount(FieldFunction::BLOCK_UNCUT) << " uncut "
+            << blocks.getCount(FieldFunction::BLOCK_AIR) << " air "
+            << blocks.getCount(FieldFunction::BLOCK_SOLID) << " solid");
+
+  CubeSlice slice(grid, blocks, needsNormals());
   double resolution = grid.getResolution();
   Vector3D p;
 
@@ -51,7 +64,8 @@ void SliceContourGenerator::run(FieldFunction &func, GridTreeRef &grid) {
       for (unsigned x = 0; x < steps.x(); x++) {
         p.x() = grid.getOffset().x() + resolution * x;
 
-        if (!func.cull(p, resolution * 1.1)) doCell(grid, slice, x, y);
+        if (blocks.isSurface(x, y, z) && !func.cull(p, resolution * 1.1))
+          doCell(grid, slice, x, y);
 
         // Progress
         if ((++completedCells & 7) == 0 &&
@@ -29,6 +29,7 @@
 namespace CAMotics {
   class SliceContourGenerator : public ContourGenerator {
   public:
+    virtual bool needsNormals() const {return false;}
     virtual void doSlice(FieldFunction &func, const CubeSlice &slice,
                          unsigned z) {}
     virtual void doCell(GridTreeRef &tree, const CubeSlice &slice, unsigned x,
@@ -20,12 +20,15 @@
 
 #pragma once
 
+#include "ReduceMode.h"
+
 #include <cbang/geom/Rectangle.h>
 #include <cbang/io/OutputSink.h>
 #include <cbang/json/Serializable.h>
 
 #include <functional>
 #include <vector>
+#include <cinttypes>
 
 
 namespace STL {class Sink;}
@@ -38,13 +41,18 @@ namespace CAMotics {
     virtual ~Surface() {}
 
     virtual cb::SmartPointer<Surface> copy() const = 0;
+    virtual uint64_t getVertexCount() const = 0;
     virtual uint64_t getTriangleCount() const = 0;
     virtual cb::Rectangle3D getBounds() const = 0;
+    // Vertices and normals are per shared vertex, three indices per triangle
     typedef std::function<void (const std::vector<float> &vertices,
-                                const std::vector<float> &normals)> vert_cb_t;
+                                const std::vector<float> &normals,
+                                const std::vector<uint32_t> &indices)>
+    vert_cb_t;
     virtual void getVertices(vert_cb_t cb) const = 0;
     virtual void write(STL::Sink &sink, Task *task = 0) const = 0;
-    virtual void reduce(Task &task) = 0;
+    virtual void reduce(Task &task,
+                        ReduceMode mode = ReduceMode::HASH_MODE) = 0;
 
     void writeSTL(const cb::OutputSink &sink, bool binary,
                   const std::string &name, const std::string &hash) const;
@@ -19,6 +19,8 @@
 \******************************************************************************/
 
 #include "TriangleMesh.h"
+#include "IndexedMesh.h"
+#include "MeshReducer.h"
 
 #include <camotics/Task.h>
 
@@ -34,7 +36,19 @@ using namespace CAMotics;
 
 
 TriangleMesh::TriangleMesh(const TriangleMesh &o) :
-  vertices(o.vertices), normals(o.normals) {}
+  vertices(o.vertices), normals(o.normals), indices(o.indices) {}
+
+
+Vector3F TriangleMesh::getVertex(unsigned i) const {
+  return Vector3F(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+}
+
+
+Vector3F TriangleMesh::getFaceNormal(unsigned triangle) const {
+  Vector3F v[3];
+  for (unsigned i = 0; i < 3; i++) v[i] = getVertex(indices[triangle * 3 + i]);
+  return (v[1] - v[0]).cross(v[2] - v[0]).normalize();
+}
 
 
 void TriangleMesh::Vertex::set(const Vector3D &v) {
@@ -178,7 +192,65 @@ void TriangleMesh::weld(Task &task, float threshold) {
 }
 
 
-void TriangleMesh::reduce(Task &task) {
+void TriangleMesh::reduce(Task &task, ReduceMode mode) {
+  switch (mode) {
+  case ReduceMode::HASH_MODE: unindex(); reduceHash(task); break;
+  case ReduceMode::MAP_MODE: unindex(); weld(task); reduceMap(task); break;
+  default: THROW("Invalid reduce mode " << mode);
+  }
+
+  // Reduced meshes have large flat faces which must not share normals
+  reindex();
+}
+
+
+void TriangleMesh::unindex() {
+  vector<float> vertices;
+  vector<float> normals;
+
+  vertices.reserve(indices.size() * 3);
+  normals.reserve(indices.size() * 3);
+
+  for (unsigned i = 0; i < getTriangleCount(); i++) {
+    Vector3F normal = getFaceNormal(i);
+
+    for (unsigned j = 0; j < 3; j++) {
+      Vector3F v = getVertex(indices[i * 3 + j]);
+
+      for (unsigned k = 0; k < 3; k++) {
+        vertices.push_back(v[k]);
+        normals.push_back(normal[k]);
+      }
+    }
+  }
+
+  this->vertices.swap(vertices);
+  this->normals.swap(normals);
+  reindex();
+}
+
+
+void TriangleMesh::reindex() {
+  indices.resize(getVertexCount());
+  for (unsigned i = 0; i < indices.size(); i++) indices[i] = i;
+}
+
+
+void TriangleMesh::reduceHash(Task &task) {
+  task.begin("Reducing mesh: welding vertices");
+
+  IndexedMesh mesh;
+  mesh.weld(vertices);
+
+  MeshReducer(mesh).reduce(task);
+  if (task.shouldQuit()) return;
+
+  task.begin("Reducing mesh: reconstructing");
+  mesh.getTriangles(vertices, normals);
+}
+
+
+void TriangleMesh::reduceMap(Task &task) {
   unsigned count = getTriangleCount();
 
   // Build triangles and find unique vertices
@@ -20,11 +20,14 @@
 
 #pragma once
 
+#include "ReduceMode.h"
+
 #include <cbang/geom/Vector.h>
 
 #include <vector>
 #include <set>
 #include <limits>
+#include <cinttypes>
 
 
 namespace CAMotics {
@@ -76,20 +79,29 @@ namespace CAMotics {
     };
 
   protected:
-    std::vector<float> vertices;
-    std::vector<float> normals;
+    std::vector<float> vertices; // Shared vertex positions
+    std::vector<float> normals;  // One per vertex
+    std::vector<uint32_t> indices;
 
   public:
     TriangleMesh() {}
     TriangleMesh(const TriangleMesh &o);
 
-    unsigned getTriangleCount() const {return vertices.size() / 9;}
+    unsigned getVertexCount() const {return vertices.size() / 3;}
+    unsigned getTriangleCount() const {return indices.size() / 3;}
+
+    cb::Vector3F getVertex(unsigned i) const;
+    cb::Vector3F getFaceNormal(unsigned triangle) const;
 
     void weld(Task &task,
               float threshold = std::numeric_limits<float>::epsilon() * 10);
-    void reduce(Task &task);
+    void reduce(Task &task, ReduceMode mode = ReduceMode::HASH_MODE);
 
   protected:
+    void unindex(); // One vertex per corner with face normals
+    void reindex(); // Index vertices in order
+    void reduceHash(Task &task);
+    void reduceMap(Task &task);
     static bool moreThan2InCommon(VertexSet &vs1, VertexSet &vs2);
   };
 }
@@ -22,6 +22,7 @@
 
 #include "TriangleMesh.h"
 #include "GridTree.h"
+#include "VertexIndex.h"
 
 #include <cbang/Exception.h>
 #include <cbang/log/Logger.h>
@@ -51,6 +52,10 @@ TriangleSurface::TriangleSurface(vector<SmartPointer<Surface> > &surfaces) {
     if (!s) THROW("Expected an TriangleSurface");
 
     // Copy surface data
+    uint32_t offset = getVertexCount();
+    for (unsigned j = 0; j < s->indices.size(); j++)
+      indices.push_back(s->indices[j] + offset);
+
     vertices.insert(vertices.end(), s->vertices.begin(), s->vertices.end());
     normals.insert(normals.end(), s->normals.begin(), s->normals.end());
     bounds.add(s->bounds);
@@ -64,6 +69,28 @@ TriangleSurface::TriangleSurface(const TriangleSurface &o) :
   TriangleMesh(o), bounds(o.bounds) {}
 
 
+// Takes ownership of the vertex, normal and index data by swapping
+TriangleSurface::TriangleSurface(vector<float> &vertices,
+                                 vector<float> &normals,
+                                 vector<uint32_t> &indices) {
+  if (vertices.size() != normals.size() || vertices.size() % 3 ||
+      indices.size() % 3)
+    THROW("Invalid triangle surface data");
+
+  for (unsigned i = 0; i < indices.size(); i++)
+    if (vertices.size() / 3 <= indices[i])
+      THROW("Triangle surface index out of range");
+
+  this->vertices.swap(vertices);
+  this->normals.swap(normals);
+  this->indices.swap(indices);
+
+  for (unsigned i = 0; i < this->vertices.size(); i += 3)
+    bounds.add(Vector3F(this->vertices[i], this->vertices[i + 1],
+                        this->vertices[i + 2]));
+}
+
+
 void TriangleSurface::add(const Vector3F vertices[3]) {
   // Compute face normal
   Vector3F normal =
@@ -82,6 +109,7 @@ void TriangleSurface::add(const Vector3F vertices[3]) {
 void TriangleSurface::add(const Vector3F vertices[3], const Vector3F &normal) {
   for (unsigned i = 0; i < 3; i++) {
     bounds.add(vertices[i]);
+    indices.push_back(getVertexCount());
 
     for (unsigned j = 0; j < 3; j++) {
       this->vertices.push_back(vertices[i][j]);
@@ -92,9 +120,11 @@ void TriangleSurface::add(const Vector3F vertices[3], const Vector3F &normal) {
 
 
 void TriangleSurface::add(const GridTree &tree) {
-  unsigned start = getTriangleCount();
+  unsigned start = vertices.size();
 
-  tree.gather(vertices, normals);
+  VertexIndex index(vertices, normals, indices);
+  tree.gather(index);
+  index.finish();
 
   for (unsigned i = start; i < vertices.size(); i += 3)
     bounds.add(Vector3F(vertices[i], vertices[i + 1], vertices[i + 2]));
@@ -104,6 +134,7 @@ void TriangleSurface::add(const GridTree &tree) {
 void TriangleSurface::clear() {
   vertices.clear();
   normals.clear();
+  indices.clear();
 
   bounds = Rectangle3D();
 }
@@ -150,7 +181,9 @@ SmartPointer<Surface> TriangleSurface::copy() const {
 }
 
 
-void TriangleSurface::getVertices(vert_cb_t cb) const {cb(vertices, normals);}
+void TriangleSurface::getVertices(vert_cb_t cb) const {
+  cb(vertices, normals, indices);
+}
 
 
 void TriangleSurface::write(STL::Sink &sink, Task *task) const {
@@ -160,30 +193,23 @@ void TriangleSurface::write(STL::Sink &sink, Task *task) const {
 
   for (unsigned i = 0; i < getTriangleCount() &&
          (!task || !task->shouldQuit()); i++) {
-    unsigned offset = i * 9;
-
-    // In an STL file, there's only one normal per facet.
-    // They are the same anyway.
-    Vector3F normal =
-      Vector3F(normals[offset + 0], normals[offset + 1], normals[offset + 2]);
+    // In an STL file, there's only one normal per facet.  Vertex normals
+    // may be shared with other facets so use the face normal.
+    for (unsigned j = 0; j < 3; j++) p[j] = getVertex(indices[i * 3 + j]);
 
-    for (unsigned j = 0; j < 3; j++)
-      for (unsigned k = 0; k < 3; k++)
-        p[j][k] = vertices[offset + j * 3 + k];
-
-    sink.writeFacet(p[0], p[1], p[2], normal);
+    sink.writeFacet(p[0], p[1], p[2], getFaceNormal(i));
 
     if (task) task->update((double)i / getTriangleCount());
   }
 }
 
 
-void TriangleSurface::reduce(Task &task) {
-  weld(task);
-  TriangleMesh::reduce(task);
+void TriangleSurface::reduce(Task &task, ReduceMode mode) {
+  TriangleMesh::reduce(task, mode);
 }
 
 
+// JSON surfaces are unindexed with one normal per triangle
 void TriangleSurface::read(const JSON::Value &value) {
   if (value.hasList("vertices")) {
     vertices.clear();
@@ -197,13 +223,33 @@ void TriangleSurface::read(const JSON::Value &value) {
       if (n % 3 == 0)
         bounds.add(Vector3D(vertices[n - 3], vertices[n - 2], vertices[n - 1]));
     }
+
+    vertices.resize(vertices.size() - vertices.size() % 9);
+    reindex();
   }
 
+  normals.clear();
+
   if (value.hasList("normals")) {
-    normals.clear();
     auto l = value.get("normals");
-    for (unsigned i = 0; i < l->size(); i++)
-      normals.push_back(l->getNumber(i));
+
+    if (l->size() == getTriangleCount() * 3)
+      for (unsigned i = 0; i < l->size(); i += 3)
+        for (unsigned j = 0; j < 3; j++)
+          for (unsigned k = 0; k < 3; k++)
+            normals.push_back(l->getNumber(i + k));
+  }
+
+  if (normals.size() != vertices.size()) {
+    normals.clear();
+
+    for (unsigned i = 0; i < getTriangleCount(); i++) {
+      Vector3F normal = getFaceNormal(i);
+
+      for (unsigned j = 0; j < 3; j++)
+        for (unsigned k = 0; k < 3; k++)
+          normals.push_back(normal[k]);
+    }
   }
 }
 
@@ -212,15 +258,18 @@ void TriangleSurface::write(JSON::Sink &sink) const {
   sink.beginDict();
 
   sink.insertList("vertices");
-  for (unsigned i = 0; i < vertices.size(); i++)
-    sink.append(vertices[i]);
+  for (unsigned i = 0; i < indices.size(); i++)
+    for (unsigned j = 0; j < 3; j++)
+      sink.append(vertices[indices[i] * 3 + j]);
   sink.endList();
 
-  // Only output every third normal since they are the same for a triangle.
+  // Only output one normal per triangle
   sink.insertList("normals");
-  for (unsigned i = 0; i < normals.size() / 9; i++)
+  for (unsigned i = 0; i < getTriangleCount(); i++) {
+    Vector3F normal = getFaceNormal(i);
     for (unsigned j = 0; j < 3; j++)
-      sink.append(normals[i * 9 + j]);
+      sink.append(normal[j]);
+  }
   sink.endList();
 
   sink.endDict();
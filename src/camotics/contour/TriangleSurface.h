@@ -44,6 +44,8 @@ namespace CAMotics {
     TriangleSurface(STL::Source &source, Task *task = 0);
     TriangleSurface(std::vector<cb::SmartPointer<Surface> > &surfaces);
     TriangleSurface(const TriangleSurface &o);
+    TriangleSurface(std::vector<float> &vertices, std::vector<float> &normals,
+                    std::vector<uint32_t> &indices);
 
     void add(const cb::Vector3F vertices[3]);
     void add(const cb::Vector3F vertices[3], const cb::Vector3F &normal);
@@ -54,11 +56,12 @@ namespace CAMotics {
 
     // From Surface
     cb::SmartPointer<Surface> copy() const;
+    uint64_t getVertexCount() const {return TriangleMesh::getVertexCount();}
     uint64_t getTriangleCount() const {return TriangleMesh::getTriangleCount();}
     cb::Rectangle3D getBounds() const {return bounds;}
     void getVertices(vert_cb_t cb) const;
     void write(STL::Sink &sink, Task *task = 0) const;
-    void reduce(Task &task);
+    void reduce(Task &task, ReduceMode mode);
 
     // From cb::JSON::Serializable
     void read(const cb::JSON::Value &value);
@@ -0,0 +1,92 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+#include "VertexIndex.h"
+
+#include <cbang/Exception.h>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+VertexIndex::VertexIndex(vector<float> &vertices, vector<float> &normals,
+                         vector<uint32_t> &indices) :
+  vertices(vertices), normals(normals), indices(indices),
+  start(vertices.size() / 3), indexStart(indices.size()) {
+  if (vertices.size() != normals.size())
+    THROW("Number of vertices not equal to number of normals");
+}
+
+
+uint32_t VertexIndex::get(const Vector3U &point, unsigned axis,
+                          const Vector3F &vertex, bool owner) {
+  auto result = index.insert(make_pair(Key(point, axis), vertices.size() / 3));
+  uint32_t i = result.first->second;
+
+  if (result.second) {
+    for (unsigned j = 0; j < 3; j++) {
+      vertices.push_back(vertex[j]);
+      normals.push_back(0);
+    }
+
+    owned.push_back(owner);
+
+  } else if (owner && !owned[i - start]) {
+    for (unsigned j = 0; j < 3; j++) vertices[i * 3 + j] = vertex[j];
+    owned[i - start] = true;
+  }
+
+  return i;
+}
+
+
+void VertexIndex::add(const uint32_t triangle[3]) {
+  for (unsigned i = 0; i < 3; i++) indices.push_back(triangle[i]);
+}
+
+
+void VertexIndex::finish() {
+  // Sum face normals, unnormalized so larger faces have more weight
+  for (unsigned i = indexStart; i + 2 < indices.size(); i += 3) {
+    Vector3F v[3];
+    for (unsigned j = 0; j < 3; j++)
+      v[j] = Vector3F(vertices[indices[i + j] * 3 + 0],
+                      vertices[indices[i + j] * 3 + 1],
+                      vertices[indices[i + j] * 3 + 2]);
+
+    Vector3F normal = (v[1] - v[0]).cross(v[2] - v[0]);
+
+    for (unsigned j = 0; j < 3; j++)
+      for (unsigned k = 0; k < 3; k++)
+        normals[indices[i + j] * 3 + k] += normal[k];
+  }
+
+  for (unsigned i = start * 3; i < normals.size(); i += 3) {
+    Vector3F n(normals[i], normals[i + 1], normals[i + 2]);
+
+    double length = n.length();
+    if (!length) continue; // Faces cancel out, leave zero
+
+    for (unsigned j = 0; j < 3; j++) normals[i + j] = n[j] / length;
+  }
+
+  index.clear();
+  owned.clear();
+}
@@ -0,0 +1,75 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+#pragma once
+
+#include <cbang/geom/Vector.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // Shares one vertex between all the cells which use the same grid edge.
+  // Vertices are keyed by the grid point the edge starts at, in root grid
+  // coordinates, and the edge axis.  Axis 3 is for vertices inside a cell.
+  // A position given by a non-owner is replaced by the owner's when it comes.
+  // finish() computes vertex normals from the adjacent faces.
+  class VertexIndex {
+    struct Key {
+      cb::Vector3U point;
+      unsigned axis;
+
+      Key(const cb::Vector3U &point, unsigned axis) :
+        point(point), axis(axis) {}
+
+      bool operator==(const Key &o) const {
+        return axis == o.axis && point == o.point;
+      }
+    };
+
+
+    struct KeyHash {
+      size_t operator()(const Key &k) const {
+        return (size_t)k.point.x() * 73856093 ^
+          (size_t)k.point.y() * 19349663 ^ (size_t)k.point.z() * 83492791 ^
+          (size_t)k.axis;
+      }
+    };
+
+    std::vector<float> &vertices;
+    std::vector<float> &normals;
+    std::vector<uint32_t> &indices;
+    unsigned start;
+    unsigned indexStart;
+    std::vector<bool> owned;
+
+    std::unordered_map<Key, uint32_t, KeyHash> index;
+
+  public:
+    VertexIndex(std::vector<float> &vertices, std::vector<float> &normals,
+                std::vector<uint32_t> &indices);
+
+    uint32_t get(const cb::Vector3U &point, unsigned axis,
+                 const cb::Vector3F &vertex, bool owner = true);
+    void add(const uint32_t triangle[3]);
+    void finish();
+  };
+}
@@ -27,8 +27,8 @@ using namespace cb;
 using namespace CAMotics;
 
 
-VertexSlice::VertexSlice(const GridTreeRef &grid, unsigned z) :
-  grid(grid), z(z) {}
+VertexSlice::VertexSlice(const GridTreeRef &grid, const GridBlocks &blocks,
+                         unsigned z) : grid(grid), blocks(blocks), z(z) {}
 
 
 void VertexSlice::compute(FieldFunction &func) {
@@ -40,13 +40,30 @@ void VertexSlice::compute(FieldFunction &func) {
   double resolution = grid.getResolution();
   Vector3D p = Vector3D(0, 0, grid.getOffset().z() + resolution * z);
 
-  for (unsigned x = 0; x <= steps.x(); x++) {
-    p.x() = grid.getOffset().x() + resolution * x;
+  // Compute unculled points one row at a time
+  vector<double> xs(steps.x() + 1);
+  vector<double> depths(steps.x() + 1);
+  vector<unsigned> index(steps.x() + 1);
 
-    for (unsigned y = 0; y <= steps.y(); y++) {
-      p.y() = grid.getOffset().y() + resolution * y;
+  for (unsigned y = 0; y <= steps.y(); y++) {
+    p.y() = grid.getOffset().y() + resolution * y;
+    unsigned n = 0;
 
-      if (!func.cull(p, 2.1 * resolution)) at(x).at(y) = func.depth(p);
+    for (unsigned x = 0; x <= steps.x(); x++) {
+      p.x() = grid.getOffset().x() + resolution * x;
+
+      if (blocks.isSurface(x, y, z) && !func.cull(p, 2.1 * resolution)) {
+        xs[n] = p.x();
+        index[n++] = x;
+
+      } else if (blocks.isSolid(x, y, z))
+        at(x)[y] = numeric_limits<double>::max();
     }
+
+    if (!n) continue;
+
+    func.depth(&xs[0], p.y(), p.z(), n, &depths[0]);
+
+    for (unsigned i = 0; i < n; i++) at(index[i])[y] = depths[i];
   }
 }
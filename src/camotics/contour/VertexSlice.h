@@ -23,6 +23,7 @@
 
 #include "FieldFunction.h"
 #include "GridTreeRef.h"
+#include "GridBlocks.h"
 
 #include <vector>
 
@@ -30,10 +31,12 @@
 namespace CAMotics {
   class VertexSlice : public std::vector<std::vector<double> > {
     const GridTreeRef &grid;
+    const GridBlocks &blocks;
     unsigned z;
 
   public:
-    VertexSlice(const GridTreeRef &grid, unsigned z);
+    VertexSlice(const GridTreeRef &grid, const GridBlocks &blocks,
+                unsigned z);
 
     double depth(unsigned x, unsigned y) const {return at(x).at(y);}
 
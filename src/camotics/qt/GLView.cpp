@@ -203,7 +203,7 @@ void GLView::paintGL() {
       auto &path = *getView().path->getPath();
 
       if (selectedMove < path.size()) {
-        auto &move = path.at(selectedMove);
+        const auto &move = path.at(selectedMove);
 
         if (move.getFilename().isSet()) {
           getView().path->setByMove(selectedMove);
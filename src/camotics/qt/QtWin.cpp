@@ -748,8 +748,9 @@ void QtWin::loadToolPath(const SmartPointer<GCode::ToolPath> &toolPath,
                  project->getResolution(), view->getTime(),
                  mode, options["threads"].toInteger());
 
-  // Load new surface
-  taskMan.addTask(new SurfaceTask(sim));
+  // Load new surface, re-rendering only what changed if possible
+  if (simRun.isSet()) taskMan.addTask(new SurfaceTask(simRun, sim));
+  else taskMan.addTask(new SurfaceTask(sim));
 }
 
 
@@ -854,12 +855,16 @@ void QtWin::reload(bool now) {
   ui->console->setTextColor(QColor("#d9d9d9"));
 
   try {
-    // Queue tool path task
+    // Queue tool path task, without the planner the machine limits are still
+    // used to time the moves
+    const GCode::PlannerConfig &machine = settingsDialog.getPlannerConfig();
     const GCode::PlannerConfig *config = 0;
-    if (settingsDialog.getPlannerEnabled())
-      config = &settingsDialog.getPlannerConfig();
+    if (settingsDialog.getPlannerEnabled()) config = &machine;
 
-    taskMan.addTask(new ToolPathTask(*project, config));
+    SmartPointer<ToolPathTask> task =
+      new ToolPathTask(*project, config, 0, &machine);
+    task->setCache(settingsDialog.getPathCacheEnabled());
+    taskMan.addTask(task);
     setStatusActive(true);
   } CATCH_ERROR;
 }
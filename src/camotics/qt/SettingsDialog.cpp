@@ -73,6 +73,11 @@ void SettingsDialog::setPlannerEnabled(bool enabled) {
 }
 
 
+bool SettingsDialog::getPathCacheEnabled() const {
+  return settings.get("Settings/PathCache", 0).toInt();
+}
+
+
 void SettingsDialog::loadPlanVec(const string &widget, const string &var,
                                  GCode::Axes &axes, double scale) {
   auto v = settings.getVector3D("Settings/" + var, axes.getXYZ() / scale);
@@ -152,6 +157,8 @@ void SettingsDialog::load(Project::Project &project, View &view) {
   ui.aabbCheckBox->setChecked(view.isFlagSet(View::SHOW_BBTREE_FLAG));
   ui.aabbLeavesCheckBox->setChecked(view.isFlagSet(View::BBTREE_LEAVES_FLAG));
 
+  ui.pathCacheCheckBox->setChecked(getPathCacheEnabled());
+
   loadPlanConfig();
 }
 
@@ -176,6 +183,8 @@ void SettingsDialog::save(Project::Project &project, View &view) {
   view.setFlag(View::SHOW_BBTREE_FLAG, ui.aabbCheckBox->isChecked());
   view.setFlag(View::BBTREE_LEAVES_FLAG, ui.aabbLeavesCheckBox->isChecked());
 
+  settings.set("Settings/PathCache", (int)ui.pathCacheCheckBox->isChecked());
+
   savePlanConfig();
 }
 
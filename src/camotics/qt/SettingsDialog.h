@@ -60,6 +60,8 @@ namespace CAMotics {
     bool getPlannerEnabled() const;
     void setPlannerEnabled(bool enabled);
 
+    bool getPathCacheEnabled() const;
+
     void loadPlanVec(const std::string &widget, const std::string &var,
                      GCode::Axes &vec, double scale = 1);
     void savePlanVec(const std::string &widget, const std::string &var,
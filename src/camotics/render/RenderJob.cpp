@@ -23,6 +23,7 @@
 #include <camotics/contour/MarchingCubes.h>
 #include <camotics/contour/CorrectedMC33.h>
 #include <camotics/contour/CubicalMarchingSquares.h>
+#include <camotics/contour/DualContouring.h>
 
 #include <cbang/Exception.h>
 #include <cbang/time/Timer.h>
@@ -32,12 +33,13 @@ using namespace cb;
 using namespace CAMotics;
 
 
-RenderJob::RenderJob(Condition &condition, FieldFunction &func, RenderMode mode,
-                     GridTreeRef &tree) :
-  condition(condition), func(func), tree(tree) {
+RenderJob::RenderJob(FieldFunction &func, RenderMode mode,
+                     const GridTreeRef &tree) : func(func), tree(tree) {
   switch (mode) {
   case RenderMode::MCUBES_MODE: generator = new MarchingCubes;          break;
   case RenderMode::CMS_MODE:    generator = new CubicalMarchingSquares; break;
+  case RenderMode::MC33_MODE:   generator = new CorrectedMC33;          break;
+  case RenderMode::DC_MODE:     generator = new DualContouring;         break;
   default: THROW("Invalid or unsupported render mode " << mode);
   }
 }
@@ -47,8 +49,6 @@ void RenderJob::run() {
   try {
     generator->run(func, tree);
   } CATCH_WARNING;
-
-  condition.signal();
 }
 
 
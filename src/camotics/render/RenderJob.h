@@ -26,25 +26,20 @@
 #include <camotics/contour/ContourGenerator.h>
 #include <camotics/contour/GridTreeRef.h>
 
-#include <cbang/os/Thread.h>
-#include <cbang/os/Condition.h>
-
 
 namespace CAMotics {
-  class RenderJob : public cb::Thread {
-    cb::Condition &condition;
+  class RenderJob {
     cb::SmartPointer<ContourGenerator> generator;
 
     FieldFunction &func;
-    GridTreeRef &tree;
+    GridTreeRef tree;
 
   public:
-    RenderJob(cb::Condition &condition, FieldFunction &func, RenderMode mode,
-              GridTreeRef &tree);
+    RenderJob(FieldFunction &func, RenderMode mode, const GridTreeRef &tree);
 
     double getProgress() {return generator->getProgress();}
+    unsigned getCells() const {return tree.getTotalCells();}
 
-    // From Thread
     void run();
     void stop();
   };
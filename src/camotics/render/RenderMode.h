@@ -32,5 +32,7 @@
 
 CBANG_ENUM(MCUBES_MODE)
 CBANG_ENUM(CMS_MODE)
+CBANG_ENUM(MC33_MODE)
+CBANG_ENUM(DC_MODE)
 
 #endif // CBANG_ENUM_EXPAND
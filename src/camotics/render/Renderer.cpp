@@ -22,7 +22,9 @@
 
 #include "RenderJob.h"
 
-#include <camotics/Grid.h>
+#include <camotics/ThreadPool.h>
+#include <camotics/contour/GridTree.h>
+#include <camotics/contour/GridTreeRef.h>
 #include <camotics/sim/CutWorkpiece.h>
 
 #include <cbang/String.h>
@@ -32,14 +34,19 @@
 #include <cbang/util/SmartLock.h>
 #include <cbang/Catch.h>
 
-#include <cmath>
-#include <list>
+#include <algorithm>
 
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
 
 
+namespace {
+  const unsigned jobsPerThread = 64;
+  const unsigned minJobCells = 16 * 16 * 16;
+}
+
+
 void Renderer::render(CutWorkpiece &cutWorkpiece, GridTree &tree,
                       const Rectangle3D &bbox, unsigned threads,
                       RenderMode mode) {
@@ -50,57 +57,43 @@ void Renderer::render(CutWorkpiece &cutWorkpiece, GridTree &tree,
     return;
   }
 
-  typedef list<SmartPointer<RenderJob> > jobs_t;
-  jobs_t jobs;
-  vector<GridTreeRef> jobGrids;
+  if (tree.isEmpty() || !bbox.intersects(bounds)) return;
+
+  ThreadPool &pool = ThreadPool::instance();
+  if (!threads) threads = pool.getThreads();
+  pool.reserve(threads);
 
   try {
     SmartLock lock(this);
 
-    // Divide work
-    unsigned targetJobCount = pow(2, ceil(log(threads) / log(2)) + 2);
+    this->cutWorkpiece = &cutWorkpiece;
+    this->mode = mode;
+    this->bbox = bbox;
+    this->threads = threads;
+    inFlight = 0;
+    pending.clear();
+    outstanding = 0;
+    completedCells = 0;
+    quit = false;
+
+    // Split regions which are not culled until jobs are about this size
+    totalCells = tree.getRef(bbox).getTotalCells();
+    minCells = std::max((double)minJobCells,
+                        totalCells / (threads * jobsPerThread));
 
-    task.begin("Partitioning 3D space");
-    tree.partition(jobGrids, bbox, targetJobCount);
-    unsigned totalJobCount = jobGrids.size();
-
-    LOG_DEBUG(1, "Partitioned in to " << totalJobCount << " jobs");
     LOG_INFO(1, "Computing surface bounded by " << bounds << " at "
              << tree.getResolution() << " grid resolution");
 
     // Run jobs
     double lastUpdate = 0;
     task.begin("Computing cut surface");
-    while (!task.shouldQuit() && !(jobGrids.empty() && jobs.empty())) {
-      // Start new jobs
-      while (!jobGrids.empty() && jobs.size() < threads) {
-        SmartPointer<RenderJob> job =
-          new RenderJob(*this, cutWorkpiece, mode, jobGrids.back());
-        job->start();
-        jobs.push_back(job);
-        jobGrids.pop_back();
-      }
-
-      // Reap completed jobs
-      jobs_t::iterator it;
-      for (it = jobs.begin(); it != jobs.end() && !task.shouldQuit();)
-        if ((*it)->getState() == Thread::THREAD_DONE) {
-          (*it)->join();
-          it = jobs.erase(it);
-        } else it++;
+    add(&tree, -1);
 
+    while (outstanding) {
+      if (task.shouldQuit()) break;
 
       // Update Progress
-      double progress = 0;
-
-      // Add running jobs
-      for (it = jobs.begin(); it != jobs.end() && !task.shouldQuit(); it++)
-        progress += (*it)->getProgress();
-
-      // Add completed jobs
-      progress += totalJobCount - jobGrids.size() - jobs.size();
-      progress /= totalJobCount;
-
+      double progress = getProgress();
       task.update(progress);
 
       // Log progress
@@ -112,12 +105,129 @@ void Renderer::render(CutWorkpiece &cutWorkpiece, GridTree &tree,
                  << " ETA: " << TimeInterval(task.getETA()));
       }
 
-      // Wait
-      timedWait(0.1);
+      // Wait for a job to complete or the next progress update
+      timedWait(0.25);
     }
   } CATCH_ERROR;
 
-  // Clean up remaining jobs in case of an early exit
-  for (jobs_t::iterator it = jobs.begin(); it != jobs.end(); it++)
-    (*it)->join();
+  // Stop remaining jobs in case of an early exit
+  SmartLock lock(this);
+  if (outstanding) quit = true;
+
+  while (outstanding) {
+    for (auto it = running.begin(); it != running.end(); it++)
+      (*it)->stop();
+
+    timedWait(0.1);
+  }
+}
+
+
+void Renderer::add(GridTree *tree, int worker) {
+  SmartLock lock(this);
+
+  pending.push_back(make_pair(tree, worker));
+  outstanding++;
+  dispatch();
+}
+
+
+// Called with the lock held, which keeps complete() from running before
+// inFlight is counted.  The last pending job is started first so a split
+// region continues on the same worker.
+void Renderer::dispatch() {
+  while (inFlight < threads && !pending.empty()) {
+    GridTree *tree = pending.back().first;
+    int worker = pending.back().second;
+
+    try {
+      ThreadPool::instance().add([this, tree] (unsigned id) {
+          double cells = 0;
+
+          try {
+            cells = contour(tree, id);
+          } CATCH_ERROR;
+
+          complete(cells);
+        }, worker);
+
+    } catch (const std::exception &e) {
+      LOG_ERROR("Failed to queue render job: " << e.what());
+
+      // Drop the remaining jobs, the jobs in flight still complete
+      outstanding -= pending.size();
+      pending.clear();
+      quit = true;
+      signal();
+      return;
+    }
+
+    pending.pop_back();
+    inFlight++;
+  }
+}
+
+
+double Renderer::contour(GridTree *tree, unsigned worker) {
+  if (tree->isEmpty() || !bbox.intersects(tree->getBounds())) return 0;
+
+  GridTreeRef ref = tree->getRef(bbox);
+  double cells = ref.getTotalCells();
+
+  // Skip regions with no cuts, grown to cover the culling done by the
+  // contour generators at the region edges
+  Rectangle3D bounds = tree->getBounds().intersection(bbox);
+  if (shouldQuit() || cutWorkpiece->cull(bounds.grow(2.2 * tree->getResolution())))
+    return cells;
+
+  // Split heavy regions, trees split by earlier runs must stay split
+  if (tree->isSplit() || (minCells < cells && tree->canSplit())) {
+    tree->split();
+    add(tree->getRight(), worker);
+    add(tree->getLeft(), worker); // Run next on this worker
+    return 0;
+  }
+
+  RenderJob job(*cutWorkpiece, mode, ref);
+
+  {
+    SmartLock lock(this);
+    if (quit) return cells;
+    running.insert(&job);
+  }
+
+  job.run();
+
+  SmartLock lock(this);
+  running.erase(&job);
+
+  return cells;
+}
+
+
+void Renderer::complete(double cells) {
+  SmartLock lock(this);
+
+  completedCells += cells;
+  outstanding--;
+  inFlight--;
+  dispatch();
+  signal();
+}
+
+
+bool Renderer::shouldQuit() const {
+  SmartLock lock(this);
+  return quit;
+}
+
+
+double Renderer::getProgress() const {
+  SmartLock lock(this);
+
+  double cells = completedCells;
+  for (auto it = running.begin(); it != running.end(); it++)
+    cells += (*it)->getProgress() * (*it)->getCells();
+
+  return totalCells ? std::min(1.0, cells / totalCells) : 1;
 }
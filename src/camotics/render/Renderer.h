@@ -28,19 +28,49 @@
 #include <cbang/os/Condition.h>
 #include <cbang/geom/Rectangle.h>
 
+#include <set>
+#include <vector>
+#include <utility>
+
 
 namespace CAMotics {
   class CutWorkpiece;
   class GridTree;
+  class RenderJob;
 
   class Renderer : cb::Condition {
     Task &task;
 
+    // Current render, guarded by the lock
+    CutWorkpiece *cutWorkpiece = 0;
+    RenderMode mode;
+    cb::Rectangle3D bbox;
+    double minCells = 0;
+
+    // At most threads jobs are queued on the ThreadPool at once, the rest
+    // wait in pending.  outstanding counts both.
+    unsigned threads = 0;
+    unsigned inFlight = 0;
+    std::vector<std::pair<GridTree *, int> > pending;
+    unsigned outstanding = 0;
+    double totalCells = 0;
+    double completedCells = 0;
+    std::set<RenderJob *> running;
+    bool quit = false;
+
   public:
     Renderer(Task &task) : task(task) {}
 
     void render(CutWorkpiece &cutWorkpiece, GridTree &tree,
                 const cb::Rectangle3D &bbox, unsigned threads,
                 RenderMode mode = RenderMode::MCUBES_MODE);
+
+  protected:
+    void add(GridTree *tree, int worker);
+    void dispatch();
+    double contour(GridTree *tree, unsigned worker);
+    void complete(double cells);
+    bool shouldQuit() const;
+    double getProgress() const;
   };
 }
@@ -32,7 +32,7 @@ using namespace CAMotics;
 
 
 /// NOTE: Expects @param nodes to be a link list along the left child
-AABB::AABB(AABB *nodes) : left(0), right(0), move(0) { // 构造函数，并将左右邻连接起来。左右邻默认为空指针。
+AABB::AABB(AABB *nodes) : left(0), right(0), move(noMove) { // 构造函数，并将左右邻连接起来。左右邻默认为空指针。
   if (!nodes) return; // 若指定的节点组不存在，则直接返回，即构造不含左右邻的节点。
 
   // Compute bounds
@@ -118,7 +118,7 @@ bool AABB::intersects(const Rectangle3D &r) {
 
 
 void AABB::collisions(const Vector3D &p,
-                      vector<const GCode::Move *> &moves) {
+                      vector<unsigned> &moves) {
   if (!Rectangle3D::contains(p)) return; // 调用 cbang 的 立体矩形判断是否包含边，若不包含，则返回。
   if (isLeaf()) moves.push_back(move); // 若当前节点是叶节点，则将当前节点的“移动”放入组中。
   if (left) left->collisions(p, moves); // 若左节点存在，判断左节点是否与其碰撞。
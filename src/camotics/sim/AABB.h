@@ -33,11 +33,13 @@ namespace CAMotics {
   class AABB : public cb::Rectangle3D {
     AABB *left; // 左邻
     AABB *right; // 右邻
-    const GCode::Move *move; // 移动方向
+    unsigned move; // 移动在路径中的下标，内部节点为noMove。
 
   public:
+    static const unsigned noMove = ~0U;
+
     AABB(AABB *nodes); // 构造函数，参数为立方体节点组，亦即
-    AABB(const GCode::Move *move, const cb::Rectangle3D &bbox) :
+    AABB(unsigned move, const cb::Rectangle3D &bbox) :
       cb::Rectangle3D(bbox), left(0), right(0), move(move) {}
     ~AABB(); // 析构函数，作用为删除自己的左右邻居。
 
@@ -48,12 +50,12 @@ namespace CAMotics {
     AABB *split(unsigned count); // 切割自己，并返回切割后的一组矩形的指针。参数为切割的目标份数。
 
     cb::Rectangle3D getBounds() const {return *this;} // 获得边，也就是获得自己的地址。
-    const GCode::Move *getMove() const {return move;} //
-    bool isLeaf() const {return move;} // 判断自己是否为叶节点，也即是否为分割后的最小矩形。
+    unsigned getMove() const {return move;} //
+    bool isLeaf() const {return move != noMove;} // 判断自己是否为叶节点，也即是否为分割后的最小矩形。
     unsigned getTreeHeight() const; // 获得分割树高度。
 
     bool intersects(const cb::Rectangle3D &r); // 求解与另一个矩形是否相交。
     void collisions(const cb::Vector3D &p,
-                    std::vector<const GCode::Move *> &moves); // 求解与一组边是否有碰撞。
+                    std::vector<unsigned> &moves); // 求解与一组边是否有碰撞。
   };
 }
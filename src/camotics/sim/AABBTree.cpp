@@ -36,7 +36,7 @@ Rectangle3D AABBTree::getBounds() const { // getBounds函数：重写了父类Mo
 }
 
 
-void AABBTree::insert(const GCode::Move *move, const Rectangle3D &bbox) { // getBounds函数：重写了父类MoveLookup的虚函数，返回AABB树的边界矩形，如果root为空，则返回空矩形。在返回之前，先检查finalized是否为true，如果为false，则抛出异常，表示AABB树还没有构建完成。
+void AABBTree::insert(unsigned move, const Rectangle3D &bbox) { // getBounds函数：重写了父类MoveLookup的虚函数，返回AABB树的边界矩形，如果root为空，则返回空矩形。在返回之前，先检查finalized是否为true，如果为false，则抛出异常，表示AABB树还没有构建完成。
   if (finalized) THROW("Cannot insert into AABBTree after partitioning");
   root = (new AABB(move, bbox))->prepend(root);
 }
@@ -49,7 +49,7 @@ bool AABBTree::intersects(const Rectangle3D &r) const { // getBounds函数：重
 
 
 void AABBTree::collisions(const Vector3D &p, // getBounds函数：重写了父类MoveLookup的虚函数，返回AABB树的边界矩形，如果root为空，则返回空矩形。在返回之前，先检查finalized是否为true，如果为false，则抛出异常，表示AABB树还没有构建完成。
-                          vector<const GCode::Move *> &moves) const {
+                          vector<unsigned> &moves) const {
   if (!finalized) THROW("AABBTree not yet finalized");
   if (root) root->collisions(p, moves);
 }
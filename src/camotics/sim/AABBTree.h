@@ -46,10 +46,10 @@ namespace CAMotics {
 
     // From MoveLookup
     cb::Rectangle3D getBounds() const; // getBounds方法，重写了父类MoveLookup的虚函数，返回AABB树的边界矩形，如果root为空，则返回空矩形。
-    void insert(const GCode::Move *move, const cb::Rectangle3D &bbox); // insert方法，重写了父类MoveLookup的虚函数，接受一个GCode::Move对象的指针和一个边界矩形作为参数，将它们插入到AABB树中。如果root为空，则创建一个新的AABB对象作为root，并将参数作为其数据。否则，调用root的insert方法将参数插入到合适的子节点中，并更新root的边界矩形。最后将finalized设为false。
+    void insert(unsigned move, const cb::Rectangle3D &bbox); // insert方法，重写了父类MoveLookup的虚函数，接受一个GCode::Move对象的指针和一个边界矩形作为参数，将它们插入到AABB树中。如果root为空，则创建一个新的AABB对象作为root，并将参数作为其数据。否则，调用root的insert方法将参数插入到合适的子节点中，并更新root的边界矩形。最后将finalized设为false。
     bool intersects(const cb::Rectangle3D &r) const; // insert方法，重写了父类MoveLookup的虚函数，接受一个GCode::Move对象的指针和一个边界矩形作为参数，将它们插入到AABB树中。如果root为空，则创建一个新的AABB对象作为root，并将参数作为其数据。否则，调用root的insert方法将参数插入到合适的子节点中，并更新root的边界矩形。最后将finalized设为false。
     void collisions(const cb::Vector3D &p, // insert方法，重写了父类MoveLookup的虚函数，接受一个GCode::Move对象的指针和一个边界矩形作为参数，将它们插入到AABB树中。如果root为空，则创建一个新的AABB对象作为root，并将参数作为其数据。否则，调用root的insert方法将参数插入到合适的子节点中，并更新root的边界矩形。最后将finalized设为false。
-                    std::vector<const GCode::Move *> &moves) const;
+                    std::vector<unsigned> &moves) const;
     void finalize(); // insert方法，重写了父类MoveLookup的虚函数，接受一个GCode::Move对象的指针和一个边界矩形作为参数，将它们插入到AABB树中。如果root为空，则创建一个新的AABB对象作为root，并将参数作为其数据。否则，调用root的insert方法将参数插入到合适的子节点中，并更新root的边界矩形。最后将finalized设为false。
   };
 }
@@ -0,0 +1,302 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "BVH.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  // double 转 float 时向外取整，保证包围盒只会变大不会变小。
+  inline float roundDown(double x) {
+    float f = (float)x;
+    if (x < f) f = nextafterf(f, -numeric_limits<float>::infinity());
+    return f;
+  }
+
+
+  inline float roundUp(double x) {
+    float f = (float)x;
+    if (f < x) f = nextafterf(f, numeric_limits<float>::infinity());
+    return f;
+  }
+
+
+  // 包围盒的半表面积，SAH 代价函数只需要相对大小。
+  inline double halfArea(const Rectangle3D &r) {
+    Vector3D d = r.getDimensions();
+    return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+  }
+
+
+  inline unsigned binIndex(double c, double base, double scale,
+                           unsigned bins) {
+    unsigned bin = (unsigned)((c - base) * scale);
+    return bin < bins ? bin : bins - 1;
+  }
+}
+
+
+BVH::BVH() : height(0), finalized(false) {}
+
+
+Rectangle3D BVH::getNodeBounds(unsigned node) const {
+  return Rectangle3D(Vector3D(nMinX.at(node), nMinY[node], nMinZ[node]),
+                     Vector3D(nMaxX[node], nMaxY[node], nMaxZ[node]));
+}
+
+
+Rectangle3D BVH::getItemBounds(unsigned i) const {
+  return Rectangle3D(Vector3D(iMinX.at(i), iMinY[i], iMinZ[i]),
+                     Vector3D(iMaxX[i], iMaxY[i], iMaxZ[i]));
+}
+
+
+bool BVH::contains(const Rectangle3D &r) const {
+  auto inside = [this, &r] (unsigned i) {return getItemBounds(i).contains(r);};
+  return visitItems(r, inside);
+}
+
+
+Rectangle3D BVH::getBounds() const {
+  if (!finalized) THROW("BVH not yet finalized");
+  return bounds;
+}
+
+
+void BVH::insert(unsigned move, const Rectangle3D &bbox) {
+  if (finalized) THROW("Cannot insert into BVH after finalize");
+
+  Item item;
+  item.move = move;
+  item.bbox = bbox;
+  item.centroid = bbox.getCenter();
+  items.push_back(item);
+}
+
+
+bool BVH::intersects(const Rectangle3D &r) const {
+  if (!finalized) THROW("BVH not yet finalized");
+  if (counts.empty()) return false;
+
+  unsigned stack[maxDepth];
+  unsigned top = 0;
+  unsigned node = 0;
+
+  while (true) {
+    if (nodeIntersects(node, r)) {
+      if (!counts[node]) {
+        stack[top++] = offsets[node];
+        node++; // Left child
+        continue;
+      }
+
+      unsigned end = offsets[node] + counts[node];
+      for (unsigned i = offsets[node]; i < end; i++)
+        if (itemIntersects(i, r)) return true;
+    }
+
+    if (!top) return false;
+    node = stack[--top];
+  }
+}
+
+
+void BVH::collisions(const Vector3D &p,
+                     vector<unsigned> &moves) const {
+  auto collect = [&moves] (unsigned move) {
+    moves.push_back(move);
+    return false;
+  };
+
+  visit(p, collect);
+}
+
+
+void BVH::finalize() {
+  if (finalized) return;
+  finalized = true;
+
+  if (items.empty()) return;
+
+  for (unsigned i = 0; i < items.size(); i++) bounds.add(items[i].bbox);
+
+  vector<unsigned> order(items.size());
+  for (unsigned i = 0; i < order.size(); i++) order[i] = i;
+
+  build(order, 0, order.size(), 1);
+
+  // Build data is no longer needed
+  vector<Item>().swap(items);
+}
+
+
+unsigned BVH::build(vector<unsigned> &order, unsigned first, unsigned last,
+                    unsigned depth) {
+  if (height < depth) height = depth;
+
+  Rectangle3D bbox;
+  Rectangle3D centroids;
+  for (unsigned i = first; i < last; i++) {
+    const Item &item = items[order[i]];
+    bbox.add(item.bbox);
+    centroids.add(item.centroid);
+  }
+
+  unsigned node = counts.size();
+
+  // Leaf, keep moves in insertion order
+  if (last - first <= maxLeafSize) {
+    addNode(bbox, moves.size(), last - first);
+    sort(order.begin() + first, order.begin() + last);
+
+    for (unsigned i = first; i < last; i++) {
+      const Item &item = items[order[i]];
+
+      iMinX.push_back(roundDown(item.bbox.rmin.x()));
+      iMinY.push_back(roundDown(item.bbox.rmin.y()));
+      iMinZ.push_back(roundDown(item.bbox.rmin.z()));
+      iMaxX.push_back(roundUp(item.bbox.rmax.x()));
+      iMaxY.push_back(roundUp(item.bbox.rmax.y()));
+      iMaxZ.push_back(roundUp(item.bbox.rmax.z()));
+      moves.push_back(item.move);
+    }
+
+    return node;
+  }
+
+  // Internal node, the right child offset is filled in after the left subtree
+  addNode(bbox, 0, 0);
+
+  // Fall back to median splits deep in the tree so the height stays bounded
+  bool median = maxDepth / 2 <= depth;
+  unsigned mid = partition(order, first, last, centroids, median);
+
+  build(order, first, mid, depth + 1);
+  unsigned right = build(order, mid, last, depth + 1);
+  offsets[node] = right;
+
+  return node;
+}
+
+
+unsigned BVH::partition(vector<unsigned> &order, unsigned first,
+                        unsigned last, const Rectangle3D &centroids,
+                        bool median) {
+  Vector3D extent = centroids.getDimensions();
+
+  if (!median) {
+    // Binned surface area heuristic
+    double bestCost = numeric_limits<double>::max();
+    unsigned bestAxis = 0;
+    unsigned bestSplit = 0;
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+      if (extent[axis] <= 0) continue;
+
+      const double base = centroids.rmin[axis];
+      const double scale = sahBins / extent[axis];
+
+      unsigned binCounts[sahBins] = {0};
+      Rectangle3D binBounds[sahBins];
+
+      for (unsigned i = first; i < last; i++) {
+        const Item &item = items[order[i]];
+        unsigned bin = binIndex(item.centroid[axis], base, scale, sahBins);
+        binCounts[bin]++;
+        binBounds[bin].add(item.bbox);
+      }
+
+      // Accumulate right hand costs
+      double rightArea[sahBins];
+      unsigned rightCount[sahBins];
+      Rectangle3D acc;
+      unsigned count = 0;
+
+      for (unsigned i = sahBins - 1; i; i--) {
+        if (binCounts[i]) acc.add(binBounds[i]);
+        count += binCounts[i];
+        rightCount[i] = count;
+        rightArea[i] = count ? halfArea(acc) : 0;
+      }
+
+      // Sweep split planes from the left
+      acc = Rectangle3D();
+      count = 0;
+
+      for (unsigned i = 1; i < sahBins; i++) {
+        if (binCounts[i - 1]) acc.add(binBounds[i - 1]);
+        count += binCounts[i - 1];
+        if (!count || !rightCount[i]) continue;
+
+        double cost = count * halfArea(acc) + rightCount[i] * rightArea[i];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = i;
+        }
+      }
+    }
+
+    if (bestSplit) {
+      const double base = centroids.rmin[bestAxis];
+      const double scale = sahBins / extent[bestAxis];
+
+      auto it = std::partition
+        (order.begin() + first, order.begin() + last,
+         [&] (unsigned i) {
+          return binIndex(items[i].centroid[bestAxis], base, scale, sahBins) <
+            bestSplit;
+        });
+
+      unsigned mid = it - order.begin();
+      if (mid != first && mid != last) return mid;
+    }
+  }
+
+  // Median split along the largest centroid extent
+  unsigned axis = extent.findLargest();
+  unsigned mid = first + (last - first) / 2;
+
+  nth_element(order.begin() + first, order.begin() + mid,
+              order.begin() + last, [&] (unsigned a, unsigned b) {
+                return items[a].centroid[axis] < items[b].centroid[axis];
+              });
+
+  return mid;
+}
+
+
+void BVH::addNode(const Rectangle3D &bbox, uint32_t offset, uint32_t count) {
+  nMinX.push_back(roundDown(bbox.rmin.x()));
+  nMinY.push_back(roundDown(bbox.rmin.y()));
+  nMinZ.push_back(roundDown(bbox.rmin.z()));
+  nMaxX.push_back(roundUp(bbox.rmax.x()));
+  nMaxY.push_back(roundUp(bbox.rmax.y()));
+  nMaxZ.push_back(roundUp(bbox.rmax.z()));
+  offsets.push_back(offset);
+  counts.push_back(count);
+}
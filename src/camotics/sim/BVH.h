@@ -0,0 +1,175 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "MoveLookup.h"
+
+#include <cbang/Exception.h>
+
+#include <vector>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // 扁平化的层次包围盒（BVH）。节点按深度优先顺序连续存放，内部节点的左子节点
+  // 紧跟在其后，右子节点由下标指出。包围盒以 float 的 SoA 形式存放，并向外取整，
+  // 因此查询结果不会漏掉任何移动。
+  class BVH : public MoveLookup {
+    struct Item { // 构建阶段收集的移动及其包围盒。
+      unsigned move;
+      cb::Rectangle3D bbox;
+      cb::Vector3D centroid;
+    };
+
+    std::vector<Item> items; // finalize() 之前插入的移动。
+
+    // Nodes, depth-first
+    std::vector<float> nMinX, nMinY, nMinZ, nMaxX, nMaxY, nMaxZ; // 节点包围盒。
+    std::vector<uint32_t> offsets; // 叶节点：第一个移动的下标；内部节点：右子节点的下标。
+    std::vector<uint32_t> counts;  // 叶节点包含的移动数量，内部节点为0。
+
+    // Leaf moves, in leaf order
+    std::vector<float> iMinX, iMinY, iMinZ, iMaxX, iMaxY, iMaxZ; // 每个移动自身的包围盒。
+    std::vector<unsigned> moves; // 移动在路径中的下标。
+
+    cb::Rectangle3D bounds;
+    unsigned height;
+    bool finalized;
+
+  public:
+    static const unsigned maxLeafSize = 4; // 叶节点最多包含的移动数。
+    static const unsigned maxDepth = 64;   // 树的最大高度，也是遍历栈的大小。
+    static const unsigned sahBins = 16;    // SAH 分箱的数量。
+
+    BVH();
+
+    unsigned getNodeCount() const {return counts.size();}
+    bool isLeaf(unsigned node) const {return counts.at(node);}
+    unsigned getRight(unsigned node) const {return offsets.at(node);}
+    cb::Rectangle3D getNodeBounds(unsigned node) const;
+
+    // 依次把包围盒包含点p的移动交给visitor，visitor返回true时立即停止并返回true。
+    // 遍历栈在调用者的栈帧上，整个查询不分配堆内存。同一叶节点内的移动按插入顺序排列。
+    template <typename Func>
+    bool visit(const cb::Vector3D &p, Func &visitor) const {
+      if (!finalized) THROW("BVH not yet finalized");
+      if (counts.empty()) return false;
+
+      const double x = p.x(), y = p.y(), z = p.z();
+      unsigned stack[maxDepth];
+      unsigned top = 0;
+      unsigned node = 0;
+
+      while (true) {
+        if (nodeContains(node, x, y, z)) {
+          if (!counts[node]) {
+            stack[top++] = offsets[node];
+            node++; // Left child
+            continue;
+          }
+
+          unsigned end = offsets[node] + counts[node];
+          for (unsigned i = offsets[node]; i < end; i++)
+            if (itemContains(i, x, y, z) && visitor(moves[i])) return true;
+        }
+
+        if (!top) return false;
+        node = stack[--top];
+      }
+    }
+
+    // 依次把包围盒与r相交的移动的下标交给visitor，visitor返回true时立即停止。
+    // 用于按行批量计算深度，再用itemContains()判断每个点是否在这个移动的包围盒内。
+    template <typename Func>
+    bool visitItems(const cb::Rectangle3D &r, Func &visitor) const {
+      if (!finalized) THROW("BVH not yet finalized");
+      if (counts.empty()) return false;
+
+      unsigned stack[maxDepth];
+      unsigned top = 0;
+      unsigned node = 0;
+
+      while (true) {
+        if (nodeIntersects(node, r)) {
+          if (!counts[node]) {
+            stack[top++] = offsets[node];
+            node++; // Left child
+            continue;
+          }
+
+          unsigned end = offsets[node] + counts[node];
+          for (unsigned i = offsets[node]; i < end; i++)
+            if (itemIntersects(i, r) && visitor(i)) return true;
+        }
+
+        if (!top) return false;
+        node = stack[--top];
+      }
+    }
+
+    unsigned getItemCount() const {return moves.size();}
+    unsigned getMove(unsigned i) const {return moves[i];}
+    cb::Rectangle3D getItemBounds(unsigned i) const;
+
+    // r是否完全落在某一个移动的包围盒内。结果对r的子区域同样成立。
+    bool contains(const cb::Rectangle3D &r) const;
+
+    bool itemContains(unsigned i, double x, double y, double z) const {
+      return iMinX[i] <= x && x <= iMaxX[i] && iMinY[i] <= y &&
+        y <= iMaxY[i] && iMinZ[i] <= z && z <= iMaxZ[i];
+    }
+
+    // From MoveLookup
+    cb::Rectangle3D getBounds() const;
+    void insert(unsigned move, const cb::Rectangle3D &bbox);
+    bool intersects(const cb::Rectangle3D &r) const;
+    void collisions(const cb::Vector3D &p,
+                    std::vector<unsigned> &moves) const;
+    unsigned getHeight() const {return height;}
+    void finalize();
+
+  protected:
+    unsigned build(std::vector<unsigned> &order, unsigned first,
+                   unsigned last, unsigned depth);
+    unsigned partition(std::vector<unsigned> &order, unsigned first,
+                       unsigned last, const cb::Rectangle3D &centroids,
+                       bool median);
+    void addNode(const cb::Rectangle3D &bbox, uint32_t offset,
+                 uint32_t count);
+
+    bool nodeContains(unsigned i, double x, double y, double z) const {
+      return nMinX[i] <= x && x <= nMaxX[i] && nMinY[i] <= y &&
+        y <= nMaxY[i] && nMinZ[i] <= z && z <= nMaxZ[i];
+    }
+
+    bool nodeIntersects(unsigned i, const cb::Rectangle3D &r) const {
+      return nMinX[i] <= r.rmax.x() && r.rmin.x() <= nMaxX[i] &&
+        nMinY[i] <= r.rmax.y() && r.rmin.y() <= nMaxY[i] &&
+        nMinZ[i] <= r.rmax.z() && r.rmin.z() <= nMaxZ[i];
+    }
+
+    bool itemIntersects(unsigned i, const cb::Rectangle3D &r) const {
+      return iMinX[i] <= r.rmax.x() && r.rmin.x() <= iMaxX[i] &&
+        iMinY[i] <= r.rmax.y() && r.rmin.y() <= iMaxY[i] &&
+        iMinZ[i] <= r.rmax.z() && r.rmin.z() <= iMaxZ[i];
+    }
+  };
+}
@@ -21,6 +21,7 @@
 #include "CompositeSweep.h"
 
 #include <limits>
+#include <algorithm>
 
 using namespace std;
 using namespace cb;
@@ -41,6 +42,41 @@ void CompositeSweep::getBBoxes(const Vector3D &start,
     children[i]->getBBoxes(start, end, bboxes, tolerance);
 }
 
+// 计算点到当前复杂曲面的有向距离，取子曲面的最小值。
+double CompositeSweep::distance(const Vector3D &p, Vector3D &normal) const {
+  double best = numeric_limits<double>::max();
+
+  for (unsigned i = 0; i < children.size(); i++) {
+    Vector3D n;
+    double d = children[i]->distance(p - Vector3D(0, 0, zOffsets[i]), n);
+    if (d < best) {
+      best = d;
+      normal = n;
+    }
+  }
+
+  return best;
+}
+
+
+double CompositeSweep::distance(const Vector3D &start, const Vector3D &end,
+                                const Vector3D &p, Vector3D &normal) const {
+  double best = numeric_limits<double>::max();
+
+  for (unsigned i = 0; i < children.size(); i++) {
+    Vector3D n;
+    double d = children[i]->distance
+      (start, end, p - Vector3D(0, 0, zOffsets[i]), n);
+    if (d < best) {
+      best = d;
+      normal = n;
+    }
+  }
+
+  return best;
+}
+
+
 // 计算当前复杂曲面的深度。
 double CompositeSweep::depth(const Vector3D &start, const Vector3D &end,
                              const Vector3D &p) const {
@@ -54,3 +90,27 @@ double CompositeSweep::depth(const Vector3D &start, const Vector3D &end,
 
   return d2; // 最后返回每个子曲面的最大值。
 }
+
+// 批量计算当前复杂曲面一行点的深度，每次最多处理64个点以便使用栈上的缓冲区。
+void CompositeSweep::depth(const Vector3D &start, const Vector3D &end,
+                           const double *xs, double y, double z, unsigned n,
+                           double *out) const {
+  const unsigned block = 64;
+  double cd2[block];
+
+  for (unsigned offset = 0; offset < n; offset += block) {
+    unsigned count = std::min(block, n - offset);
+    double *d2 = out + offset;
+
+    for (unsigned j = 0; j < count; j++)
+      d2[j] = -numeric_limits<double>::max();
+
+    for (unsigned i = 0; i < children.size(); i++) {
+      children[i]->depth(start, end, xs + offset, y, z - zOffsets[i], count,
+                         cd2);
+
+      for (unsigned j = 0; j < count; j++)
+        if (d2[j] < cd2[j]) d2[j] = cd2[j]; // 深度取更大值。
+    }
+  }
+}
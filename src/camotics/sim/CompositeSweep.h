@@ -43,9 +43,18 @@ namespace CAMotics {
     void getBBoxes(const cb::Vector3D &start, const cb::Vector3D &end,
                    std::vector<cb::Rectangle3D> &bboxes,
                    double tolerance = 0.01) const;
+    // 有向距离取各个子曲面的最小值。扫过形状的距离按子曲面分别搜索，
+    // 因为子曲面各自是凸体，合起来的形状不一定是。
+    double distance(const cb::Vector3D &p, cb::Vector3D &normal) const;
+    double distance(const cb::Vector3D &start, const cb::Vector3D &end,
+                    const cb::Vector3D &p, cb::Vector3D &normal) const;
     // 一个继承自Sweep类的虚函数，用于根据给定的起点和终点，计算CompositeSweep对象在扫描路径上的某一点的深度，
     // 深度是指该点到扫描路径平面的垂直距离。
     double depth(const cb::Vector3D &start, const cb::Vector3D &end,
                const cb::Vector3D &p) const;
+    // 批量计算一行点的深度，每个子曲面按行计算后取最大值。
+    void depth(const cb::Vector3D &start, const cb::Vector3D &end,
+               const double *xs, double y, double z, unsigned n,
+               double *out) const;
   };
 }
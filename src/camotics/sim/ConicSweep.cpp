@@ -19,6 +19,7 @@
 \******************************************************************************/
 
 #include "ConicSweep.h"
+#include "SweepKernels.h"
 
 #include <cbang/log/Logger.h>
 
@@ -46,6 +47,63 @@ namespace {
   inline double sqr(double x) {return x * x;} // 计算平方
 }
 
+// 点p到刀具的有向距离。刀具绕z轴旋转对称，所以在过轴线的平面内计算点(r, z)
+// 到梯形截面的距离，截面由侧面、底面和顶面三条边组成。
+double ConicSweep::distance(const Vector3D &p, Vector3D &normal) const {
+  const double r = sqrt(sqr(p.x()) + sqr(p.y()));
+  const double z = p.z();
+
+  // 各条边的起点、终点和向外的法向量，侧面在前，刀尖处与退化的底面重合时
+  // 优先使用侧面
+  const double sideLen = sqrt(sqr(l) + sqr(rt - rb));
+  const double edges[3][6] = {
+    {rb, 0, rt, l, l / sideLen, (rb - rt) / sideLen},
+    {0, 0, rb, 0, 0, -1},
+    {rt, l, 0, l, 0, 1},
+  };
+
+  const bool inside = 0 <= z && z <= l && r <= rb + (rt - rb) * z / l;
+
+  double best = numeric_limits<double>::max();
+  double nr = 0, nz = -1;
+
+  for (unsigned i = 0; i < 3; i++) {
+    const double *e = edges[i];
+    const double dr = e[2] - e[0];
+    const double dz = e[3] - e[1];
+    const double len2 = sqr(dr) + sqr(dz);
+
+    double t = len2 ? ((r - e[0]) * dr + (z - e[1]) * dz) / len2 : 0;
+    const bool corner = t <= 0 || 1 <= t;
+    t = t < 0 ? 0 : (1 < t ? 1 : t);
+
+    const double cr = r - (e[0] + t * dr);
+    const double cz = z - (e[1] + t * dz);
+    const double d = sqrt(sqr(cr) + sqr(cz));
+
+    if (d < best) {
+      best = d;
+
+      // 最近点是外部的点所对的顶点时法向量指向该点，否则使用边的法向量。
+      // 最近点在边上时差值只剩舍入误差，不能用来求方向。
+      if (!inside && corner && d) {
+        nr = cr / d;
+        nz = cz / d;
+
+      } else {
+        nr = e[4];
+        nz = e[5];
+      }
+    }
+  }
+
+  if (r) normal = Vector3D(nr * p.x() / r, nr * p.y() / r, nz);
+  else normal = Vector3D(0, 0, nz < 0 ? -1 : 1);
+
+  return inside ? -best : best;
+}
+
+
 // 计算一个空间中的点P到一个圆锥曲面的深度。这个圆锥曲面是由一个线段AB和一个圆锥形工具扫过而成的，其中线段AB的起点为A，终点为B，圆锥形工具的高度为l，顶部半径为rt，底部半径为rb。这个函数的过程如下：
 double ConicSweep::depth(const Vector3D &A, const Vector3D &B,
                          const Vector3D &P) const {
@@ -124,3 +182,53 @@ double ConicSweep::depth(const Vector3D &A, const Vector3D &B,
 
   return 1;
 }
+
+
+// 批量计算一行点(xs[i], y, z)的深度。先计算与x无关的部分，z高度不在范围内或
+// epsilon为0时整行都不相交，否则交给SIMD内核逐个x计算。
+void ConicSweep::depth(const Vector3D &A, const Vector3D &B,
+                       const double *xs, double Py, double Pz, unsigned n,
+                       double *out) const {
+  const double Ax = A.x(), Ay = A.y(), Az = A.z();
+  const double Bx = B.x(), By = B.y(), Bz = B.z();
+
+  // Check z-height
+  bool miss = Pz < min(Az, Bz) || max(Az, Bz) + l < Pz;
+
+  double epsilon = sqr(Bx - Ax) + sqr(By - Ay) - sqr(Tm * (Bz - Az));
+  if (epsilon == 0 && Bz != Az && Tm == 0) epsilon = 0.000000001;
+
+  if (miss || epsilon == 0) {
+    for (unsigned i = 0; i < n; i++) out[i] = -1;
+    return;
+  }
+
+  ConicRow row;
+  row.ax = Ax;
+  row.dx = Bx - Ax;
+  row.gy = (Ay - Py) * (By - Ay);
+  row.gz = (sqr(Tm) * (Az - Pz) - Tm * rb) * (Az - Bz);
+  row.ry = sqr(Ay - Py);
+  row.rz = sqr(Tm * (Az - Pz) - rb);
+  row.eps = epsilon;
+  row.dz = Bz - Az;
+  row.az = Az;
+  row.pz = Pz;
+  row.l = l;
+
+  // Bottom disc
+  const double bBeta = (Pz - Az) / (Bz - Az);
+  row.bottom = rb && 0 <= bBeta && bBeta <= 1;
+  row.bx = bBeta * (Bx - Ax) + Ax;
+  row.by2 = sqr(bBeta * (By - Ay) + Ay - Py);
+  row.rb2 = rb * rb;
+
+  // Top disc
+  const double tBeta = (Pz - Az - l) / (Bz - Az);
+  row.top = rt && 0 <= tBeta && tBeta <= 1;
+  row.tx = tBeta * (Bx - Ax) + Ax;
+  row.ty2 = sqr(tBeta * (By - Ay) + Ay - Py);
+  row.rt2 = rt * rt;
+
+  SweepKernels::conic(row, xs, n, out);
+}
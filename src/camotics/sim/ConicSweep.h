@@ -37,7 +37,12 @@ namespace CAMotics {
     void getBBoxes(const cb::Vector3D &start, const cb::Vector3D &end,
                    std::vector<cb::Rectangle3D> &bboxes,
                    double tolerance) const;
+    using Sweep::distance;
+    double distance(const cb::Vector3D &p, cb::Vector3D &normal) const;
     double depth(const cb::Vector3D &start, const cb::Vector3D &end,
                const cb::Vector3D &p) const;
+    void depth(const cb::Vector3D &start, const cb::Vector3D &end,
+               const double *xs, double y, double z, unsigned n,
+               double *out) const; // 用SIMD批量计算一行点的深度。
   };
 }
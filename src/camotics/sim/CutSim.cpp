@@ -23,6 +23,7 @@
 #include "ToolPathTask.h"
 #include "SurfaceTask.h"
 #include "ReduceTask.h"
+#include "StreamTask.h"
 #include "AABBTree.h"
 
 using namespace std;
@@ -35,11 +36,15 @@ CutSim::~CutSim() {} // 析构函数：释放task指向的内存。
 
 
 SmartPointer<GCode::ToolPath>
-CutSim::computeToolPath(const Project::Project &project)  //  computeToolPath函数：接受一个Project对象作为参数，返回一个GCode::ToolPath对象的智能指针。这个函数用来根据项目的设置和文件，计算出GCode的工具路径。为了完成这个任务，它创建了一个ToolPathTask对象，并将其赋值给task，并调用其run方法执行计算，并返回其getPath方法得到的结果。
+CutSim::computeToolPath(const Project::Project &project, bool cache,
+                        const GCode::PlannerConfig *config) { //  computeToolPath函数：接受一个Project对象作为参数，返回一个GCode::ToolPath对象的智能指针。这个函数用来根据项目的设置和文件，计算出GCode的工具路径。为了完成这个任务，它创建了一个ToolPathTask对象，并将其赋值给task，并调用其run方法执行计算，并返回其getPath方法得到的结果。
+  task = new ToolPathTask(project, 0, 0, config);
 
-task = new ToolPathTask(project);
-  task->run();
-  return task.cast<ToolPathTask>()->getPath();
+  SmartPointer<ToolPathTask> pathTask = task.cast<ToolPathTask>();
+  pathTask->setCache(cache);
+  pathTask->run();
+
+  return pathTask->getPath();
 }
 
 
@@ -50,9 +55,21 @@ SmartPointer<Surface> CutSim::computeSurface(const Simulation &sim) { // compute
 }
 
 
+SmartPointer<Surface> CutSim::streamSurface(const Project::Project &project,
+                                            Simulation &sim) {
+  task = new StreamTask(project, sim);
+  task->run();
+
+  SmartPointer<StreamTask> streamTask = task.cast<StreamTask>();
+  sim.path = streamTask->getPath();
+
+  return streamTask->getSurface();
+}
+
 
-void CutSim::reduceSurface(const SmartPointer<Surface> &surface)  //  reduceSurface函数：接受一个Surface对象的智能指针作为参数。这个函数用来对表面进行简化，减少顶点和三角形的数量，提高渲染效率。为了完成这个任务，它创建了一个ReduceTask对象，并将其赋值给task，并调用其run方法执行简化。
-  task = new ReduceTask(surface);
+void CutSim::reduceSurface(const SmartPointer<Surface> &surface,
+                           ReduceMode mode) { //  reduceSurface函数：接受一个Surface对象的智能指针作为参数。这个函数用来对表面进行简化，减少顶点和三角形的数量，提高渲染效率。为了完成这个任务，它创建了一个ReduceTask对象，并将其赋值给task，并调用其run方法执行简化。
+  task = new ReduceTask(surface, mode);
   task->run();
 }
 
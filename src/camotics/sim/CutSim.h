@@ -20,10 +20,15 @@
 
 #pragma once
 
+#include <camotics/contour/ReduceMode.h>
+
 #include <cbang/SmartPointer.h>
 
 
-namespace GCode {class ToolPath;}
+namespace GCode {
+  class ToolPath;
+  class PlannerConfig;
+}
 
 namespace CAMotics {
   namespace Project {class Project;}
@@ -40,11 +45,19 @@ namespace CAMotics {
     ~CutSim(); // 析构函数，释放task指向的内存。
 
     cb::SmartPointer<GCode::ToolPath>
-    computeToolPath(const Project::Project &project); // computeToolPath方法，接受一个Project对象作为参数，返回一个GCode::ToolPath对象的智能指针。这个方法用来根据项目的设置和文件，计算出GCode的工具路径。
+    computeToolPath(const Project::Project &project, bool cache = false,
+                    const GCode::PlannerConfig *config = 0); // computeToolPath方法，接受一个Project对象作为参数，返回一个GCode::ToolPath对象的智能指针。这个方法用来根据项目的设置和文件，计算出GCode的工具路径。cache为真时通过ToolPathCache复用已解释过的文件。移动时间按config中的机器限制规划，config为空时用默认配置。
 
       cb::SmartPointer<Surface> computeSurface(const Simulation &sim); // computeSurface方法，接受一个Simulation对象作为参数，返回一个Surface对象的智能指针。这个方法用来根据模拟的参数和工具路径，计算出切割后的表面。
-    void reduceSurface(const cb::SmartPointer<Surface> &surface); // reduceSurface方法，接受一个Surface对象的智能指针作为参数。这个方法用来对表面进行简化，减少顶点和三角形的数量，提高渲染效率。
-
-    void interrupt() // interrupt方法，用来中断当前正在执行的任务。
+    // 边解释边模拟。流式的移动不经过MoveTimer，时间是按进给率估计的，所以只有
+    // sim.time覆盖整个程序时，返回的表面才与先computeToolPath()再
+    // computeSurface()相同。结束后sim.path是解释得到的工具路径。工件的边界
+    // 必须事先确定。
+    cb::SmartPointer<Surface> streamSurface(const Project::Project &project,
+                                            Simulation &sim);
+    void reduceSurface(const cb::SmartPointer<Surface> &surface,
+                       ReduceMode mode = ReduceMode::HASH_MODE); // reduceSurface方法，接受一个Surface对象的智能指针作为参数。这个方法用来对表面进行简化，减少顶点和三角形的数量，提高渲染效率。
+
+    void interrupt(); // interrupt方法，用来中断当前正在执行的任务。
   };
 }
@@ -22,6 +22,8 @@
 
 #include <cbang/Math.h>
 
+#include <algorithm>
+
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
@@ -58,7 +60,55 @@ bool CutWorkpiece::cull(const Rectangle3D &r) const { // cull函数：重写了
 }
 
 
+FieldFunction::block_t CutWorkpiece::classify(const Rectangle3D &r) const { // classify函数：先用toolSweep的cull判断区域是否被切割。其余的区域用toolSweep的BVH判断，完整渲染时change为空，也能跳过没有移动经过的区域。
+  if (cull(r)) return BLOCK_UNCUT;
+
+  // 没有任何移动的包围盒与区域相交时，区域内的深度只由工件决定
+  bool swept = toolSweep->intersects(r);
+
+  if (!workpiece.isValid()) return swept ? BLOCK_SURFACE : BLOCK_AIR;
+
+  const Rectangle3D &bounds = workpiece.getBounds();
+  if (!r.intersects(bounds)) return BLOCK_AIR; // 区域在工件外部，所有点的深度都是负值
+  if (!swept && bounds.contains(r)) return BLOCK_SOLID; // 区域在工件内部且没有被切割，所有点的深度都是正值
+  return BLOCK_SURFACE;
+}
+
+
 double CutWorkpiece::depth(const Vector3D &p) const { // depth函数：重写了父类FieldFunction的虚函数，接受一个三维向量作为参数，表示一个空间中的点。这个函数返回这个点到工件表面最近的距离的平方，如果这个点在工件内部，则返回正值，否则返回负值。如果workpiece是无效的，则直接返回toolSweep的depth函数得到的结果。否则，返回workpiece和toolSweep的depth函数得到的结果中较小的一个。
   if (!workpiece.isValid()) return toolSweep->depth(p);
   return min(workpiece.depth(p), -toolSweep->depth(p));
 }
+
+
+Vector3D CutWorkpiece::normal(const Vector3D &p, double offset) const {
+  if (!workpiece.isValid()) return toolSweep->normal(p, offset);
+
+  Vector3D boxNormal;
+  double box = workpiece.distance(p, boxNormal);
+
+  Vector3D sweepNormal;
+  double sweep = toolSweep->distance(p, sweepNormal);
+
+  if (-sweep < box) return boxNormal; // 没有候选移动时sweep为最大值
+  return sweepNormal * -1;
+}
+
+
+void CutWorkpiece::depth(const double *xs, double y, double z, unsigned n,
+                         double *out) const { // 批量计算一行点的深度。结果与逐点调用depth()相同，toolSweep的结果每次最多64个点，存放在栈上的缓冲区中。
+  if (!workpiece.isValid()) return toolSweep->depth(xs, y, z, n, out);
+
+  const unsigned block = 64;
+  double sweep[block];
+
+  workpiece.depth(xs, y, z, n, out);
+
+  for (unsigned offset = 0; offset < n; offset += block) {
+    unsigned count = min(block, n - offset);
+    toolSweep->depth(xs + offset, y, z, count, sweep);
+
+    for (unsigned i = 0; i < count; i++)
+      out[offset + i] = min(out[offset + i], -sweep[i]);
+  }
+}
@@ -30,7 +30,7 @@
 
 
 namespace CAMotics {
-  class CutWorkpiece : public FieldFunction  // 表示一个被切割的工件。这个类继承了FieldFunction类，表示一个场函数，用来计算空间中的点到工件表面的距离。这个类有以下特点：
+  class CutWorkpiece : public FieldFunction { // 表示一个被切割的工件。这个类继承了FieldFunction类，表示一个场函数，用来计算空间中的点到工件表面的距离。这个类有以下特点：
     cb::SmartPointer<ToolSweep> toolSweep; // toolSweep成员变量，是一个ToolSweep对象的智能指针。ToolSweep对象表示一个工具扫过的形状，用来模拟切割过程。
     Workpiece workpiece; // workpiece成员变量，是一个Workpiece对象。Workpiece对象表示一个原始的工件，是一个三维矩形。
 
@@ -45,7 +45,11 @@ namespace CAMotics {
     cb::Rectangle3D getBounds() const; // getBounds方法，返回工件的边界矩形。
 
     // From FieldFunction
+    block_t classify(const cb::Rectangle3D &r) const; // classify方法，重写了父类FieldFunction的虚函数。没有被切割的区域返回BLOCK_UNCUT，完全在工件外部或没有移动经过的区域返回BLOCK_AIR，在工件内部且没有移动经过的区域返回BLOCK_SOLID，其余返回BLOCK_SURFACE。
     bool cull(const cb::Rectangle3D &r) const; // cull方法，重写了父类FieldFunction的虚函数，接受一个矩形作为参数，判断它是否与工件不相交。如果不相交，则返回true，表示可以剪除这个区域，提高计算效率。
+    void depth(const double *xs, double y, double z, unsigned n,
+               double *out) const; // 批量计算一行点的深度，分别批量计算工件和toolSweep的深度后合并。
+    cb::Vector3D normal(const cb::Vector3D &p, double offset) const; // 工件去掉扫过形状后的有向距离是max(工件距离, -扫过形状距离)，法向量取较大一项的法向量，扫过形状的法向量要反向。
     double depth(const cb::Vector3D &p) const; // depth方法，重写了父类FieldFunction的虚函数，接受一个三维向量作为参数，表示一个空间中的点。这个方法返回这个点到工件表面最近的距离的平方，如果这个点在工件内部，则返回正值，否则返回负值。
   };
 }
@@ -0,0 +1,117 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "FileCache.h"
+
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/DirectoryWalker.h>
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  struct Entry {
+    string filename;
+    uint64_t time;
+    uint64_t size;
+
+    bool operator<(const Entry &o) const {return time < o.time;}
+  };
+}
+
+
+FileCache::FileCache(const string &path, const string &extension,
+                     uint64_t maxSize) :
+  path(path), extension(extension), maxSize(maxSize), enabled(true) {}
+
+
+string FileCache::getDefaultPath(const char *env, const string &name) {
+  const char *path = SystemUtilities::getenv(env);
+  if (path) return path;
+
+#ifdef _WIN32
+  const char *root = SystemUtilities::getenv("LOCALAPPDATA");
+  if (root) return string(root) + "/CAMotics/" + name;
+
+#else
+  const char *root = SystemUtilities::getenv("XDG_CACHE_HOME");
+  if (root && *root) return string(root) + "/camotics/" + name;
+
+  const char *home = SystemUtilities::getenv("HOME");
+  if (home) return string(home) + "/.cache/camotics/" + name;
+#endif
+
+  return "";
+}
+
+
+void FileCache::evict() {
+  if (!isEnabled() || !SystemUtilities::isDirectory(path)) return;
+
+  SmartLock lock(this);
+
+  vector<Entry> entries;
+  uint64_t total = 0;
+
+  DirectoryWalker walker(path, ".*\\" + extension, 1);
+  while (walker.hasNext()) {
+    Entry e;
+    e.filename = walker.next();
+    e.time = SystemUtilities::getModificationTime(e.filename);
+    e.size = SystemUtilities::getFileSize(e.filename);
+
+    total += e.size;
+    entries.push_back(e);
+  }
+
+  if (total <= maxSize) return;
+
+  // 按最近使用时间从旧到新删除，直到总大小不超过上限。
+  sort(entries.begin(), entries.end());
+
+  for (unsigned i = 0; i < entries.size() && maxSize < total; i++) {
+    LOG_DEBUG(1, "Evicting " << entries[i].filename << " from cache");
+    TRY_CATCH_ERROR(SystemUtilities::unlink(entries[i].filename));
+    total -= entries[i].size;
+  }
+}
+
+
+string FileCache::getFilename(const string &hash) const {
+  // Base64 可能包含 '/' 和 '+'，换成文件名中安全的字符，并去掉末尾的 '='。
+  string name;
+  for (unsigned i = 0; i < hash.length(); i++)
+    switch (hash[i]) {
+    case '/': name += '_'; break;
+    case '+': name += '-'; break;
+    case '=': break;
+    default: name += hash[i]; break;
+    }
+
+  return path + "/" + name + extension;
+}
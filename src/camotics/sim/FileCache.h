@@ -0,0 +1,60 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/os/Mutex.h>
+
+#include <string>
+#include <cinttypes>
+
+
+namespace CAMotics {
+  // 按hash寻址的磁盘缓存目录。每一项存成一个文件，文件的修改时间就是最近使用时间，
+  // 超过大小上限时删除最久未用的文件。
+  class FileCache : public cb::Mutex {
+    std::string path;      // 缓存目录，为空时缓存不可用。
+    std::string extension; // 缓存文件的扩展名，包括 '.'。
+    uint64_t maxSize;      // 缓存文件总大小的上限，单位是字节。
+    bool enabled;
+
+  public:
+    static const uint64_t defaultMaxSize = 1024 * 1024 * 1024; // 1 GiB
+
+    FileCache(const std::string &path, const std::string &extension,
+              uint64_t maxSize = defaultMaxSize);
+    virtual ~FileCache() {}
+
+    // 环境变量env设置时返回它的值，否则返回用户缓存目录下的 camotics/name。
+    static std::string getDefaultPath(const char *env, const std::string &name);
+
+    const std::string &getPath() const {return path;}
+    void setPath(const std::string &path) {this->path = path;}
+    uint64_t getMaxSize() const {return maxSize;}
+    void setMaxSize(uint64_t maxSize) {this->maxSize = maxSize;}
+    bool isEnabled() const {return enabled && !path.empty();}
+    void setEnabled(bool enabled) {this->enabled = enabled;}
+
+    void evict();
+
+  protected:
+    std::string getFilename(const std::string &hash) const;
+  };
+}
@@ -0,0 +1,83 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "IncrementalBVH.h"
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+void IncrementalBVH::insert(unsigned move, const Rectangle3D &bbox) {
+  pending.push_back(make_pair(move, bbox));
+}
+
+
+bool IncrementalBVH::intersects(const Rectangle3D &r) const {
+  for (unsigned i = 0; i < levels.size(); i++)
+    if (levels[i]->intersects(r)) return true;
+
+  return false;
+}
+
+
+void IncrementalBVH::collisions(const Vector3D &p,
+                                vector<unsigned> &moves) const {
+  for (unsigned i = 0; i < levels.size(); i++)
+    levels[i]->collisions(p, moves);
+}
+
+
+unsigned IncrementalBVH::getHeight() const {
+  unsigned height = 0;
+
+  for (unsigned i = 0; i < levels.size(); i++)
+    if (height < levels[i]->getHeight()) height = levels[i]->getHeight();
+
+  return height;
+}
+
+
+void IncrementalBVH::finalize() {
+  if (pending.empty()) return;
+
+  SmartPointer<BVH> bvh = new BVH;
+  unsigned count = pending.size();
+
+  for (unsigned i = 0; i < pending.size(); i++)
+    bvh->insert(pending[i].first, pending[i].second);
+
+  pending.clear();
+
+  // 合并不比新树大的BVH。BVH中的包围盒已经向外取整成float，再取整一次不会变化。
+  while (!levels.empty() && levels.back()->getItemCount() <= count) {
+    const BVH &level = *levels.back();
+
+    for (unsigned i = 0; i < level.getItemCount(); i++)
+      bvh->insert(level.getMove(i), level.getItemBounds(i));
+
+    count += level.getItemCount();
+    levels.pop_back();
+  }
+
+  bvh->finalize();
+  bounds.add(bvh->getBounds());
+  levels.push_back(bvh);
+}
@@ -0,0 +1,62 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "BVH.h"
+
+#include <cbang/SmartPointer.h>
+
+#include <vector>
+#include <utility>
+
+
+namespace CAMotics {
+  // 在finalize()之后还可以继续插入移动的BVH，用于边解释G代码边模拟。每次
+  // finalize()把新插入的移动建成一棵BVH，并与不比它大的已有BVH合并重建
+  // （Bentley-Saxe），因此最多有O(log n)棵BVH，每个移动最多重建O(log n)次。
+  class IncrementalBVH : public MoveLookup {
+    std::vector<cb::SmartPointer<BVH> > levels; // 按移动数量从大到小排列。
+    std::vector<std::pair<unsigned, cb::Rectangle3D> > pending; // 还没有建树的移动。
+    cb::Rectangle3D bounds;
+
+  public:
+    unsigned getLevelCount() const {return levels.size();}
+    const BVH &getLevel(unsigned i) const {return *levels.at(i);}
+
+    // 与BVH::visit()相同，依次遍历每一棵BVH。
+    template <typename Func>
+    bool visit(const cb::Vector3D &p, Func &visitor) const {
+      for (unsigned i = 0; i < levels.size(); i++)
+        if (levels[i]->visit(p, visitor)) return true;
+
+      return false;
+    }
+
+    // From MoveLookup
+    cb::Rectangle3D getBounds() const {return bounds;}
+    void insert(unsigned move, const cb::Rectangle3D &bbox);
+    bool intersects(const cb::Rectangle3D &r) const;
+    void collisions(const cb::Vector3D &p,
+                    std::vector<unsigned> &moves) const;
+    unsigned getHeight() const;
+    void finalize();
+  };
+}
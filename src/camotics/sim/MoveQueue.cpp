@@ -0,0 +1,98 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "MoveQueue.h"
+
+#include <cbang/util/SmartLock.h>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+MoveQueue::MoveQueue(unsigned batchSize, unsigned maxBatches) :
+  batchSize(batchSize), maxBatches(maxBatches) {
+  batch.reserve(batchSize);
+}
+
+
+bool MoveQueue::isClosed() const {
+  SmartLock lock(this);
+  return closed;
+}
+
+
+void MoveQueue::close() {
+  SmartLock lock(this);
+  if (closed) return;
+
+  flush();
+  closed = true;
+  broadcast();
+}
+
+
+void MoveQueue::cancel() {
+  SmartLock lock(this);
+
+  closed = true;
+  batches.clear();
+  broadcast();
+}
+
+
+bool MoveQueue::next(vector<GCode::Move> &moves) {
+  SmartLock lock(this);
+
+  moves.clear();
+  while (batches.empty() && !closed) wait();
+  if (batches.empty()) return false;
+
+  // 模拟跟不上解释时一次取走所有批，减少渲染的次数
+  moves.swap(batches.front());
+  batches.pop_front();
+
+  for (; !batches.empty(); batches.pop_front())
+    moves.insert(moves.end(), batches.front().begin(), batches.front().end());
+
+  broadcast();
+
+  return true;
+}
+
+
+void MoveQueue::move(GCode::Move &move) {
+  batch.push_back(move);
+  if (batchSize <= batch.size()) flush();
+}
+
+
+void MoveQueue::flush() {
+  if (batch.empty()) return;
+
+  SmartLock lock(this);
+  while (maxBatches <= batches.size() && !closed) wait();
+
+  // 队列关闭后不再有消费者，丢弃剩下的移动
+  if (!closed) batches.push_back(batch);
+
+  batch.clear();
+  broadcast();
+}
@@ -0,0 +1,62 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <gcode/MoveStream.h>
+
+#include <cbang/os/Condition.h>
+
+#include <vector>
+#include <deque>
+
+
+namespace CAMotics {
+  // 解释G代码的线程和模拟线程之间有界的移动队列。生产者按batchSize个移动
+  // 一批放入队列，队列中已有maxBatches批时阻塞，直到消费者取走。
+  class MoveQueue : public GCode::MoveStream, public cb::Condition {
+    unsigned batchSize;
+    unsigned maxBatches;
+
+    std::vector<GCode::Move> batch; // 生产者正在填充的一批。
+    std::deque<std::vector<GCode::Move> > batches;
+    bool closed = false;
+
+  public:
+    MoveQueue(unsigned batchSize = 4096, unsigned maxBatches = 16);
+
+    bool isClosed() const;
+
+    // 生产者结束时调用，放入还没有满的一批，之后next()取空队列后返回false。
+    void close();
+
+    // 消费者中断时调用，丢弃队列中的移动，阻塞的生产者会返回，之后的移动都被丢弃。
+    void cancel();
+
+    // 等待并取出队列中的所有移动，队列关闭并且取空后返回false。
+    bool next(std::vector<GCode::Move> &moves);
+
+    // From GCode::MoveStream
+    void move(GCode::Move &move);
+
+  protected:
+    void flush();
+  };
+}
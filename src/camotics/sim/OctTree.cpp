@@ -39,9 +39,9 @@ OctTree::OctNode::~OctNode() {
 }
 
 // OctNode类的insert方法的实现，它与头文件中的声明一致，没有任何变化。
-// 用于将一个移动对象插入到节点中。移动对象是一个GCode::Move类的指针，它表示三维空间中的一次移动操作。
+// 用于将一个移动对象插入到节点中。移动对象由它在路径中的下标表示，它表示三维空间中的一次移动操作。
 // 移动对象有一个边界框属性，它是一个cb::Rectangle3D类的对象，它表示移动对象所占据的最小矩形区域。
-void OctTree::OctNode::insert(const GCode::Move *move,
+void OctTree::OctNode::insert(unsigned move,
                               const Rectangle3D &bbox) {
     // 首先，判断移动对象的边界框是否与节点所代表的空间区域相交。如果不相交，则直接返回，不做任何操作。
   if (!bounds.intersects(bbox)) return;
@@ -107,7 +107,7 @@ bool OctTree::OctNode::intersects(const Rectangle3D &r) const {
 
 // OctNode类的collisions方法的实现，它与头文件中的声明一致，没有任何变化。
 void OctTree::OctNode::collisions(const Vector3D &p,
-                                  vector<const GCode::Move *> &moves) const {
+                                  vector<unsigned> &moves) const {
   if (!bounds.contains(p)) return;
 
   moves.insert(moves.end(), this->moves.begin(), this->moves.end());
@@ -131,7 +131,7 @@ OctTree::~OctTree() {
 }
 
 // OctTree类的insert方法的实现，它与头文件中的声明一致，没有任何变化。
-void OctTree::insert(const GCode::Move *move, const Rectangle3D &bbox) {
+void OctTree::insert(unsigned move, const Rectangle3D &bbox) {
   this->bbox.add(bbox);
   root->insert(move, bbox);
 }
@@ -143,6 +143,6 @@ bool OctTree::intersects(const Rectangle3D &r) const {
 
 // OctTree类的collisions方法的实现，它与头文件中的声明一致，没有任何变化。
 void OctTree::collisions(const Vector3D &p,
-                         vector<const GCode::Move *> &moves) const {
+                         vector<unsigned> &moves) const {
   root->collisions(p, moves);
 }
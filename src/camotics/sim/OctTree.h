@@ -37,16 +37,16 @@ namespace CAMotics {
       unsigned depth; // 表示节点在树中的深度，根节点的深度为0。
 
       OctNode *children[8]; // 表示节点的八个子节点的指针数组，如果某个子节点不存在，则对应的指针为NULL。
-      std::set<const GCode::Move *> moves; // 表示节点所包含的移动对象的集合。GCode::Move是一个自定义的类，它表示三维空间中的一次移动操作。
+      std::set<unsigned> moves; // 表示节点所包含的移动对象的下标集合。GCode::Move是一个自定义的类，它表示三维空间中的一次移动操作。
 
     public:
       OctNode(const cb::Rectangle3D &bounds, unsigned depth); // 构造函数，它用于初始化节点对象，并将其所有子节点指针设为NULL。
       ~OctNode(); // 析构函数，它用于释放节点对象占用的内存，并递归地删除其所有子节点对象。
 
-      void insert(const GCode::Move *move, const cb::Rectangle3D &bbox); // 用于将一个移动对象插入到节点中。如果移动对象与节点所代表的空间区域相交，则将其加入到节点所包含的移动对象集合中，并根据需要创建子节点，并将移动对象插入到相应的子节点中。
+      void insert(unsigned move, const cb::Rectangle3D &bbox); // 用于将一个移动对象插入到节点中。如果移动对象与节点所代表的空间区域相交，则将其加入到节点所包含的移动对象集合中，并根据需要创建子节点，并将移动对象插入到相应的子节点中。
       bool intersects(const cb::Rectangle3D &r) const; // 用于判断节点所代表的空间区域是否与给定的矩形区域相交。如果相交，则返回true，否则返回false。
       void collisions(const cb::Vector3D &p,
-                      std::vector<const GCode::Move *> &moves) const; // 用于查找与给定点相交或包含该点的所有移动对象，并将它们加入到一个向量中。如果节点所代表的空间区域包含该点，则将节点所包含的所有移动对象加入到向量中，并递归地在其所有子节点中进行查找。如果节点所代表的空间区域与该点相交，但不包含该点，则只在其相交的子节点中进行查找。
+                      std::vector<unsigned> &moves) const; // 用于查找与给定点相交或包含该点的所有移动对象，并将它们加入到一个向量中。如果节点所代表的空间区域包含该点，则将节点所包含的所有移动对象加入到向量中，并递归地在其所有子节点中进行查找。如果节点所代表的空间区域与该点相交，但不包含该点，则只在其相交的子节点中进行查找。
     };
 
     OctNode *root; // 用于存储OctTree类对象的根节点的指针。
@@ -57,9 +57,9 @@ namespace CAMotics {
 
     // From MoveLookup
     cb::Rectangle3D getBounds() const {return bbox;} // 用于获取OctTree类对象的边界框，它是MoveLookup类的一个纯虚方法，具体实现来自MoveLookup。
-    void insert(const GCode::Move *move, const cb::Rectangle3D &bbox); // 用于将一个移动对象插入到OctTree类对象中，它是MoveLookup类的一个纯虚方法，因此必须在子类中实现。它调用了根节点对象的insert方法来完成插入操作。
+    void insert(unsigned move, const cb::Rectangle3D &bbox); // 用于将一个移动对象插入到OctTree类对象中，它是MoveLookup类的一个纯虚方法，因此必须在子类中实现。它调用了根节点对象的insert方法来完成插入操作。
     bool intersects(const cb::Rectangle3D &r) const; // 用于判断OctTree类对象是否与给定的矩形区域相交。它调用了根节点对象的intersects方法来完成判断操作。
     void collisions(const cb::Vector3D &p, // 用于查找与给定点相交或包含该点的所有移动对象，并将它们加入到一个向量中。它调用了根节点对象的collisions方法来完成查找操作。
-                    std::vector<const GCode::Move *> &moves) const;
+                    std::vector<unsigned> &moves) const;
   };
 }
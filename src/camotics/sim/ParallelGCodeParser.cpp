@@ -0,0 +1,198 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "ParallelGCodeParser.h"
+
+#include <camotics/ThreadPool.h>
+
+#include <gcode/parse/FastParser.h>
+
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/util/SmartLock.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+ParallelGCodeParser::ParallelGCodeParser(const char *data, uint64_t size,
+                                         const string &filename) :
+  data(data), size(size), filename(filename), split(data), line(1) {
+  // 每个线程保留两块，解释器取走一块时下一块通常已经解析完。
+  maxChunks = 2 * ThreadPool::instance().getThreads();
+}
+
+
+ParallelGCodeParser::~ParallelGCodeParser() {
+  // 工作线程引用了this，必须等它们全部结束。
+  lock();
+  while (outstanding) timedWait(0.25);
+  unlock();
+}
+
+
+double ParallelGCodeParser::getProgress() const {
+  if (!size) return 1;
+  if (serial.isSet())
+    return (serialOffset + serial->getOffset()) / (double)size;
+  if (chunks.empty()) return (split - data) / (double)size;
+  return (chunks.front()->begin - data) / (double)size;
+}
+
+
+bool ParallelGCodeParser::hasMore() const {
+  if (serial.isSet()) return serial->hasMore();
+  return !chunks.empty() || split < data + size;
+}
+
+
+SmartPointer<GCode::Block> ParallelGCodeParser::next() {
+  while (serial.isNull()) {
+    dispatch();
+
+    // 最后一块可能只有空白，没有任何结果。
+    if (chunks.empty()) {
+      vector<SmartPointer<GCode::Entity> > none;
+      return new GCode::Block(false, -1, none);
+    }
+
+    SmartPointer<Chunk> chunk = chunks.front();
+
+    lock();
+    while (!chunk->done) timedWait(0.25);
+    unlock();
+
+    if (!chunk->independent) {
+      fallback(*chunk);
+      break;
+    }
+
+    if (index < chunk->results.size()) {
+      Result result = chunk->results[index++];
+
+      // 用完的块立即释放，它的块已经交给了解释器。
+      if (index == chunk->results.size()) {
+        chunks.pop_front();
+        index = 0;
+      }
+
+      if (result.error.isSet()) throw *result.error;
+      return result.block;
+    }
+
+    chunks.pop_front();
+    index = 0;
+  }
+
+  return serial->next();
+}
+
+
+void ParallelGCodeParser::dispatch() {
+  const char *end = data + size;
+
+  while (chunks.size() < maxChunks && split < end) {
+    // 块在chunkSize之后的第一个换行处结束。
+    const char *chunkEnd = end;
+    if (chunkSize < (uint64_t)(end - split)) {
+      const char *start = split + chunkSize;
+      const char *eol = (const char *)memchr(start, '\n', end - start);
+      if (eol) chunkEnd = eol + 1;
+    }
+
+    SmartPointer<Chunk> chunk = new Chunk(split, chunkEnd, line);
+    line += count(split, chunkEnd, '\n');
+    split = chunkEnd;
+    chunks.push_back(chunk);
+
+    lock();
+    outstanding++;
+    unlock();
+
+    try {
+      ThreadPool::instance().add([this, chunk] (unsigned worker) {
+          parse(*chunk);
+        });
+
+    } catch (const std::exception &e) {
+      LOG_WARNING("Failed to queue parse of " << filename << " at line "
+                  << chunk->line << ": " << e.what());
+
+      // 没有加入线程池的块标记为完成但不独立，解释器从这里开始串行解析。
+      SmartLock lock(this);
+      outstanding--;
+      chunk->independent = false;
+      chunk->done = true;
+      broadcast();
+      break;
+    }
+  }
+}
+
+
+void ParallelGCodeParser::parse(Chunk &chunk) {
+  vector<Result> results;
+  bool independent = false;
+
+  try {
+    GCode::FastParser parser(chunk.begin, chunk.end - chunk.begin, filename,
+                             chunk.line);
+
+    // 一旦发现跨行状态，这一块的结果就没有用了。
+    while (parser.hasMore() && parser.isIndependent()) {
+      Result result;
+
+      try {
+        result.block = parser.next();
+      } catch (const Exception &e) {
+        result.error = new Exception(e);
+      }
+
+      results.push_back(result);
+    }
+
+    independent = parser.isIndependent();
+  } CATCH_ERROR;
+
+  SmartLock lock(this);
+  chunk.results.swap(results);
+  chunk.independent = independent;
+  chunk.done = true;
+  outstanding--;
+  broadcast();
+}
+
+
+void ParallelGCodeParser::fallback(const Chunk &chunk) {
+  LOG_INFO(1, "Parsing " << filename << " serially from line " << chunk.line);
+
+  serialOffset = chunk.begin - data;
+  serial = new GCode::FastParser
+    (chunk.begin, data + size - chunk.begin, filename, chunk.line);
+
+  // 其余已提交的块被丢弃，工作线程完成后会释放它们。
+  chunks.clear();
+  index = 0;
+  split = data + size;
+}
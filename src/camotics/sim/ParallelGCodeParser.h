@@ -0,0 +1,93 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <gcode/Producer.h>
+
+#include <cbang/SmartPointer.h>
+#include <cbang/Exception.h>
+#include <cbang/os/Condition.h>
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <cinttypes>
+
+
+namespace GCode {class FastParser;}
+
+namespace CAMotics {
+  // 把内存中的G代码在行边界处切成若干块，在线程池上用GCode::FastParser并行解析，
+  // 再按文件顺序把块交给解释器。某一块含有O代码或跨行注释等跨行状态时，
+  // 从这一块开始退回到串行解析。
+  class ParallelGCodeParser : public GCode::Producer, public cb::Condition {
+    struct Result { // 一个块的解析结果，解析出错时只有error。
+      cb::SmartPointer<GCode::Block> block;
+      cb::SmartPointer<cb::Exception> error;
+    };
+
+    struct Chunk {
+      const char *begin;
+      const char *end;
+      int line;                 // 第一行的行号。
+      bool done = false;        // 由工作线程在加锁后设置。
+      bool independent = true;  // 为false时这一块必须串行解析。
+      std::vector<Result> results;
+
+      Chunk(const char *begin, const char *end, int line) :
+        begin(begin), end(end), line(line) {}
+    };
+
+    const char *data;
+    uint64_t size;
+    std::string filename;
+
+    const char *split;   // 下一块的开始位置。
+    int line;            // 下一块第一行的行号。
+    unsigned maxChunks;  // 同时提交给线程池的最大块数，限制内存占用。
+    unsigned outstanding = 0;
+
+    std::deque<cb::SmartPointer<Chunk> > chunks; // 已提交的块，按文件顺序排列。
+    unsigned index = 0;  // 第一块中下一个要返回的结果。
+
+    cb::SmartPointer<GCode::FastParser> serial; // 退回串行解析后使用。
+    uint64_t serialOffset = 0;
+
+  public:
+    static const unsigned chunkSize = 256 * 1024; // 每块的最小字节数。
+
+    ParallelGCodeParser(const char *data, uint64_t size,
+                        const std::string &filename);
+    ~ParallelGCodeParser();
+
+    bool isSerial() const {return serial.isSet();}
+    double getProgress() const;
+
+    // From GCode::Producer
+    bool hasMore() const;
+    cb::SmartPointer<GCode::Block> next();
+
+  protected:
+    void dispatch();
+    void parse(Chunk &chunk);
+    void fallback(const Chunk &chunk);
+  };
+}
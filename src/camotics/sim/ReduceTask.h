@@ -22,6 +22,7 @@
 
 
 #include <camotics/Task.h>
+#include <camotics/contour/ReduceMode.h>
 
 #include <cbang/SmartPointer.h>
 
@@ -30,12 +31,14 @@ namespace CAMotics {
   class Surface;
 
   class ReduceTask : public Task { // 表示一个简化表面的任务。这个类继承了Task类，表示一个异步的任务，用来执行模拟的计算。这个类有以下特点：
+    ReduceMode mode; // mode成员变量，表示简化使用的算法。
     cb::SmartPointer<Surface> surface; // surface成员变量，是一个Surface对象的智能指针。Surface对象表示一个三维的表面，由一组顶点和三角形组成。
 
   public:
-    ReduceTask(const cb::SmartPointer<Surface> &surface); // 构造函数，接受一个Surface对象的智能指针作为参数，用来初始化surface。
+    ReduceTask(const cb::SmartPointer<Surface> &surface,
+               ReduceMode mode = ReduceMode::HASH_MODE); // 构造函数，接受一个Surface对象的智能指针和简化算法作为参数，用来初始化surface和mode。
 
-    const cb::SmartPointer<Surface> &getSurface() const {return surface; // getSurface方法，返回surface的常量引用。
+    const cb::SmartPointer<Surface> &getSurface() const {return surface;} // getSurface方法，返回surface的常量引用。
 
     // From Task
     void run(); // run方法，重写了父类Task的虚函数。这个方法用来对surface进行简化，减少顶点和三角形的数量，提高渲染效率。这个方法会调用surface的reduce方法进行简化。
@@ -22,6 +22,7 @@
 
 
 #include "Workpiece.h"
+#include "LookupMode.h"
 
 #include <gcode/ToolTable.h>
 #include <gcode/ToolPath.h>
@@ -52,6 +53,8 @@ namespace CAMotics {
     double resolution; // resolution成员变量，是一个双精度浮点数。它表示模拟的分辨率，单位是米。
     double time; // time成员变量，是一个双精度浮点数。它表示模拟的时间，单位是秒。
     RenderMode mode; // mode成员变量，是一个RenderMode枚举类型。它表示模拟的渲染模式，可以是实体模式、线框模式或者混合模式。
+    LookupMode lookupMode = LookupMode::BVH_MODE; // lookupMode成员变量，是一个LookupMode枚举类型。它表示ToolSweep使用的移动查找结构，不影响模拟结果，因此不参与序列化。
+    bool cache = true; // cache成员变量，是一个布尔值。为真时SimulationRun先在SurfaceCache中查找结果，并把新计算的表面存入缓存。它不参与序列化。
     unsigned threads; // threads成员变量，是一个无符号整数。它表示模拟使用的线程数量。
 
     Simulation(const cb::SmartPointer<GCode::ToolPath> &path,
@@ -20,20 +20,77 @@
 
 #include "SimulationRun.h"
 #include "Simulation.h"
+#include "SurfaceCache.h"
+#include "MoveQueue.h"
+#include "BVH.h"
 
 #include <camotics/contour/TriangleSurface.h>
 #include <camotics/contour/GridTree.h>
 #include <camotics/render/Renderer.h>
 #include <camotics/sim/CutWorkpiece.h>
+#include <camotics/sim/Sweep.h>
 
 #include <cbang/log/Logger.h>
 #include <cbang/time/TimeInterval.h>
 #include <cbang/time/Timer.h>
 
+#include <limits>
+#include <vector>
+
 using namespace cb;
 using namespace CAMotics;
 
 
+namespace {
+  // 移动在time时已经切削过的线段。移动在time时还没有开始或没有刀具时返回false。
+  bool getCut(const GCode::ToolPath &path, unsigned i, double time,
+              Vector3D &start, Vector3D &end) {
+    if (path.getTool(i) < 0 || time < path.getStartTime(i)) return false;
+
+    start = path.getStartPt(i);
+    end = path.getPtAtTime(i, time);
+
+    return true;
+  }
+
+
+  bool sameGeometry(const GCode::ToolPath &a, unsigned i,
+                    const GCode::ToolPath &b, unsigned j) {
+    return a.getEndPt(i) == b.getEndPt(j) &&
+      a.getStartPt(i) == b.getStartPt(j) && a.getTool(i) == b.getTool(j);
+  }
+
+
+  // 流式模拟中一轮要渲染的区域：与settled中的移动相交，但不完全落在deferred的
+  // 某个包围盒内。后一个条件对子区域同样成立，所以Renderer按区域剔除和轮廓生成器
+  // 按单元剔除的结果一致，被推迟的单元都与deferred相交，下一轮一定会被渲染。
+  class StreamChange : public MoveLookup {
+    SmartPointer<BVH> settled;
+    SmartPointer<BVH> deferred;
+
+  public:
+    StreamChange(const SmartPointer<BVH> &settled,
+                 const SmartPointer<BVH> &deferred) :
+      settled(settled), deferred(deferred) {}
+
+    // From MoveLookup
+    Rectangle3D getBounds() const {return settled->getBounds();}
+    void insert(unsigned move, const Rectangle3D &bbox) {
+      THROW("Cannot insert into stream change");
+    }
+
+    bool intersects(const Rectangle3D &r) const {
+      return settled->intersects(r) &&
+        (deferred.isNull() || !deferred->contains(r));
+    }
+
+    void collisions(const Vector3D &p, std::vector<unsigned> &moves) const {
+      settled->collisions(p, moves);
+    }
+  };
+}
+
+
 SimulationRun::SimulationRun(const Simulation &sim) : sim(sim), lastTime(-1) {}
 
 
@@ -41,9 +98,34 @@ SimulationRun::~SimulationRun() {}
 
 
 SmartPointer<MoveLookup> SimulationRun::getMoveLookup() const {
-  if (!sweep.isNull() && !sweep->getChange().isNull())
-    return sweep->getChange();
-  return sweep;
+  if (sweep.isNull()) return 0;
+
+  if (!sweep->getChange().isNull()) {
+    const ToolSweep *change =
+      dynamic_cast<const ToolSweep *>(sweep->getChange().get());
+    return change ? change->getLookup() : sweep->getChange();
+  }
+
+  return sweep->getLookup();
+}
+
+
+void SimulationRun::update(const Simulation &sim) {
+  // tree只有在网格和切削结果的含义都不变时才能重用
+  bool reuse = tree.isSet() && this->sim.path.isSet() && sim.path.isSet() &&
+    this->sim.workpiece.getBounds() == sim.workpiece.getBounds() &&
+    this->sim.resolution == sim.resolution && this->sim.mode == sim.mode &&
+    this->sim.path->getTools().toString() == sim.path->getTools().toString();
+
+  if (!reuse) {
+    sweep.release();
+    tree.release();
+    lastPath.release();
+
+  } else if (lastPath.isNull() && this->sim.path != sim.path)
+    lastPath = this->sim.path; // tree中是这条路径在lastTime时的结果
+
+  this->sim = sim;
 }
 
 
@@ -58,10 +140,26 @@ SmartPointer<Surface> SimulationRun::compute(Task &task) { // 这个方法接受
 
   LOG_INFO(1, "Computing surface at " << TimeInterval(simTime));
 
+  // Check the surface cache before a full render
+  SurfaceCache &cache = SurfaceCache::instance();
+  bool useCache = sweep.isNull() && sim.cache && cache.isEnabled(); // 只有完整渲染才使用缓存，增量渲染依赖tree中已有的数据。
+  std::string hash;
+
+  if (useCache) {
+    Simulation key = sim; // 用实际的模拟时间计算hash，这样时间超过路径总时间的模拟共用同一个缓存项。
+    key.time = simTime;
+    hash = key.computeHash();
+
+    SmartPointer<Surface> surface = cache.get(hash);
+    if (surface.isSet()) return surface;
+  }
+
   // Build full sweep once OR for each file
   if (sweep.isNull()) { // 接着，判断sweep是否为空。如果为空，则说明是第一次进行模拟，需要创建一个ToolSweep对象，并将其赋值给sweep。ToolSweep对象表示一个工具扫过的形状，用来模拟切割过程。这个对象根据sim中的工具路径创建，并覆盖整个时间段。然后，根据sim中的工件获取其边界，并将其扩大一点作为bbox。接着，创建一个GridTree对象，并将其赋值给tree。GridTree对象表示一个网格树，用来存储和查询表面的数据。这个对象根据bbox和sim中的分辨率创建一个网格。
     // GCode::Tool sweep
-    sweep = new ToolSweep(sim.path); // Build sweep for entire time period
+    // Build sweep for entire time period
+    sweep = new ToolSweep(sim.path, 0, std::numeric_limits<double>::max(),
+                          sim.lookupMode);
 
     // Bounds, increased a little
     bbox = sim.workpiece.getBounds().grow(sim.resolution * 0.9);
@@ -69,6 +167,24 @@ SmartPointer<Surface> SimulationRun::compute(Task &task) { // 这个方法接受
     // Grid
     tree = new GridTree(Grid(bbox, sim.resolution));
 
+  } else if (lastPath.isSet()) { // 如果调用update()换了工具路径，则比较新旧路径，只重新渲染切削形状有变化的移动覆盖的区域，tree中其他部分的结果保持不变。
+    SmartPointer<MoveLookup> change =
+      diff(*lastPath, lastTime, *sim.path, simTime);
+
+    lastPath.release();
+
+    sweep = new ToolSweep(sim.path, 0, std::numeric_limits<double>::max(),
+                          sim.lookupMode);
+
+    if (change.isNull()) { // 切削形状没有变化，不需要渲染
+      sweep->setEndTime(simTime);
+      lastTime = simTime;
+      return new TriangleSurface(*tree);
+    }
+
+    sweep->setChange(change);
+    bbox = change->getBounds().grow(sim.resolution * 1.1);
+
   } else { // 如果sweep不为空，则说明是继续进行模拟，需要更新sweep中的移动查找器。移动查找器是一个存储和查询GCode::Move对象的结构，表示G代码中的移动指令。首先计算出最小和最大的时间，分别表示模拟的起始和结束时间。然后创建一个ToolSweep对象，并将其赋值给change。这个对象根据sim中的工具路径和最小和最大时间创建，并只覆盖这个时间段。然后调用sweep的setChange方法，将change设置为sweep中的移动查找器。接着，根据change获取其边界，并将其扩大一点作为bbox。
     double minTime = simTime;
     double maxTime = simTime;
@@ -76,7 +192,8 @@ SmartPointer<Surface> SimulationRun::compute(Task &task) { // 这个方法接受
     if (lastTime < minTime) minTime = lastTime;
     if (maxTime < lastTime) maxTime = lastTime;
 
-    SmartPointer<MoveLookup> change = new ToolSweep(sim.path, minTime, maxTime);
+    SmartPointer<MoveLookup> change =
+      new ToolSweep(sim.path, minTime, maxTime, sim.lookupMode);
     sweep->setChange(change);
     bbox = change->getBounds().grow(sim.resolution * 1.1);
   }
@@ -101,5 +218,165 @@ SmartPointer<Surface> SimulationRun::compute(Task &task) { // 这个方法接受
 
   // Extract surface
   lastTime = simTime; //  最后，更新lastTime为simTime，并返回一个TriangleSurface对象的智能指针。TriangleSurface对象表示一个三维的表面，由一组顶点和三角形组成。这个对象根据tree创建。
-  return new TriangleSurface(*tree);
+  SmartPointer<Surface> surface = new TriangleSurface(*tree);
+  if (useCache) cache.put(hash, *surface); // 把新计算的表面存入缓存。
+
+  return surface;
+}
+
+
+SmartPointer<Surface> SimulationRun::stream(Task &task, MoveQueue &queue,
+                                           const partial_t &partial) {
+  if (!sim.path->empty()) THROW("Stream simulation requires an empty path");
+
+  double start = Timer::now();
+
+  LOG_INFO(1, "Streaming surface to " << TimeInterval(sim.time));
+
+  // 只加入sim.time之前的移动，与compute()从0到sim.time的结果相同
+  sweep = new ToolSweep(sim.path, 0, sim.time, sim.lookupMode, true);
+  Rectangle3D bounds = sim.workpiece.getBounds().grow(sim.resolution * 0.9);
+  tree = new GridTree(Grid(bounds, sim.resolution));
+  lastPath.release();
+
+  CutWorkpiece cutWP(sweep, sim.workpiece);
+  Renderer renderer(task);
+
+  // 先完整渲染还没有切削的毛坯，之后每一轮只更新移动覆盖的区域。这与compute()
+  // 先完整渲染再增量渲染的过程相同，远离移动的毛坯表面也会出现在结果中。
+  renderer.render(cutWP, *tree, bounds, sim.threads, sim.mode);
+
+  std::vector<GCode::Move> moves;
+  SmartPointer<BVH> deferred; // 最新一批移动的包围盒
+  unsigned passes = 0;
+
+  while (!task.shouldQuit()) {
+    SmartPointer<BVH> added;
+
+    if (queue.next(moves)) {
+      unsigned first = sim.path->size();
+      for (unsigned i = 0; i < moves.size(); i++) sim.path->move(moves[i]);
+
+      added = new BVH;
+      sweep->append(first, added.get());
+      added->finalize();
+
+    } else if (deferred.isNull() || task.shouldQuit()) break;
+
+    // 渲染上一批移动覆盖的区域，队列取空后最后一批不再推迟
+    SmartPointer<BVH> settled = deferred;
+    deferred = added;
+    if (settled.isNull() || !settled->getItemCount()) continue;
+
+    sweep->setChange(new StreamChange(settled, deferred));
+    Rectangle3D bbox = settled->getBounds().grow(sim.resolution * 1.1);
+    renderer.render(cutWP, *tree, bbox, sim.threads, sim.mode);
+    passes++;
+
+    if (partial && !task.shouldQuit()) partial(new TriangleSurface(*tree));
+  }
+
+  if (task.shouldQuit()) {
+    queue.cancel();
+    sweep.release();
+    tree.release();
+    return 0;
+  }
+
+  LOG_DEBUG(1, "Stream time " << TimeInterval(Timer::now() - start)
+            << " moves=" << sim.path->size() << " passes=" << passes);
+
+  // 分批渲染的三角形与compute()的结果不完全相同，所以不存入表面缓存
+  SmartPointer<Surface> surface = new TriangleSurface(*tree);
+  lastTime = std::min(sim.path->getTime(), sim.time);
+
+  // sweep中没有sim.time之后的移动，更换时间后需要完整渲染
+  if (sim.time < sim.path->getTime()) {
+    sweep.release();
+    tree.release();
+
+  } else sweep->setChange(0);
+
+  return surface;
+}
+
+
+SmartPointer<MoveLookup>
+SimulationRun::diff(const GCode::ToolPath &oldPath, double oldTime,
+                    const GCode::ToolPath &newPath, double newTime) const {
+  SmartPointer<MoveLookup> change = ToolSweep::createLookup(sim.lookupMode);
+  GCode::ToolTable &tools = sim.path->getTools();
+  std::vector<SmartPointer<Sweep> > sweeps;
+  std::vector<Rectangle3D> bboxes;
+  unsigned boxes = 0;
+  unsigned changed = 0;
+
+  // 把移动在time时切削过的部分的包围盒加入change
+  auto add = [&] (const GCode::ToolPath &path, unsigned i, double time) {
+    Vector3D start, end;
+    if (!getCut(path, i, time, start, end)) return;
+
+    unsigned tool = path.getTool(i);
+    if (sweeps.size() <= tool) sweeps.resize(tool + 1);
+    if (sweeps[tool].isNull())
+      sweeps[tool] = ToolSweep::getSweep(tools.get(tool));
+
+    sweeps[tool]->getBBoxes(start, end, bboxes);
+    for (unsigned j = 0; j < bboxes.size(); j++)
+      change->insert(i, bboxes[j]);
+
+    boxes += bboxes.size();
+    bboxes.clear();
+  };
+
+  // 比较对齐的一对移动，切削过的部分不同时两者都算作变化
+  auto compare = [&] (unsigned a, unsigned b) {
+    Vector3D aStart, aEnd, bStart, bEnd;
+    bool aCut = getCut(oldPath, a, oldTime, aStart, aEnd);
+    bool bCut = getCut(newPath, b, newTime, bStart, bEnd);
+
+    if (aCut == bCut &&
+        (!aCut || (oldPath.getTool(a) == newPath.getTool(b) &&
+                   aStart == bStart && aEnd == bEnd)))
+      return;
+
+    add(oldPath, a, oldTime);
+    add(newPath, b, newTime);
+    changed++;
+  };
+
+  // 按几何形状找出相同的开头和结尾，插入或删除几行不会使后面所有的移动都算作变化。
+  // 只改变进给速度时几何形状相同，只有时间不同。
+  unsigned oldSize = oldPath.size();
+  unsigned newSize = newPath.size();
+  unsigned prefix = 0;
+  unsigned suffix = 0;
+
+  while (prefix < oldSize && prefix < newSize &&
+         sameGeometry(oldPath, prefix, newPath, prefix))
+    prefix++;
+
+  while (suffix < oldSize - prefix && suffix < newSize - prefix &&
+         sameGeometry(oldPath, oldSize - suffix - 1,
+                      newPath, newSize - suffix - 1))
+    suffix++;
+
+  for (unsigned i = 0; i < prefix; i++) compare(i, i);
+  for (unsigned i = 1; i <= suffix; i++)
+    compare(oldSize - i, newSize - i);
+
+  // 中间不能对齐的移动全部算作变化
+  for (unsigned i = prefix; i < oldSize - suffix; i++, changed++)
+    add(oldPath, i, oldTime);
+  for (unsigned i = prefix; i < newSize - suffix; i++, changed++)
+    add(newPath, i, newTime);
+
+  LOG_INFO(1, "Tool path changed: first divergent move=" << prefix
+           << " changed moves=" << changed);
+
+  if (!boxes) return 0;
+
+  change->finalize();
+
+  return change;
 }
@@ -25,6 +25,8 @@
 
 #include <cbang/SmartPointer.h>
 
+#include <functional>
+
 
 namespace CAMotics {
   class ToolSweep;
@@ -32,6 +34,7 @@ namespace CAMotics {
   class Surface;
   class MoveLookup;
   class Task;
+  class MoveQueue;
 
 
   class SimulationRun { // 表示一个切割模拟的运行过程。这个类用来根据一个Simulation对象的参数，计算出一个Surface对象的结果。这个类有以下特点：
@@ -39,6 +42,7 @@ namespace CAMotics {
     cb::SmartPointer<ToolSweep> sweep; // sweep成员变量，是一个ToolSweep对象的智能指针。ToolSweep对象表示一个工具扫过的形状，用来模拟切割过程。
     cb::SmartPointer<GridTree> tree; // tree成员变量，是一个GridTree对象的智能指针。GridTree对象表示一个网格树，用来存储和查询表面的数据。
 
+    cb::SmartPointer<GCode::ToolPath> lastPath; // lastPath成员变量，是上一次渲染tree时使用的工具路径。调用update()更换工具路径后用它与新路径比较，只重新渲染有变化的移动覆盖的区域。
     double lastTime = 0; // lastTime成员变量，是一个双精度浮点数。它表示模拟的最后一次更新的时间，单位是秒。
 
   public:
@@ -49,8 +53,24 @@ namespace CAMotics {
 
     cb::SmartPointer<MoveLookup> getMoveLookup() const; // getMoveLookup方法，返回sweep中的移动查找器的智能指针。移动查找器是一个存储和查询GCode::Move对象的结构，表示G代码中的移动指令。
 
+    void update(const Simulation &sim); // update方法，用新的模拟参数（通常是编辑后的工具路径）替换sim。如果工件、分辨率、渲染模式和工具表都没有变，则保留sweep和tree，下一次compute()只重新渲染变化的部分，否则下一次compute()完整渲染。
     void setEndTime(double endTime); // setEndTime方法，接受一个双精度浮点数作为参数，表示模拟的结束时间。这个方法用来设置sim中的时间，并根据时间调整sweep中的移动查找器。
 
     cb::SmartPointer<Surface> compute(Task &task); // compute方法，接受一个Task对象作为参数。这个方法用来根据sweep和workpiece计算出表面，并返回一个Surface对象的智能指针。这个方法会创建并更新tree，并调用其compute方法进行计算，并传入task作为参数。Task对象表示一个异步的任务，用来执行模拟的计算。
+
+    typedef std::function<void (const cb::SmartPointer<Surface> &)> partial_t;
+
+    // 边解释边模拟。sim.path必须是空的工具路径，从queue中取出的移动依次加入其中。
+    // 开始时完整渲染毛坯，之后每取到一批移动就渲染上一批移动覆盖的区域，完全落在最新一批移动包围盒内的
+    // 区域推迟到下一轮，因为刀具很可能还会回到那里。partial不为空时每一轮之后
+    // 用当前的表面调用它。工件的边界必须事先确定。
+    cb::SmartPointer<Surface> stream(Task &task, MoveQueue &queue,
+                                     const partial_t &partial = partial_t());
+
+  protected:
+    cb::SmartPointer<MoveLookup> diff(const GCode::ToolPath &oldPath,
+                                      double oldTime,
+                                      const GCode::ToolPath &newPath,
+                                      double newTime) const; // diff方法，比较旧路径在oldTime时和新路径在newTime时切削过的形状，返回所有有变化的移动的包围盒，没有变化时返回空指针。
   };
 }
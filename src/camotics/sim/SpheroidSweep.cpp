@@ -19,6 +19,7 @@
 \******************************************************************************/
 
 #include "SpheroidSweep.h"
+#include "SweepKernels.h"
 
 #include <gcode/Move.h>
 
@@ -50,6 +51,28 @@ namespace {
 }
 
 
+// 点p到球心的距离减去半径。椭球形的工具先缩放z轴，法向量是缩放后梯度乘以
+// scale，即原空间中的梯度方向。
+double SpheroidSweep::distance(const Vector3D &_p, Vector3D &normal) const {
+  const bool oblong = 2 * radius != length;
+
+  Vector3D v = _p;
+  if (oblong) v *= scale;
+  v = v - Vector3D(0, 0, radius);
+
+  const double d = v.length();
+  if (!d) {
+    normal = Vector3D(0, 0, -1);
+    return -radius;
+  }
+
+  if (oblong) v *= scale;
+  normal = v / v.length();
+
+  return d - radius;
+}
+
+
 double SpheroidSweep::depth(const Vector3D &_A, const Vector3D &_B, // depth方法：接受三个三维向量作为参数。这个方法用来计算空间中的一点到工具扫过的表面最近的距离的平方，如果这个点在表面内部，则返回正值，否则返回负值。这个方法做了以下步骤：
                             const Vector3D &_P) const {
   const double r = radius;
@@ -91,3 +114,50 @@ double SpheroidSweep::depth(const Vector3D &_A, const Vector3D &_B, // depth方
  // 最后，返回1，表示有碰撞。
   return 1;
 }
+
+
+// 批量计算一行点(xs[i], y, z)的深度。与x无关的部分只计算一次，其余交给SIMD内核。
+void SpheroidSweep::depth(const Vector3D &_A, const Vector3D &_B,
+                          const double *xs, double y, double z, unsigned n,
+                          double *out) const {
+  const double r = radius;
+
+  Vector3D A = _A;
+  Vector3D B = _B;
+  Vector3D P(1, y, z); // x由内核计算
+  double sx = 1;
+
+  // Handle oblong spheroids by scaling the z-axis
+  if (2 * radius != length) {
+    A *= scale;
+    B *= scale;
+    P *= scale;
+    sx = scale.x();
+  }
+
+  const Vector3D AB = B - A;
+  const double epsilon = AB.dot(AB);
+
+  // Check z-height
+  if (P.z() < min(A.z(), B.z()) || max(A.z(), B.z()) + 2 * r < P.z() ||
+      epsilon == 0) {
+    for (unsigned i = 0; i < n; i++) out[i] = -1;
+    return;
+  }
+
+  const double PAy = A.y() - P.y();
+  const double PAz = A.z() - P.z();
+
+  SpheroidRow row;
+  row.sx = sx;
+  row.ax = A.x();
+  row.abx = AB.x();
+  row.gy = AB.y() * PAy;
+  row.gz = AB.z() * (PAz + r);
+  row.ry = PAy * PAy;
+  row.rz = PAz * PAz;
+  row.k = 2 * r * (A.z() - P.z());
+  row.eps = epsilon;
+
+  SweepKernels::spheroid(row, xs, n, out);
+}
@@ -38,8 +38,13 @@ namespace CAMotics {
     void getBBoxes(const cb::Vector3D &start, const cb::Vector3D &end, // getBBoxes方法，重写了父类Sweep的纯虚函数。这个方法接受两个三维向量和一个向量的引用作为参数。这个方法用来根据工具从起始点到终止点的移动，计算出一系列包围盒，并将它们存储到参数向量中。包围盒是一种用来描述物体空间范围的矩形结构。
                    std::vector<cb::Rectangle3D> &bboxes,
                    double tolerance) const;
+    using Sweep::distance;
+    double distance(const cb::Vector3D &p, cb::Vector3D &normal) const; // 点p到椭球的有向距离。椭球形的工具在缩放后的空间中计算，距离只是近似值，法向量是准确的。
     double depth(const cb::Vector3D &start, const cb::Vector3D &end, // depth方法，重写了父类Sweep的纯虚函数。这个方法接受三个三维向量作为参数。这个方法用来计算空间中的一点到工具扫过的表面最近的距离的平方，如果这个点在表面内部，则返回正值，否则返回负值。
 
                  const cb::Vector3D &p) const;
+    void depth(const cb::Vector3D &start, const cb::Vector3D &end, // 用SIMD批量计算一行点的深度。
+               const double *xs, double y, double z, unsigned n,
+               double *out) const;
   };
 }
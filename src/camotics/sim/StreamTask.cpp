@@ -0,0 +1,100 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "StreamTask.h"
+#include "MoveQueue.h"
+#include "ToolPathTask.h"
+
+#include <camotics/project/Project.h>
+#include <camotics/contour/Surface.h>
+
+#include <cbang/Catch.h>
+#include <cbang/os/Thread.h>
+#include <cbang/log/Logger.h>
+
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  class PathThread : public Thread {
+    ToolPathTask &task;
+    MoveQueue &queue;
+
+  public:
+    PathThread(ToolPathTask &task, MoveQueue &queue) :
+      task(task), queue(queue) {}
+
+    // From cb::Thread
+    void run() {
+      try {
+        task.run();
+      } CATCH_ERROR;
+
+      queue.close();
+    }
+  };
+}
+
+
+StreamTask::StreamTask(const Project::Project &project,
+                       const Simulation &sim) : queue(new MoveQueue) {
+  Simulation streamSim = sim;
+  streamSim.path = new GCode::ToolPath(project.getTools());
+
+  pathTask = new ToolPathTask(project, sim.planConf.get(), queue);
+  simRun = new SimulationRun(streamSim);
+}
+
+
+StreamTask::~StreamTask() {}
+
+
+unsigned StreamTask::getErrorCount() const {return pathTask->getErrorCount();}
+
+
+const SmartPointer<GCode::ToolPath> &StreamTask::getPath() const {
+  return simRun->getSimulation().path;
+}
+
+
+void StreamTask::run() {
+  PathThread thread(*pathTask, *queue);
+  thread.start();
+
+  try {
+    surface = simRun->stream(*this, *queue, partial);
+  } CATCH_ERROR;
+
+  // 模拟提前结束时让阻塞在队列上的解释线程返回
+  if (surface.isNull()) {
+    queue->cancel();
+    pathTask->interrupt();
+  }
+
+  thread.join();
+}
+
+
+void StreamTask::interrupt() {
+  Task::interrupt();
+  pathTask->interrupt();
+  queue->cancel();
+}
@@ -0,0 +1,62 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "SimulationRun.h"
+
+#include <camotics/Task.h>
+
+#include <cbang/SmartPointer.h>
+
+
+namespace CAMotics {
+  namespace Project {class Project;}
+  class MoveQueue;
+  class ToolPathTask;
+
+  // 边解释G代码边模拟的任务。ToolPathTask在单独的线程中把移动放入MoveQueue，
+  // run()在当前线程中用SimulationRun::stream()取出移动并渲染。工件的边界必须
+  // 事先确定，不能由工具路径自动计算。
+  class StreamTask : public Task {
+    cb::SmartPointer<MoveQueue> queue;
+    cb::SmartPointer<ToolPathTask> pathTask;
+    cb::SmartPointer<SimulationRun> simRun;
+    cb::SmartPointer<Surface> surface;
+    SimulationRun::partial_t partial;
+
+  public:
+    // sim.path被换成一条新的空路径，模拟过程中填入解释得到的移动。
+    StreamTask(const Project::Project &project, const Simulation &sim);
+    ~StreamTask();
+
+    void setPartial(const SimulationRun::partial_t &partial)
+    {this->partial = partial;}
+
+    unsigned getErrorCount() const;
+    const cb::SmartPointer<GCode::ToolPath> &getPath() const;
+    const cb::SmartPointer<SimulationRun> &getSimRun() const {return simRun;}
+    const cb::SmartPointer<Surface> &getSurface() const {return surface;}
+
+    // From Task
+    void run();
+    void interrupt();
+  };
+}
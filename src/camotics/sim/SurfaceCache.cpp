@@ -0,0 +1,205 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "SurfaceCache.h"
+
+#include <camotics/contour/TriangleSurface.h>
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/os/SystemUtilities.h>
+
+#include <vector>
+#include <cstring>
+
+#include <utime.h>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+namespace {
+  const char magic[8] = {'C', 'A', 'M', 'S', 'U', 'R', 'F', 0};
+  // 修改表面生成算法导致结果变化时需要增加这个版本号，旧的缓存文件会被丢弃。
+  const uint32_t version = 2;
+
+
+  template <typename T>
+  void writeValue(ostream &stream, const T &value) {
+    stream.write((const char *)&value, sizeof(T));
+  }
+
+
+  template <typename T>
+  bool readValue(istream &stream, T &value) {
+    return (bool)stream.read((char *)&value, sizeof(T));
+  }
+
+
+  // count来自文件，调整大小之前先确认剩余的字节足够，损坏的文件不会导致
+  // 巨大的内存分配。size是文件的总字节数。
+  template <typename T>
+  bool readArray(istream &stream, vector<T> &data, uint64_t count,
+                 uint64_t size) {
+    streamoff offset = stream.tellg();
+    if (offset < 0 || size < (uint64_t)offset ||
+        (size - offset) / sizeof(T) < count) return false;
+
+    data.resize(count);
+    return count ? (bool)stream.read((char *)&data[0], count * sizeof(T))
+      : true;
+  }
+
+
+  template <typename T>
+  void writeArray(ostream &stream, const vector<T> &data) {
+    writeValue(stream, (uint64_t)data.size());
+    if (!data.empty())
+      stream.write((const char *)&data[0], data.size() * sizeof(T));
+  }
+}
+
+
+SurfaceCache::SurfaceCache(const string &path, uint64_t maxSize) :
+  FileCache(path, ".surface", maxSize) {}
+
+
+SurfaceCache &SurfaceCache::instance() {
+  static SurfaceCache cache(getDefaultPath());
+  return cache;
+}
+
+
+string SurfaceCache::getDefaultPath() {
+  return FileCache::getDefaultPath("CAMOTICS_SURFACE_CACHE", "surfaces");
+}
+
+
+SmartPointer<Surface> SurfaceCache::get(const string &hash) {
+  if (!isEnabled()) return 0;
+
+  SmartLock lock(this);
+
+  string filename = getFilename(hash);
+  if (!SystemUtilities::exists(filename)) return 0;
+
+  try {
+    SmartPointer<istream> stream = SystemUtilities::iopen(filename);
+
+    char header[sizeof(magic)];
+    uint32_t fileVersion = 0;
+    uint32_t hashLength = 0;
+    uint64_t count = 0;
+    uint64_t size = SystemUtilities::getFileSize(filename);
+
+    // 文件头：魔数、版本、hash，之后是带长度的顶点、法线和索引数组。
+    if (!stream->read(header, sizeof(header)) ||
+        memcmp(header, magic, sizeof(magic)) ||
+        !readValue(*stream, fileVersion) || fileVersion != version ||
+        !readValue(*stream, hashLength) || hashLength != hash.length())
+      THROW("Invalid surface cache header");
+
+    string fileHash(hashLength, 0);
+    if (!stream->read(&fileHash[0], hashLength) || fileHash != hash)
+      THROW("Surface cache hash mismatch");
+
+    vector<float> vertices;
+    vector<float> normals;
+    vector<uint32_t> indices;
+
+    if (!readValue(*stream, count) ||
+        !readArray(*stream, vertices, count, size) ||
+        !readValue(*stream, count) ||
+        !readArray(*stream, normals, count, size) ||
+        !readValue(*stream, count) ||
+        !readArray(*stream, indices, count, size))
+      THROW("Truncated surface cache file");
+
+    stream.release();
+
+    // 更新修改时间，使这个文件成为最近使用的。
+    utime(filename.c_str(), 0);
+
+    LOG_INFO(1, "Loaded surface from cache " << filename);
+
+    // 构造函数会检查数组大小和索引范围。
+    return new TriangleSurface(vertices, normals, indices);
+
+  } catch (const std::exception &e) {
+    // 除了格式错误，损坏的文件还可能导致bad_alloc等标准异常。
+    LOG_WARNING("Discarding surface cache file " << filename << ": "
+                << e.what());
+    TRY_CATCH_ERROR(SystemUtilities::unlink(filename));
+  }
+
+  return 0;
+}
+
+
+void SurfaceCache::put(const string &hash, const Surface &surface) {
+  if (!isEnabled()) return;
+
+  SmartLock lock(this);
+
+  string filename = getFilename(hash);
+  string tmp = filename + "." + String(SystemUtilities::getPID()) + ".tmp";
+
+  try {
+    SystemUtilities::ensureDirectory(getPath());
+
+    SmartPointer<ostream> stream = SystemUtilities::oopen(tmp);
+
+    stream->write(magic, sizeof(magic));
+    writeValue(*stream, version);
+    writeValue(*stream, (uint32_t)hash.length());
+    stream->write(hash.data(), hash.length());
+
+    // 组合表面会多次调用回调，文件里只能存一组数组。
+    unsigned calls = 0;
+    surface.getVertices(
+      [&] (const vector<float> &vertices, const vector<float> &normals,
+           const vector<uint32_t> &indices) {
+        if (calls++) THROW("Cannot cache composite surface");
+        if (vertices.size() != normals.size())
+          THROW("Surface vertex and normal counts differ");
+
+        writeArray(*stream, vertices);
+        writeArray(*stream, normals);
+        writeArray(*stream, indices);
+      });
+
+    if (!*stream) THROW("Failed to write " << tmp);
+    stream.release();
+
+    // 先写临时文件再改名，其他进程不会读到写了一半的文件。
+    SystemUtilities::rename(tmp, filename);
+
+  } catch (const Exception &e) {
+    LOG_WARNING("Failed to cache surface: " << e);
+    if (SystemUtilities::exists(tmp))
+      TRY_CATCH_ERROR(SystemUtilities::unlink(tmp));
+    return;
+  }
+
+  evict();
+}
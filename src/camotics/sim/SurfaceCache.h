@@ -0,0 +1,48 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "FileCache.h"
+
+#include <cbang/SmartPointer.h>
+
+#include <string>
+
+
+namespace CAMotics {
+  class Surface;
+
+  // 按Simulation::computeHash()寻址的磁盘表面缓存。每个表面以紧凑的二进制形式
+  // 存成一个文件。
+  class SurfaceCache : public FileCache {
+  public:
+    SurfaceCache(const std::string &path = std::string(),
+                 uint64_t maxSize = defaultMaxSize);
+
+    // 所有模拟共用的缓存，目录取自 CAMOTICS_SURFACE_CACHE 环境变量或用户的缓存目录。
+    static SurfaceCache &instance();
+    static std::string getDefaultPath();
+
+    // 查找hash对应的表面，未命中或缓存文件损坏时返回空指针。
+    cb::SmartPointer<Surface> get(const std::string &hash);
+    void put(const std::string &hash, const Surface &surface);
+  };
+}
@@ -21,6 +21,7 @@
 #include "SurfaceTask.h"
 
 #include <camotics/sim/SimulationRun.h>
+#include <camotics/sim/Simulation.h>
 #include <camotics/contour/Surface.h>
 
 #include <cbang/String.h>
@@ -39,11 +40,18 @@ SurfaceTask::SurfaceTask(const SmartPointer<SimulationRun> &simRun) :
   simRun(simRun) {}
 
 
+SurfaceTask::SurfaceTask(const SmartPointer<SimulationRun> &simRun,
+                         const Simulation &sim) :
+  simRun(simRun), update(new Simulation(sim)) {}
+
+
 SurfaceTask::~SurfaceTask() {}
 
 
 // 实现了SurfaceTask类的run方法。这个类表示一个计算表面的任务，用来根据一个SimulationRun对象的参数和结果，生成一个Surface对象。这个方法接受一个Task对象作为参数，表示一个异步的任务，用来执行模拟的计算。这个方法的流程如下：
 void SurfaceTask::run() {
+  if (update.isSet()) simRun->update(*update); // 如果有新的模拟参数，先更新simRun。
+
   double startTime = Timer::now(); // 首先，获取当前的时间，并将其赋值给startTime，作为计算开始的时间。
 
   surface = simRun->compute(*this); // 然后，调用simRun的compute方法，并将其返回值赋值给surface。simRun是一个SimulationRun对象，表示一个切割模拟的运行过程，用来根据一个Simulation对象的参数，计算出一个Surface对象的结果。compute方法接受一个Task对象作为参数，并返回一个Surface对象的智能指针。Surface对象表示一个三维的表面，由一组顶点和三角形组成。
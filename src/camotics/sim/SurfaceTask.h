@@ -34,11 +34,14 @@ namespace CAMotics {
 
   class SurfaceTask : public Task { // 表示一个计算表面的任务。这个类继承了Task类，表示一个异步的任务，用来执行模拟的计算。这个类有以下特点：
     cb::SmartPointer<SimulationRun> simRun; // 一个simRun成员变量，是一个SimulationRun对象的智能指针。SimulationRun对象表示一个切割模拟的运行过程，用来根据一个Simulation对象的参数，计算出一个Surface对象的结果。
+    cb::SmartPointer<Simulation> update; // update成员变量，如果设置了，run()会先调用simRun的update方法换上新的模拟参数，这样只在任务线程中修改simRun。
     cb::SmartPointer<Surface> surface; // 一个surface成员变量，是一个Surface对象的智能指针。Surface对象表示一个三维的表面，由一组顶点和三角形组成。
 
   public:
     SurfaceTask(const Simulation &sim); // 两个构造函数，分别接受一个Simulation对象和一个SimulationRun对象的智能指针作为参数。这两个函数用来创建并初始化simRun，并根据参数选择不同的方式。如果传入的是Simulation对象，则创建一个新的SimulationRun对象并赋值给simRun。如果传入的是SimulationRun对象，则直接赋值给simRun。
     SurfaceTask(const cb::SmartPointer<SimulationRun> &simRun);
+    SurfaceTask(const cb::SmartPointer<SimulationRun> &simRun,
+                const Simulation &sim); // 用编辑后的模拟参数更新已有的simRun，只重新渲染变化的部分。
     ~SurfaceTask(); // 析构函数，释放内存。
 
     const cb::SmartPointer<SimulationRun> &getSimRun() const {return simRun;} // getSimRun方法，返回simRun的常量引用。
@@ -22,6 +22,8 @@
 
 #include <gcode/Move.h>
 
+#include <cmath>
+
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
@@ -57,3 +59,45 @@ void Sweep::getBBoxes(const Vector3D &start, const Vector3D &end,
     p1 = p2; // 当前的重点为下一轮循环的起点
   }
 }
+
+
+// 批量计算一行点的深度，默认逐点计算。
+void Sweep::depth(const Vector3D &start, const Vector3D &end,
+                  const double *xs, double y, double z, unsigned n,
+                  double *out) const {
+  for (unsigned i = 0; i < n; i++)
+    out[i] = depth(start, end, Vector3D(xs[i], y, z));
+}
+
+
+// 在[0, 1]上用黄金分割搜索有向距离最小的刀具位置，最后在该位置计算法向量。
+double Sweep::distance(const Vector3D &start, const Vector3D &end,
+                       const Vector3D &p, Vector3D &normal) const {
+  const Vector3D delta = end - start;
+  if (!delta.lengthSquared()) return distance(p - start, normal);
+
+  const double phi = (sqrt(5.0) - 1) / 2;
+  double a = 0, b = 1;
+  double c = b - phi, d = phi;
+  Vector3D n;
+  double fc = distance(p - (start + delta * c), n);
+  double fd = distance(p - (start + delta * d), n);
+
+  for (unsigned i = 0; i < 40; i++)
+    if (fc < fd) {
+      b = d;
+      d = c;
+      fd = fc;
+      c = b - phi * (b - a);
+      fc = distance(p - (start + delta * c), n);
+
+    } else {
+      a = c;
+      c = d;
+      fc = fd;
+      d = a + phi * (b - a);
+      fd = distance(p - (start + delta * d), n);
+    }
+
+  return distance(p - (start + delta * ((a + b) / 2)), normal);
+}
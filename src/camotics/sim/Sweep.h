@@ -55,5 +55,22 @@ namespace CAMotics {
     // 该函数固定返回 0.
     virtual double depth(const cb::Vector3D &start, const cb::Vector3D &end,
                        const cb::Vector3D &p) const = 0;
+
+    // 点p相对于刀尖位于原点的刀具本身的有向距离，内部为负。
+    // normal为向外的单位法向量。
+    virtual double distance(const cb::Vector3D &p,
+                            cb::Vector3D &normal) const = 0;
+
+    // 点p相对于刀具从start移动到end扫过形状的有向距离和向外的法向量。
+    // 刀具是凸体，所以到各个位置的刀具的有向距离是移动比例的凸函数，
+    // 默认用黄金分割搜索最近的位置。
+    virtual double distance(const cb::Vector3D &start, const cb::Vector3D &end,
+                            const cb::Vector3D &p, cb::Vector3D &normal) const;
+
+    // 批量计算一行点(xs[i], y, z)的深度，结果写入out。
+    // 默认逐点调用上面的depth()，子类可以用SIMD实现。
+    virtual void depth(const cb::Vector3D &start, const cb::Vector3D &end,
+                       const double *xs, double y, double z, unsigned n,
+                       double *out) const;
   };
 }
@@ -0,0 +1,79 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "SweepLanes.h"
+
+using namespace CAMotics;
+
+
+namespace {
+  typedef void (*conic_t)(const ConicRow &, const double *, unsigned,
+                          double *);
+  typedef void (*spheroid_t)(const SpheroidRow &, const double *, unsigned,
+                             double *);
+
+
+  // 检查CPU是否支持AVX2，并且AVX2内核已被编译。
+  bool haveAVX2() {
+    if (!SweepKernels::avx2Compiled()) return false;
+
+#if (defined(__GNUC__) || defined(__clang__)) &&        \
+  (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+
+
+  // 在程序启动时选择一次指令集
+  const bool avx2 = haveAVX2();
+
+#ifdef SWEEP_LANES_SSE2
+  const char *const instructionSet = avx2 ? "AVX2" : "SSE2";
+  const conic_t conicImpl = avx2 ? SweepKernels::conicAVX2 :
+    conicRow<SSE2Lanes>;
+  const spheroid_t spheroidImpl = avx2 ? SweepKernels::spheroidAVX2 :
+    spheroidRow<SSE2Lanes>;
+
+#else
+  const char *const instructionSet = avx2 ? "AVX2" : "scalar";
+  const conic_t conicImpl = avx2 ? SweepKernels::conicAVX2 :
+    conicRow<ScalarLanes>;
+  const spheroid_t spheroidImpl = avx2 ? SweepKernels::spheroidAVX2 :
+    spheroidRow<ScalarLanes>;
+#endif
+}
+
+
+const char *SweepKernels::getInstructionSet() {return instructionSet;}
+
+
+void SweepKernels::conic(const ConicRow &row, const double *xs, unsigned n,
+                         double *out) {
+  conicImpl(row, xs, n, out);
+}
+
+
+void SweepKernels::spheroid(const SpheroidRow &row, const double *xs,
+                            unsigned n, double *out) {
+  spheroidImpl(row, xs, n, out);
+}
@@ -0,0 +1,83 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+
+namespace CAMotics {
+  // 一行点(xs[i], y, z)上与x无关的圆锥曲面参数，由ConicSweep预先计算。
+  // 每一项的计算顺序与ConicSweep::depth()的标量版本一致，因此结果完全相同。
+  struct ConicRow {
+    double ax;  // A.x
+    double dx;  // B.x - A.x
+    double gy;  // gamma的y项
+    double gz;  // gamma的z项
+    double ry;  // rho的y项
+    double rz;  // rho的z项
+    double eps; // epsilon
+    double dz;  // B.z - A.z
+    double az;  // A.z
+    double pz;  // P.z
+    double l;   // 刀具长度
+
+    bool bottom; // 是否检查底部圆盘
+    double bx;   // 底部圆盘上的交点E.x
+    double by2;  // (E.y - P.y)^2
+    double rb2;  // 底部半径的平方
+
+    bool top;    // 是否检查顶部圆盘
+    double tx;   // 顶部圆盘上的交点E.x
+    double ty2;  // (E.y - P.y)^2
+    double rt2;  // 顶部半径的平方
+  };
+
+
+  // 一行点上与x无关的球形曲面参数，由SpheroidSweep预先计算。
+  struct SpheroidRow {
+    double sx;  // x轴缩放
+    double ax;  // A.x，已缩放
+    double abx; // (B - A).x
+    double gy;  // gamma的y项
+    double gz;  // gamma的z项
+    double ry;  // rho的y项
+    double rz;  // rho的z项
+    double k;   // 2 * r * (A.z - P.z)
+    double eps; // epsilon
+  };
+
+
+  // 按行计算曲面深度的SIMD内核。使用的指令集在运行时根据CPU选择，
+  // 依次为AVX2、SSE2和标量实现。结果为1或-1，与标量版本相同。
+  namespace SweepKernels {
+    const char *getInstructionSet();
+
+    void conic(const ConicRow &row, const double *xs, unsigned n,
+               double *out);
+    void spheroid(const SpheroidRow &row, const double *xs, unsigned n,
+                  double *out);
+
+    // AVX2实现位于单独的编译单元中，编译器不支持时avx2Compiled()返回false。
+    bool avx2Compiled();
+    void conicAVX2(const ConicRow &row, const double *xs, unsigned n,
+                   double *out);
+    void spheroidAVX2(const SpheroidRow &row, const double *xs, unsigned n,
+                      double *out);
+  }
+}
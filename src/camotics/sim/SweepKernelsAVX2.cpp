@@ -0,0 +1,81 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+// 这个编译单元中的函数使用AVX2编译，只有在CPU支持AVX2时才会被调用。
+// 所有其他头文件必须在切换目标指令集之前包含。
+
+#include "SweepKernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), \
+                              apply_to = function)
+#define SWEEP_LANES_AVX2
+
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#define SWEEP_LANES_AVX2
+#endif
+#endif
+
+#include "SweepLanes.h"
+
+using namespace CAMotics;
+
+
+#ifdef SWEEP_LANES_AVX2
+bool SweepKernels::avx2Compiled() {return true;}
+
+
+void SweepKernels::conicAVX2(const ConicRow &row, const double *xs,
+                             unsigned n, double *out) {
+  conicRow<AVX2Lanes>(row, xs, n, out);
+}
+
+
+void SweepKernels::spheroidAVX2(const SpheroidRow &row, const double *xs,
+                                unsigned n, double *out) {
+  spheroidRow<AVX2Lanes>(row, xs, n, out);
+}
+
+
+#ifdef __clang__
+#pragma clang attribute pop
+#endif
+
+#else // SWEEP_LANES_AVX2
+bool SweepKernels::avx2Compiled() {return false;}
+
+
+void SweepKernels::conicAVX2(const ConicRow &row, const double *xs,
+                             unsigned n, double *out) {
+  conicRow<ScalarLanes>(row, xs, n, out);
+}
+
+
+void SweepKernels::spheroidAVX2(const SpheroidRow &row, const double *xs,
+                                unsigned n, double *out) {
+  spheroidRow<ScalarLanes>(row, xs, n, out);
+}
+#endif // SWEEP_LANES_AVX2
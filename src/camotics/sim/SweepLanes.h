@@ -0,0 +1,230 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+// 注意：这个头文件只能被SweepKernels*.cpp包含。其中的函数都放在匿名命名空间中，
+// 使每个编译单元都有自己的副本，避免用AVX2编译的内联函数在链接时被其他编译单元选用。
+
+#pragma once
+
+#include "SweepKernels.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && 2 <= _M_IX86_FP)
+#define SWEEP_LANES_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef SWEEP_LANES_AVX2
+#include <immintrin.h>
+#endif
+
+
+namespace {
+  using namespace CAMotics;
+
+
+  // 每种指令集提供相同的运算：V是一组double，M是对应的比较掩码。
+  struct ScalarLanes {
+    typedef double V;
+    typedef bool M;
+    static const unsigned width = 1;
+
+    static V set(double x) {return x;}
+    static V load(const double *p) {return *p;}
+    static void store(double *p, V x) {*p = x;}
+
+    static V add(V a, V b) {return a + b;}
+    static V sub(V a, V b) {return a - b;}
+    static V mul(V a, V b) {return a * b;}
+    static V div(V a, V b) {return a / b;}
+    static V neg(V a) {return -a;}
+    static V sqrt(V a) {return std::sqrt(a);}
+
+    static M none() {return false;}
+    static M lt(V a, V b) {return a < b;}
+    static M le(V a, V b) {return a <= b;}
+    static M nlt(V a, V b) {return !(a < b);}
+    static M mand(M a, M b) {return a && b;}
+    static M mor(M a, M b) {return a || b;}
+    static M mandNot(M a, M b) {return !a && b;}
+    static V select(M m, V a, V b) {return m ? a : b;}
+  };
+
+
+#ifdef SWEEP_LANES_SSE2
+  struct SSE2Lanes {
+    typedef __m128d V;
+    typedef __m128d M;
+    static const unsigned width = 2;
+
+    static V set(double x) {return _mm_set1_pd(x);}
+    static V load(const double *p) {return _mm_loadu_pd(p);}
+    static void store(double *p, V x) {_mm_storeu_pd(p, x);}
+
+    static V add(V a, V b) {return _mm_add_pd(a, b);}
+    static V sub(V a, V b) {return _mm_sub_pd(a, b);}
+    static V mul(V a, V b) {return _mm_mul_pd(a, b);}
+    static V div(V a, V b) {return _mm_div_pd(a, b);}
+    static V neg(V a) {return _mm_xor_pd(a, _mm_set1_pd(-0.0));}
+    static V sqrt(V a) {return _mm_sqrt_pd(a);}
+
+    static M none() {return _mm_setzero_pd();}
+    static M lt(V a, V b) {return _mm_cmplt_pd(a, b);}
+    static M le(V a, V b) {return _mm_cmple_pd(a, b);}
+    static M nlt(V a, V b) {return _mm_cmpnlt_pd(a, b);}
+    static M mand(M a, M b) {return _mm_and_pd(a, b);}
+    static M mor(M a, M b) {return _mm_or_pd(a, b);}
+    static M mandNot(M a, M b) {return _mm_andnot_pd(a, b);}
+    static V select(M m, V a, V b)
+    {return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));}
+  };
+#endif
+
+
+#ifdef SWEEP_LANES_AVX2
+  struct AVX2Lanes {
+    typedef __m256d V;
+    typedef __m256d M;
+    static const unsigned width = 4;
+
+    static V set(double x) {return _mm256_set1_pd(x);}
+    static V load(const double *p) {return _mm256_loadu_pd(p);}
+    static void store(double *p, V x) {_mm256_storeu_pd(p, x);}
+
+    static V add(V a, V b) {return _mm256_add_pd(a, b);}
+    static V sub(V a, V b) {return _mm256_sub_pd(a, b);}
+    static V mul(V a, V b) {return _mm256_mul_pd(a, b);}
+    static V div(V a, V b) {return _mm256_div_pd(a, b);}
+    static V neg(V a) {return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));}
+    static V sqrt(V a) {return _mm256_sqrt_pd(a);}
+
+    static M none() {return _mm256_setzero_pd();}
+    static M lt(V a, V b) {return _mm256_cmp_pd(a, b, _CMP_LT_OQ);}
+    static M le(V a, V b) {return _mm256_cmp_pd(a, b, _CMP_LE_OQ);}
+    static M nlt(V a, V b) {return _mm256_cmp_pd(a, b, _CMP_NLT_UQ);}
+    static M mand(M a, M b) {return _mm256_and_pd(a, b);}
+    static M mor(M a, M b) {return _mm256_or_pd(a, b);}
+    static M mandNot(M a, M b) {return _mm256_andnot_pd(a, b);}
+    static V select(M m, V a, V b) {return _mm256_blendv_pd(b, a, m);}
+  };
+#endif
+
+
+  // 与ConicSweep::depth()相同的计算，但所有分支都变成了掩码。
+  template <typename L>
+  inline typename L::V conicLanes(const ConicRow &r, typename L::V px) {
+    typedef typename L::V V;
+    typedef typename L::M M;
+
+    const V ax = L::sub(L::set(r.ax), px); // Ax - Px
+    const V gamma =
+      L::add(L::add(L::mul(ax, L::set(r.dx)), L::set(r.gy)), L::set(r.gz));
+    const V rho = L::sub(L::add(L::mul(ax, ax), L::set(r.ry)), L::set(r.rz));
+    const V sigma =
+      L::sub(L::mul(gamma, gamma), L::mul(L::set(r.eps), rho));
+
+    // 有解，sigma为负时sqrt的结果被掩码丢弃
+    const M valid = L::nlt(sigma, L::set(0));
+    const V beta =
+      L::div(L::sub(L::neg(gamma), L::sqrt(sigma)), L::set(r.eps));
+
+    // 接触点是否在高度范围之外
+    const V Pz = L::set(r.pz);
+    const V Qz = L::add(L::mul(L::set(r.dz), beta), L::set(r.az));
+    const M outside =
+      L::mor(L::lt(Pz, Qz), L::lt(L::add(Qz, L::set(r.l)), Pz));
+
+    // 是否在线段上
+    const M onSegment =
+      L::mand(L::nlt(beta, L::set(0)), L::nlt(L::set(1), beta));
+
+    // 底部和顶部圆盘
+    M disc = L::none();
+
+    if (r.bottom) {
+      const V ex = L::sub(L::set(r.bx), px);
+      const V d2 = L::add(L::mul(ex, ex), L::set(r.by2));
+      disc = L::mor(disc, L::le(d2, L::set(r.rb2)));
+    }
+
+    if (r.top) {
+      const V ex = L::sub(L::set(r.tx), px);
+      const V d2 = L::add(L::mul(ex, ex), L::set(r.ty2));
+      disc = L::mor(disc, L::le(d2, L::set(r.rt2)));
+    }
+
+    const M hit = L::mand(valid, L::mor(L::mand(outside, disc),
+                                         L::mandNot(outside, onSegment)));
+
+    return L::select(hit, L::set(1), L::set(-1));
+  }
+
+
+  // 与SpheroidSweep::depth()相同的计算。
+  template <typename L>
+  inline typename L::V spheroidLanes(const SpheroidRow &r,
+                                     typename L::V px) {
+    typedef typename L::V V;
+    typedef typename L::M M;
+
+    const V pax = L::sub(L::set(r.ax), L::mul(px, L::set(r.sx))); // (A - P).x
+    const V gamma =
+      L::add(L::add(L::mul(L::set(r.abx), pax), L::set(r.gy)), L::set(r.gz));
+    const V rho = L::add(L::add(L::add(L::mul(pax, pax), L::set(r.ry)),
+                                L::set(r.rz)), L::set(r.k));
+    const V sigma =
+      L::sub(L::mul(gamma, gamma), L::mul(L::set(r.eps), rho));
+    const V beta =
+      L::div(L::sub(L::neg(gamma), L::sqrt(sigma)), L::set(r.eps));
+
+    const M hit = L::mand(L::nlt(sigma, L::set(0)),
+                          L::mand(L::nlt(beta, L::set(0)),
+                                  L::nlt(L::set(1), beta)));
+
+    return L::select(hit, L::set(1), L::set(-1));
+  }
+
+
+  // 整组处理，剩余不足一组的点用标量计算。
+  template <typename L>
+  void conicRow(const ConicRow &row, const double *xs, unsigned n,
+                double *out) {
+    unsigned i = 0;
+
+    for (; i + L::width <= n; i += L::width)
+      L::store(out + i, conicLanes<L>(row, L::load(xs + i)));
+
+    for (; i < n; i++) out[i] = conicLanes<ScalarLanes>(row, xs[i]);
+  }
+
+
+  template <typename L>
+  void spheroidRow(const SpheroidRow &row, const double *xs, unsigned n,
+                   double *out) {
+    unsigned i = 0;
+
+    for (; i + L::width <= n; i += L::width)
+      L::store(out + i, spheroidLanes<L>(row, L::load(xs + i)));
+
+    for (; i < n; i++) out[i] = spheroidLanes<ScalarLanes>(row, xs[i]);
+  }
+}
@@ -0,0 +1,121 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "ToolPathCache.h"
+
+#include <camotics/MappedFile.h>
+
+#include <gcode/ToolPath.h>
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/os/SystemUtilities.h>
+
+#include <utime.h>
+
+using namespace std;
+using namespace cb;
+using namespace CAMotics;
+
+
+ToolPathCache::ToolPathCache(const string &path, uint64_t maxSize) :
+  FileCache(path, ".path", maxSize) {}
+
+
+ToolPathCache &ToolPathCache::instance() {
+  static ToolPathCache cache(getDefaultPath());
+  return cache;
+}
+
+
+string ToolPathCache::getDefaultPath() {
+  return FileCache::getDefaultPath("CAMOTICS_PATH_CACHE", "paths");
+}
+
+
+bool ToolPathCache::get(const string &key, GCode::ToolPath &path) {
+  if (!isEnabled()) return false;
+
+  SmartLock lock(this);
+
+  string filename = getFilename(key);
+  if (!SystemUtilities::exists(filename)) return false;
+
+  try {
+    // 直接从映射的内存解码，不把整个文件读入缓冲区。先解码到临时路径，
+    // 文件损坏时path保持不变。
+    GCode::ToolPath cached(path.getTools());
+    {
+      MappedFile file(filename);
+      if (cached.readBinary(file.getData(), file.getSize()) != key)
+        THROW("Tool path cache key mismatch");
+    }
+
+    path = cached;
+
+    // 更新修改时间，使这个文件成为最近使用的。
+    utime(filename.c_str(), 0);
+
+    LOG_INFO(1, "Loaded tool path from cache " << filename);
+
+    return true;
+
+  } catch (const std::exception &e) {
+    // 损坏的文件还可能导致bad_alloc等标准异常，同样丢弃。
+    LOG_WARNING("Discarding tool path cache file " << filename << ": "
+                << e.what());
+    TRY_CATCH_ERROR(SystemUtilities::unlink(filename));
+  }
+
+  return false;
+}
+
+
+void ToolPathCache::put(const string &key, const GCode::ToolPath &path) {
+  if (!isEnabled()) return;
+
+  SmartLock lock(this);
+
+  string filename = getFilename(key);
+  string tmp = filename + "." + String(SystemUtilities::getPID()) + ".tmp";
+
+  try {
+    SystemUtilities::ensureDirectory(getPath());
+
+    SmartPointer<ostream> stream = SystemUtilities::oopen(tmp);
+    path.writeBinary(*stream, key);
+
+    if (!*stream) THROW("Failed to write " << tmp);
+    stream.release();
+
+    // 先写临时文件再改名，其他进程不会读到写了一半的文件。
+    SystemUtilities::rename(tmp, filename);
+
+  } catch (const Exception &e) {
+    LOG_WARNING("Failed to cache tool path: " << e);
+    if (SystemUtilities::exists(tmp))
+      TRY_CATCH_ERROR(SystemUtilities::unlink(tmp));
+    return;
+  }
+
+  evict();
+}
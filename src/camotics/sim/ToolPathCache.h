@@ -0,0 +1,46 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "FileCache.h"
+
+#include <string>
+
+
+namespace GCode {class ToolPath;}
+
+namespace CAMotics {
+  // 按输入文件内容的hash寻址的磁盘工具路径缓存，路径以GCode::ToolPath的二进制
+  // 格式存放。命中时可以跳过整个G代码解释过程。
+  class ToolPathCache : public FileCache {
+  public:
+    ToolPathCache(const std::string &path = std::string(),
+                  uint64_t maxSize = defaultMaxSize);
+
+    // 所有任务共用的缓存，目录取自 CAMOTICS_PATH_CACHE 环境变量或用户的缓存目录。
+    static ToolPathCache &instance();
+    static std::string getDefaultPath();
+
+    // 查找key对应的路径并替换path的内容。未命中或缓存文件损坏时返回false。
+    bool get(const std::string &key, GCode::ToolPath &path);
+    void put(const std::string &key, const GCode::ToolPath &path);
+  };
+}
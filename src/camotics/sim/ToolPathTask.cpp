@@ -19,8 +19,11 @@
 \******************************************************************************/
 
 #include "ToolPathTask.h"
+#include "ParallelGCodeParser.h"
+#include "ToolPathCache.h"
 
-#include <camotics/TaskFilter.h>
+#include <camotics/MappedFile.h>
+#include <camotics/SHA256.h>
 #include <camotics/project/Project.h>
 #include <camotics/sim/Simulation.h>
 
@@ -28,6 +31,7 @@
 #include <tplang/Interpreter.h>
 
 #include <gcode/interp/Interpreter.h>
+#include <gcode/parse/FastParser.h>
 
 #include <gcode/machine/MachineState.h>
 #include <gcode/machine/MachineLinearizer.h>
@@ -36,9 +40,13 @@
 #include <gcode/machine/MoveSink.h>
 
 #include <gcode/plan/PlannerMachine.h>
+#include <gcode/plan/MoveTimer.h>
+#include <gcode/plan/PlannerConfig.h>
 
 #include <cbang/config.h>
 #include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/net/Base64.h>
 
 #include <cbang/os/SystemUtilities.h>
 
@@ -50,12 +58,6 @@
 
 #include <cbang/js/JSInterrupted.h>
 
-#include <boost/ref.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/device/file.hpp>
-namespace io = boost::iostreams;
-
 #include <sstream>
 
 using namespace std;
@@ -64,10 +66,12 @@ using namespace CAMotics;
 
 // 构造函数：接受一个Project::Project对象和一个GCode::PlannerConfig对象作为参数。这两个函数用来根据项目中的配置和参数初始化tools、units、files、simJSON、pipeline、controller、path等成员变量，并根据config选择不同的规划器配置。Project::Project对象表示一个CAMotics项目，包含了一些文件和设置信息。GCode::PlannerConfig对象表示一个规划器配置，包含了一些控制移动速度和加速度的参数。
 ToolPathTask::ToolPathTask(const Project::Project &project,
-                           const GCode::PlannerConfig *config) :
+                           const GCode::PlannerConfig *config,
+                           const SmartPointer<GCode::MoveStream> &stream,
+                           const GCode::PlannerConfig *timerConfig) :
   tools(project.getTools()), units(project.getUnits()),
   simJSON(project.toString()), controller(pipeline, tools),
-  path(new GCode::ToolPath(tools)) {
+  path(stream.isSet() ? 0 : new GCode::ToolPath(tools)), stream(stream) {
 
   for (unsigned i = 0; i < project.getFileCount(); i++)
     files.push_back(project.getFile(i)->getPath());
@@ -80,9 +84,25 @@ ToolPathTask::ToolPathTask(const Project::Project &project,
   pipeline.add(new GCode::MachineLinearizer);
 
   // Setup planner
-  if (config) pipeline.add(new GCode::PlannerMachine(*config));
-
-  pipeline.add(new GCode::MoveSink(*path));
+  if (config) {
+    // 离线计算时整个程序成批规划，流式模拟需要逐条输出移动。
+    SmartPointer<GCode::PlannerMachine> planner =
+      new GCode::PlannerMachine(*config);
+    planner->setBatch(stream.isNull());
+
+    pipeline.add(planner);
+    configJSON = config->toString();
+  }
+
+  if (stream.isSet()) pipeline.add(new GCode::MoveSink(*stream));
+  else if (config) pipeline.add(new GCode::MoveSink(*path));
+  else {
+    // 没有规划器时在后台线程里规划移动，结束后用规划出的时间和速度代替按进给率估计的时间。
+    timer = new GCode::MoveTimer
+      (*path, timerConfig ? *timerConfig : GCode::PlannerConfig());
+    configJSON = timer->getConfig().toString();
+    pipeline.add(new GCode::MoveSink(*timer));
+  }
   if (units != GCode::Units::METRIC)
     pipeline.add(new GCode::MachineUnitAdapter(GCode::Units::METRIC, units));
   pipeline.add(new GCode::GCodeMachine(gcodePtr, units));
@@ -136,47 +156,106 @@ void ToolPathTask::runGCode(const InputSource &source) {
 
   GCode::Interpreter interp(controller);
   interp.push(source);
+  interpret(interp, 0);
+}
+
+
+void ToolPathTask::runGCode(const string &filename) {
+  // 把文件映射到内存，解析器直接扫描其中的字节，不经过流和中间字符串。
+  MappedFile file(filename);
+  runGCode(file.getData(), file.getSize(), filename);
+}
+
+
+void ToolPathTask::runGCodeString(const string &gcode) {
+  runGCode(gcode.data(), gcode.size(), "<string>");
+}
+
+
+void ToolPathTask::runGCode(const char *data, uint64_t size,
+                            const string &filename) {
+  Task::begin("Running GCode");
+
+  GCode::Interpreter interp(controller);
+
+  // 大文件在线程池上分块并行解析。
+  if (parallel && ParallelGCodeParser::chunkSize < size) {
+    SmartPointer<ParallelGCodeParser> parser =
+      new ParallelGCodeParser(data, size, filename);
+
+    interp.push(parser);
+    interpret(interp, [parser] {return parser->getProgress();});
+
+  } else {
+    SmartPointer<GCode::FastParser> parser =
+      new GCode::FastParser(data, size, filename);
+
+    interp.push(parser);
+    interpret(interp, [parser] {return parser->getProgress();});
+  }
+
+  if (interp.hasLoadedFiles()) loadedFiles = true;
+}
+
+
+void ToolPathTask::runCachedGCode(const string &filename) {
+  ToolPathCache &pathCache = ToolPathCache::instance();
+
+  MappedFile file(filename);
+  string key = computeKey(file.getData(), file.getSize(), filename);
+
+  if (pathCache.get(key, *path)) return;
+
+  loadedFiles = false;
+  runGCode(file.getData(), file.getSize(), filename);
+  if (timer.isSet()) timer->finish();
+
+  // 出错或被中断的路径不完整，不能缓存。
+  if (!errors && !loadedFiles && !Task::shouldQuit())
+    pathCache.put(key, *path);
+}
+
+
+string ToolPathTask::computeKey(const char *data, uint64_t size,
+                                const string &filename) const {
+  SHA256 sha256;
+
+  // 各字段之间用'\0'分隔，避免不同的组合得到相同的字节序列。
+  const char *scriptPath = SystemUtilities::getenv("GCODE_SCRIPT_PATH");
+
+  string header = String(GCode::ToolPath::binaryVersion) + '\0' + filename +
+    '\0' + tools.toString() + '\0' + units.toString() + '\0' + configJSON +
+    '\0' + (scriptPath ? scriptPath : "") + '\0';
+
+  sha256.update(header);
+  sha256.update(data, (streamsize)size);
+
+  return Base64().encode(sha256.finalize());
+}
+
+
+void ToolPathTask::interpret(GCode::Interpreter &interp,
+                             const function<double ()> &progress) {
   pipeline.start();
 
   try {
+    unsigned blocks = 0;
+
     while (!Task::shouldQuit() && interp.hasMore() && errors < 32)
       try {
         interp(interp.next());
 
+        // Task::update()需要加锁，所以每隔一段才按已解析的字节数报告一次进度。
+        if (progress && !(++blocks % progressInterval)) update(progress());
+
       } catch (const Exception &e) {
         LOG_ERROR(e);
         errors++;
       }
   } catch (const GCode::EndProgram &) {}
-  pipeline.end();
-}
-
-
-void ToolPathTask::runGCode(const string &filename) {
-  SmartPointer<istream> stream;
-  io::filtering_istream filter;
-
-  // Track the file load
-  TaskFilter taskFilter(*this, SystemUtilities::getFileSize(filename));
-  filter.push(boost::ref(taskFilter));
-
-  // Interpret GCode
-  filter.push(io::file_source(filename));
-  runGCode(InputSource(filter, filename));
-}
 
-
-void ToolPathTask::runGCodeString(const string &gcode) {
-  SmartPointer<istream> stream;
-  io::filtering_istream filter;
-
-  // Track the file load
-  TaskFilter taskFilter(*this, gcode.size());
-  filter.push(boost::ref(taskFilter));
-
-  // Interpret GCode
-  filter.push(io::array_source(gcode.data(), gcode.length()));
-  runGCode(InputSource(filter, "<string>"));
+  if (progress) update(progress());
+  pipeline.end();
 }
 
 
@@ -194,8 +273,12 @@ void ToolPathTask::run() {
       bool isTPL = String::endsWith(filename, ".tpl");
 
       if (isTPL) runTPL(filename);
+      else if (cache && path.isSet() && files.size() == 1)
+        runCachedGCode(filename);
       else runGCode(filename);
     }
+
+    if (timer.isSet()) timer->finish();
   } CATCH_ERROR;
 }
 
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <functional>
 
 
 namespace cb {
@@ -42,8 +43,10 @@ namespace cb {
 
 namespace GCode {
   class Controller;
+  class Interpreter;
   class MachineInterface;
   class PlannerConfig;
+  class MoveTimer;
 }
 
 namespace tplang {class TPLContext;}
@@ -60,18 +63,35 @@ namespace CAMotics {
     GCode::MachinePipeline pipeline; // pipeline成员变量，是一个GCode::MachinePipeline对象。GCode::MachinePipeline对象表示一个机器管道，用来处理G代码中的指令，并模拟机器的运动和状态。
     GCode::ControllerImpl controller; // controller成员变量，是一个GCode::ControllerImpl对象。GCode::ControllerImpl对象表示一个控制器，用来解析和执行G代码中的指令，并与机器管道交互。
 
+    bool parallel = true; // 是否并行解析大的G代码文件。
+    bool cache = false; // 是否通过ToolPathCache复用已解释过的G代码文件。命中时getGCode()为空。
+    std::string configJSON; // 规划器配置，参与缓存键的计算。
+    bool loadedFiles = false; // 是否从GCODE_SCRIPT_PATH加载过子程序文件，这样的结果不能缓存。
     unsigned errors = 0; // errors成员变量，是一个无符号整数。它表示计算过程中出现的错误数量。
     cb::SmartPointer<GCode::ToolPath> path; // path成员变量，是一个GCode::ToolPath对象的智能指针。GCode::ToolPath对象表示一个工具路径，包含了一系列的移动指令和工具信息。
+    cb::SmartPointer<GCode::MoveStream> stream; // 流式模拟时接收移动的队列。
+    cb::SmartPointer<GCode::MoveTimer> timer; // 没有规划器时在后台规划移动的时间。
     std::ostringstream gcode; // gcode成员变量，是一个字符串流。它用来存储计算后生成的G代码。
 
     cb::SmartPointer<tplang::TPLContext> tplCtx; // 它有一个tplCtx成员变量，是一个tplang::TPLContext对象的智能指针。tplang::TPLContext对象表示一个TPL语言的上下文，用来解释和执行TPL语言中的指令。TPL语言是一种基于Python语法的模板语言，用来生成G代码
 
   public:
+    static const unsigned progressInterval = 1024; // 每解释这么多个块报告一次进度。
+
       // 接受一个Project::Project对象和一个GCode::PlannerConfig对象作为参数。这两个函数用来根据项目中的配置和参数初始化tools、units、files、simJSON、pipeline、controller等成员变量，并根据config选择不同的规划器配置。Project::Project对象表示一个CAMotics项目，包含了一些文件和设置信息。GCode::PlannerConfig对象表示一个规划器配置，包含了一些控制移动速度和加速度的参数。
+    // stream不为空时移动写入stream而不是path，getPath()返回空指针。
+    // config为空时按timerConfig中的机器限制在后台计算移动时间，timerConfig也
+    // 为空时用默认的规划器配置。
     ToolPathTask(const Project::Project &project,
-                 const GCode::PlannerConfig *config = 0);
+                 const GCode::PlannerConfig *config = 0,
+                 const cb::SmartPointer<GCode::MoveStream> &stream = 0,
+                 const GCode::PlannerConfig *timerConfig = 0);
     ~ToolPathTask(); // 析构函数，释放内存。
 
+    bool getParallel() const {return parallel;}
+    void setParallel(bool parallel) {this->parallel = parallel;}
+    bool getCache() const {return cache;}
+    void setCache(bool cache) {this->cache = cache;}
     unsigned getErrorCount() const {return errors;} // getErrorCount方法，返回errors的值。
     const cb::SmartPointer<GCode::ToolPath> &getPath() const {return path;} // getPath方法，返回path的常量引用。
     std::string getGCode() const {return gcode.str();} // getGCode方法，返回gcode流中的字符串。
@@ -83,9 +103,25 @@ namespace CAMotics {
     void runGCode(const cb::InputSource &src);
     void runGCode(const std::string &filename);
     void runGCodeString(const std::string &gcode);
+    // 直接解析内存中的G代码，data在调用期间必须有效。
+    void runGCode(const char *data, uint64_t size,
+                  const std::string &filename);
 
     // From Task
     void run(); // run方法，重写了父类Task的虚函数。这个方法用来遍历files向量中的每个文件，并根据文件后缀名选择不同的运行方式。如果文件后缀名是.tpl，则调用runTPL方法运行TPL语言，并生成G代码。如果文件后缀名是.nc或者.gcode，则调用runGCode方法运行G代码，并生成工具路径。最后，将controller中的工具路径赋值给path，并打印一条日志信息，表示计算结束。
     void interrupt();// interrupt方法，重写了父类Task的虚函数。这个方法用来中断任务，并释放pipeline和tplCtx。
+
+  protected:
+    // 先在ToolPathCache中按文件内容查找路径，未命中时解释文件并存入缓存。
+    // 加载了外部子程序文件的结果不存入缓存，因为键中没有这些文件的内容。
+    void runCachedGCode(const std::string &filename);
+    // 缓存键：文件名、文件内容、GCODE_SCRIPT_PATH以及影响结果的工具表、单位和
+    // 规划器配置的hash。
+    std::string computeKey(const char *data, uint64_t size,
+                           const std::string &filename) const;
+
+    // 执行解释器中的所有块。progress不为空时用它返回的已解析比例报告进度。
+    void interpret(GCode::Interpreter &interp,
+                   const std::function<double ()> &progress);
   };
 }
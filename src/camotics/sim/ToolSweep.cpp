@@ -24,6 +24,9 @@
 #include "ConicSweep.h"
 #include "CompositeSweep.h"
 #include "SpheroidSweep.h"
+#include "AABBTree.h"
+#include "BVH.h"
+#include "IncrementalBVH.h"
 
 #include <gcode/ToolTable.h>
 
@@ -36,11 +39,14 @@ using namespace std;
 using namespace cb;
 using namespace CAMotics;
 
-// 表示一个工具扫过的形状和移动的查找器，用来模拟切割过程。这个类继承了FieldFunction类和AABBTree类，分别表示一个空间中的场函数和一个轴对齐的包围盒树。这个类的各个方法的流程如下：
-ToolSweep::ToolSweep(const SmartPointer<GCode::ToolPath> &path, //  构造函数：接受一个GCode::ToolPath对象的智能指针和两个双精度浮点数作为参数，分别表示工具路径、起始时间和结束时间。这个函数用来初始化path、startTime、endTime，并根据path中的工具编号和工具表创建sweeps向量，并将其添加到AABBTree中。sweeps向量是一个Sweep对象的智能指针的向量，Sweep对象表示一个抽象的扫过形状，用来模拟切割过程。AABBTree是一个轴对齐的包围盒树，用来存储和查询空间中的对象。
-                     double startTime, double endTime) :
-  path(path), startTime(startTime), endTime(endTime) {
-
+// 表示一个工具扫过的形状和移动的查找器，用来模拟切割过程。这个类继承了FieldFunction类和MoveLookup类，分别表示一个空间中的场函数和一个移动查找器。这个类的各个方法的流程如下：
+ToolSweep::ToolSweep(const SmartPointer<GCode::ToolPath> &path, //  构造函数：接受一个GCode::ToolPath对象的智能指针和两个双精度浮点数作为参数，分别表示工具路径、起始时间和结束时间。这个函数用来初始化path、startTime、endTime，并根据path中的工具编号和工具表创建sweeps向量，并将其添加到移动查找器中。sweeps向量是一个Sweep对象的智能指针的向量，Sweep对象表示一个抽象的扫过形状，用来模拟切割过程。移动查找器（BVH或AABBTree）用来存储和查询空间中的对象。
+                     double startTime, double endTime, LookupMode mode,
+                     bool incremental) :
+  path(path), lookup(incremental ?
+                     SmartPointer<MoveLookup>(new IncrementalBVH) :
+                     createLookup(mode)),
+  startTime(startTime), endTime(endTime) {
   if (endTime < startTime) {
     swap(startTime, endTime);
     swap(this->startTime, this->endTime);
@@ -55,41 +61,30 @@ ToolSweep::ToolSweep(const SmartPointer<GCode::ToolPath> &path, //  构造函数
     if (lastMove == -1) lastMove = path->size() - 1;
     if (firstMove == -1) firstMove = lastMove + 1;
 
-    double duration = path->at(lastMove).getEndTime() - startTime;
+    double duration = path->getEndTime(lastMove) - startTime;
 
     LOG_DEBUG(1, "Times: start=" << TimeInterval(startTime) << " end="
               << TimeInterval(startTime + duration) << " duration="
               << TimeInterval(duration));
     LOG_DEBUG(1, "GCode::Moves: first=" << firstMove << " last=" << lastMove);
 
-    GCode::ToolTable &tools = path->getTools();
-    vector<Rectangle3D> bboxes;
-
-    // Gather nodes in a list
-    for (int i = firstMove; i <= lastMove; i++) {
-      const GCode::Move &move = path->at(i);
-      int tool = move.getTool();
-
-      if (tool < 0) continue;
-      if (sweeps.size() <= (unsigned)tool) sweeps.resize(tool + 1);
-      if (sweeps[tool].isNull()) sweeps[tool] = getSweep(tools.get(tool));
-
-      Vector3D startPt = move.getPtAtTime(startTime);
-      Vector3D endPt = move.getPtAtTime(endTime);
+    boxes = add(firstMove, lastMove + 1, 0);
+  }
 
-      sweeps[tool]->getBBoxes(startPt, endPt, bboxes);
+  finalize(); // Finalize MoveLookup
+  updateBVHs();
 
-      for (unsigned j = 0; j < bboxes.size(); j++)
-        insert(&move, bboxes[j]);
+  LOG_DEBUG(1, mode << " boxes=" << boxes << " height=" << getHeight());
+}
 
-      boxes += bboxes.size();
-      bboxes.clear();
-    }
-  }
 
-  AABBTree::finalize(); // Finalize MoveLookup
+void ToolSweep::append(unsigned first, MoveLookup *change) {
+  if (!dynamic_cast<IncrementalBVH *>(lookup.get()))
+    THROW("Cannot append to a ToolSweep which is not incremental");
 
-  LOG_DEBUG(1, "AABBTree boxes=" << boxes << " height=" << getHeight());
+  add(first, path->size(), change);
+  finalize();
+  updateBVHs();
 }
 
 // cull方法：重写了父类FieldFunction的纯虚函数。这个方法接受一个矩形作为参数，表示空间中的一个区域。这个方法用来判断该区域是否与工具扫过的形状相交，如果不相交，则返回true，否则返回false。这个方法主要用来优化计算效率，避免不必要的深度计算。
@@ -100,38 +95,237 @@ bool ToolSweep::cull(const Rectangle3D &r) const {
 
 
 namespace {
-  struct move_sort {
-    bool operator()(const GCode::Move *a, const GCode::Move *b) const {
-      return a->getStartTime() < b->getStartTime();
+  // Sweep depths only carry the sign of the result so the first positive hit
+  // decides the result no matter which move it comes from.
+  struct DepthVisitor {
+    const ToolSweep &sweep;
+    const Vector3D &p;
+    double d2 = -numeric_limits<double>::max();
+
+    DepthVisitor(const ToolSweep &sweep, const Vector3D &p) :
+      sweep(sweep), p(p) {}
+
+    bool operator()(unsigned move) {
+      double sd2 = sweep.depth(move, p);
+      if (d2 < sd2) d2 = sd2;
+      return 0 <= sd2; // Stop on first hit
+    }
+  };
+
+
+  const unsigned rowBlock = 16; // 批量计算时每次查询BVH的点数
+
+
+  // 把一组点交给包围盒包含其中任一点的移动。每个点只接受包含它的移动的结果，
+  // 因此与逐点调用depth()的结果完全相同。
+  struct RowVisitor {
+    const ToolSweep &sweep;
+    const BVH &bvh;
+    const double *xs;
+    const double y;
+    const double z;
+    const unsigned n;
+    double *out;
+
+    RowVisitor(const ToolSweep &sweep, const BVH &bvh, const double *xs,
+               double y, double z, unsigned n, double *out) :
+      sweep(sweep), bvh(bvh), xs(xs), y(y), z(z), n(n), out(out) {}
+
+    bool operator()(unsigned item) {
+      bool inside[rowBlock];
+      bool any = false;
+
+      for (unsigned i = 0; i < n; i++) {
+        inside[i] = out[i] < 0 && bvh.itemContains(item, xs[i], y, z);
+        any = any || inside[i];
+      }
+
+      if (!any) return false;
+
+      double d2[rowBlock];
+      sweep.depth(bvh.getMove(item), xs, y, z, n, d2);
+
+      bool done = true;
+      for (unsigned i = 0; i < n; i++) {
+        if (inside[i] && out[i] < d2[i]) out[i] = d2[i];
+        if (out[i] < 0) done = false;
+      }
+
+      return done; // Stop when every point has been hit
     }
   };
 }
 
-// depth方法：重写了父类FieldFunction的纯虚函数。这个方法接受一个三维向量作为参数，表示空间中的一点。这个方法用来计算该点到工具扫过的表面最近的距离的平方，如果该点在表面内部，则返回正值，否则返回负值。这个方法首先调用AABBTree中的collisions方法，找出与该点相交的移动指令，并按照时间顺序排序。然后遍历每个移动指令，并根据其工具编号和起止点，调用相应的Sweep对象中的depth方法，计算该点到该移动指令对应的扫过形状最近的距离。最后返回最大的距离值。
+
+double ToolSweep::depth(unsigned move, const Vector3D &p) const {
+  if (path->getEndTime(move) < startTime || endTime < path->getStartTime(move))
+    return -numeric_limits<double>::max();
+
+  Vector3D startPt = path->getPtAtTime(move, startTime);
+  Vector3D endPt = path->getPtAtTime(move, endTime);
+
+  return sweeps[path->getTool(move)]->depth(startPt, endPt, p);
+}
+
+// depth方法：重写了父类FieldFunction的纯虚函数。这个方法接受一个三维向量作为参数，表示空间中的一点。这个方法用来计算该点到工具扫过的表面，如果该点在表面内部，则返回正值，否则返回负值。使用BVH时直接在其上做不分配内存的遍历，遇到第一个正值立即返回；其他查找器先用collisions收集候选移动。因为各个Sweep的深度只表示符号，所以不需要按时间排序。
 double ToolSweep::depth(const Vector3D &p) const {
-  vector<const GCode::Move *> moves;
-  collisions(p, moves);
+  DepthVisitor visitor(*this, p);
+
+  if (!bvhs.empty()) {
+    for (unsigned i = 0; i < bvhs.size(); i++)
+      if (bvhs[i]->visit(p, visitor)) break;
+
+  } else {
+    vector<unsigned> moves;
+    lookup->collisions(p, moves);
+
+    for (unsigned i = 0; i < moves.size(); i++)
+      if (visitor(moves[i])) break;
+  }
 
-  // Earlier moves first
-  sort(moves.begin(), moves.end(), move_sort());
+  return visitor.d2;
+}
+
+
+double ToolSweep::distance(unsigned move, const Vector3D &p,
+                          Vector3D &normal) const {
+  if (path->getEndTime(move) < startTime || endTime < path->getStartTime(move))
+    return numeric_limits<double>::max();
+
+  Vector3D startPt = path->getPtAtTime(move, startTime);
+  Vector3D endPt = path->getPtAtTime(move, endTime);
+
+  return sweeps[path->getTool(move)]->distance(startPt, endPt, p, normal);
+}
+
+
+// 扫过形状的并集的有向距离是各个移动的最小值。
+double ToolSweep::distance(const Vector3D &p, Vector3D &normal) const {
+  vector<unsigned> moves;
+  lookup->collisions(p, moves);
 
-  double d2 = -numeric_limits<double>::max();
+  double best = numeric_limits<double>::max();
 
   for (unsigned i = 0; i < moves.size(); i++) {
-    const GCode::Move &move = *moves[i];
+    Vector3D n;
+    double d = distance(moves[i], p, n);
+    if (d < best) {
+      best = d;
+      normal = n;
+    }
+  }
 
-    if (move.getEndTime() < startTime || endTime < move.getStartTime())
+  return best;
+}
+
+
+Vector3D ToolSweep::normal(const Vector3D &p, double offset) const {
+  Vector3D n;
+  if (distance(p, n) == numeric_limits<double>::max())
+    return FieldFunction::normal(p, offset);
+  return n;
+}
+
+
+void ToolSweep::depth(unsigned move, const double *xs, double y, double z,
+                      unsigned n, double *out) const {
+  if (path->getEndTime(move) < startTime ||
+      endTime < path->getStartTime(move)) {
+    for (unsigned i = 0; i < n; i++) out[i] = -numeric_limits<double>::max();
+    return;
+  }
+
+  Vector3D startPt = path->getPtAtTime(move, startTime);
+  Vector3D endPt = path->getPtAtTime(move, endTime);
+
+  sweeps[path->getTool(move)]->depth(startPt, endPt, xs, y, z, n, out);
+}
+
+
+// 批量计算一行点的深度：每rowBlock个点用它们的包围盒查询一次BVH，
+// 对每个候选移动用Sweep的SIMD实现计算整组点。没有BVH时逐点计算。
+void ToolSweep::depth(const double *xs, double y, double z, unsigned n,
+                      double *out) const {
+  if (bvhs.empty()) return FieldFunction::depth(xs, y, z, n, out);
+
+  for (unsigned offset = 0; offset < n; offset += rowBlock) {
+    unsigned count = std::min(rowBlock, n - offset);
+    const double *bxs = xs + offset;
+    double *bout = out + offset;
+
+    double minX = bxs[0];
+    double maxX = bxs[0];
+
+    for (unsigned i = 0; i < count; i++) {
+      if (bxs[i] < minX) minX = bxs[i];
+      if (maxX < bxs[i]) maxX = bxs[i];
+      bout[i] = -numeric_limits<double>::max();
+    }
+
+    Rectangle3D box(Vector3D(minX, y, z), Vector3D(maxX, y, z));
+    for (unsigned i = 0; i < bvhs.size(); i++) {
+      RowVisitor visitor(*this, *bvhs[i], bxs, y, z, count, bout);
+      if (bvhs[i]->visitItems(box, visitor)) break;
+    }
+  }
+}
+
+
+unsigned ToolSweep::add(unsigned first, unsigned last, MoveLookup *change) {
+  GCode::ToolTable &tools = path->getTools();
+  vector<Rectangle3D> bboxes;
+  unsigned boxes = 0;
+
+  for (unsigned i = first; i < last; i++) {
+    int tool = path->getTool(i);
+
+    if (tool < 0) continue;
+    if (path->getEndTime(i) < startTime || endTime < path->getStartTime(i))
       continue;
 
-    Vector3D startPt = move.getPtAtTime(startTime);
-    Vector3D endPt = move.getPtAtTime(endTime);
+    if (sweeps.size() <= (unsigned)tool) sweeps.resize(tool + 1);
+    if (sweeps[tool].isNull()) sweeps[tool] = getSweep(tools.get(tool));
+
+    Vector3D startPt = path->getPtAtTime(i, startTime);
+    Vector3D endPt = path->getPtAtTime(i, endTime);
+
+    sweeps[tool]->getBBoxes(startPt, endPt, bboxes);
+
+    for (unsigned j = 0; j < bboxes.size(); j++) {
+      insert(i, bboxes[j]);
+      if (change) change->insert(i, bboxes[j]);
+    }
+
+    boxes += bboxes.size();
+    bboxes.clear();
+  }
+
+  return boxes;
+}
+
+
+void ToolSweep::updateBVHs() {
+  bvhs.clear();
+
+  const BVH *bvh = dynamic_cast<const BVH *>(lookup.get());
+  if (bvh) bvhs.push_back(bvh);
+
+  const IncrementalBVH *incremental =
+    dynamic_cast<const IncrementalBVH *>(lookup.get());
+  if (incremental)
+    for (unsigned i = 0; i < incremental->getLevelCount(); i++)
+      bvhs.push_back(&incremental->getLevel(i));
+}
+
 
-    double sd2 = sweeps[move.getTool()]->depth(startPt, endPt, p);
-    if (0 <= sd2) return sd2; // Approx 5% faster
-    if (d2 < sd2) d2 = sd2;
+// 静态方法createLookup：根据LookupMode创建移动查找器。BVH_MODE创建扁平化的BVH，AABB_MODE创建原来的指针式AABB树。
+SmartPointer<MoveLookup> ToolSweep::createLookup(LookupMode mode) {
+  switch (mode) {
+  case LookupMode::BVH_MODE: return new BVH;
+  case LookupMode::AABB_MODE: return new AABBTree;
   }
 
-  return d2;
+  THROW("Invalid lookup mode " << mode);
 }
 
 // 静态方法getSweep：接受一个GCode::Tool对象作为参数。这个方法用来根据工具的形状创建并返回不同类型的Sweep对象。GCode::Tool对象表示一个工具，包含了编号、形状、半径、长度等信息。Sweep对象有多种子类，如ConicSweep、SpheroidSweep、CompositeSweep等，分别表示圆锥形、椭球形、复合形等扫过形状。
@@ -20,7 +20,8 @@
 
 #pragma once
 
-#include "AABBTree.h"
+#include "MoveLookup.h"
+#include "LookupMode.h"
 #include <gcode/ToolPath.h>
 
 #include <camotics/contour/FieldFunction.h>
@@ -36,32 +37,70 @@ namespace GCode {class ToolTable;}
 
 namespace CAMotics {
   class Sweep;
+  class BVH;
 
-  class ToolSweep : public FieldFunction, public AABBTree { // 表示一个工具扫过的形状和移动的查找器。这个类继承了FieldFunction类和AABBTree类，分别表示一个空间中的场函数和一个轴对齐的包围盒树。这个类有以下特点：
+  class ToolSweep : public FieldFunction, public MoveLookup { // 表示一个工具扫过的形状和移动的查找器。这个类继承了FieldFunction类和MoveLookup类，分别表示一个空间中的场函数和一个移动查找器，查找工作委托给lookup。这个类有以下特点：
     cb::SmartPointer<GCode::ToolPath> path; // path成员变量，是一个GCode::ToolPath对象的智能指针。GCode::ToolPath对象表示一个工具路径，包含了一系列的移动指令和工具信息。
     std::vector<cb::SmartPointer<Sweep> > sweeps; // sweeps成员变量，是一个Sweep对象的智能指针的向量。Sweep对象表示一个抽象的扫过形状，用来模拟切割过程。这个向量根据path中的工具编号和工具表创建不同类型的Sweep对象。
 
+    cb::SmartPointer<MoveLookup> lookup; // lookup成员变量，是实际存储移动包围盒的查找器，根据LookupMode创建BVH或AABBTree。
+    std::vector<const BVH *> bvhs; // lookup中的BVH，depth()可以直接使用不分配内存的内联遍历。lookup是AABBTree时为空。
+
     double startTime = 0; // startTime成员变量，是一个双精度浮点数。它表示工具路径的起始时间，单位是秒。
     double endTime = 0; // endTime成员变量，是一个双精度浮点数。它表示工具路径的结束时间，单位是秒。
 
     cb::SmartPointer<MoveLookup> change; // change成员变量，是一个MoveLookup对象的智能指针。MoveLookup对象表示一个存储和查询GCode::Move对象的结构，表示G代码中的移动指令。这个对象用来表示工具路径在某个时间段内的变化。
 
   public:
-    ToolSweep(const cb::SmartPointer<GCode::ToolPath> &path, // 构造函数，接受一个GCode::ToolPath对象的智能指针和两个双精度浮点数作为参数，分别表示工具路径、起始时间和结束时间。这个函数用来初始化path、startTime、endTime，并根据path中的工具编号和工具表创建sweeps向量，并将其添加到AABBTree中。
+    ToolSweep(const cb::SmartPointer<GCode::ToolPath> &path, // 构造函数，接受一个GCode::ToolPath对象的智能指针和两个双精度浮点数作为参数，分别表示工具路径、起始时间和结束时间。这个函数用来初始化path、startTime、endTime，并根据path中的工具编号和工具表创建sweeps向量，并将其添加到移动查找器中。
               double startTime = 0,
-              double endTime = std::numeric_limits<double>::max());
+              double endTime = std::numeric_limits<double>::max(),
+              LookupMode mode = LookupMode::BVH_MODE,
+              bool incremental = false); // incremental为真时使用IncrementalBVH，之后可以用append()加入路径末尾新增的移动。
 // 两个set方法，分别用来设置startTime和endTime。
     void setStartTime(double startTime) {this->startTime = startTime;}
     void setEndTime(double endTime) {this->endTime = endTime;}
 // 两个get方法，分别用来获取change和sweeps。
+    const cb::SmartPointer<MoveLookup> &getLookup() const {return lookup;} // 返回实际的查找器，例如用于显示包围盒。
     const cb::SmartPointer<MoveLookup> &getChange() const {return change;}
     void setChange(const cb::SmartPointer<MoveLookup> &change)
     {this->change = change;}
 
+    // 把路径中从first开始的移动加入查找器，只能用于incremental的ToolSweep。
+    // change不为空时同样的包围盒也插入change。不能与depth()同时调用。
+    void append(unsigned first, MoveLookup *change = 0);
+
+    // From MoveLookup
+    cb::Rectangle3D getBounds() const {return lookup->getBounds();}
+    void insert(unsigned move, const cb::Rectangle3D &bbox)
+    {lookup->insert(move, bbox);}
+    bool intersects(const cb::Rectangle3D &r) const
+    {return lookup->intersects(r);}
+    void collisions(const cb::Vector3D &p,
+                    std::vector<unsigned> &moves) const
+    {lookup->collisions(p, moves);}
+    unsigned getHeight() const {return lookup->getHeight();}
+    void finalize() {lookup->finalize();}
+
     // From FieldFunction
     bool cull(const cb::Rectangle3D &r) const; // cull方法，重写了父类FieldFunction的纯虚函数。这个方法接受一个矩形作为参数，表示空间中的一个区域。这个方法用来判断该区域是否与工具扫过的形状相交，如果不相交，则返回true，否则返回false。
+    double depth(unsigned move, const cb::Vector3D &p) const; // 计算点p相对于下标为move的移动扫过形状的深度，移动不在时间范围内时返回负的最大值。
+    void depth(unsigned move, const double *xs, double y, double z,
+               unsigned n, double *out) const; // 批量计算一行点相对于单个移动扫过形状的深度。
+    void depth(const double *xs, double y, double z, unsigned n,
+               double *out) const; // 批量计算一行点的深度，重写了父类FieldFunction的虚函数。使用BVH时每16个点查询一次候选移动，再用SIMD计算。
+    cb::Vector3D normal(const cb::Vector3D &p, double offset) const; // 用包含p的移动中有向距离最小的扫过形状计算向外的法向量，没有这样的移动时退回到中心差分。depth()只表示符号，不能直接求梯度。
     double depth(const cb::Vector3D &p) const; // depth方法，重写了父类FieldFunction的纯虚函数。这个方法接受一个三维向量作为参数，表示空间中的一点。这个方法用来计算该点到工具扫过的表面最近的距离的平方，如果该点在表面内部，则返回正值，否则返回负值。
 
+    double distance(unsigned move, const cb::Vector3D &p,
+                    cb::Vector3D &normal) const; // 点p到下标为move的移动扫过形状的有向距离，内部为负，移动不在时间范围内时返回最大值。
+    double distance(const cb::Vector3D &p, cb::Vector3D &normal) const; // 点p到所有包围盒包含p的移动扫过形状的最小有向距离和对应的法向量，没有这样的移动时返回最大值。
+
+    static cb::SmartPointer<MoveLookup> createLookup(LookupMode mode); // 静态方法createLookup，根据LookupMode创建对应的移动查找器。
     static cb::SmartPointer<Sweep> getSweep(const GCode::Tool &tool); // 静态方法getSweep，接受一个GCode::Tool对象作为参数。这个方法用来根据工具的形状创建并返回不同类型的Sweep对象。
+
+  protected:
+    unsigned add(unsigned first, unsigned last, MoveLookup *change); // 插入下标在[first, last)内的移动在时间范围内的包围盒，返回包围盒的数量。
+    void updateBVHs();
   };
 }
@@ -20,6 +20,9 @@
 
 #include "Workpiece.h"
 
+#include <algorithm>
+#include <limits>
+
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
@@ -36,3 +39,69 @@ double Workpiece::depth(const Vector3D &p) const { // depth方法，接受一个
   double d2 = p.distanceSquared(closestPointOnSurface(p));
   return Rectangle3D::contains(p) ? d2 : -d2;
 }
+
+
+// 内部的点取最近的面，外部的点取到工件上最近点的方向。
+double Workpiece::distance(const Vector3D &p, Vector3D &normal) const {
+  if (!Rectangle3D::contains(p)) {
+    Vector3D v = p - closestPointOnSurface(p);
+    double d = v.length();
+    normal = v / d;
+    return d;
+  }
+
+  double best = numeric_limits<double>::max();
+
+  for (unsigned i = 0; i < 3; i++) {
+    double lo = p[i] - rmin[i];
+    double hi = rmax[i] - p[i];
+
+    if (lo < best) {
+      best = lo;
+      normal = Vector3D(0, 0, 0);
+      normal[i] = -1;
+    }
+
+    if (hi < best) {
+      best = hi;
+      normal = Vector3D(0, 0, 0);
+      normal[i] = 1;
+    }
+  }
+
+  return -best;
+}
+
+
+void Workpiece::depth(const double *xs, double y, double z, unsigned n,
+                      double *out) const { // 批量计算一行点的深度。y和z对整行相同，只需计算一次。点在内部时返回到最近面的距离的平方，在外部时返回到工件最近点的距离的平方的负值。
+  const double minX = rmin.x(), maxX = rmax.x();
+
+  // Distance to the nearest y and z faces from inside
+  const double dy = min(y - rmin.y(), rmax.y() - y);
+  const double dz = min(z - rmin.z(), rmax.z() - z);
+  const bool insideYZ = 0 <= dy && 0 <= dz;
+
+  // Squared distance outside along y and z
+  const double oy =
+    y < rmin.y() ? rmin.y() - y : (rmax.y() < y ? y - rmax.y() : 0);
+  const double oz =
+    z < rmin.z() ? rmin.z() - z : (rmax.z() < z ? z - rmax.z() : 0);
+  const double oy2 = oy * oy;
+  const double oz2 = oz * oz;
+
+  for (unsigned i = 0; i < n; i++) {
+    const double x = xs[i];
+    const double dx = min(x - minX, maxX - x);
+    const double ox = x < minX ? minX - x : (maxX < x ? x - maxX : 0);
+
+    // Inside, distance to the closest face
+    const double d = min(dx, min(dy, dz));
+    const double in = d * d;
+
+    // Outside, distance to the closest point on the box
+    const double outside = ox * ox + oy2 + oz2;
+
+    out[i] = insideYZ && 0 <= dx ? in : -outside;
+  }
+}
@@ -34,9 +34,12 @@ namespace CAMotics {
 
     cb::Rectangle3D getBounds() const {return *this;} // getBounds方法，返回工件的边界矩形，即父类cb::Rectangle3D本身。
     bool isValid() const {return getVolume();} // isValid方法，判断工件是否有效，即是否有体积。
+    double distance(const cb::Vector3D &p, cb::Vector3D &normal) const; // 点p到工件表面的有向距离，内部为负，normal为最近的面向外的法向量。
     using cb::Rectangle3D::contains; // contains方法，判断一个点是否在工件内部，即调用父类cb::Rectangle3D的contains方法。
 
     // From FieldFunction
+    void depth(const double *xs, double y, double z, unsigned n,
+               double *out) const; // 批量计算一行点的深度，与逐点计算的结果相同，循环中没有分支，便于编译器向量化。
     double depth(const cb::Vector3D &p) const; // depth方法，接受一个cb::Vector3D对象作为参数，表示一个空间中的点。这个方法返回这个点到工件表面最近的距离的平方，如果这个点在工件内部，则返回正值，否则返回负值。这个方法实现了父类FieldFunction的纯虚函数。
   };
 }
@@ -23,6 +23,7 @@
 
 using namespace CAMotics;
 using namespace cb;
+using namespace std;
 
 
 AABBView::AABBView() : leaves(new GLComposite), nodes(new GLComposite) {
@@ -31,10 +32,15 @@ AABBView::AABBView() : leaves(new GLComposite), nodes(new GLComposite) {
 }
 
 
-void AABBView::load(const AABBTree &tree) {
+void AABBView::load(const MoveLookup &lookup) {
   leaves->clear();
   nodes->clear();
-  if (tree.getRoot()) load(*tree.getRoot(), tree.getHeight(), 0);
+
+  auto tree = dynamic_cast<const AABBTree *>(&lookup);
+  if (tree && tree->getRoot()) load(*tree->getRoot(), tree->getHeight(), 0);
+
+  auto bvh = dynamic_cast<const BVH *>(&lookup);
+  if (bvh) load(*bvh);
 }
 
 
@@ -42,13 +48,33 @@ void AABBView::showNodes(bool show) {nodes->setVisible(show);}
 
 
 void AABBView::load(const AABB &aabb, unsigned height, unsigned depth) {
+  addBox(aabb, aabb.isLeaf(), height, depth);
+
+  if (aabb.getLeft()) load(*aabb.getLeft(), height, depth + 1);
+  if (aabb.getRight()) load(*aabb.getRight(), height, depth + 1);
+}
+
+
+void AABBView::load(const BVH &bvh) {
+  unsigned height = bvh.getHeight();
+  vector<unsigned> depths(bvh.getNodeCount());
+
+  // Nodes are stored depth-first so parents always precede their children
+  for (unsigned i = 0; i < bvh.getNodeCount(); i++) {
+    bool leaf = bvh.isLeaf(i);
+    addBox(bvh.getNodeBounds(i), leaf, height, depths[i]);
+
+    if (!leaf) depths[i + 1] = depths[bvh.getRight(i)] = depths[i] + 1;
+  }
+}
+
+
+void AABBView::addBox(const Rectangle3D &bounds, bool leaf, unsigned height,
+                      unsigned depth) {
   SmartPointer<GLBox> box = new GLBox;
-  box->setBounds(aabb);
+  box->setBounds(bounds);
   box->setColor(0.5, 0, (height - depth) / (double)height);
 
-  if (aabb.isLeaf()) leaves->add(box);
+  if (leaf) leaves->add(box);
   else nodes->add(box);
-
-  if (aabb.getLeft()) load(*aabb.getLeft(), height, depth + 1);
-  if (aabb.getRight()) load(*aabb.getRight(), height, depth + 1);
 }
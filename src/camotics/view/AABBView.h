@@ -23,6 +23,7 @@
 #include "GLComposite.h"
 
 #include <camotics/sim/AABBTree.h>
+#include <camotics/sim/BVH.h>
 
 
 namespace CAMotics {
@@ -33,10 +34,13 @@ namespace CAMotics {
   public:
     AABBView();
 
-    void load(const AABBTree &tree);
+    void load(const MoveLookup &lookup);
     void showNodes(bool show);
 
   protected:
     void load(const AABB &aabb, unsigned height, unsigned depth);
+    void load(const BVH &bvh);
+    void addBox(const cb::Rectangle3D &bounds, bool leaf, unsigned height,
+                unsigned depth);
   };
 }
@@ -26,7 +26,7 @@ using namespace cb;
 using namespace CAMotics;
 
 
-CuboidView::CuboidView() : Mesh(12) {
+CuboidView::CuboidView() : Mesh(36, 12) {
   static float vertices[] = {
     1, 0, 0,  1, 0, 1,  1, 1, 0,   1, 0, 1,  1, 1, 1,  1, 1, 0,
     0, 0, 0,  0, 0, 1,  0, 1, 0,   0, 0, 1,  0, 1, 1,  0, 1, 0,
@@ -49,7 +49,11 @@ CuboidView::CuboidView() : Mesh(12) {
      0,  0, -1,   0,  0, -1,   0,  0, -1,   0,  0, -1,   0,  0, -1,   0,  0, -1,
   };
 
-  Mesh::add(36, vertices, normals);
+  // Faces are flat shaded so vertices are not shared
+  uint32_t indices[36];
+  for (unsigned i = 0; i < 36; i++) indices[i] = i;
+
+  Mesh::add(36, vertices, normals, 36, indices);
 }
 
 
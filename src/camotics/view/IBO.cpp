@@ -0,0 +1,69 @@
+/******************************************************************************\
+
+             CAMotics is an Open-Source simulation and CAM software.
+     Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+       This program is free software: you can redistribute it and/or modify
+       it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 2 of the License, or
+                       (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+                   GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "IBO.h"
+#include "GLContext.h"
+
+using namespace CAMotics;
+
+
+IBO::~IBO() {
+  try {
+    if (buffer && GLContext::isActive())
+      GLContext().glDeleteBuffers(1, &buffer);
+  } catch (...) {}
+}
+
+
+unsigned IBO::get() {
+  if (!buffer) GLContext().glGenBuffers(1, &buffer);
+  return buffer;
+}
+
+
+void IBO::allocate(unsigned count) {
+  size = count * sizeof(uint32_t);
+  fill = 0;
+
+  GLContext gl;
+
+  gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, get());
+  gl.glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, 0, GL_STATIC_DRAW);
+  gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+void IBO::add(unsigned count, const uint32_t *data) {
+  unsigned bytes = count * sizeof(uint32_t);
+  unsigned newFill = fill + bytes;
+  if (size < newFill) THROW("IBO overflow " << size << " < " << newFill);
+
+  GLContext gl;
+
+  gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, get());
+  gl.glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, fill, bytes, data);
+  gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  fill = newFill;
+}
+
+
+void IBO::bind() {GLContext().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, get());}
+void IBO::unbind() {GLContext().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);}
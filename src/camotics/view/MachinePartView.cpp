@@ -38,12 +38,13 @@ MachinePartView::MachinePartView(MachinePart &part) :
   add(lines = new Lines(part.getLines()));
 
   // Mesh
-  add(mesh = new Mesh(part.getTriangleCount()));
+  add(mesh = new Mesh(part.getVertexCount(), part.getTriangleCount()));
   mesh->setColor(color);
 
   auto cb =
-    [this] (const vector<float> &vertices, const vector<float> &normals) {
-      mesh->add(vertices, normals);
+    [this] (const vector<float> &vertices, const vector<float> &normals,
+            const vector<uint32_t> &indices) {
+      mesh->add(vertices, normals, indices);
     };
 
   part.getVertices(cb);
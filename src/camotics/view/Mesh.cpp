@@ -26,41 +26,61 @@ using namespace CAMotics;
 using namespace std;
 
 
-Mesh::Mesh(unsigned triangles) {reset(triangles);}
+Mesh::Mesh(unsigned vertices, unsigned triangles) {
+  reset(vertices, triangles);
+}
 
 
-void Mesh::reset(unsigned triangles) {
+void Mesh::reset(unsigned vertices, unsigned triangles) {
   this->triangles = triangles;
-  unsigned size = triangles * 9 * sizeof(float);
+  fill = 0;
+  unsigned size = vertices * 3 * sizeof(float);
 
   lines.release();
-  vertices.allocate(size);
+  this->vertices.allocate(size);
   normals.allocate(size);
+  indices.allocate(triangles * 3);
 }
 
 
-void Mesh::add(unsigned count, const float *vertices, const float *normals) {
-  if (count % 3) THROW("Mesh vertices array size not a multiple of 3");
+void Mesh::add(unsigned count, const float *vertices, const float *normals,
+               unsigned indexCount, const uint32_t *indices) {
+  if (indexCount % 3) THROW("Mesh index array size not a multiple of 3");
 
   lines.release();
   this->vertices.add(3 * count, vertices);
   this->normals.add(3 * count, normals);
+
+  // Offset indices past the vertices of earlier calls
+  if (fill) {
+    vector<uint32_t> offset(indices, indices + indexCount);
+    for (unsigned i = 0; i < indexCount; i++) offset[i] += fill;
+    this->indices.add(indexCount, &offset[0]);
+
+  } else this->indices.add(indexCount, indices);
+
+  fill += count;
 }
 
 
-void Mesh::add(const vector<float> &vertices, const vector<float> &normals) {
+void Mesh::add(const vector<float> &vertices, const vector<float> &normals,
+               const vector<uint32_t> &indices) {
   if (vertices.size() != normals.size())
     THROW("Number of vertices not equal to number of normals");
-  if (!vertices.empty()) add(vertices.size() / 3, &vertices[0], &normals[0]);
+  if (!indices.empty())
+    add(vertices.size() / 3, &vertices[0], &normals[0], indices.size(),
+        &indices[0]);
 }
 
 
 void Mesh::glDraw(GLContext &gl) {
   vertices.enable(3);
   normals.enable(3);
+  indices.bind();
 
-  gl.glDrawArrays(GL_TRIANGLES, 0, triangles * 3);
+  gl.glDrawElements(GL_TRIANGLES, indices.getCount(), GL_UNSIGNED_INT, 0);
 
+  indices.unbind();
   vertices.disable();
   normals.disable();
 }
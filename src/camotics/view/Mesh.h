@@ -23,28 +23,35 @@
 #include "GLObject.h"
 #include "Lines.h"
 #include "VBO.h"
+#include "IBO.h"
 
 #include <vector>
+#include <cinttypes>
 
 
 namespace CAMotics {
   class Mesh : public GLObject {
     unsigned triangles;
+    unsigned fill; // Vertices added so far
     cb::SmartPointer<Lines> lines;
 
     VBO vertices = GL_ATTR_POSITION;
     VBO normals = GL_ATTR_NORMAL;
+    IBO indices;
 
   public:
-    Mesh(unsigned triangles);
+    Mesh(unsigned vertices, unsigned triangles);
 
     bool empty() const {return !triangles;}
 
-    void reset(unsigned triangles);
+    void reset(unsigned vertices, unsigned triangles);
 
-    void add(unsigned count, const float *vertices, const float *normals);
+    // Indices are relative to the vertices passed in the same call
+    void add(unsigned count, const float *vertices, const float *normals,
+             unsigned indexCount, const uint32_t *indices);
     void add(const std::vector<float> &vertices,
-             const std::vector<float> &normals);
+             const std::vector<float> &normals,
+             const std::vector<uint32_t> &indices);
 
     // From GLObject
     void glDraw(GLContext &gl);
@@ -25,12 +25,47 @@
 #include <cbang/Catch.h>
 
 #include <limits>
+#include <algorithm>
 
 using namespace std;
 using namespace cb;
 using namespace CAMotics;
 
 
+namespace {
+  const Color dim(0.3, 0.3, 0.3);
+
+
+  void push(vector<float> &data, const Vector3D &v) {
+    for (unsigned i = 0; i < 3; i++) data.push_back(v[i]);
+  }
+
+
+  void push(vector<float> &data, const Color &c) {
+    for (unsigned i = 0; i < 3; i++) data.push_back(c[i]);
+  }
+
+
+  void upload(GLContext &gl, VBO &vbo, vector<float> &data, GLenum usage) {
+    if (data.empty()) return;
+
+    gl.glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+    gl.glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0],
+                    usage);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vector<float>().swap(data);
+  }
+
+
+  void bindAttrib(GLContext &gl, GLuint attrib, VBO &vbo) {
+    gl.glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+    gl.glVertexAttribPointer(attrib, 3, GL_FLOAT, false, 0, 0);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+}
+
+
 ToolPathView::ToolPathView(ValueSet &valueSet) : values(valueSet) {
   values.add("x", position.x());
   values.add("y", position.y());
@@ -74,7 +109,7 @@ void ToolPathView::setPath(const SmartPointer<const GCode::ToolPath> &path) {
   this->path = path;
 
   move = GCode::Move();
-  dirty = true;
+  dirty = geometryDirty = colorsDirty = true;
 
   if (path.isNull() || path->empty()) return;
 
@@ -112,7 +147,7 @@ void ToolPathView::setByMove(unsigned i) {
   if (path->size() <= i) THROW("Move index out of range");
 
   if (moveIndex != (int)i) {
-    auto &move = path->at(i);
+    GCode::Move move = path->at(i);
     setByLine(*move.getFilename(), move.getLine());
     moveIndex = i;
     dirty = true;
@@ -137,7 +172,7 @@ void ToolPathView::decTime(double amount) {
 void ToolPathView::setShowIntensity(bool show) {
   if (show == showIntensity) return;
   showIntensity = show;
-  dirty = true;
+  dirty = colorsDirty = true;
 }
 
 
@@ -159,110 +194,229 @@ Color ToolPathView::getColor(GCode::MoveType type, double intensity) {
 }
 
 
-void ToolPathView::update() {
-  if (!dirty) return;
+Color ToolPathView::getMoveColor(const GCode::Move &move) {
+  double s =
+    (showIntensity && maxSpeed) ? fabs(move.getSpeed()) / maxSpeed : 1;
+  return getColor(move.getType(), s);
+}
 
-  time = distance = 0;
-  move = GCode::Move();
+
+bool ToolPathView::fileMatches(unsigned i) const {
+  if (filename.empty()) return true;
+  const SmartPointer<string> &moveFile = path->getFilename(i);
+  return moveFile.isSet() ? filename == *moveFile : false;
+}
+
+
+void ToolPathView::buildGeometry() {
+  unsigned n = path.isNull() ? 0 : path->size();
+
+  moveTimes.assign(1, 0);
+  moveDistances.assign(1, 0);
+  moveTimes.reserve(n + 1);
+  moveDistances.reserve(n + 1);
 
   vertices.clear();
-  colors.clear();
   picking.clear();
+  vertices.reserve(6 * n);
+  picking.reserve(6 * n);
+
+  for (unsigned i = 0; i < n; i++) {
+    const GCode::Move &move = path->at(i);
+
+    moveTimes.push_back(moveTimes.back() + move.getTime());
+    moveDistances.push_back(moveDistances.back() + move.getDistance());
+
+    // Convert index to RGB picking color
+    Color pick = Color::fromIndex(i);
+
+    push(vertices, move.getStartPt());
+    push(vertices, move.getEndPt());
+    push(picking, pick);
+    push(picking, pick);
+  }
+
+  numMoves = n;
+  geometryDirty = false;
+}
+
+
+void ToolPathView::buildColors() {
+  unsigned n = path.isNull() ? 0 : path->size();
 
   // Find maximum speed
-  double maxSpeed = 0;
-  if (showIntensity && path.isSet())
-    for (auto &move : *path)
-      if (maxSpeed < fabs(move.getSpeed()))
-        maxSpeed = fabs(move.getSpeed());
-
-  // Find position on path
-  if (!path.isNull()) {
-    bool found = false;
-
-    for (unsigned i = 0; i < path->size(); i++) {
-      const GCode::Move &move = path->at(i);
-
-      const Vector3D &start = move.getStartPt();
-      Vector3D end          = move.getEndPt();
-      Vector3D mid;
-      double moveTime       = move.getTime();
-      double moveDistance   = move.getDistance();
-      uint32_t moveLine     = move.getLine();
-      string moveFile;
-      bool partial          = false;
-
-      if (move.getFilename().isSet()) moveFile = *move.getFilename();
-      bool fileMatch = filename.empty() || filename == moveFile;
-      bool moveMatch = moveIndex == -1 || moveIndex == (int)i;
-
-      if (!found) {
-        if (byLine) {
-          // Selection by line
-          if (fileMatch && line <= moveLine && moveMatch) {
-            found = true;
-
-            if (position.isReal()) {
-              double distance = move.distance(position, mid);
-
-              // TODO find the closest point on the closest move at this line
-              if (distance < 0.00001) {
-                double delta = start.distance(mid);
-                moveTime *= delta / moveDistance;
-                moveDistance = delta;
-                partial = true;
-              }
-
-            } else position = end;
-          }
-
-        } else {
-          // Selection by time ratio
-          double targetTime = ratio * getTotalTime();
-
-          if (targetTime < time + moveTime) {
-            double delta = targetTime - time;
-            mid = move.getPtAtTime(targetTime);
-            moveDistance *= delta / moveTime;
-            moveTime = delta;
-            partial = found = true;
-            line = moveLine;
-            filename = moveFile;
-            position = mid;
-          }
-        }
+  maxSpeed = 0;
+  if (showIntensity)
+    for (unsigned i = 0; i < n; i++)
+      if (maxSpeed < fabs(path->at(i).getSpeed()))
+        maxSpeed = fabs(path->at(i).getSpeed());
+
+  colors.clear();
+  dimColors.clear();
+  colors.reserve(6 * n);
+  dimColors.reserve(6 * n);
+
+  for (unsigned i = 0; i < n; i++) {
+    Color color = getMoveColor(path->at(i));
+    push(colors, color);
+    push(colors, color);
+
+    color *= dim;
+    push(dimColors, color);
+    push(dimColors, color);
+  }
 
-        time += moveTime;
-        distance += moveDistance;
+  colorsDirty = false;
+}
+
+
+void ToolPathView::locate() {
+  time = distance = 0;
+  move = GCode::Move();
+  spans.clear();
+  extraVertices.clear();
+  extraColors.clear();
+  extraPicking.clear();
+  numExtra = 0;
 
-        // Update current move
-        if (found && position.isReal()) this->move = move;
+  if (path.isNull()) return;
+
+  unsigned n = path->size();
+  int found = -1;
+  bool partial = false;
+  Vector3D mid;
+  vector<unsigned> selected; // Moves on the selected line, in order
+
+  if (byLine) {
+    // Selection by line
+    if (0 <= moveIndex) {
+      unsigned i = moveIndex;
+
+      if (i < n && line <= path->getLine(i) && fileMatches(i)) {
+        found = i;
+        if (line == path->getLine(i)) selected.push_back(i);
       }
 
-      // Store vertex and color data
-      double s =
-        (showIntensity && maxSpeed) ? fabs(move.getSpeed()) / maxSpeed : 1;
-      Color color = getColor(move.getType(), s);
-
-      // Change color based on selection
-      if (byLine && line == moveLine && fileMatch && moveMatch)
-        color = Color::WHITE;
-      else if (!partial && found) color *= Color(0.3, 0.3, 0.3);
-
-      pushVertex(start, color, i);
-      if (partial) {
-        pushVertex(mid, color, i);
-        color *= Color(0.3, 0.3, 0.3);
-        pushVertex(mid, color, i);
+    } else
+      for (unsigned i = 0; i < n; i++) {
+        unsigned moveLine = path->getLine(i);
+        if (moveLine < line || (found != -1 && moveLine != line)) continue;
+        if (!fileMatches(i)) continue;
+
+        if (found == -1) found = i;
+        if (moveLine == line) selected.push_back(i);
       }
-      pushVertex(end, color, i);
+
+    if (found != -1) {
+      const GCode::Move &move = path->at(found);
+      double moveTime = move.getTime();
+      double moveDistance = move.getDistance();
+
+      if (position.isReal()) {
+        // TODO find the closest point on the closest move at this line
+        if (move.distance(position, mid) < 0.00001) {
+          double delta = move.getStartPt().distance(mid);
+          moveTime *= delta / moveDistance;
+          moveDistance = delta;
+          partial = true;
+        }
+
+      } else position = move.getEndPt();
+
+      time = moveTimes[found] + moveTime;
+      distance = moveDistances[found] + moveDistance;
+      this->move = move;
+    }
+
+  } else {
+    // Selection by time ratio, find the first move ending after the target
+    double targetTime = ratio * getTotalTime();
+    auto it = upper_bound(moveTimes.begin() + 1, moveTimes.end(), targetTime);
+
+    if (it != moveTimes.end()) {
+      found = it - moveTimes.begin() - 1;
+
+      const GCode::Move &move = path->at(found);
+      double delta = targetTime - moveTimes[found];
+
+      mid = path->getPtAtTime(found, path->getStartTime(found) + delta);
+      time = targetTime;
+      distance = moveDistances[found] + move.getDistance() * delta /
+        move.getTime();
+      partial = true;
+      line = move.getLine();
+      filename = move.getFilename().isSet() ? *move.getFilename() : string();
+      position = mid;
+      this->move = move;
+    }
+  }
+
+  if (found == -1) {
+    time = moveTimes.back();
+    distance = moveDistances.back();
+    if (n) position = path->getEndPt(n - 1);
+  }
+
+  // Moves before the current one in full color, the rest dimmed
+  if (found == -1) addSpans(0, n, false, selected);
+  else {
+    addSpans(0, found, false, selected);
+    addSpans(partial ? found + 1 : found, n, true, selected);
+  }
+
+  // Selected moves in white
+  for (unsigned i = 0; i < selected.size(); i++) {
+    unsigned index = selected[i];
+    if (partial && (int)index == found) continue;
+
+    pushExtra(path->getStartPt(index), Color::WHITE, index);
+    pushExtra(path->getEndPt(index), Color::WHITE, index);
+  }
+
+  // Split the current move
+  if (partial) {
+    bool isSelected = !selected.empty() &&
+      binary_search(selected.begin(), selected.end(), (unsigned)found);
+    Color color =
+      isSelected ? Color::WHITE : getMoveColor(path->at(found));
+
+    pushExtra(path->getStartPt(found), color, found);
+    pushExtra(mid, color, found);
+    color *= dim;
+    pushExtra(mid, color, found);
+    pushExtra(path->getEndPt(found), color, found);
+  }
+
+  numExtra = extraVertices.size() / 3;
+}
+
+
+void ToolPathView::addSpans(unsigned first, unsigned last, bool dim,
+                            const vector<unsigned> &selected) {
+  // Selected moves are skipped, they are drawn in white
+  auto it = lower_bound(selected.begin(), selected.end(), first);
+
+  while (first < last) {
+    unsigned end = (it == selected.end() || last < *it) ? last : *it;
+
+    if (first < end) {
+      Span span = {first, end - first, dim};
+      spans.push_back(span);
     }
 
-    if (!found && path->size())
-        position = path->at(path->size() - 1).getEndPt();
+    if (end == last) break;
+    first = end + 1;
+    it++;
   }
+}
+
+
+void ToolPathView::update() {
+  if (!dirty) return;
 
-  numVertices = vertices.size() / 3;
+  if (geometryDirty) buildGeometry();
+  if (colorsDirty) buildColors();
+  locate();
 
   values.updated();
   dirty = false;
@@ -274,54 +428,38 @@ void ToolPathView::glDraw(GLContext &gl) {
 
   update();
 
-  if (!numVertices) return;
-
-  // Setup picking buffers
-  if (!picking.empty()) {
-    gl.glBindBuffer(GL_ARRAY_BUFFER, pickingVBuf.get());
-    gl.glBufferData(GL_ARRAY_BUFFER, picking.size() * sizeof(float),
-                    &picking[0], GL_STATIC_DRAW);
-    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
-    picking.clear();
-  }
-
-  // Setup color buffers
-  if (!colors.empty()) {
-    gl.glBindBuffer(GL_ARRAY_BUFFER, colorVBuf.get());
-    gl.glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(float),
-                    &colors[0], GL_STATIC_DRAW);
-    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
-    colors.clear();
-  }
+  if (!numMoves) return;
 
-  // Setup vertex buffers
-  if (!vertices.empty()) {
-    gl.glBindBuffer(GL_ARRAY_BUFFER, vertexVBuf.get());
-    gl.glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
-                    &vertices[0], GL_STATIC_DRAW);
-    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
-    vertices.clear();
-  }
+  // Setup buffers, the path buffers only change with the path or colors
+  upload(gl, pickingVBuf, picking, GL_STATIC_DRAW);
+  upload(gl, colorVBuf, colors, GL_STATIC_DRAW);
+  upload(gl, dimColorVBuf, dimColors, GL_STATIC_DRAW);
+  upload(gl, vertexVBuf, vertices, GL_STATIC_DRAW);
+  upload(gl, extraPickingVBuf, extraPicking, GL_DYNAMIC_DRAW);
+  upload(gl, extraColorVBuf, extraColors, GL_DYNAMIC_DRAW);
+  upload(gl, extraVertexVBuf, extraVertices, GL_DYNAMIC_DRAW);
 
-  // Picking
   gl.glEnableVertexAttribArray(GL_ATTR_PICKING);
-  gl.glBindBuffer(GL_ARRAY_BUFFER, pickingVBuf.get());
-  gl.glVertexAttribPointer(GL_ATTR_PICKING, 3, GL_FLOAT, false, 0, 0);
-
-  // Color
   gl.glEnableVertexAttribArray(GL_ATTR_COLOR);
-  gl.glBindBuffer(GL_ARRAY_BUFFER, colorVBuf.get());
-  gl.glVertexAttribPointer(GL_ATTR_COLOR, 3, GL_FLOAT, false, 0, 0);
-
-  // Position
   gl.glEnableVertexAttribArray(GL_ATTR_POSITION);
-  gl.glBindBuffer(GL_ARRAY_BUFFER, vertexVBuf.get());
-  gl.glVertexAttribPointer(GL_ATTR_POSITION, 3, GL_FLOAT, false, 0, 0);
 
-  gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // Draw path
+  bindAttrib(gl, GL_ATTR_PICKING, pickingVBuf);
+  bindAttrib(gl, GL_ATTR_POSITION, vertexVBuf);
 
-  // Draw
-  gl.glDrawArrays(GL_LINES, 0, numVertices);
+  for (unsigned i = 0; i < spans.size(); i++) {
+    const Span &span = spans[i];
+    bindAttrib(gl, GL_ATTR_COLOR, span.dim ? dimColorVBuf : colorVBuf);
+    gl.glDrawArrays(GL_LINES, 2 * span.first, 2 * span.count);
+  }
+
+  // Draw current and selected moves
+  if (numExtra) {
+    bindAttrib(gl, GL_ATTR_PICKING, extraPickingVBuf);
+    bindAttrib(gl, GL_ATTR_COLOR, extraColorVBuf);
+    bindAttrib(gl, GL_ATTR_POSITION, extraVertexVBuf);
+    gl.glDrawArrays(GL_LINES, 0, numExtra);
+  }
 
   // Clean up
   gl.glDisableVertexAttribArray(GL_ATTR_POSITION);
@@ -330,15 +468,9 @@ void ToolPathView::glDraw(GLContext &gl) {
 }
 
 
-void ToolPathView::pushVertex(
+void ToolPathView::pushExtra(
   const Vector3D &v, const Color &color, unsigned index) {
-
-  // Convert index to RGB picking color
-  Color pick = Color::fromIndex(index);
-
-  for (unsigned i = 0; i < 3; i++) {
-    colors.push_back(color[i]);
-    picking.push_back(pick[i]);
-    vertices.push_back(v[i]);
-  }
+  push(extraVertices, v);
+  push(extraColors, color);
+  push(extraPicking, Color::fromIndex(index));
 }
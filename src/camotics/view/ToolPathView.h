@@ -49,18 +49,49 @@ namespace CAMotics {
     double distance = 0;
     GCode::Move move;
 
-    bool dirty = true;
+    bool dirty = true;         // Position or selection changed
+    bool geometryDirty = true; // Path changed
+    bool colorsDirty = true;   // Path or intensity changed
     bool showIntensity = false;
+    double maxSpeed = 0;
 
+    // Prefix sums of move times and distances, one more entry than moves
+    std::vector<double> moveTimes;
+    std::vector<double> moveDistances;
+
+    // The whole path, two vertices per move.  Uploaded when the path or the
+    // colors change, not during playback.
     std::vector<float> vertices;
     std::vector<float> colors;
+    std::vector<float> dimColors;
     std::vector<float> picking;
 
     VBO vertexVBuf;
     VBO colorVBuf;
+    VBO dimColorVBuf;
     VBO pickingVBuf;
 
-    unsigned numVertices = 0;
+    unsigned numMoves = 0;
+
+    // Ranges of moves drawn from the path buffers
+    struct Span {
+      unsigned first;
+      unsigned count;
+      bool dim;
+    };
+
+    std::vector<Span> spans;
+
+    // The partially completed move and selected moves, drawn separately
+    std::vector<float> extraVertices;
+    std::vector<float> extraColors;
+    std::vector<float> extraPicking;
+
+    VBO extraVertexVBuf;
+    VBO extraColorVBuf;
+    VBO extraPickingVBuf;
+
+    unsigned numExtra = 0;
 
   public:
     ToolPathView(ValueSet &valueSet);
@@ -129,6 +160,13 @@ namespace CAMotics {
     void glDraw(GLContext &gl);
 
   protected:
-    void pushVertex(const cb::Vector3D &v, const Color &color, unsigned index);
+    Color getMoveColor(const GCode::Move &move);
+    bool fileMatches(unsigned i) const;
+    void buildGeometry();
+    void buildColors();
+    void locate();
+    void addSpans(unsigned first, unsigned last, bool dim,
+                  const std::vector<unsigned> &selected);
+    void pushExtra(const cb::Vector3D &v, const Color &color, unsigned index);
   };
 }
@@ -206,23 +206,23 @@ void View::loadWireModel() {
   wireModel->reset(surface->getTriangleCount() * 3, false, true);
 
   auto cb =
-    [this] (const vector<float> &vertices, const vector<float> &normals) {
-      unsigned triangles = vertices.size() / 9;
+    [this] (const vector<float> &vertices, const vector<float> &normals,
+            const vector<uint32_t> &indices) {
+      unsigned triangles = indices.size() / 3;
+      if (!triangles) return;
+
       vector<float> v(triangles * 18);
       vector<float> n(triangles * 18);
 
+      // Three lines per triangle, v0->v1, v1->v2 and v2->v0
+      static const unsigned corners[6] = {0, 1, 1, 2, 2, 0};
+
       for (unsigned i = 0; i < triangles; i++)
-        for (unsigned j = 0; j < 2; j++) {
-          const float *t = j ? &normals[i * 9] : &vertices[i * 9];
-          vector<float> &out = j ? n : v;
-          const float *v0 = t;
-          const float *v1 = &t[3];
-          const float *v2 = &t[6];
-
-          memcpy(&out[i * 18 +  0], v0, sizeof(float) * 6);
-          memcpy(&out[i * 18 +  6], v1, sizeof(float) * 6);
-          memcpy(&out[i * 18 + 12], v2, sizeof(float) * 3);
-          memcpy(&out[i * 18 + 15], v0, sizeof(float) * 3);
+        for (unsigned j = 0; j < 6; j++) {
+          unsigned index = indices[i * 3 + corners[j]] * 3;
+
+          memcpy(&v[i * 18 + j * 3], &vertices[index], sizeof(float) * 3);
+          memcpy(&n[i * 18 + j * 3], &normals[index], sizeof(float) * 3);
         }
 
       wireModel->add(triangles * 6, &v[0], 0, &n[0]);
@@ -245,17 +245,18 @@ void View::updateModel() {
     wireModel->reset(0, false, false);
 
     if (surface.isSet()) {
-      model->reset(surface->getTriangleCount());
+      model->reset(surface->getVertexCount(), surface->getTriangleCount());
 
       auto cb =
-        [this] (const vector<float> &vertices, const vector<float> &normals) {
-          model->add(vertices, normals);
+        [this] (const vector<float> &vertices, const vector<float> &normals,
+                const vector<uint32_t> &indices) {
+          model->add(vertices, normals, indices);
         };
 
       surface->getVertices(cb);
       model->setVisible(!wire);
 
-    } else model->reset(0);
+    } else model->reset(0, 0);
   }
 
   if (surface.isSet() && wire && wireModel->empty()) loadWireModel();
@@ -291,7 +292,7 @@ void View::updateMachine() {
 void View::updateAABB() {
   if (moveLookup.isSet() && aabbView->isVisible() && moveLookupChanged) {
     moveLookupChanged = false;
-    aabbView->load(*moveLookup.cast<AABBTree>());
+    aabbView->load(*moveLookup);
   }
 }
 
@@ -306,7 +307,7 @@ void View::glInit() {
   group->add(bounds = new GLBox);
   group->add(path);
   group->add(aabbView);
-  group->add(model = new Mesh(0));
+  group->add(model = new Mesh(0, 0));
   group->add(wireModel = new Lines(0, false, false));
   group->add(workpiece = new CuboidView);
   group->add(tool = new ToolView); // Last for transparency
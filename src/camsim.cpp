@@ -21,6 +21,8 @@
 #include <camotics/Application.h>
 #include <camotics/sim/Simulation.h>
 #include <camotics/sim/CutSim.h>
+#include <camotics/sim/SurfaceCache.h>
+#include <camotics/sim/ToolPathCache.h>
 #include <camotics/project/Project.h>
 #include <camotics/contour/Surface.h>
 
@@ -48,10 +50,17 @@ namespace CAMotics {
   class SimApp : public Application {
     double time = 0;
     bool reduce = false;
+    ReduceMode reduceMode;
     bool binary = true;
     RenderMode renderMode;
+    LookupMode lookupMode;
     string resolution;
     unsigned threads;
+    bool cache = true;
+    bool pathCache = false;
+    bool stream = false;
+    string cacheDir;
+    unsigned cacheSize;
 
     string input;
     SmartPointer<ostream> output;
@@ -62,7 +71,9 @@ namespace CAMotics {
   public:
     SimApp() :
       Application("CAMotics Sim"),
-      threads(SystemInfo::instance().getCPUCount()) {
+      threads(SystemInfo::instance().getCPUCount()),
+      cacheDir(SurfaceCache::getDefaultPath()),
+      cacheSize(SurfaceCache::defaultMaxSize / (1024 * 1024)) {
 
       cmdLine.setUsageArgs
         ("[OPTIONS] <project.camotics | input.gcode | input.tpl> <output.stl>");
@@ -73,13 +84,35 @@ namespace CAMotics {
       cmdLine.addTarget("time", time, "Simulation end time in seconds.  "
                         "A value of zero simulates the entire path.");
       cmdLine.addTarget("reduce", reduce, "Reduce cut workpiece.");
+      cmdLine.addTarget("reduce-mode", reduceMode,
+                        "Mesh reduction algorithm.");
       cmdLine.addTarget("binary", binary,
                         "Output binary STL, otherwise ASCII.");
       cmdLine.addTarget("render-mode", renderMode,
                         "Render surface generation mode.");
+      cmdLine.addTarget("lookup-mode", lookupMode,
+                        "Tool path move lookup structure.");
       cmdLine.addTarget("resolution", resolution, "Valid values are 'low', "
                         "'medium', 'high' or a decimal value.");
       cmdLine.addTarget("threads", threads, "Number of simulation threads.");
+      cmdLine.addTarget("cache", cache, "Reuse previously computed surfaces "
+                        "from the surface cache.");
+      cmdLine.addTarget("path-cache", pathCache, "Reuse previously "
+                        "interpreted G-code from the tool path cache.  "
+                        "Cached runs skip G-code messages and programs "
+                        "which load subroutine files are never cached.  "
+                        "The cache is in $CAMOTICS_PATH_CACHE or the user's "
+                        "cache directory.");
+      cmdLine.addTarget("stream", stream, "Simulate while the program is "
+                        "still being interpreted.  Requires a project with "
+                        "fixed workpiece bounds.  Streamed moves are timed "
+                        "by feed rate only, so it cannot be combined with "
+                        "--time.");
+      cmdLine.addTarget("cache-dir", cacheDir, "Surface cache directory.  "
+                        "Defaults to $CAMOTICS_SURFACE_CACHE or the user's "
+                        "cache directory.");
+      cmdLine.addTarget("cache-size", cacheSize,
+                        "Maximum surface cache size in MiB.");
 
       Logger::instance().setLogTime(false);
       Logger::instance().setLogNoInfoHeader(true);
@@ -102,6 +135,15 @@ namespace CAMotics {
       input = args[0];
       output = SystemUtilities::oopen(args[1]);
 
+      if (stream && time) THROW("--stream cannot be used with --time");
+
+      SurfaceCache &surfaceCache = SurfaceCache::instance();
+      surfaceCache.setEnabled(cache);
+      surfaceCache.setPath(cacheDir);
+      surfaceCache.setMaxSize((uint64_t)cacheSize * 1024 * 1024);
+
+      ToolPathCache::instance().setEnabled(pathCache);
+
       return 0;
     }
 
@@ -127,22 +169,32 @@ namespace CAMotics {
         project.setResolutionMode(resMode);
       }
 
-      // Generate tool path
-      SmartPointer<GCode::ToolPath> path = cutSim.computeToolPath(project);
-
-      // Simulate
       Rectangle3D bounds = project.getWorkpiece().getBounds();
-      project.getWorkpiece().update(*path);
-
-      Simulation sim(path, 0, 0, bounds, project.getResolution(),
+      Simulation sim(0, 0, 0, bounds, project.getResolution(),
                      time ? time : numeric_limits<double>::max(),
                      renderMode, threads);
+      sim.lookupMode = lookupMode;
 
       SmartPointer<Surface> surface;
-      if (!shouldQuit()) surface = cutSim.computeSurface(sim);
+
+      if (stream && project.getWorkpiece().isAutomatic())
+        LOG_WARNING("Automatic workpiece bounds, not streaming");
+
+      if (stream && !project.getWorkpiece().isAutomatic())
+        surface = cutSim.streamSurface(project, sim);
+
+      else {
+        // Generate tool path
+        sim.path =
+          cutSim.computeToolPath(project, pathCache, sim.planConf.get());
+        project.getWorkpiece().update(*sim.path);
+
+        // Simulate
+        if (!shouldQuit()) surface = cutSim.computeSurface(sim);
+      }
 
       // Reduce
-      if (reduce && !shouldQuit()) cutSim.reduceSurface(surface);
+      if (reduce && !shouldQuit()) cutSim.reduceSurface(surface, reduceMode);
 
       // Export surface
       if (!shouldQuit())
@@ -23,6 +23,7 @@
 #include <cbang/String.h>
 #include <cbang/Math.h>
 
+#include <vector>
 #include <cctype>
 
 using namespace std;
@@ -579,32 +580,52 @@ const Code Codes::mcodes[] = {
 
 
 namespace {
-  const Code *findCode(const Code *table, unsigned number) {
-    // A linear search will do pig
-    for (int i = 0; table[i].type; i++)
-      if (table[i].number == number) return &table[i];
+  // Direct lookup table built once from one of the code arrays
+  class CodeTable {
+    vector<const Code *> entries;
 
-    return 0; // Not found
+  public:
+    CodeTable(const Code *table, bool byType = false) {
+      for (int i = 0; table[i].type; i++) {
+        unsigned key = byType ? (unsigned)table[i].type : table[i].number;
+        if (entries.size() <= key) entries.resize(key + 1, 0);
+
+        // The first entry wins, as with the linear search this replaced
+        if (!entries[key]) entries[key] = &table[i];
+      }
+    }
+
+    const Code *find(unsigned key) const {
+      return key < entries.size() ? entries[key] : 0;
+    }
+  };
+
+
+  // Tables are indexed by code number * 10
+  const CodeTable gTable(Codes::gcodes);
+  const CodeTable g10Table(Codes::g10codes);
+  const CodeTable mTable(Codes::mcodes);
+  const CodeTable otherTable(Codes::codes, true);
+
+
+  unsigned toKey(double number) {
+    double key = round(number * 10);
+    return 0 <= key && key < (double)~0U ? (unsigned)key : ~0U;
   }
 }
 
 
 const Code *Codes::find(char _type, double _number, double _L) {
   char type = toupper(_type);
-  unsigned number = round(_number * 10);
 
   switch (type) {
-  case 'G':
-    if (number == 100 && _L) return findCode(g10codes, round(_L * 10));
-    return findCode(gcodes, number);
-
-  case 'M': return findCode(mcodes, number);
-
-  default:
-    for (int i = 0; codes[i].type; i++)
-      if (codes[i].type == type) return &codes[i];
-    return 0;
+  case 'G': {
+    unsigned number = toKey(_number);
+    if (number == 100 && _L) return g10Table.find(toKey(_L));
+    return gTable.find(number);
   }
 
-  return 0;
+  case 'M': return mTable.find(toKey(_number));
+  default: return otherTable.find((unsigned char)type);
+  }
 }
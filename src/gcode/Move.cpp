@@ -40,10 +40,37 @@ Move::Move(MoveType type, const Axes &start, const Axes &end, double startTime,
 }
 
 
+void Move::setPlan(double time, double entryVel, double exitVel) {
+  this->time = time;
+  this->entryVel = entryVel;
+  this->exitVel = exitVel;
+  planned = true;
+}
+
+
+double Move::getFraction(double delta, double time, double dist,
+                         double entryVel, double exitVel) {
+  if (time <= 0) return 1;
+  double u = delta / time;
+  if (!dist) return u;
+
+  // Cubic Hermite curve with the entry and exit velocities as end slopes
+  double vi = entryVel * time / 60 / dist;
+  double vt = exitVel * time / 60 / dist;
+  double f = ((vi + vt - 2) * u + 3 - 2 * vi - vt) * u * u + vi * u;
+
+  return f < 0 ? 0 : (1 < f ? 1 : f);
+}
+
+
 Vector3D Move::getPtAtTime(double time) const {
   if (getEndTime() <= time) return getEndPt();
   if (time <= getStartTime()) return getStartPt();
 
   double delta = time - getStartTime();
-  return getStartPt() + (getEndPt() - getStartPt()) * delta / getTime();
+  double fraction = planned ?
+    getFraction(delta, getTime(), dist, entryVel, exitVel) :
+    delta / getTime();
+
+  return getStartPt() + (getEndPt() - getStartPt()) * fraction;
 }
@@ -46,6 +46,9 @@ namespace GCode {
     cb::SmartPointer<std::string> filename;
     double time = 0;
     double dist = 0;
+    double entryVel = 0;
+    double exitVel = 0;
+    bool planned = false;
 
   public:
     Move() {}
@@ -69,6 +72,16 @@ namespace GCode {
     double getStartTime() const {return startTime;}
     double getEndTime() const {return startTime + time;}
 
+    // Entry and exit velocities in mm/min when the time came from the planner
+    bool isPlanned() const {return planned;}
+    double getEntryVelocity() const {return entryVel;}
+    double getExitVelocity() const {return exitVel;}
+    void setPlan(double time, double entryVel, double exitVel);
+
+    // Fraction of a move covered delta seconds after it starts
+    static double getFraction(double delta, double time, double dist,
+                              double entryVel, double exitVel);
+
     cb::Vector3D getPtAtTime(double time) const;
 
     using cb::Segment3D::reverse;
@@ -22,15 +22,169 @@
 
 #include <cbang/json/Sink.h>
 #include <cbang/json/Dict.h>
+#include <cbang/json/Reader.h>
 
 #include <string>
 #include <limits>
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
 
 using namespace std;
 using namespace cb;
 using namespace GCode;
 
 
+namespace {
+  template <typename Run>
+  const Run &findRun(const vector<Run> &runs, unsigned i) {
+    // Last run starting at or before move i
+    auto it = upper_bound(runs.begin(), runs.end(), i,
+                          [] (unsigned i, const Run &run) {
+                            return i < run.first;
+                          });
+    return *--it;
+  }
+
+
+  template <typename Run, typename T, typename Func>
+  void expandRuns(const vector<Run> &runs, unsigned size, vector<T> &column,
+                  Func value) {
+    column.clear();
+    column.reserve(size);
+
+    for (unsigned i = 0; i < runs.size(); i++) {
+      unsigned last = i + 1 < runs.size() ? runs[i + 1].first : size;
+      column.insert(column.end(), last - runs[i].first, value(runs[i]));
+    }
+  }
+
+
+  template <typename T>
+  uint64_t capacityOf(const vector<T> &v) {return v.capacity() * sizeof(T);}
+
+
+  const char binaryMagic[8] = {'C', 'A', 'M', 'P', 'A', 'T', 'H', 0};
+
+
+  uint64_t toBits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+  }
+
+
+  double fromBits(uint64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+  }
+
+
+  class Encoder {
+    string &data;
+
+  public:
+    Encoder(string &data) : data(data) {}
+
+    void putByte(uint8_t x) {data.push_back((char)x);}
+    void putBytes(const char *s, unsigned n) {data.append(s, n);}
+    void putString(const string &s) {putVarint(s.size()); data.append(s);}
+
+
+    void putVarint(uint64_t x) {
+      for (; 0x80 <= x; x >>= 7) putByte(0x80 | (x & 0x7f));
+      putByte(x);
+    }
+
+
+    void putSigned(int64_t x) {putVarint(((uint64_t)x << 1) ^ (x >> 63));}
+
+
+    // XOR with a predicted value, only the bytes which differ are written.
+    // The first byte holds the number of zero bytes on either side.
+    void putDouble(double x, double predicted = 0) {
+      uint64_t bits = toBits(x) ^ toBits(predicted);
+      if (!bits) return putByte(0xff);
+
+      unsigned lead = 0, trail = 0;
+      while (!(bits >> (56 - 8 * lead))) lead++;
+      while (!((bits >> (8 * trail)) & 0xff)) trail++;
+
+      putByte(lead << 3 | trail);
+      for (unsigned i = trail; i < 8 - lead; i++) putByte(bits >> (8 * i));
+    }
+  };
+
+
+  class Decoder {
+    const char *ptr;
+    const char *end;
+
+  public:
+    Decoder(const char *data, uint64_t size) : ptr(data), end(data + size) {}
+
+    bool atEnd() const {return ptr == end;}
+    uint64_t getRemaining() const {return end - ptr;}
+
+
+    uint8_t getByte() {
+      if (ptr == end) THROW("Truncated binary tool path");
+      return (uint8_t)*ptr++;
+    }
+
+
+    const char *getBytes(uint64_t n) {
+      if ((uint64_t)(end - ptr) < n) THROW("Truncated binary tool path");
+      const char *s = ptr;
+      ptr += n;
+      return s;
+    }
+
+
+    string getString() {
+      uint64_t n = getVarint();
+      return string(getBytes(n), n);
+    }
+
+
+    uint64_t getVarint() {
+      uint64_t x = 0;
+
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t b = getByte();
+        x |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return x;
+      }
+
+      THROW("Invalid varint in binary tool path");
+    }
+
+
+    int64_t getSigned() {
+      uint64_t x = getVarint();
+      return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+    }
+
+
+    double getDouble(double predicted = 0) {
+      uint8_t header = getByte();
+      if (header == 0xff) return predicted;
+
+      unsigned lead = header >> 3, trail = header & 7;
+      if (8 <= lead + trail) THROW("Invalid double in binary tool path");
+
+      uint64_t bits = 0;
+      for (unsigned i = trail; i < 8 - lead; i++)
+        bits |= (uint64_t)getByte() << (8 * i);
+
+      return fromBits(bits ^ toBits(predicted));
+    }
+  };
+}
+
+
 ToolPath::~ToolPath() {}
 
 
@@ -40,7 +194,7 @@ int ToolPath::find(double time, unsigned first, unsigned last) const {
 
   // Base case, one item
   if (first == last - 1) {
-    if (at(first).getStartTime() <= time && time <= at(first).getEndTime())
+    if (getStartTime(first) <= time && time <= getEndTime(first))
       return first;
 
     return -1;
@@ -48,7 +202,7 @@ int ToolPath::find(double time, unsigned first, unsigned last) const {
 
   // Recur
   unsigned mid = (first + last) / 2;
-  if (time < at(mid).getStartTime()) return find(time, first, mid);
+  if (time < getStartTime(mid)) return find(time, first, mid);
   return find(time, mid, last);
 }
 
@@ -56,6 +210,97 @@ int ToolPath::find(double time, unsigned first, unsigned last) const {
 int ToolPath::find(double time) const {return find(time, 0, size());}
 
 
+Move ToolPath::at(unsigned i) const {
+  if (size() <= i) THROW("Move index " << i << " out of range");
+
+  const StateRun &state = getState(i);
+
+  Move move(state.type, getStart(i), getEnd(i), startTimes[i], getTool(i),
+            state.feed, state.speed, lines[i], files[state.file], times[i]);
+  if (isPlanned()) move.setPlan(times[i], entryVels[i], exitVels[i]);
+
+  return move;
+}
+
+
+Vector3D ToolPath::getStartPt(unsigned i) const {
+  if (jumps[i]) return starts.at(i).getXYZ();
+  return ends[i - 1];
+}
+
+
+int ToolPath::getTool(unsigned i) const {return findRun(toolRuns, i).tool;}
+
+
+Vector3D ToolPath::getPtAtTime(unsigned i, double time) const {
+  if (getEndTime(i) <= time) return getEndPt(i);
+  if (time <= getStartTime(i)) return getStartPt(i);
+
+  Vector3D start = getStartPt(i);
+  double delta = time - getStartTime(i);
+  double fraction = isPlanned() ?
+    Move::getFraction(delta, getTime(i), getStart(i).distance(getEnd(i)),
+                      entryVels[i], exitVels[i]) : delta / getTime(i);
+
+  return start + (getEndPt(i) - start) * fraction;
+}
+
+
+void ToolPath::getToolColumn(vector<int32_t> &tools) const {
+  expandRuns(toolRuns, size(), tools,
+             [] (const ToolRun &run) {return (int32_t)run.tool;});
+}
+
+
+void ToolPath::getFeedColumn(vector<double> &feeds) const {
+  expandRuns(stateRuns, size(), feeds,
+             [] (const StateRun &run) {return run.feed;});
+}
+
+
+double ToolPath::getEntryVelocity(unsigned i) const {
+  return isPlanned() ? entryVels.at(i) : 0;
+}
+
+
+double ToolPath::getExitVelocity(unsigned i) const {
+  return isPlanned() ? exitVels.at(i) : 0;
+}
+
+
+void ToolPath::setPlan(const vector<double> &times,
+                       const vector<double> &entryVels,
+                       const vector<double> &exitVels) {
+  if (times.size() != size() || entryVels.size() != size() ||
+      exitVels.size() != size())
+    THROW("Plan has " << times.size() << " moves, tool path has " << size());
+
+  this->times = times;
+  this->entryVels = entryVels;
+  this->exitVels = exitVels;
+
+  time = 0;
+  for (unsigned i = 0; i < size(); i++) {
+    startTimes[i] = time;
+    time += times[i];
+  }
+}
+
+
+uint64_t ToolPath::getMemoryUsage() const {
+  uint64_t bytes = sizeof(ToolPath) + capacityOf(ends) +
+    capacityOf(startTimes) + capacityOf(times) + capacityOf(lines) +
+    capacityOf(extra) + capacityOf(entryVels) + capacityOf(exitVels) +
+    jumps.capacity() / 8 + capacityOf(toolRuns) +
+    capacityOf(stateRuns) + starts.size() * (sizeof(Axes) + 32);
+
+  for (unsigned i = 0; i < files.size(); i++)
+    if (files[i].isSet()) bytes += files[i]->capacity();
+
+  return bytes;
+}
+
+
 void ToolPath::read(const JSON::Value &value) {
   GCode::Axes start;
   GCode::MoveType type = GCode::MoveType::MOVE_RAPID;
@@ -151,8 +396,316 @@ void ToolPath::write(JSON::Sink &sink) const {
 }
 
 
+void ToolPath::writeBinary(ostream &stream, const string &key,
+                           bool compress) const {
+  // Move records
+  string records;
+  Encoder enc(records);
+
+  enc.putVarint(size());
+  enc.putDouble(time);
+  enc.putDouble(distance);
+  for (unsigned i = 0; i < 3; i++) enc.putDouble(rmin[i]);
+  for (unsigned i = 0; i < 3; i++) enc.putDouble(rmax[i]);
+
+  // Files, without the reserved null entry
+  enc.putVarint(files.size() - 1);
+  for (unsigned i = 1; i < files.size(); i++) enc.putString(*files[i]);
+
+  // Columns, each value predicted from the one before
+  Vector3D lastEnd(0, 0, 0);
+  double lastTime = 0;
+  double lastEndTime = 0;
+  unsigned lastLine = 0;
+
+  for (unsigned i = 0; i < size(); i++) {
+    for (unsigned j = 0; j < 3; j++) enc.putDouble(ends[i][j], lastEnd[j]);
+    enc.putDouble(startTimes[i], lastEndTime);
+    enc.putDouble(times[i], lastTime);
+    enc.putSigned((int64_t)lines[i] - lastLine);
+
+    lastEnd = ends[i];
+    lastTime = times[i];
+    lastEndTime = startTimes[i] + times[i];
+    lastLine = lines[i];
+  }
+
+  enc.putByte(!extra.empty());
+  for (unsigned i = 0; i < extra.size(); i++)
+    enc.putDouble(extra[i], 6 <= i ? extra[i - 6] : 0);
+
+  // Entry velocity usually equals the previous exit velocity
+  enc.putByte(isPlanned());
+  for (unsigned i = 0; i < entryVels.size(); i++) {
+    enc.putDouble(entryVels[i], i ? exitVels[i - 1] : 0);
+    enc.putDouble(exitVels[i], entryVels[i]);
+  }
+
+  enc.putVarint(starts.size());
+  unsigned last = 0;
+  for (auto it = starts.begin(); it != starts.end(); it++) {
+    enc.putVarint(it->first - last);
+    last = it->first;
+
+    Axes prev = it->first ? getEnd(it->first - 1) : Axes();
+    for (unsigned j = 0; j < 9; j++) enc.putDouble(it->second[j], prev[j]);
+  }
+
+  enc.putVarint(toolRuns.size());
+  last = 0;
+  for (unsigned i = 0; i < toolRuns.size(); i++) {
+    enc.putVarint(toolRuns[i].first - last);
+    enc.putSigned(toolRuns[i].tool);
+    last = toolRuns[i].first;
+  }
+
+  enc.putVarint(stateRuns.size());
+  last = 0;
+  double feed = 0, speed = 0;
+  for (unsigned i = 0; i < stateRuns.size(); i++) {
+    const StateRun &run = stateRuns[i];
+
+    enc.putVarint(run.first - last);
+    enc.putVarint(run.type);
+    enc.putDouble(run.feed, feed);
+    enc.putDouble(run.speed, speed);
+    enc.putVarint(run.file);
+
+    last = run.first;
+    feed = run.feed;
+    speed = run.speed;
+  }
+
+  // Compress
+  string data;
+  if (compress) {
+    uLongf length = compressBound(records.size());
+    data.resize(length);
+
+    if (compress2((Bytef *)&data[0], &length, (const Bytef *)records.data(),
+                  records.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+      THROW("Failed to compress tool path");
+
+    data.resize(length);
+
+  } else data.swap(records);
+
+  // Header
+  string header;
+  Encoder hdr(header);
+
+  hdr.putBytes(binaryMagic, sizeof(binaryMagic));
+  hdr.putVarint(binaryVersion);
+  hdr.putVarint(compress);
+  hdr.putString(key);
+  hdr.putString(tools.toString());
+  hdr.putVarint(compress ? records.size() : data.size());
+  hdr.putVarint(data.size());
+
+  stream.write(header.data(), header.size());
+  stream.write(data.data(), data.size());
+}
+
+
+string ToolPath::readBinary(const char *data, uint64_t size) {
+  if (!empty()) THROW("Cannot read binary tool path into non-empty path");
+
+  // Header
+  Decoder hdr(data, size);
+
+  if (memcmp(hdr.getBytes(sizeof(binaryMagic)), binaryMagic,
+             sizeof(binaryMagic)))
+    THROW("Not a binary tool path");
+
+  uint64_t version = hdr.getVarint();
+  if (version != binaryVersion)
+    THROW("Unsupported binary tool path version " << version);
+
+  bool compressed = hdr.getVarint();
+  string key = hdr.getString();
+
+  tools.clear();
+  tools.read(*JSON::Reader::parseString(hdr.getString()));
+
+  uint64_t rawSize = hdr.getVarint();
+  uint64_t dataSize = hdr.getVarint();
+  const char *block = hdr.getBytes(dataSize);
+
+  // Decompress
+  string records;
+  if (compressed) {
+    // Sizes come from the file, deflate never expands more than 1032:1
+    if (dataSize * 1032 < rawSize) THROW("Invalid binary tool path size");
+
+    uLongf length = rawSize;
+    if (length != rawSize) THROW("Binary tool path too large");
+    records.resize(rawSize);
+
+    if (uncompress((Bytef *)&records[0], &length, (const Bytef *)block,
+                   dataSize) != Z_OK || length != rawSize)
+      THROW("Failed to decompress tool path");
+
+    block = records.data();
+    dataSize = rawSize;
+  }
+
+  Decoder dec(block, dataSize);
+
+  uint64_t count = dec.getVarint();
+  // Each move takes at least six bytes
+  if (dec.getRemaining() / 6 < count)
+    THROW("Invalid move count in binary tool path");
+
+  time = dec.getDouble();
+  distance = dec.getDouble();
+  for (unsigned i = 0; i < 3; i++) rmin[i] = dec.getDouble();
+  for (unsigned i = 0; i < 3; i++) rmax[i] = dec.getDouble();
+
+  uint64_t fileCount = dec.getVarint();
+  for (uint64_t i = 0; i < fileCount; i++) {
+    SmartPointer<string> filename = new string(dec.getString());
+    fileIndex[*filename] = files.size();
+    files.push_back(filename);
+  }
+
+  ends.resize(count);
+  startTimes.resize(count);
+  times.resize(count);
+  lines.resize(count);
+
+  Vector3D lastEnd(0, 0, 0);
+  double lastTime = 0;
+  double lastEndTime = 0;
+  unsigned lastLine = 0;
+
+  for (uint64_t i = 0; i < count; i++) {
+    for (unsigned j = 0; j < 3; j++) ends[i][j] = dec.getDouble(lastEnd[j]);
+    startTimes[i] = dec.getDouble(lastEndTime);
+    times[i] = dec.getDouble(lastTime);
+    lines[i] = lastLine + dec.getSigned();
+
+    lastEnd = ends[i];
+    lastTime = times[i];
+    lastEndTime = startTimes[i] + times[i];
+    lastLine = lines[i];
+  }
+
+  if (dec.getByte()) {
+    extra.resize(6 * count);
+    for (uint64_t i = 0; i < extra.size(); i++)
+      extra[i] = dec.getDouble(6 <= i ? extra[i - 6] : 0);
+  }
+
+  if (dec.getByte()) {
+    entryVels.resize(count);
+    exitVels.resize(count);
+
+    for (uint64_t i = 0; i < count; i++) {
+      entryVels[i] = dec.getDouble(i ? exitVels[i - 1] : 0);
+      exitVels[i] = dec.getDouble(entryVels[i]);
+    }
+  }
+
+  jumps.assign(count, false);
+  uint64_t startCount = dec.getVarint();
+  uint64_t index = 0;
+  for (uint64_t i = 0; i < startCount; i++) {
+    index += dec.getVarint();
+    if (count <= index) THROW("Invalid move index in binary tool path");
+
+    Axes prev = index ? getEnd(index - 1) : Axes();
+    Axes &start = starts[index];
+    for (unsigned j = 0; j < 9; j++) start[j] = dec.getDouble(prev[j]);
+    jumps[index] = true;
+  }
+
+  uint64_t runCount = dec.getVarint();
+  index = 0;
+  for (uint64_t i = 0; i < runCount; i++) {
+    ToolRun run;
+    run.first = index += dec.getVarint();
+    run.tool = dec.getSigned();
+    toolRuns.push_back(run);
+  }
+
+  runCount = dec.getVarint();
+  index = 0;
+  double feed = 0, speed = 0;
+  for (uint64_t i = 0; i < runCount; i++) {
+    StateRun run;
+    run.first = index += dec.getVarint();
+    run.type = (MoveType::enum_t)dec.getVarint();
+    run.feed = feed = dec.getDouble(feed);
+    run.speed = speed = dec.getDouble(speed);
+    run.file = dec.getVarint();
+    if (files.size() <= run.file) THROW("Invalid file in binary tool path");
+    stateRuns.push_back(run);
+  }
+
+  if (count && (!jumps[0] || toolRuns.empty() || toolRuns[0].first ||
+                stateRuns.empty() || stateRuns[0].first))
+    THROW("Invalid binary tool path");
+
+  if (!dec.atEnd()) THROW("Trailing data in binary tool path");
+
+  return key;
+}
+
+
 void ToolPath::move(GCode::Move &move) {
-  push_back(move);
+  unsigned i = size();
+  const Axes &start = move.getStart();
+  const Axes &end = move.getEnd();
+
+  bool useExtra = !extra.empty();
+  for (unsigned j = 3; j < 9 && !useExtra; j++)
+    useExtra = start[j] || end[j];
+
+  // Fill in zeros for earlier moves the first time ABCUVW are used
+  if (useExtra && extra.empty()) extra.resize(6 * i, 0);
+
+  // Record the start when it differs from the previous end
+  bool jump = !i || getEnd(i - 1) != start;
+  jumps.push_back(jump);
+  if (jump) starts[i] = start;
+
+  ends.push_back(end.getXYZ());
+  if (useExtra)
+    for (unsigned j = 3; j < 9; j++) extra.push_back(end[j]);
+
+  startTimes.push_back(move.getStartTime());
+  times.push_back(move.getTime());
+  lines.push_back(move.getLine());
+
+  if (isPlanned() || (!i && move.isPlanned())) {
+    // Constant velocity for unplanned moves appended to a planned path
+    double v = move.getTime() ? move.getDistance() / move.getTime() * 60 : 0;
+
+    entryVels.push_back(move.isPlanned() ? move.getEntryVelocity() : v);
+    exitVels.push_back(move.isPlanned() ? move.getExitVelocity() : v);
+  }
+
+  if (toolRuns.empty() || toolRuns.back().tool != move.getTool()) {
+    ToolRun run;
+    run.first = i;
+    run.tool = move.getTool();
+    toolRuns.push_back(run);
+  }
+
+  unsigned file = intern(move.getFilename());
+
+  if (stateRuns.empty() || stateRuns.back().type != move.getType() ||
+      stateRuns.back().feed != move.getFeed() ||
+      stateRuns.back().speed != move.getSpeed() ||
+      stateRuns.back().file != file) {
+    StateRun run;
+    run.first = i;
+    run.type = move.getType();
+    run.feed = move.getFeed();
+    run.speed = move.getSpeed();
+    run.file = file;
+    stateRuns.push_back(run);
+  }
 
   // Bounds
   Rectangle3D::add(move.getStartPt());
@@ -161,3 +714,40 @@ void ToolPath::move(GCode::Move &move) {
   time += move.getTime();
   distance += move.getDistance();
 }
+
+
+Axes ToolPath::getStart(unsigned i) const {
+  if (jumps[i]) return starts.at(i);
+  return getEnd(i - 1);
+}
+
+
+Axes ToolPath::getEnd(unsigned i) const {
+  Axes end;
+
+  end.setXYZ(ends[i]);
+  if (!extra.empty())
+    for (unsigned j = 0; j < 6; j++) end[j + 3] = extra[6 * i + j];
+
+  return end;
+}
+
+
+const ToolPath::StateRun &ToolPath::getState(unsigned i) const {
+  return findRun(stateRuns, i);
+}
+
+
+unsigned ToolPath::intern(const SmartPointer<string> &filename) {
+  if (filename.isNull()) return 0; // Reserved for moves without a file
+
+  // Consecutive moves usually share the same string
+  unsigned last = stateRuns.empty() ? 0 : stateRuns.back().file;
+  if (files[last] == filename) return last;
+
+  auto it = fileIndex.find(*filename);
+  if (it != fileIndex.end()) return it->second;
+
+  files.push_back(filename);
+  return fileIndex[*filename] = files.size() - 1;
+}
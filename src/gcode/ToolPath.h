@@ -27,7 +27,10 @@
 #include <cbang/geom/Rectangle.h>
 
 #include <vector>
+#include <map>
+#include <string>
 #include <ostream>
+#include <cinttypes>
 
 
 namespace cb {namespace JSON {class Sink;}}
@@ -35,16 +38,60 @@ namespace cb {namespace JSON {class Sink;}}
 namespace GCode {
   class STL;
 
+  // Moves are stored in columns rather than as Move objects.  Most moves
+  // start where the previous one ended and share tool, feed, speed, type and
+  // file with their neighbors so only the end point, times and line are kept
+  // for every move.  at() returns a Move built from the columns.
   class ToolPath :
-    protected std::vector<GCode::Move>, public cb::Rectangle3D,
-    public GCode::MoveStream, public cb::JSON::Serializable {
+    public cb::Rectangle3D, public GCode::MoveStream,
+    public cb::JSON::Serializable {
     GCode::ToolTable tools;
 
     double time = 0;
     double distance = 0;
 
+    // One entry per move
+    std::vector<cb::Vector3D> ends;
+    std::vector<double> startTimes;
+    std::vector<double> times;
+    std::vector<uint32_t> lines;
+
+    // ABCUVW end points, six per move, empty until one of these axes is used
+    std::vector<double> extra;
+
+    // Planned velocities in mm/min, empty unless setPlan() was called
+    std::vector<double> entryVels;
+    std::vector<double> exitVels;
+
+    // Moves which do not start at the previous move's end
+    std::vector<bool> jumps;
+    std::map<unsigned, Axes> starts;
+
+    // Interned file names, the first entry is always null
+    std::vector<cb::SmartPointer<std::string> > files;
+    std::map<std::string, unsigned> fileIndex;
+
+    // Run length encoded state, each run starts at move ``first''
+    struct ToolRun {
+      unsigned first;
+      int tool;
+    };
+
+    struct StateRun {
+      unsigned first;
+      MoveType type;
+      double feed;
+      double speed;
+      unsigned file;
+    };
+
+    std::vector<ToolRun> toolRuns;
+    std::vector<StateRun> stateRuns;
+
   public:
-    ToolPath(const GCode::ToolTable &tools) : tools(tools) {}
+    static const unsigned binaryVersion = 2;
+
+    ToolPath(const GCode::ToolTable &tools) : tools(tools), files(1) {}
     ~ToolPath();
 
     const cb::Rectangle3D &getBounds() const {return *this;}
@@ -58,15 +105,70 @@ namespace GCode {
 
     void print() const {}
 
-    // From std::vector<GCode::Move>
-    typedef std::vector<GCode::Move> path_t;
-    using path_t::size;
-    using path_t::empty;
-    using path_t::begin;
-    using path_t::end;
-    using path_t::const_iterator;
-    const Move &operator[](int i) const {return path_t::operator[](i);}
-    const Move &at(int i) const {return path_t::at(i);}
+    unsigned size() const {return ends.size();}
+    bool empty() const {return ends.empty();}
+
+    Move at(unsigned i) const;
+    Move operator[](unsigned i) const {return at(i);}
+
+    // Column access which does not build a Move
+    cb::Vector3D getStartPt(unsigned i) const;
+    const cb::Vector3D &getEndPt(unsigned i) const {return ends[i];}
+    double getStartTime(unsigned i) const {return startTimes[i];}
+    double getEndTime(unsigned i) const {return startTimes[i] + times[i];}
+    double getTime(unsigned i) const {return times[i];}
+    unsigned getLine(unsigned i) const {return lines[i];}
+    int getTool(unsigned i) const;
+    const cb::SmartPointer<std::string> &getFilename(unsigned i) const
+    {return files[getState(i).file];}
+    cb::Vector3D getPtAtTime(unsigned i, double time) const;
+
+    // Whole columns, valid until the path is modified
+    const std::vector<cb::Vector3D> &getEndPts() const {return ends;}
+    const std::vector<double> &getStartTimes() const {return startTimes;}
+    const std::vector<double> &getTimes() const {return times;}
+    const std::vector<uint32_t> &getLines() const {return lines;}
+
+    // Expand the run length encoded state to one entry per move
+    void getToolColumn(std::vector<int32_t> &tools) const;
+    void getFeedColumn(std::vector<double> &feeds) const;
+
+    bool isPlanned() const {return !entryVels.empty();}
+    double getEntryVelocity(unsigned i) const;
+    double getExitVelocity(unsigned i) const;
+
+    // Replace the feed rate based move times with planned times and record
+    // the planned velocities, one entry per move.  Start times and the total
+    // time are recomputed.
+    void setPlan(const std::vector<double> &times,
+                 const std::vector<double> &entryVels,
+                 const std::vector<double> &exitVels);
+
+    uint64_t getMemoryUsage() const;
+
+    class const_iterator {
+      const ToolPath *path;
+      unsigned i;
+
+    public:
+      const_iterator(const ToolPath *path, unsigned i) : path(path), i(i) {}
+
+      Move operator*() const {return path->at(i);}
+      const_iterator &operator++() {i++; return *this;}
+      bool operator==(const const_iterator &o) const {return i == o.i;}
+      bool operator!=(const const_iterator &o) const {return i != o.i;}
+    };
+
+    const_iterator begin() const {return const_iterator(this, 0);}
+    const_iterator end() const {return const_iterator(this, size());}
+
+    // Compact binary format.  key is stored in the header for the caller to
+    // identify the source of the path.  readBinary() reads from memory so the
+    // file can be mapped and returns the key.  The path must be empty.
+    void writeBinary(std::ostream &stream,
+                     const std::string &key = std::string(),
+                     bool compress = true) const;
+    std::string readBinary(const char *data, uint64_t size);
 
     // From cb::JSON::Serializable
     using cb::JSON::Serializable::read;
@@ -76,5 +178,11 @@ namespace GCode {
 
     // From GCode::MoveStream
     void move(GCode::Move &move);
+
+  protected:
+    Axes getStart(unsigned i) const;
+    Axes getEnd(unsigned i) const;
+    const StateRun &getState(unsigned i) const;
+    unsigned intern(const cb::SmartPointer<std::string> &filename);
   };
 }
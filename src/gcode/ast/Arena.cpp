@@ -0,0 +1,57 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "Arena.h"
+
+using namespace std;
+using namespace GCode;
+
+
+Arena::~Arena() {
+  // Destroy in reverse order of creation
+  for (Node *node = entities; node; node = node->next)
+    node->entity->~Entity();
+
+  while (chunks) {
+    char *next = *(char **)chunks;
+    delete [] chunks;
+    chunks = next;
+  }
+}
+
+
+void *Arena::allocate(size_t size) {
+  size = (size + alignment - 1) / alignment * alignment;
+
+  if ((size_t)(end - ptr) < size) {
+    // The chunk header is padded so the data stays aligned
+    size_t length = alignment + (chunkSize < size ? size : chunkSize);
+    char *chunk = new char[length];
+
+    *(char **)chunk = chunks;
+    chunks = chunk;
+    ptr = chunk + alignment;
+    end = chunk + length;
+  }
+
+  void *p = ptr;
+  ptr += size;
+  return p;
+}
@@ -0,0 +1,73 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+
+#include "Entity.h"
+
+#include <new>
+#include <utility>
+#include <cstddef>
+
+
+namespace GCode {
+  // Bump allocator for the entities of one block.  The first chunk is part
+  // of the arena itself so short blocks need no further allocations.
+  // Entities are destroyed with the arena and must not be referenced after.
+  class Arena {
+    struct Node {
+      Node *next;
+      Entity *entity;
+    };
+
+    static const unsigned alignment = alignof(std::max_align_t);
+    static const unsigned inlineSize = 2048;
+    static const unsigned chunkSize = 8192;
+
+    alignas(std::max_align_t) char buffer[inlineSize];
+    char *ptr;
+    char *end;
+    char *chunks;  // Heap chunks, each starting with a pointer to the next
+    Node *entities;
+
+  public:
+    Arena() : ptr(buffer), end(buffer + inlineSize), chunks(0), entities(0) {}
+    Arena(const Arena &) = delete;
+    ~Arena();
+
+    Arena &operator=(const Arena &) = delete;
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args) {
+      Node *node = new (allocate(sizeof(Node))) Node;
+      T *entity = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+
+      node->next = entities;
+      node->entity = entity;
+      entities = node;
+
+      return entity;
+    }
+
+  protected:
+    void *allocate(std::size_t size);
+  };
+}
@@ -36,14 +36,18 @@ namespace GCode {
 
     bool deleted;
     int line;
+    bool compiled;
 
   public:
     Block(bool deleted, int line, const Super_t &children) :
-      Super_t(children), deleted(deleted), line(line) {}
+      Super_t(children), deleted(deleted), line(line), compiled(false) {}
 
     bool isDeleted() const {return deleted;}
     int getUserLine() const {return line;}
 
+    bool isCompiled() const {return compiled;}
+    void setCompiled(bool compiled) {this->compiled = compiled;}
+
     bool isEmpty() const {return !deleted && line == -1 && empty();}
 
     Word *findWord(char type, double number) const;
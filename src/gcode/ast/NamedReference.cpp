@@ -26,5 +26,5 @@ using namespace GCode;
 
 
 void NamedReference::print(ostream &stream) const {
-  stream << "#<" << name << '>';
+  stream << "#<" << getName() << '>';
 }
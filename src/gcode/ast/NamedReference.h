@@ -23,14 +23,17 @@
 
 #include "Entity.h"
 
+#include <gcode/interp/Symbol.h>
+
 namespace GCode {
   class NamedReference : public Entity {
-    std::string name;
+    Symbol symbol;
 
   public:
-    NamedReference(const std::string &name) : name(name) {}
+    NamedReference(const std::string &name) : symbol(name) {}
 
-    const std::string &getName() const {return name;}
+    const std::string &getName() const {return symbol.getName();}
+    const Symbol &getSymbol() const {return symbol;}
 
     // From Entity
     double eval(Evaluator &evaluator) {return evaluator.eval(*this);}
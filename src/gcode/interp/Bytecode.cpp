@@ -0,0 +1,294 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "Bytecode.h"
+#include "Evaluator.h"
+
+#include <gcode/ast/Block.h>
+#include <gcode/ast/Word.h>
+#include <gcode/ast/Assign.h>
+#include <gcode/ast/OCode.h>
+#include <gcode/ast/UnaryOp.h>
+#include <gcode/ast/BinaryOp.h>
+#include <gcode/ast/QuotedExpr.h>
+#include <gcode/ast/Reference.h>
+#include <gcode/ast/NamedReference.h>
+#include <gcode/ast/FunctionCall.h>
+#include <gcode/ast/Number.h>
+#include <gcode/ast/CompiledExpr.h>
+
+#include <cbang/Exception.h>
+#include <cbang/String.h>
+#include <cbang/Math.h>
+#include <cbang/log/Logger.h>
+
+using namespace std;
+using namespace cb;
+using namespace GCode;
+
+
+namespace {
+  struct Function {
+    const char *name;
+    Bytecode::op_t op;
+    unsigned args;
+  };
+
+
+  const Function functions[] = {
+    {"ABS",   Bytecode::ABS_OP,      1},
+    {"ACOS",  Bytecode::ACOS_OP,     1},
+    {"ASIN",  Bytecode::ASIN_OP,     1},
+    {"COS",   Bytecode::COS_OP,      1},
+    {"EXP",   Bytecode::EXP_FUNC_OP, 1},
+    {"FIX",   Bytecode::FIX_OP,      1},
+    {"FUP",   Bytecode::FUP_OP,      1},
+    {"ROUND", Bytecode::ROUND_OP,    1},
+    {"LN",    Bytecode::LN_OP,       1},
+    {"SIN",   Bytecode::SIN_OP,      1},
+    {"SQRT",  Bytecode::SQRT_OP,     1},
+    {"TAN",   Bytecode::TAN_OP,      1},
+    {"ATAN",  Bytecode::ATAN_OP,     2},
+    {0},
+  };
+
+
+  const unsigned localDepth = 32;
+}
+
+
+Bytecode::Bytecode(Entity &expr) : maxDepth(0) {compileExpr(expr, 0);}
+
+
+double Bytecode::eval(Evaluator &evaluator) const {
+  double local[localDepth];
+  vector<double> heap;
+  double *stack = local;
+  if (localDepth < maxDepth) {
+    heap.resize(maxDepth);
+    stack = &heap[0];
+  }
+
+  double *top = stack - 1;
+
+  for (auto it = code.begin(); it != code.end(); it++) {
+    const uint32_t arg = it->arg;
+
+    switch (it->op) {
+    case PUSH_OP: *++top = constants[arg]; break;
+
+    case REF_OP: {
+      double num = *top;
+
+      if (num < 1 || MAX_ADDRESS < num || !isfinite(num))
+        THROW(entities[arg]->getLocation() << " Invalid reference number "
+              << num);
+
+      *top = evaluator.lookupReference((address_t)(unsigned)round(num));
+      break;
+    }
+
+    case NAMED_REF_OP:
+      *++top = evaluator.lookupReference(symbols[arg]);
+      break;
+
+    case EXISTS_OP: *++top = evaluator.hasReference(symbols[arg]); break;
+    case NEG_OP: *top = -*top; break;
+
+    case DIV_OP: case MOD_OP:
+      if (*top == 0) {
+        LOG_ERROR(entities[arg]->getLocation() << ": Divide by zero");
+        *--top = 0;
+        break;
+      }
+
+      top--;
+      *top = it->op == DIV_OP ? *top / top[1] : fmod(*top, top[1]);
+      break;
+
+    // NOTE, LinuxCNC handles floating-point equality differently.
+    //   See ``Equality and floating-point values``.
+    case EXP_OP: top--; *top = pow(*top, top[1]); break;
+    case MUL_OP: top--; *top = *top * top[1]; break;
+    case ADD_OP: top--; *top = *top + top[1]; break;
+    case SUB_OP: top--; *top = *top - top[1]; break;
+    case EQ_OP:  top--; *top = *top == top[1]; break;
+    case NE_OP:  top--; *top = *top != top[1]; break;
+    case GT_OP:  top--; *top = *top > top[1]; break;
+    case GE_OP:  top--; *top = *top >= top[1]; break;
+    case LT_OP:  top--; *top = *top < top[1]; break;
+    case LE_OP:  top--; *top = *top <= top[1]; break;
+    case AND_OP: top--; *top = *top && top[1]; break;
+    case OR_OP:  top--; *top = *top || top[1]; break;
+    case XOR_OP: top--; *top = (bool)*top ^ (bool)top[1]; break;
+
+    case ABS_OP:      *top = fabs(*top); break;
+    case ACOS_OP:     *top = acos(*top) * 180.0 / M_PI; break;
+    case ASIN_OP:     *top = asin(*top) * 180.0 / M_PI; break;
+    case COS_OP:      *top = cos(*top * M_PI / 180.0); break;
+    case EXP_FUNC_OP: *top = exp(*top); break;
+    case FIX_OP:      *top = floor(*top); break;
+    case FUP_OP:      *top = ceil(*top); break;
+    case ROUND_OP:    *top = Math::round(*top); break;
+    case LN_OP:       *top = log(*top); break;
+    case SIN_OP:      *top = sin(*top * M_PI / 180.0); break;
+    case SQRT_OP:     *top = sqrt(*top); break;
+    case TAN_OP:      *top = tan(*top * M_PI / 180.0); break;
+    case ATAN_OP: top--; *top = atan2(*top, top[1]) * 180.0 / M_PI; break;
+
+    default: THROW("Invalid bytecode op " << (unsigned)it->op);
+    }
+  }
+
+  return *top;
+}
+
+
+void Bytecode::compile(Block &block) {
+  if (block.isCompiled()) return;
+  block.setCompiled(true);
+
+  for (auto it = block.begin(); it != block.end(); it++) {
+    Word *word;
+    Assign *assign;
+    OCode *ocode;
+
+    if ((word = (*it)->instance<Word>()))
+      word->setExpression(compile(word->getExpression()));
+
+    else if ((assign = (*it)->instance<Assign>()))
+      assign->setExpression(compile(assign->getExpression()));
+
+    else if ((ocode = (*it)->instance<OCode>())) {
+      ocode->setNumExpression(compile(ocode->getNumExpression()));
+
+      const OCode::expressions_t &expressions = ocode->getExpressions();
+      for (unsigned i = 0; i < expressions.size(); i++)
+        ocode->setExpression(i, compile(expressions[i]));
+    }
+  }
+}
+
+
+SmartPointer<Entity> Bytecode::compile(const SmartPointer<Entity> &expr) {
+  // Plain numbers are already as fast as they can be
+  if (expr.isNull() || expr->instance<Number>() ||
+      expr->instance<CompiledExpr>()) return expr;
+
+  try {
+    return new CompiledExpr(expr);
+  } catch (const Exception &e) {
+    LOG_DEBUG(3, "Not compiling expression " << *expr << ": " << e);
+  }
+
+  return expr;
+}
+
+
+void Bytecode::emit(op_t op, uint32_t arg) {
+  Instruction instruction;
+  instruction.op = op;
+  instruction.arg = arg;
+  code.push_back(instruction);
+}
+
+
+void Bytecode::compileExpr(Entity &expr, unsigned depth) {
+  if (maxDepth <= depth) maxDepth = depth + 1;
+
+  Number *number;
+  UnaryOp *unaryOp;
+  BinaryOp *binaryOp;
+  QuotedExpr *quoted;
+  Reference *ref;
+  NamedReference *namedRef;
+  FunctionCall *call;
+
+  if ((number = expr.instance<Number>())) {
+    emit(PUSH_OP, constants.size());
+    constants.push_back(number->getValue());
+
+  } else if ((unaryOp = expr.instance<UnaryOp>())) {
+    compileExpr(*unaryOp->getExpr(), depth);
+
+    switch (unaryOp->getType()) {
+    case Operator::ADD_OP: break;
+    case Operator::SUB_OP: emit(NEG_OP); break;
+    default: THROW(expr.getLocation() << " Invalid unary operator");
+    }
+
+  } else if ((binaryOp = expr.instance<BinaryOp>())) {
+    Operator type = binaryOp->getType();
+    if (type < Operator::EXP_OP || Operator::XOR_OP < type)
+      THROW(expr.getLocation() << " Invalid binary operator");
+
+    compileExpr(*binaryOp->getLeft(), depth);
+    compileExpr(*binaryOp->getRight(), depth + 1);
+
+    op_t op = (op_t)(EXP_OP + type - Operator::EXP_OP);
+    emit(op, op == DIV_OP || op == MOD_OP ? addEntity(expr) : 0);
+
+  } else if ((quoted = expr.instance<QuotedExpr>()))
+    compileExpr(*quoted->getExpression(), depth);
+
+  else if ((ref = expr.instance<Reference>())) {
+    compileExpr(*ref->getExpression(), depth);
+    emit(REF_OP, addEntity(expr));
+
+  } else if ((namedRef = expr.instance<NamedReference>())) {
+    emit(NAMED_REF_OP, symbols.size());
+    symbols.push_back(namedRef->getSymbol());
+
+  } else if ((call = expr.instance<FunctionCall>())) {
+    string name = String::toUpper(call->getName());
+
+    if (name == "EXISTS") {
+      if (!call->getArg1().isInstance<NamedReference>()) {
+        emit(PUSH_OP, constants.size());
+        constants.push_back(0);
+
+      } else {
+        emit(EXISTS_OP, symbols.size());
+        symbols.push_back(call->getArg1().cast<NamedReference>()->getSymbol());
+      }
+
+      return;
+    }
+
+    unsigned args = call->getArg2().isNull() ? 1 : 2;
+
+    for (unsigned i = 0; functions[i].name; i++)
+      if (name == functions[i].name && args == functions[i].args) {
+        compileExpr(*call->getArg1(), depth);
+        if (args == 2) compileExpr(*call->getArg2(), depth + 1);
+        emit(functions[i].op);
+        return;
+      }
+
+    THROW(expr.getLocation() << " Unsupported function '" << name << "'");
+
+  } else THROW(expr.getLocation() << " Cannot compile expression " << expr);
+}
+
+
+uint32_t Bytecode::addEntity(const Entity &entity) {
+  entities.push_back(&entity);
+  return entities.size() - 1;
+}
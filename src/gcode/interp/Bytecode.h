@@ -0,0 +1,88 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "Symbol.h"
+
+#include <vector>
+#include <cinttypes>
+
+#include <cbang/SmartPointer.h>
+
+
+namespace GCode {
+  class Entity;
+  class Evaluator;
+  class Block;
+
+  // An expression compiled to instructions for a small stack machine.  Named
+  // references are resolved to Symbols and functions to opcodes once, at
+  // compile time, rather than on every evaluation.
+  class Bytecode {
+  public:
+    typedef enum {
+      PUSH_OP,       // Push constants[arg]
+      REF_OP,        // Replace top with the numbered parameter it addresses
+      NAMED_REF_OP,  // Push the value of symbols[arg]
+      EXISTS_OP,     // Push 1 if symbols[arg] is defined, 0 otherwise
+      NEG_OP,
+
+      // Binary operators, in the order of Operator
+      EXP_OP, MUL_OP, DIV_OP, MOD_OP, ADD_OP, SUB_OP, EQ_OP, NE_OP, GT_OP,
+      GE_OP, LT_OP, LE_OP, AND_OP, OR_OP, XOR_OP,
+
+      // Functions
+      ABS_OP, ACOS_OP, ASIN_OP, COS_OP, EXP_FUNC_OP, FIX_OP, FUP_OP, ROUND_OP,
+      LN_OP, SIN_OP, SQRT_OP, TAN_OP, ATAN_OP,
+    } op_t;
+
+  protected:
+    struct Instruction {
+      uint8_t op;
+      uint32_t arg; // Index in to constants, symbols or entities
+    };
+
+    std::vector<Instruction> code;
+    std::vector<double> constants;
+    std::vector<Symbol> symbols;
+    std::vector<const Entity *> entities; // For error locations
+    unsigned maxDepth;
+
+  public:
+    // Throws if the expression cannot be compiled
+    Bytecode(Entity &expr);
+
+    unsigned getSize() const {return code.size();}
+
+    double eval(Evaluator &evaluator) const;
+
+    // Replace the expressions in a block with compiled ones.  Expressions which
+    // fail to compile are left for the tree walking Evaluator.
+    static void compile(Block &block);
+    static cb::SmartPointer<Entity>
+    compile(const cb::SmartPointer<Entity> &expr);
+
+  protected:
+    void emit(op_t op, uint32_t arg = 0);
+    void compileExpr(Entity &expr, unsigned depth);
+    uint32_t addEntity(const Entity &entity);
+  };
+}
@@ -19,6 +19,7 @@
 \******************************************************************************/
 
 #include "Evaluator.h"
+#include "Symbol.h"
 
 #include <gcode/ast/UnaryOp.h>
 #include <gcode/ast/BinaryOp.h>
@@ -39,6 +40,16 @@ using namespace cb;
 using namespace GCode;
 
 
+double Evaluator::lookupReference(const Symbol &symbol) {
+  return lookupReference(symbol.getName());
+}
+
+
+bool Evaluator::hasReference(const Symbol &symbol) {
+  return hasReference(symbol.getName());
+}
+
+
 double Evaluator::eval(UnaryOp &e) {
   double value = e.getExpr()->eval(*this);
 
@@ -91,7 +102,7 @@ double Evaluator::eval(FunctionCall &e) {
 
   if (name == "EXISTS") {
     if (!e.getArg1().isInstance<NamedReference>()) return false;
-    return hasReference(e.getArg1().cast<NamedReference>()->getName());
+    return hasReference(e.getArg1().cast<NamedReference>()->getSymbol());
   }
 
   double arg1 = e.getArg1()->eval(*this);
@@ -120,7 +131,9 @@ double Evaluator::eval(FunctionCall &e) {
 }
 
 
-double Evaluator::eval(NamedReference &e) {return lookupReference(e.getName());}
+double Evaluator::eval(NamedReference &e) {
+  return lookupReference(e.getSymbol());
+}
 
 
 double Evaluator::eval(Reference &e) {
@@ -36,12 +36,15 @@ namespace GCode {
   class Number;
   class QuotedExpr;
   class Reference;
+  class Symbol;
 
   class Evaluator {
   public:
     virtual double lookupReference(address_t addr) {return 0;}
     virtual double lookupReference(const std::string &name) {return 0;}
     virtual bool hasReference(const std::string &name) {return false;}
+    virtual double lookupReference(const Symbol &symbol);
+    virtual bool hasReference(const Symbol &symbol);
 
     virtual double eval(UnaryOp &e);
     virtual double eval(BinaryOp &e);
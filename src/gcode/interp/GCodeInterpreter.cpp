@@ -42,7 +42,7 @@ using namespace GCode;
 
 
 GCodeInterpreter::GCodeInterpreter(Controller &controller) :
-  controller(controller) {}
+  controller(controller), bytecode(true) {}
 
 
 void GCodeInterpreter::setReference(address_t addr, double value) {
@@ -57,6 +57,13 @@ void GCodeInterpreter::setReference(const string &name, double value) {
 }
 
 
+void GCodeInterpreter::setReference(const Symbol &symbol, double value) {
+  LOG_DEBUG(3, "Set global variable #<" << symbol.getName() << "> = "
+            << value);
+  controller.set(symbol.getCanonical(), value);
+}
+
+
 void GCodeInterpreter::clearReference(const string &name) {
   LOG_DEBUG(3, "Clear global variable #<" << name << ">");
   controller.clear(canonical(name));
@@ -190,7 +197,7 @@ string GCodeInterpreter::interpolate(const string &s) {
 
 
 string GCodeInterpreter::canonical(const string &name) const {
-  return String::replace(String::toLower(name), " ", "");
+  return Symbol::canonicalize(name);
 }
 
 
@@ -223,7 +230,7 @@ void GCodeInterpreter::operator()(const SmartPointer<Block> &block) {
         setReference(ref->getAddress(), assign->getExprValue());
 
       else if ((nameRef = assign->getReference()->instance<NamedReference>()))
-        setReference(nameRef->getName(), assign->getExprValue());
+        setReference(nameRef->getSymbol(), assign->getExprValue());
 
       else THROW("Invalid reference type in Assign");
 
@@ -373,3 +380,13 @@ double GCodeInterpreter::lookupReference(const string &name) {
 bool GCodeInterpreter::hasReference(const string &name) {
   return controller.has(canonical(name));
 }
+
+
+double GCodeInterpreter::lookupReference(const Symbol &symbol) {
+  return controller.get(symbol.getCanonical());
+}
+
+
+bool GCodeInterpreter::hasReference(const Symbol &symbol) {
+  return controller.has(symbol.getCanonical());
+}
@@ -22,6 +22,7 @@
 
 
 #include "Evaluator.h"
+#include "Symbol.h"
 
 #include <gcode/VarTypes.h>
 #include <gcode/ModalGroup.h>
@@ -38,6 +39,7 @@ namespace GCode {
     public Processor, public Evaluator, public VarTypes, public ModalGroup {
   protected:
     Controller &controller;
+    bool bytecode;
 
     std::vector<cb::SmartPointer<std::ostream> > log;
 
@@ -46,6 +48,7 @@ namespace GCode {
 
     virtual void setReference(address_t addr, double value);
     virtual void setReference(const std::string &name, double value);
+    virtual void setReference(const Symbol &symbol, double value);
     virtual void clearReference(const std::string &name);
 
     virtual void execute(const Code &code, int vars);
@@ -54,6 +57,10 @@ namespace GCode {
     std::string interpolate(const std::string &s);
     std::string canonical(const std::string &name) const;
 
+    // Expressions are compiled to Bytecode unless disabled
+    bool getBytecode() const {return bytecode;}
+    void setBytecode(bool bytecode) {this->bytecode = bytecode;}
+
     // From Processor
     void operator()(const cb::SmartPointer<Block> &block);
 
@@ -61,5 +68,7 @@ namespace GCode {
     double lookupReference(address_t addr);
     double lookupReference(const std::string &name);
     bool hasReference(const std::string &name);
+    double lookupReference(const Symbol &symbol);
+    bool hasReference(const Symbol &symbol);
   };
 }
@@ -24,6 +24,7 @@
 #include "SubroutineLoader.h"
 #include "DoLoop.h"
 #include "RepeatLoop.h"
+#include "Bytecode.h"
 
 #include <gcode/ast/OCode.h>
 #include <gcode/ast/Word.h>
@@ -355,6 +356,9 @@ void OCodeInterpreter::doEndRepeat(OCode *ocode) {
 void OCodeInterpreter::operator()(const SmartPointer<Block> &block) {
   if (block->isDeleted()) return;
 
+  // Compiled once, subroutine and loop bodies keep their compiled blocks
+  if (getBytecode()) Bytecode::compile(*block);
+
   OCode *ocode = block->findOCode();
   unsigned number = ocode ? ocode->eval(*this) : 0;
   string keyword = ocode ? ocode->getKeyword() : string();
@@ -425,12 +429,29 @@ void OCodeInterpreter::setReference(address_t addr, double value) {
 
 
 void OCodeInterpreter::setReference(const string &name, double value) {
-  if (stack.empty() || name[0] == '_')
-    GCodeInterpreter::setReference(name, value);
+  setReference(Symbol(name), value);
+}
+
+
+void OCodeInterpreter::setReference(const Symbol &symbol, double value) {
+  if (stack.empty() || symbol.getName()[0] == '_')
+    GCodeInterpreter::setReference(symbol, value);
 
   else {
-    LOG_DEBUG(3, "Set local variable #<" << name << "> = " << value);
-    stack.back().names[canonical(name)] = value; // Local variable assignment
+    LOG_DEBUG(3, "Set local variable #<" << symbol.getName() << "> = "
+              << value);
+
+    // Local variable assignment
+    StackEntry &entry = stack.back();
+    unsigned id = symbol.getId();
+
+    if (entry.names.size() <= id) {
+      entry.names.resize(id + 1);
+      entry.named.resize(id + 1);
+    }
+
+    entry.names[id] = value;
+    entry.named[id] = true;
   }
 }
 
@@ -445,12 +466,18 @@ double OCodeInterpreter::lookupReference(address_t addr) {
 
 
 double OCodeInterpreter::lookupReference(const string &name) {
-  if (name[0] != '_' && !stack.empty()) {
-    auto &nameMap = stack.back().names;
-    auto it = nameMap.find(canonical(name));
-    if (it != nameMap.end()) return it->second;
-    THROW("Local reference to '" << name << "' not found");
+  return lookupReference(Symbol(name));
+}
+
+
+double OCodeInterpreter::lookupReference(const Symbol &symbol) {
+  if (symbol.getName()[0] != '_' && !stack.empty()) {
+    const StackEntry &entry = stack.back();
+    unsigned id = symbol.getId();
+
+    if (id < entry.named.size() && entry.named[id]) return entry.names[id];
+    THROW("Local reference to '" << symbol.getName() << "' not found");
   }
 
-  return GCodeInterpreter::lookupReference(name);
+  return GCodeInterpreter::lookupReference(symbol);
 }
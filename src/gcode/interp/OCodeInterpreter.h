@@ -45,7 +45,8 @@ namespace GCode {
     // Variable call stack
     struct StackEntry {
       std::vector<double> nums;
-      std::map<std::string, double> names;
+      std::vector<double> names; // Indexed by Symbol id
+      std::vector<bool> named;
 
       StackEntry() : nums(30) {}
     };
@@ -73,6 +74,7 @@ namespace GCode {
 
     const cb::SmartPointer<Program> &
     lookupSubroutine(const std::string &name) const;
+    bool hasLoadedFiles() const {return !sub.loadedFiles.empty();}
 
     void checkExpressions(OCode *ocode, const char *name, bool expr = false,
                           bool optional = false);
@@ -101,9 +103,11 @@ namespace GCode {
     // From GCodeInterpreter
     void setReference(address_t addr, double value);
     void setReference(const std::string &name, double value);
+    void setReference(const Symbol &symbol, double value);
 
     // From Evaluator
     double lookupReference(address_t addr);
     double lookupReference(const std::string &name);
+    double lookupReference(const Symbol &symbol);
   };
 }
@@ -0,0 +1,43 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <string>
+
+
+namespace GCode {
+  // A named parameter.  The canonical name is computed once and interned to a
+  // small integer id so local variables can be stored in flat arrays.
+  class Symbol {
+    std::string name;
+    std::string canonical;
+    unsigned id;
+
+  public:
+    explicit Symbol(const std::string &name);
+
+    const std::string &getName() const {return name;}
+    const std::string &getCanonical() const {return canonical;}
+    unsigned getId() const {return id;}
+
+    static std::string canonicalize(const std::string &name);
+  };
+}
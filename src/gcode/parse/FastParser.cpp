@@ -0,0 +1,733 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "FastParser.h"
+
+#include <gcode/ast/Arena.h>
+#include <gcode/ast/Block.h>
+#include <gcode/ast/Comment.h>
+#include <gcode/ast/Word.h>
+#include <gcode/ast/Assign.h>
+#include <gcode/ast/OCode.h>
+#include <gcode/ast/Number.h>
+#include <gcode/ast/FunctionCall.h>
+#include <gcode/ast/UnaryOp.h>
+#include <gcode/ast/BinaryOp.h>
+#include <gcode/ast/QuotedExpr.h>
+#include <gcode/ast/Reference.h>
+#include <gcode/ast/NamedReference.h>
+
+#include <cbang/String.h>
+#include <cbang/Exception.h>
+#include <cbang/log/Logger.h>
+
+#include <cstring>
+#include <cctype>
+
+using namespace std;
+using namespace cb;
+using namespace GCode;
+
+
+namespace {
+  // Powers of ten which are exactly representable as doubles
+  const double exactPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+
+  inline bool isWhiteSpace(char c) {return c == ' ' || c == '\t' || c == '\r';}
+  inline bool isDigit(char c) {return '0' <= c && c <= '9';}
+  inline bool isIDChar(char c) {return isalpha((unsigned char)c) || c == '_';}
+
+
+  // A block which owns the entities allocated from its arena
+  class ArenaBlock : public Block {
+  public:
+    Arena arena;
+
+    ArenaBlock(bool deleted, int line) :
+      Block(deleted, line, vector<SmartPointer<Entity> >()) {}
+
+    // Release the children before the arena destroys them
+    ~ArenaBlock() {clear();}
+  };
+
+
+  template <typename T, typename... Args>
+  SmartPointer<Entity> create(Arena *arena, Args &&...args) {
+    if (!arena) return new T(std::forward<Args>(args)...);
+
+    T *entity = arena->create<T>(std::forward<Args>(args)...);
+    return SmartPointer<Entity>::Phony(entity);
+  }
+}
+
+
+FastParser::FastParser(const char *data, uint64_t size,
+                       const string &filename, int line) :
+  begin(data), end(data + size), ptr(data), filename(filename), line(line),
+  lineStart(data), type(TokenType::EOF_TOKEN), text(data), length(0),
+  value(0), tokenStart{line, 0}, lastEnd{line, 0}, arena(0),
+  independent(true) {
+
+  // Skip UTF-8 byte order mark
+  if (line == 1 && 3 <= size && !memcmp(data, "\xef\xbb\xbf", 3))
+    ptr = lineStart = data + 3;
+
+  // Errors in the first token are thrown by next() like any other
+  while (true)
+    try {
+      advance();
+      break;
+
+    } catch (const Exception &e) {
+      if (error.isNull())
+        error = new Exception(e.getMessage(), getLocation(tokenStart));
+    }
+}
+
+
+double FastParser::getProgress() const {
+  return begin == end ? 1 : (double)(ptr - begin) / (end - begin);
+}
+
+
+SmartPointer<Block> FastParser::next() {
+  if (error.isSet()) {
+    Exception e = *error;
+    error = 0;
+    throw e;
+  }
+
+  try {
+    return block();
+
+  } catch (const Exception &e) {
+    arena = 0;
+    LOG_DEBUG(3, e);
+    throw Exception(e.getMessage(), getLocation(tokenStart));
+  }
+}
+
+
+SmartPointer<Block> FastParser::block() {
+  Mark start = mark();
+
+  // Deleted
+  bool deleted = consume(TokenType::DIV_TOKEN);
+
+  // Line number
+  int userLine = -1;
+  if (isID("N")) {
+    advance();
+    check(TokenType::NUMBER_TOKEN);
+
+    if (memchr(text, '.', length) || 4294967295.0 < value)
+      userLine = String::parseU32(getValue()); // Throws
+    else userLine = (int)value;
+
+    advance();
+  }
+
+  SmartPointer<ArenaBlock> current = new ArenaBlock(deleted, userLine);
+  arena = &current->arena;
+
+  // O-Code
+  if (isID("O")) current->push_back(ocode());
+
+  while (hasMore()) {
+    switch (type) {
+    case TokenType::EOL_TOKEN: break; // End of block
+
+    case TokenType::COMMENT_TOKEN:
+    case TokenType::PAREN_COMMENT_TOKEN:
+      current->push_back(comment());
+      break;
+
+    case TokenType::POUND_TOKEN:
+      current->push_back(assign());
+      break;
+
+    default:
+      if (type != TokenType::ID_TOKEN) {
+        string found = describe();
+        advance();
+        THROW("Expected word or assignment, found " << found);
+      }
+
+      current->push_back(word());
+      break;
+    }
+
+    if (type == TokenType::EOL_TOKEN) {
+      advance();
+      break;
+    }
+  }
+
+  arena = 0;
+  current->getLocation() = getRange(start);
+
+  return current;
+}
+
+
+SmartPointer<Entity> FastParser::comment() {
+  Mark start = mark();
+
+  bool paren = type == TokenType::PAREN_COMMENT_TOKEN;
+  if (!paren) check(TokenType::COMMENT_TOKEN);
+
+  string body = getValue();
+  advance();
+
+  SmartPointer<Entity> entity = create<Comment>(arena, body, paren);
+  entity->getLocation() = getRange(start);
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::word() {
+  Mark start = mark();
+
+  check(TokenType::ID_TOKEN);
+  if (length != 1) THROW("Invalid word '" << getValue() << "'");
+  char name = *text;
+  advance();
+
+  // Plain and signed numbers, by far the most common case, are allocated
+  // from the block's arena
+  SmartPointer<Entity> expr;
+
+  if (type == TokenType::NUMBER_TOKEN) expr = number(arena);
+
+  else if (type == TokenType::ADD_TOKEN || type == TokenType::SUB_TOKEN) {
+    Operator op = type == TokenType::ADD_TOKEN ?
+      Operator::ADD_OP : Operator::SUB_OP;
+    advance();
+
+    if (type == TokenType::NUMBER_TOKEN)
+      expr = number(arena, op == Operator::SUB_OP);
+    else expr = new UnaryOp(op, numberRefOrExpr());
+
+  } else expr = numberRefOrExpr();
+
+  SmartPointer<Entity> entity = create<Word>(arena, name, expr);
+  entity->getLocation() = getRange(start);
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::assign() {
+  Mark start = mark();
+
+  SmartPointer<Entity> ref = reference();
+  match(TokenType::ASSIGN_TOKEN);
+
+  SmartPointer<Entity> entity = new Assign(ref, expression());
+  entity->getLocation() = getRange(start);
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::ocode() {
+  Mark start = mark();
+  independent = false; // Control flow spans blocks
+
+  match(TokenType::ID_TOKEN); // The 'O'
+
+  SmartPointer<OCode> ocode;
+
+  if (consume(TokenType::OANGLE_TOKEN)) {
+    string name = matchValue(TokenType::ID_TOKEN);
+    match(TokenType::CANGLE_TOKEN);
+    string keyword = matchValue(TokenType::ID_TOKEN);
+
+    ocode = new OCode(String::toLower(name), keyword);
+
+  } else {
+    SmartPointer<Entity> numExpr = numberRefOrExpr();
+    string keyword;
+
+    // Some postprocesors output an O-Code wo/ a keyword as a program number.
+    if (type == TokenType::ID_TOKEN)
+      keyword = matchValue(TokenType::ID_TOKEN);
+
+    ocode = new OCode(numExpr, keyword);
+  }
+
+  while (type == TokenType::OBRACKET_TOKEN)
+    ocode->addExpression(quotedExpr());
+
+  ocode->getLocation() = getRange(start);
+
+  return ocode;
+}
+
+
+SmartPointer<Entity> FastParser::numberRefOrExpr() {
+  switch (type) {
+  case TokenType::POUND_TOKEN:    return reference();
+  case TokenType::OBRACKET_TOKEN: return quotedExpr();
+  case TokenType::NUMBER_TOKEN:   return number();
+  case TokenType::ADD_TOKEN:
+  case TokenType::SUB_TOKEN:      return unaryOp();
+  default: {
+    string found = describe();
+    advance();
+    THROW("Expected number, reference, or bracked expression, found "
+          << found);
+  }
+  }
+}
+
+
+SmartPointer<Entity> FastParser::expression() {
+  return boolOp();
+}
+
+
+SmartPointer<Entity> FastParser::boolOp() {
+  SmartPointer<Entity> entity = compareOp();
+
+  while (type == TokenType::ID_TOKEN) {
+    Operator op;
+
+    if      (isID("AND")) op = Operator::AND_OP;
+    else if (isID("OR"))  op = Operator::OR_OP;
+    else if (isID("XOR")) op = Operator::XOR_OP;
+    else break;
+
+    advance();
+    entity = new BinaryOp(op, entity, compareOp());
+  }
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::compareOp() {
+  SmartPointer<Entity> entity = addOp();
+
+  while (type == TokenType::ID_TOKEN) {
+    Operator op;
+
+    if      (isID("EQ")) op = Operator::EQ_OP;
+    else if (isID("NE")) op = Operator::NE_OP;
+    else if (isID("GT")) op = Operator::GT_OP;
+    else if (isID("GE")) op = Operator::GE_OP;
+    else if (isID("LT")) op = Operator::LT_OP;
+    else if (isID("LE")) op = Operator::LE_OP;
+    else break;
+
+    advance();
+    entity = new BinaryOp(op, entity, addOp());
+  }
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::addOp() {
+  SmartPointer<Entity> entity = mulOp();
+
+  while (true) {
+    Operator op;
+
+    switch (type) {
+    case TokenType::ADD_TOKEN: op = Operator::ADD_OP; break;
+    case TokenType::SUB_TOKEN: op = Operator::SUB_OP; break;
+    default: return entity;
+    }
+
+    advance();
+    entity = new BinaryOp(op, entity, mulOp());
+  }
+}
+
+
+SmartPointer<Entity> FastParser::mulOp() {
+  SmartPointer<Entity> entity = expOp();
+
+  while (true) {
+    Operator op;
+
+    switch (type) {
+    case TokenType::MUL_TOKEN: op = Operator::MUL_OP; break;
+    case TokenType::DIV_TOKEN: op = Operator::DIV_OP; break;
+    case TokenType::ID_TOKEN:
+      if (isID("MOD")) op = Operator::MOD_OP;
+      break;
+    default: break;
+    }
+
+    if (op == Operator::NO_OP) return entity;
+
+    advance();
+    entity = new BinaryOp(op, entity, expOp());
+  }
+}
+
+
+SmartPointer<Entity> FastParser::expOp() {
+  SmartPointer<Entity> entity = primary();
+
+  while (consume(TokenType::EXP_TOKEN))
+    entity = new BinaryOp(Operator::EXP_OP, entity, primary());
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::unaryOp() {
+  Operator op;
+
+  switch (type) {
+  case TokenType::ADD_TOKEN: op = Operator::ADD_OP; break;
+  case TokenType::SUB_TOKEN: op = Operator::SUB_OP; break;
+  default: {
+    TokenType found = type;
+    advance();
+    THROW("Expected unary - or + operator, found " << found);
+  }
+  }
+
+  advance();
+
+  return new UnaryOp(op, numberRefOrExpr());
+}
+
+
+SmartPointer<Entity> FastParser::primary() {
+  if (type == TokenType::ID_TOKEN) return functionCall();
+  return numberRefOrExpr();
+}
+
+
+SmartPointer<Entity> FastParser::quotedExpr() {
+  Mark start = mark();
+
+  match(TokenType::OBRACKET_TOKEN);
+  SmartPointer<Entity> expr = expression();
+  match(TokenType::CBRACKET_TOKEN);
+
+  SmartPointer<Entity> quoted = new QuotedExpr(expr);
+  quoted->getLocation() = getRange(start);
+
+  return quoted;
+}
+
+
+SmartPointer<Entity> FastParser::functionCall() {
+  Mark start = mark();
+
+  string name = matchValue(TokenType::ID_TOKEN);
+  SmartPointer<Entity> arg1 = quotedExpr();
+  SmartPointer<Entity> arg2;
+
+  // Special case
+  if (String::toUpper(name) == "ATAN" && consume(TokenType::DIV_TOKEN))
+    arg2 = quotedExpr();
+
+  SmartPointer<Entity> call = new FunctionCall(name, arg1, arg2);
+  call->getLocation() = getRange(start);
+
+  return call;
+}
+
+
+SmartPointer<Entity> FastParser::number(Arena *arena, bool negative) {
+  Mark start = mark();
+
+  check(TokenType::NUMBER_TOKEN);
+  double n = negative ? -value : value;
+  advance();
+
+  SmartPointer<Entity> entity = create<Number>(arena, n);
+
+  // Numbers in the arena are word values, located by their word
+  if (!arena) entity->getLocation() = getRange(start);
+
+  return entity;
+}
+
+
+SmartPointer<Entity> FastParser::reference() {
+  Mark start = mark();
+
+  match(TokenType::POUND_TOKEN);
+
+  SmartPointer<Entity> ref;
+
+  if (consume(TokenType::OANGLE_TOKEN)) {
+    string id;
+
+    while (type != TokenType::CANGLE_TOKEN && hasMore()) {
+      id += getValue();
+      advance();
+    }
+
+    match(TokenType::CANGLE_TOKEN);
+
+    ref = new NamedReference(id);
+
+  } else ref = new Reference(numberRefOrExpr());
+
+  ref->getLocation() = getRange(start);
+
+  return ref;
+}
+
+
+void FastParser::advance() {
+  lastEnd = Mark{line, (int)(ptr - lineStart)};
+
+  skipWhiteSpace();
+
+  tokenStart = Mark{line, (int)(ptr - lineStart)};
+  text = ptr;
+  length = 1;
+
+  if (ptr == end || !*ptr) {
+    if (ptr != end) independent = false; // Ends all input
+    type = TokenType::EOF_TOKEN;
+    length = 0;
+    return;
+  }
+
+  char c = *ptr;
+  switch (c) {
+  case ';': scanComment(); return;
+  case '(': scanParenComment(); return;
+
+  case '.':
+  case '0': case '1': case '2': case '3': case '4':
+  case '5': case '6': case '7': case '8': case '9':
+    scanNumber();
+    return;
+
+  case '*':
+    if (ptr + 1 < end && ptr[1] == '*') {
+      type = TokenType::EXP_TOKEN;
+      length = 2;
+
+    } else type = TokenType::MUL_TOKEN;
+    break;
+
+  case '+': type = TokenType::ADD_TOKEN; break;
+  case '-': type = TokenType::SUB_TOKEN; break;
+  case '/': type = TokenType::DIV_TOKEN; break;
+  case '[': type = TokenType::OBRACKET_TOKEN; break;
+  case ']': type = TokenType::CBRACKET_TOKEN; break;
+  case '<': type = TokenType::OANGLE_TOKEN; break;
+  case '>': type = TokenType::CANGLE_TOKEN; break;
+  case '=': type = TokenType::ASSIGN_TOKEN; break;
+  case '#': type = TokenType::POUND_TOKEN; break;
+
+  case '\n':
+    type = TokenType::EOL_TOKEN;
+    ptr++;
+    newLine();
+    return;
+
+  default:
+    if (isIDChar(c)) {
+      scanID();
+      return;
+    }
+
+    ptr++;
+    THROW("Invalid character: '" << String::escapeC(c) << "'");
+  }
+
+  ptr += length;
+}
+
+
+void FastParser::check(TokenType type) const {
+  if (this->type != type)
+    THROW("Expected " << type << ", found " << describe());
+}
+
+
+void FastParser::match(TokenType type) {
+  check(type);
+  advance();
+}
+
+
+string FastParser::matchValue(TokenType type) {
+  check(type);
+  string s = getValue();
+  advance();
+  return s;
+}
+
+
+bool FastParser::consume(TokenType type) {
+  if (this->type != type) return false;
+  advance();
+  return true;
+}
+
+
+bool FastParser::isID(const char *id) const {
+  if (type != TokenType::ID_TOKEN) return false;
+
+  for (unsigned i = 0; i < length; i++)
+    if (!id[i] || toupper(text[i]) != id[i]) return false;
+
+  return !id[length];
+}
+
+
+string FastParser::getValue() const {
+  string s;
+  s.reserve(length);
+
+  for (unsigned i = 0; i < length; i++) {
+    char c = text[i];
+
+    // Numbers may contain white space, line comments drop carriage returns
+    if (type == TokenType::NUMBER_TOKEN && isWhiteSpace(c)) continue;
+    if (type == TokenType::COMMENT_TOKEN && c == '\r') continue;
+
+    s += c;
+  }
+
+  return s;
+}
+
+
+string FastParser::describe() const {
+  switch (type) {
+  case TokenType::EOF_TOKEN:           return "End of input";
+  case TokenType::COMMENT_TOKEN:       return "Comment";
+  case TokenType::PAREN_COMMENT_TOKEN: return "'('";
+  case TokenType::NUMBER_TOKEN:        return "Number '" + getValue() + "'";
+  case TokenType::ID_TOKEN:            return "ID '" + getValue() + "'";
+  case TokenType::EOL_TOKEN:           return "End of line";
+  default:                             return "'" + getValue() + "'";
+  }
+}
+
+
+FileLocation FastParser::getLocation(const Mark &mark) const {
+  return FileLocation(filename, mark.line, mark.col);
+}
+
+
+LocationRange FastParser::getRange(const Mark &start) const {
+  return LocationRange(getLocation(start), getLocation(lastEnd));
+}
+
+
+void FastParser::skipWhiteSpace() {
+  // Program delimiters are ignored
+  while (ptr < end && (isWhiteSpace(*ptr) || *ptr == '%')) ptr++;
+}
+
+
+void FastParser::newLine() {
+  line++;
+  lineStart = ptr;
+}
+
+
+void FastParser::scanComment() {
+  type = TokenType::COMMENT_TOKEN;
+  text = ++ptr;
+
+  const char *eol = (const char *)memchr(ptr, '\n', end - ptr);
+  ptr = eol ? eol : end;
+  length = ptr - text;
+}
+
+
+void FastParser::scanParenComment() {
+  // Like Tokenizer, this allows multiline comments
+  type = TokenType::PAREN_COMMENT_TOKEN;
+  text = ++ptr;
+
+  while (ptr < end && *ptr != ')')
+    if (*ptr++ == '\n') {
+      newLine();
+      independent = false;
+    }
+
+  length = ptr - text;
+
+  if (ptr == end) THROW("Expected ')', found End of input");
+  ptr++;
+}
+
+
+void FastParser::scanNumber() {
+  // Digits may be separated by white space.  Up to 15 significant digits
+  // with at most 22 decimals convert exactly with a single division,
+  // anything longer falls back to String::parseDouble().
+  uint64_t mantissa = 0;
+  unsigned digits = 0;
+  unsigned decimals = 0;
+  bool dot = false;
+  const char *last = ptr;
+
+  while (ptr < end) {
+    char c = *ptr;
+
+    if (c == '.') {
+      if (dot) break;
+      dot = true;
+
+    } else if (isDigit(c)) {
+      if (digits < 19) mantissa = mantissa * 10 + (c - '0');
+      digits++;
+      if (dot) decimals++;
+
+    } else break;
+
+    last = ++ptr;
+    while (ptr < end && isWhiteSpace(*ptr)) ptr++;
+  }
+
+  length = last - text;
+
+  if (!digits) {
+    type = TokenType::DOT_TOKEN;
+    return;
+  }
+
+  type = TokenType::NUMBER_TOKEN;
+
+  if (digits <= 15 && decimals <= 22) value = mantissa / exactPow10[decimals];
+  else value = String::parseDouble(getValue());
+}
+
+
+void FastParser::scanID() {
+  type = TokenType::ID_TOKEN;
+  while (ptr < end && isIDChar(*ptr)) ptr++;
+  length = ptr - text;
+}
@@ -0,0 +1,138 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "Token.h"
+
+#include <gcode/Producer.h>
+
+#include <cbang/SmartPointer.h>
+#include <cbang/Exception.h>
+
+#include <string>
+#include <cinttypes>
+
+
+namespace GCode {
+  class Arena;
+  class Entity;
+  class Comment;
+  class Word;
+  class Assign;
+  class OCode;
+  class FunctionCall;
+
+  // Parses G-code held in memory, such as a memory mapped file.  It accepts
+  // the same language as Parser but scans the bytes directly, converts
+  // numbers without building strings and allocates the words, numbers and
+  // comments of each block from an Arena owned by the block.
+  //
+  // Parsing only depends on state from earlier lines when the input has
+  // O-codes or multiline comments.  Otherwise any range of whole lines can
+  // be parsed on its own, see isIndependent().
+  class FastParser : public Producer {
+    const char *begin;
+    const char *end;
+    const char *ptr;
+    std::string filename;
+
+    int line;
+    const char *lineStart;
+
+    struct Mark {
+      int line;
+      int col;
+    };
+
+    // Current token, its text is not copied
+    TokenType type;
+    const char *text;
+    unsigned length;
+    double value;
+    Mark tokenStart;
+    Mark lastEnd; // End of the previous token
+
+    Arena *arena; // Of the block being parsed
+    bool independent;
+    cb::SmartPointer<cb::Exception> error; // In the first token
+
+  public:
+    FastParser(const char *data, uint64_t size, const std::string &filename,
+               int line = 1);
+
+    const std::string &getFilename() const {return filename;}
+    uint64_t getOffset() const {return ptr - begin;}
+    double getProgress() const;
+    bool isIndependent() const {return independent;}
+
+    // From Producer
+    bool hasMore() const
+    {return type != TokenType::EOF_TOKEN || error.isSet();}
+    cb::SmartPointer<Block> next();
+
+  protected:
+    cb::SmartPointer<Block> block();
+
+    cb::SmartPointer<Entity> comment();
+    cb::SmartPointer<Entity> word();
+    cb::SmartPointer<Entity> assign();
+    cb::SmartPointer<Entity> ocode();
+
+    cb::SmartPointer<Entity> numberRefOrExpr();
+    cb::SmartPointer<Entity> expression();
+
+    cb::SmartPointer<Entity> boolOp();
+    cb::SmartPointer<Entity> compareOp();
+    cb::SmartPointer<Entity> addOp();
+    cb::SmartPointer<Entity> mulOp();
+    cb::SmartPointer<Entity> expOp();
+    cb::SmartPointer<Entity> unaryOp();
+
+    cb::SmartPointer<Entity> primary();
+
+    cb::SmartPointer<Entity> quotedExpr();
+    cb::SmartPointer<Entity> functionCall();
+    cb::SmartPointer<Entity> number(Arena *arena = 0, bool negative = false);
+    cb::SmartPointer<Entity> reference();
+
+    // Tokens
+    void advance();
+    void check(TokenType type) const;
+    void match(TokenType type);
+    std::string matchValue(TokenType type);
+    bool consume(TokenType type);
+    bool isID(const char *id) const;
+    std::string getValue() const;
+    std::string describe() const;
+
+    const Mark &mark() const {return tokenStart;}
+    cb::FileLocation getLocation(const Mark &mark) const;
+    cb::LocationRange getRange(const Mark &start) const;
+
+    // Scanning
+    void skipWhiteSpace();
+    void newLine();
+    void scanComment();
+    void scanParenComment();
+    void scanNumber();
+    void scanID();
+  };
+}
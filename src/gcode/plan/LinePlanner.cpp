@@ -41,7 +41,10 @@
 
 #include <limits>
 #include <algorithm>
-#include <complex>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <functional>
 
 using namespace cb;
 using namespace std;
@@ -49,8 +52,34 @@ using namespace GCode;
 
 
 namespace {
-  complex<double> cbrt(complex<double> x) {
-    return x.real() < 0 ? -pow(-x, 1.0 / 3.0) : pow(x, 1.0 / 3.0);
+  // Call func(first, last) on consecutive ranges of [0, count) in parallel.
+  // Exceptions are rethrown in the calling thread.
+  void parallelFor(unsigned count, unsigned threads,
+                   const function<void (unsigned, unsigned)> &func) {
+    const unsigned minChunk = 1024;
+
+    if (!threads) threads = thread::hardware_concurrency();
+    threads = std::min(threads, (count + minChunk - 1) / minChunk);
+
+    if (threads < 2) {
+      if (count) func(0, count);
+      return;
+    }
+
+    unsigned chunk = (count + threads - 1) / threads;
+    vector<exception_ptr> errors(threads);
+    vector<thread> workers;
+
+    for (unsigned i = 0; i < threads && i * chunk < count; i++)
+      workers.push_back(thread([&, i] () {
+        try {
+          func(i * chunk, std::min(count, (i + 1) * chunk));
+        } catch (...) {errors[i] = current_exception();}
+      }));
+
+    for (unsigned i = 0; i < workers.size(); i++) workers[i].join();
+    for (unsigned i = 0; i < errors.size(); i++)
+      if (errors[i]) rethrow_exception(errors[i]);
   }
 }
 
@@ -83,6 +112,122 @@ void LinePlanner::setConfig(const PlannerConfig &config) {
 }
 
 
+void LinePlanner::setBatch(bool batch, unsigned threads) {
+  if (!batch && this->batch) planBatch();
+  this->batch = batch;
+  this->threads = threads;
+}
+
+
+void LinePlanner::planBatch() {
+  if (!unplanned) return;
+  unplanned = 0;
+
+  // Commands already marked final cannot change
+  PlannerCommand *first = cmds.front();
+  while (first && first->isFinal()) first = first->next;
+  if (!first) return;
+
+  vector<PlannerCommand *> buf;
+  for (PlannerCommand *cmd = first; cmd; cmd = cmd->next) buf.push_back(cmd);
+
+  const unsigned n = buf.size();
+  vector<LineCommand *> lines(n);
+  vector<double> entries(n);
+  vector<double> exits(n);
+
+  for (unsigned i = 0; i < n; i++) {
+    lines[i] = dynamic_cast<LineCommand *>(buf[i]);
+    entries[i] = buf[i]->getEntryVelocity();
+    exits[i] = buf[i]->getExitVelocity();
+  }
+
+  // Entry velocity at the beginning of the batch
+  double firstEntry = std::min(entries[0], first->prev ?
+                               first->prev->getExitVelocity() : lastExitVel);
+  entries[0] = firstEntry;
+  if (!lines[0]) exits[0] = std::min(exits[0], firstEntry);
+
+  // Junction velocities only depend on the neighboring moves
+  parallelFor(n, threads, [&] (unsigned start, unsigned end) {
+      for (unsigned i = start; i < end; i++)
+        if (lines[i])
+          entries[i] = std::min(entries[i], junctionLimit(*lines[i]));
+    });
+
+  // Backward and forward velocity limit passes.  Velocities only decrease
+  // so repeating until nothing changes terminates.  The streaming planner
+  // stops backplanning early, so its velocities can be slightly lower.
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (unsigned i = n; i--;) {
+      double Vi = entries[i];
+      double Vt = exits[i];
+
+      if (i + 1 < n) Vt = std::min(Vt, entries[i + 1]);
+      if (lines[i]) limitVelocity(*lines[i], Vi, Vt);
+      else Vi = Vt = std::min(Vi, Vt);
+
+      changed |= Vi != entries[i] || Vt != exits[i];
+      entries[i] = Vi;
+      exits[i] = Vt;
+    }
+
+    for (unsigned i = 0; i < n; i++) {
+      double Vi = entries[i];
+      double Vt = exits[i];
+
+      if (i) Vi = std::min(Vi, exits[i - 1]);
+      if (lines[i]) limitVelocity(*lines[i], Vi, Vt);
+      else Vi = Vt = std::min(Vi, Vt);
+
+      changed |= Vi != entries[i] || Vt != exits[i];
+      entries[i] = Vi;
+      exits[i] = Vt;
+    }
+  }
+
+  if (!first->prev && entries[0] < firstEntry)
+    THROW("Cannot backplan, previous move unavailable");
+
+  if (first->prev && entries[0] < first->prev->getExitVelocity())
+    first->prev->setExitVelocity(entries[0]);
+
+  for (unsigned i = 0; i < n; i++) {
+    buf[i]->setEntryVelocity(entries[i]);
+    buf[i]->setExitVelocity(exits[i]);
+  }
+
+  // Segment profiles are independent once the velocities are known
+  parallelFor(n, threads, [&] (unsigned start, unsigned end) {
+      for (unsigned i = start; i < end; i++) {
+        if (!lines[i]) continue;
+
+        LineCommand &lc = *lines[i];
+        double Vi = lc.entryVel;
+        double Vt = lc.exitVel;
+        bool swapped = Vt < Vi;
+        if (swapped) swap(Vi, Vt);
+
+        double length = computeLength(Vi, Vt, lc.maxAccel, lc.maxJerk);
+        if (lc.length < Math::nextDown(length)) length = lc.length;
+
+        planProfile(lc, Vi, Vt, length, swapped);
+      }
+    });
+
+  // Finalize with the same deceleration and lookahead test as the
+  // streaming planner, so only the unsettled tail is planned again
+  unsigned final = 0;
+  while (final < n && isFinal(buf[final])) buf[final++]->setFinal();
+
+  LOG_DEBUG(3, "Batch planned " << n << " commands, " << final << " final");
+}
+
+
 void LinePlanner::checkSoftLimits(const Axes &p) {
   for (unsigned axis = 0; axis < Axes::getSize(); axis++) {
     string homed = String::printf("_%c_homed", Axes::toAxis(axis, true));
@@ -106,6 +251,7 @@ bool LinePlanner::isEmpty() const {return cmds.empty();}
 
 
 bool LinePlanner::hasMove() const {
+  if (batch) return !cmds.empty() && cmds.front()->isFinal();
   return !cmds.empty() && isFinal(cmds.front());
 }
 
@@ -149,6 +295,7 @@ void LinePlanner::setActive(uint64_t id) {
 void LinePlanner::stop() {
   reset();
   nextID = 1;
+  unplanned = 0;
   cmds.clear();
   pre.clear();
   out.clear();
@@ -424,7 +571,8 @@ void LinePlanner::push(PlannerCommand *cmd) {
     PlannerCommand *cmd = pre.pop_front();
     cmd->setID(getNextID());
     cmds.push_back(cmd);
-    plan(cmd);
+    if (batch) unplanned++;
+    else plan(cmd);
   }
 
   // Flush command when in exact stop mode, exit velocity is zero or unmergable
@@ -436,8 +584,13 @@ void LinePlanner::push(PlannerCommand *cmd) {
   else {
     cmd->setID(getNextID());
     cmds.push_back(cmd);
-    plan(cmd);
+    if (batch) unplanned++;
+    else plan(cmd);
   }
+
+  // Plan batch at end of program or when the buffer is full
+  if (batch && (dynamic_cast<EndCommand *>(cmd) || batchSize <= unplanned))
+    planBatch();
 }
 
 
@@ -847,6 +1000,46 @@ bool LinePlanner::planOne(PlannerCommand *cmd) {
     }
   }
 
+  planProfile(lc, Vi, Vt, length, swapped);
+
+  return backplan;
+}
+
+
+double LinePlanner::junctionLimit(const LineCommand &lc) const {
+  for (PlannerCommand *last = lc.prev; last; last = last->prev) {
+    const LineCommand *lastLC = dynamic_cast<LineCommand *>(last);
+    if (!lastLC) continue;
+
+    if (lastLC->targetJunctionVel) return lastLC->targetJunctionVel;
+    return computeJunctionVelocity(lc.unit, lastLC->unit,
+                                   config.junctionDeviation,
+                                   config.junctionAccel);
+  }
+
+  return numeric_limits<double>::max();
+}
+
+
+// Lower the higher of Vi and Vt to what can be reached over the move, the
+// same way planOne() does
+void LinePlanner::limitVelocity(const LineCommand &lc, double &Vi,
+                                double &Vt) const {
+  double &low = Vt < Vi ? Vt : Vi;
+  double &high = Vt < Vi ? Vi : Vt;
+
+  double length = computeLength(low, high, lc.maxAccel, lc.maxJerk);
+
+  if (lc.length < Math::nextDown(length)) {
+    double peak = peakVelocity(low, lc.maxAccel, lc.maxJerk, lc.length);
+    if (peak < high) high = peak;
+  }
+}
+
+
+// Compute segment times and change in velocity for velocities which fit
+void LinePlanner::planProfile(LineCommand &lc, double Vi, double Vt,
+                              double length, bool swapped) const {
   // Zero times
   for (int i = 0; i < 7; i++) lc.times[i] = 0;
 
@@ -871,40 +1064,12 @@ bool LinePlanner::planOne(PlannerCommand *cmd) {
 
   } else {
     // Velocity change fits and a higher peak velocity can be achieved.
-    // Search for a peak velocity that fits well.
-    double peakVel = lc.maxVel;
-    double maxVel = peakVel;
-    double minVel = Vt;
-    int rounds = 0;
+    // Solve for the highest peak velocity that fits.
+    double peakVel = SCurve::peakVelocity(Vi, Vt, lc.maxVel, lc.maxAccel,
+                                          lc.maxJerk, lc.length);
 
-    while (true) {
-      double headLen = computeLength(Vi, peakVel, lc.maxAccel, lc.maxJerk);
-      double tailLen = computeLength(Vt, peakVel, lc.maxAccel, lc.maxJerk);
-      double bodyLen = lc.length - headLen - tailLen;
-
-      if (0 <= bodyLen) {
-        // Fits, stop if we are close enough or there have been enough rounds
-        if (0.99 * maxVel < peakVel || 16 < rounds) break;
-        rounds++;
-
-        // Try a higher velocity
-        minVel = peakVel;
-        peakVel = peakVel + (maxVel - peakVel) / 2;
-
-      } else {
-        // Does not fit, try a lower velocity
-        maxVel = peakVel;
-        peakVel = minVel + (peakVel - minVel) / 2;
-
-        // Quit trying if we are really close to minVel
-        if (peakVel < minVel + 0.0001) {
-          LOG_DEBUG(3, "peakVel=" << peakVel << " bodyLen=" << bodyLen
-                    << " length=" << length << " lc.length=" << lc.length);
-          peakVel = minVel;
-          break;
-        }
-      }
-    }
+    LOG_DEBUG(3, "peakVel=" << peakVel << " length=" << length
+              << " lc.length=" << lc.length);
 
     // Plan s-curve
     double length = lc.length;
@@ -929,8 +1094,6 @@ bool LinePlanner::planOne(PlannerCommand *cmd) {
   // Use what we could accelerate to as an upper bound
   double deltaV = peakVelocity(Vt, lc.maxAccel, lc.maxJerk, lc.length) - Vt;
   if (lc.deltaV < deltaV) lc.deltaV = deltaV;
-
-  return backplan;
 }
 
 
@@ -1042,24 +1205,16 @@ double LinePlanner::peakAccelFromLength(double Vi, double jerk,
   //   (1/2 * L * Jm^2)^2 + (2/3 * Vi * Jm)^3
   //
   // In fact, it is always negative when Jm < 0 and 0 < Vt.  Proof omitted.
-  // So we must handle complex numbers correctly.
-
-  if (jerk < 0 && jerk <= -cube(Vi) / square(length))
-    return -square(Vi) / length; // Peak accel when Vt = 0
-
-  complex<double> q = 0.5 * length * square(jerk);
-  complex<double> r = 2.0 / 3.0 * Vi * jerk;
-  complex<double> sqrtq2r3 = sqrt(square(q) + cube(r));
-
-  complex<double> Ap = cbrt(q + sqrtq2r3) + cbrt(q - sqrtq2r3);
+  // In that case the cubic has three real roots and SCurve uses the
+  // trigonometric form instead of complex cube roots.
+  double Ap = SCurve::peakAccelFromLength(Vi, jerk, length);
 
   LOG_DEBUG(3, "peakAccelFromLength(" << Vi << ", " << jerk << ", "
             << length << ") = " << Ap);
 
-  if (!isfinite(Ap.real()) || Ap.imag())
-    THROW("Invalid peak acceleration length=" << length);
+  if (!isfinite(Ap)) THROW("Invalid peak acceleration length=" << length);
 
-  return Ap.real();
+  return Ap;
 }
 
 
@@ -1140,16 +1295,8 @@ double LinePlanner::speedUp(PlannerCommand *cmd, double Vi) const {
 
 double LinePlanner::computeLength(double Vi, double Vt, double maxAccel,
                                   double maxJerk) const {
-  double length;
-
   // Compute length for velocity change
-  if (isAccelLimited(Vi, Vt, maxAccel, maxJerk))
-    // With constant acceleration segment
-    length = (Vi + Vt) * (square(maxAccel) + maxJerk * (Vt - Vi)) /
-      (2 * maxAccel * maxJerk);
-
-  else // With out constant acceleration
-    length = sqrt(Vt - Vi) * (Vi + Vt) / sqrt(maxJerk);
+  double length = SCurve::transitionLength(Vi, Vt, maxAccel, maxJerk);
 
   LOG_DEBUG(3, "computeLength(" << Vi << ", " << Vt << ", " << maxAccel
             << ", " << maxJerk << ") = " << length);
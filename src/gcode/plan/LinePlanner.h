@@ -51,6 +51,11 @@ namespace GCode {
 
     uint64_t nextID = 1;
 
+    // Batch mode
+    bool batch = false;
+    unsigned threads = 0;
+    unsigned unplanned = 0;
+
     std::string filename;
     int line;
     double speed;
@@ -60,6 +65,9 @@ namespace GCode {
     double distance;
 
   public:
+    // Commands buffered before a batch is planned
+    static const unsigned batchSize = 1 << 16;
+
     LinePlanner(const PlannerConfig &config);
     LinePlanner();
 
@@ -68,6 +76,17 @@ namespace GCode {
 
     void reset();
     void setConfig(const PlannerConfig &config);
+
+    // In batch mode commands are buffered and planned together when the
+    // program ends, synchronizes or the buffer fills.  Commands are output
+    // once they pass the same isFinal() test the streaming planner uses.
+    // Velocities are solved for the whole batch, so a few junctions can end
+    // up slightly faster than when planning each command as it arrives.
+    // threads = 0 uses all CPUs.
+    bool getBatch() const {return batch;}
+    void setBatch(bool batch, unsigned threads = 0);
+    void planBatch();
+
     void checkSoftLimits(const Axes &p);
     bool isEmpty() const;
     bool hasMove() const;
@@ -116,6 +135,10 @@ namespace GCode {
     bool isFinal(PlannerCommand *cmd) const;
     void plan(PlannerCommand *cmd);
     bool planOne(PlannerCommand *cmd);
+    void planProfile(LineCommand &lc, double Vi, double Vt, double length,
+                     bool swapped) const;
+    double junctionLimit(const LineCommand &lc) const;
+    void limitVelocity(const LineCommand &lc, double &Vi, double &Vt) const;
 
     bool isAccelLimited(double Vi, double Vt, double maxAccel,
                         double maxJerk) const;
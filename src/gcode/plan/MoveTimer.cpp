@@ -0,0 +1,246 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "MoveTimer.h"
+#include "LinePlanner.h"
+#include "LineCommand.h"
+
+#include <gcode/ToolPath.h>
+
+#include <cbang/Exception.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/log/Logger.h>
+
+#include <limits>
+#include <cmath>
+
+using namespace std;
+using namespace cb;
+using namespace GCode;
+
+
+namespace {
+  bool hasExtraAxes(const Axes &axes) {
+    for (unsigned i = 3; i < Axes::getSize(); i++)
+      if (axes[i]) return true;
+
+    return false;
+  }
+}
+
+
+MoveTimer::MoveTimer(ToolPath &path, const PlannerConfig &config) :
+  path(path), config(config) {
+  // Keep the path geometry, one planned line per move
+  this->config.maxMergeLength = 0;
+  this->config.maxBlendError = 0;
+
+  batch.lines.reserve(batchSize);
+  thread = std::thread(&MoveTimer::run, this);
+}
+
+
+MoveTimer::~MoveTimer() {
+  close();
+  if (thread.joinable()) thread.join();
+}
+
+
+bool MoveTimer::finish() {
+  if (finished) return error.empty();
+  finished = true;
+
+  close();
+  thread.join();
+
+  if (!error.empty()) {
+    LOG_WARNING("Planning move times failed, using feed rate estimates: "
+                << error);
+    return false;
+  }
+
+  // Path was filled elsewhere, for example from the path cache
+  if (times.size() != path.size()) return false;
+
+  for (unsigned i = 0; i < times.size(); i++)
+    if (std::isnan(times[i])) {
+      // Too short for the planner, keep the feed rate estimate
+      times[i] = path.getTime(i);
+      entryVels[i] = exitVels[i] = i ? exitVels[i - 1] : 0;
+    }
+
+  path.setPlan(times, entryVels, exitVels);
+
+  return true;
+}
+
+
+void MoveTimer::move(Move &move) {
+  path.move(move);
+
+  const Axes &start = move.getStart();
+  const Axes &end = move.getEnd();
+
+  Line line;
+  line.start = start.getXYZ();
+  line.end = end.getXYZ();
+  line.feed = move.getFeed();
+  line.flags = move.getType() == MoveType::MOVE_RAPID ? RAPID_FLAG : 0;
+
+  if (hasExtraAxes(start) || hasExtraAxes(end)) {
+    line.flags |= EXTRA_FLAG;
+    batch.extra.push_back(start);
+    batch.extra.push_back(end);
+  }
+
+  batch.lines.push_back(line);
+  if (batchSize <= batch.lines.size()) flush();
+}
+
+
+void MoveTimer::flush() {
+  if (batch.lines.empty()) return;
+
+  SmartLock lock(this);
+
+  // Wait for the planner to catch up so memory use stays bounded
+  while (maxBatches <= batches.size() && !closed) wait();
+
+  batches.push_back(Batch());
+  batches.back().lines.swap(batch.lines);
+  batches.back().extra.swap(batch.extra);
+  batch.lines.reserve(batchSize);
+  signal();
+}
+
+
+void MoveTimer::close() {
+  flush();
+
+  SmartLock lock(this);
+  closed = true;
+  signal();
+}
+
+
+bool MoveTimer::next(Batch &lines) {
+  SmartLock lock(this);
+
+  lines.lines.clear();
+  lines.extra.clear();
+  while (batches.empty() && !closed) wait();
+  if (batches.empty()) return false;
+
+  lines.lines.swap(batches.front().lines);
+  lines.extra.swap(batches.front().extra);
+  batches.pop_front();
+  signal(); // Room for move()
+
+  return true;
+}
+
+
+void MoveTimer::run() {
+  try {
+    LinePlanner planner(config);
+    deque<unsigned> pending; // Moves sent to the planner, in order
+
+    auto drain = [&] () {
+      while (planner.hasMove()) {
+        const PlannerCommand &cmd = planner.next();
+        auto lc = dynamic_cast<const LineCommand *>(&cmd);
+
+        if (lc) {
+          if (pending.empty()) THROW("Planner output more lines than moves");
+
+          unsigned i = pending.front();
+          pending.pop_front();
+
+          times[i] = lc->getTime();
+          entryVels[i] = lc->getEntryVelocity();
+          exitVels[i] = lc->getExitVelocity();
+        }
+
+        planner.setActive(cmd.getID());
+      }
+    };
+
+    planner.start();
+
+    Batch lines;
+    while (next(lines)) {
+      unsigned extra = 0;
+
+      for (unsigned i = 0; i < lines.lines.size(); i++) {
+        const Line &line = lines.lines[i];
+        Axes start, end;
+
+        if (line.flags & EXTRA_FLAG) {
+          start = lines.extra[extra++];
+          end = lines.extra[extra++];
+
+        } else {
+          start.setXYZ(line.start);
+          end.setXYZ(line.end);
+        }
+
+        // The planner drops lines shorter than minTravel
+        if (config.minTravel <= (end - start).length())
+          pending.push_back(times.size());
+
+        times.push_back(numeric_limits<double>::quiet_NaN());
+        entryVels.push_back(0);
+        exitVels.push_back(0);
+
+        plan(planner, start, end, line.feed, line.flags & RAPID_FLAG);
+        drain();
+      }
+    }
+
+    planner.end();
+    drain();
+
+    if (!pending.empty())
+      THROW(pending.size() << " moves were not planned");
+
+  } catch (const Exception &e) {
+    error = e.getMessage();
+  } catch (const std::exception &e) {
+    error = e.what();
+  }
+
+  // Drop any moves left after a failure
+  Batch lines;
+  while (next(lines)) continue;
+}
+
+
+void MoveTimer::plan(LinePlanner &planner, const Axes &start,
+                     const Axes &end, double feed, bool rapid) {
+  if (planner.getPosition() != start) planner.setPosition(start);
+
+  int axes = 0;
+  for (unsigned i = 0; i < end.getSize(); i++)
+    if (end[i] != start[i])
+      axes |= MachineEnum::getVarType(Axes::toAxis(i));
+
+  if (!rapid) planner.setFeed(feed);
+  planner.move(end, axes, rapid, 0);
+}
@@ -0,0 +1,104 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include "PlannerConfig.h"
+
+#include <gcode/Axes.h>
+#include <gcode/MoveStream.h>
+
+#include <cbang/os/Condition.h>
+
+#include <vector>
+#include <deque>
+#include <cinttypes>
+#include <string>
+#include <thread>
+
+
+namespace GCode {
+  class ToolPath;
+  class LinePlanner;
+
+  // Passes moves on to a ToolPath and plans them on a background thread.
+  // finish() replaces the feed rate based move times with planned times and
+  // records the planned entry and exit velocities.  Merging and blending are
+  // disabled so every move is planned as exactly one line.
+  class MoveTimer : public MoveStream, public cb::Condition {
+    enum {
+      RAPID_FLAG = 1 << 0,
+      EXTRA_FLAG = 1 << 1, // Full start and end axes are in Batch::extra
+    };
+
+    // Only XYZ, most programs never move ABCUVW
+    struct Line {
+      cb::Vector3D start;
+      cb::Vector3D end;
+      double feed;
+      uint8_t flags;
+    };
+
+    struct Batch {
+      std::vector<Line> lines;
+      std::vector<Axes> extra; // Start and end of each EXTRA_FLAG line
+    };
+
+    ToolPath &path;
+    PlannerConfig config;
+
+    Batch batch;
+    std::deque<Batch> batches;
+    bool closed = false;
+    bool finished = false;
+
+    std::thread thread;
+    std::string error;
+
+    // Planner results, one per move
+    std::vector<double> times;
+    std::vector<double> entryVels;
+    std::vector<double> exitVels;
+
+  public:
+    static const unsigned batchSize = 4096;
+    static const unsigned maxBatches = 16; // move() blocks beyond this
+
+    MoveTimer(ToolPath &path, const PlannerConfig &config = PlannerConfig());
+    ~MoveTimer();
+
+    const PlannerConfig &getConfig() const {return config;}
+
+    // Wait for the planner and annotate the path.  Returns false and leaves
+    // the path unchanged if planning failed.  Later calls do nothing.
+    bool finish();
+
+    // From MoveStream
+    void move(Move &move);
+
+  protected:
+    void flush();
+    void close();
+    bool next(Batch &lines);
+    void run();
+    void plan(LinePlanner &planner, const Axes &start, const Axes &end,
+              double feed, bool rapid);
+  };
+}
@@ -88,6 +88,13 @@ bool Planner::hasMore() {
     }
 
     if (planner.hasMove()) return true;
+
+    // Output batched commands before waiting on synchronization
+    if (isSynchronizing() && planner.getBatch()) {
+      planner.planBatch();
+      if (planner.hasMove()) return true;
+    }
+
     if (isSynchronizing() || runners.empty()) return false;
 
     Runner &runner = *runners.front();
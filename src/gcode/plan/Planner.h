@@ -67,6 +67,8 @@ namespace GCode {
     void setPosition(const Axes &position);
 
     void setConfig(const PlannerConfig &config);
+    bool getBatch() const {return planner.getBatch();}
+    void setBatch(bool batch) {planner.setBatch(batch);}
 
     void setResolver(const cb::SmartPointer<NameResolver> &resolver)
     {this->resolver = resolver;}
@@ -24,6 +24,7 @@
 #include <cbang/Math.h>
 
 #include <limits>
+#include <cmath>
 
 using namespace std;
 
@@ -90,14 +91,24 @@ namespace GCode {
         THROW("Distance " << d << " beyond max time " << maxT <<
                " with max distance " << maxD);
 
-      // Newton–Raphson method to find solution within tolerance
+      // Newton–Raphson method to find solution within tolerance.  Steps
+      // which leave the bracket [lo, hi] fall back to bisection.
+      double lo = 0;
+      double hi = maxT;
       double t = 0.5 * maxT; // Initial guess
 
-      while (true) {
+      for (unsigned i = 0; i < 100; i++) {
         double x = distance(t, v, a, j) - d;
-        if (near(x, 0, tolerance)) return t;
-        t -= x / (v + velocity(t, a, j));
+        if (near(x, 0, tolerance)) break;
+
+        if (x < 0) lo = t;
+        else hi = t;
+
+        double next = t - x / (v + velocity(t, a, j));
+        t = lo < next && next < hi ? next : 0.5 * (lo + hi);
       }
+
+      return t;
     }
 
 
@@ -120,5 +131,112 @@ namespace GCode {
 
       return t;
     }
+
+
+    double transitionLength(double Vi, double Vt, double maxAccel,
+                            double maxJerk) {
+      // With constant acceleration segment
+      if (Vi + square(maxAccel) / maxJerk < cb::Math::nextDown(Vt))
+        return (Vi + Vt) * (square(maxAccel) + maxJerk * (Vt - Vi)) /
+          (2 * maxAccel * maxJerk);
+
+      // With out constant acceleration
+      return sqrt(Vt - Vi) * (Vi + Vt) / sqrt(maxJerk);
+    }
+
+
+    double transitionLengthDerivative(double Vi, double Vt, double maxAccel,
+                                      double maxJerk) {
+      // d/dVt of transitionLength()
+      if (Vi + square(maxAccel) / maxJerk < cb::Math::nextDown(Vt))
+        return (square(maxAccel) + 2 * maxJerk * Vt) /
+          (2 * maxAccel * maxJerk);
+
+      return (3 * Vt - Vi) / (2 * sqrt(maxJerk) * sqrt(Vt - Vi));
+    }
+
+
+    double peakAccelFromLength(double Vi, double jerk, double length) {
+      // Solves 1 / Jm^2 * Ap^3 + 2 * Vi / Jm * Ap - L = 0 for Ap.  See
+      // LinePlanner::peakAccelFromLength() for the derivation.
+      if (jerk < 0 && jerk <= -cube(Vi) / square(length))
+        return -square(Vi) / length; // Peak accel when Vt = 0
+
+      double q = 0.5 * length * square(jerk);
+      double r = 2.0 / 3.0 * Vi * jerk;
+      double d = square(q) + cube(r);
+
+      // One real root, Cardano's formula with real cube roots
+      if (0 <= d) {
+        double s = sqrt(d);
+        return cbrt(q + s) + cbrt(q - s);
+      }
+
+      // Three real roots, only possible when jerk < 0.  This is the root the
+      // principal complex cube roots of Cardano's formula give.
+      return 2 * sqrt(-r) * cos(acos(q / sqrt(-cube(r))) / 3);
+    }
+
+
+    double peakVelocity(double Vi, double Vt, double maxVel, double maxAccel,
+                        double maxJerk, double length) {
+      auto excess = [&] (double V) {
+        return transitionLength(Vi, V, maxAccel, maxJerk) +
+          transitionLength(Vt, V, maxAccel, maxJerk) - length;
+      };
+
+      if (excess(maxVel) <= 0) return maxVel;
+      if (0 < excess(Vt)) return Vt;
+
+      // Closed form when entry and exit velocities are equal, as for rapids
+      // between stops or cuts between equal junction velocities
+      if (Vi == Vt) {
+        double A2 = square(maxAccel);
+        double V;
+
+        // Accelerate over half the length without constant acceleration.
+        // With u = sqrt(V - Vi) solve u^3 + 2 * Vi * u - c = 0.
+        double c = 0.5 * length * sqrt(maxJerk);
+        double p = 2.0 / 3.0 * Vi;
+        double s = sqrt(square(0.5 * c) + cube(p));
+        double u = cbrt(0.5 * c + s) + cbrt(0.5 * c - s);
+        V = Vi + square(u);
+
+        // With constant acceleration segment, solve the quadratic
+        //   Jm * V^2 + As^2 * V + As^2 * Vi - Jm * Vi^2 - As * Jm * L = 0
+        if (A2 / maxJerk < V - Vi) {
+          double b = A2;
+          double k = A2 * Vi - maxJerk * square(Vi) - maxAccel * maxJerk *
+            length;
+          V = (-b + sqrt(square(b) - 4 * maxJerk * k)) / (2 * maxJerk);
+        }
+
+        if (isfinite(V) && Vt <= V && V <= maxVel && fabs(excess(V)) <=
+            1e-9 * length) return V;
+      }
+
+      // Newton–Raphson bracketed by [lo, hi], falls back to bisection
+      double lo = Vt;
+      double hi = maxVel;
+      double V = maxVel;
+
+      for (unsigned i = 0; i < 64; i++) {
+        double x = excess(V);
+
+        if (x <= 0) lo = V;
+        else hi = V;
+
+        if (fabs(x) <= 1e-9 * length) return V;
+        if (hi - lo <= 1e-12 * hi) break;
+
+        double dx = transitionLengthDerivative(Vi, V, maxAccel, maxJerk) +
+          transitionLengthDerivative(Vt, V, maxAccel, maxJerk);
+        double next = V - x / dx;
+
+        V = lo < next && next < hi ? next : 0.5 * (lo + hi);
+      }
+
+      return lo; // Known to fit
+    }
   }
 }
@@ -41,5 +41,20 @@ namespace GCode {
                           double tolerance = 1e-7);
     double timeAtVelocity(double iV, double tV, double a, double j,
                           double tolerance = 1e-20);
+
+    // Length needed to change velocity from Vi up to Vt
+    double transitionLength(double Vi, double Vt, double maxAccel,
+                            double maxJerk);
+    double transitionLengthDerivative(double Vi, double Vt, double maxAccel,
+                                      double maxJerk);
+
+    // Peak acceleration of a ramp up, ramp down over length
+    double peakAccelFromLength(double Vi, double jerk, double length);
+
+    // Highest velocity, at most maxVel, reachable from Vi which can still
+    // decelerate to Vt within length.  Vi <= Vt and the transition from Vi to
+    // Vt must fit.
+    double peakVelocity(double Vi, double Vt, double maxVel, double maxAccel,
+                        double maxJerk, double length);
   }
 }
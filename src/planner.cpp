@@ -48,6 +48,7 @@ using namespace GCode;
 class PlannerApp : public CAMotics::CommandLineApp {
   PlannerConfig config;
   bool gcode = false;
+  bool batch = false;
   unsigned precision = 4;
 
 public:
@@ -58,6 +59,8 @@ public:
     cmdLine.addTarget("gcode", gcode, "Output GCode instead of plan JSON");
     cmdLine.addTarget("precision", precision,
                       "Decimal places in output numbers");
+    cmdLine.addTarget("batch", batch, "Plan the whole program in parallel "
+                      "batches instead of one command at a time");
 
     Logger::instance().setScreenStream(cerr);
   }
@@ -91,6 +94,7 @@ public:
     MachinePipeline pipeline;
 
     Planner planner;
+    planner.setBatch(batch);
     planner.load(source, config, String::endsWith(source.getName(), ".tpl"));
 
     SmartPointer<JSON::Writer> writer;
@@ -18,6 +18,8 @@
 
 \******************************************************************************/
 
+#include "python/PyBatchSimulator.h"
+#include "python/PyBuffer.h"
 #include "python/PyPlanner.h"
 #include "python/PySimulation.h"
 #include "python/PyLogger.h"
@@ -110,8 +112,10 @@ PyMODINIT_FUNC PyInit_camotics() {
   PyObject *mod = PyModule_Create(&module);
   if (!mod) return 0;
 
-  addType(mod, "Planner",    &PlannerType);
-  addType(mod, "Simulation", &SimulationType);
+  addType(mod, "BatchSimulator", &BatchSimulatorType);
+  addType(mod, "Buffer",         &BufferType);
+  addType(mod, "Planner",        &PlannerType);
+  addType(mod, "Simulation",     &SimulationType);
 
   CAMotics::BuildInfo::addBuildInfo("CAMotics");
   cb::Version version(cb::Info::instance().get("CAMotics", "Version"));
@@ -0,0 +1,435 @@
+/******************************************************************************\
+
+             CAMotics is an Open-Source simulation and CAM software.
+     Copyright (C) 2011-2021 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+       This program is free software: you can redistribute it and/or modify
+       it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 2 of the License, or
+                       (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+                   GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "PyBatchSimulator.h"
+#include "PySimulation.h"
+#include "PyPtr.h"
+#include "SmartPyGIL.h"
+#include "Catch.h"
+
+#include <camotics/ThreadPool.h>
+#include <camotics/sim/Simulation.h>
+#include <camotics/sim/SimulationRun.h>
+#include <camotics/sim/ToolPathTask.h>
+#include <camotics/project/Project.h>
+
+#include <cbang/Catch.h>
+#include <cbang/os/Thread.h>
+#include <cbang/os/Condition.h>
+#include <cbang/util/SmartLock.h>
+
+#include <deque>
+#include <set>
+#include <limits>
+#include <algorithm>
+
+using namespace CAMotics;
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  // One simulation in a batch.  compute() is called without the GIL, the
+  // constructor, finish() and the destructor must hold it.  The constructor
+  // takes everything compute() needs from the project so the worker never
+  // touches the Simulation.
+  class Job : public Task {
+    PyPtr sim;
+    SimulationState &state;
+    SmartPointer<GCode::ToolPath> path;
+    SmartPointer<ToolPathTask> pathTask;
+    SmartPointer<Surface> surface;
+    Project::Workpiece workpiece;
+    ResolutionMode resolutionMode;
+    double resolution;
+    double time;
+    bool reduce;
+    bool cache;
+    unsigned threads;
+    bool started = false;
+
+  public:
+    Job(PyObject *sim, SimulationState &state, double time, bool reduce,
+        bool cache, unsigned threads) :
+      sim(sim), state(state), path(state.path),
+      workpiece(state.project.getWorkpiece()),
+      resolutionMode(state.project.getResolutionMode()),
+      resolution(state.project.getResolution()), time(time), reduce(reduce),
+      cache(cache), threads(threads) {
+      if (path.isNull()) pathTask = new ToolPathTask(state.project);
+      state.batched = true;
+    }
+
+    ~Job() {state.batched = false;}
+
+    PyObject *getSimulation() {return sim.get();}
+
+
+    bool compute() {
+      if (path.isNull()) {
+        if (!startPathTask()) return false;
+        pathTask->run();
+        path = pathTask->getPath();
+      }
+
+      if (shouldQuit() || path.isNull()) return false;
+
+      workpiece.update(*path);
+      cb::Rectangle3D bounds = workpiece.getBounds();
+      if (resolutionMode != ResolutionMode::RESOLUTION_MANUAL)
+        resolution =
+          Project::Project::computeResolution(resolutionMode, bounds);
+
+      CAMotics::Simulation simulation(path, 0, 0, bounds, resolution, time,
+                                      RenderMode(), threads);
+      simulation.cache = cache;
+
+      surface = SimulationRun(simulation).compute(*this);
+      if (surface.isSet() && reduce) surface->reduce(*this);
+
+      return surface.isSet() && !shouldQuit();
+    }
+
+
+    void finish(bool success) {
+      if (!success) return;
+      state.path = path;
+      state.surface = surface;
+      state.project.getWorkpiece().update(*path);
+    }
+
+
+    // From Task
+    void interrupt() {
+      SmartLock lock(this);
+      Task::interrupt();
+      if (started && pathTask.isSet()) pathTask->interrupt();
+    }
+
+  protected:
+    bool startPathTask() {
+      SmartLock lock(this);
+      started = true;
+      return !shouldQuit();
+    }
+  };
+
+
+  // Runs at most a fixed number of jobs at once.  The surfaces are rendered
+  // on the shared ThreadPool, which is never resized here, so the jobs mostly
+  // overlap the serial parts of each other, such as tool path interpretation.
+  // The GIL is always taken before the lock.
+  class Batch : public Condition {
+    class Runner : public Thread {
+      Batch &batch;
+
+    public:
+      Runner(Batch &batch) : batch(batch) {}
+
+      // From Thread
+      void run() {batch.work();}
+    };
+
+    vector<SmartPointer<Runner> > runners;
+    deque<SmartPointer<Job> > queue;
+    set<Job *> running;
+    unsigned outstanding = 0;
+    bool shutdown = false;
+
+    PyPtr done;
+
+  public:
+    Batch(unsigned jobs, PyObject *done) : done(done) {
+      for (unsigned i = 0; i < jobs; i++) {
+        runners.push_back(new Runner(*this));
+        runners.back()->start();
+      }
+    }
+
+
+    void add(PyObject *sim, double time, bool reduce, bool cache) {
+      SimulationState *state = getSimulationState(sim);
+      if (!state) THROW("Expected a Simulation object");
+      if (state->task.isSet() && state->task->isRunning())
+        THROW("Simulation has an active task");
+      if (state->batched) THROW("Simulation is already in a batch");
+
+      SmartPointer<Job> job =
+        new Job(sim, *state, time, reduce, cache,
+                ThreadPool::instance().getThreads());
+
+      SmartLock lock(this);
+      if (shutdown) THROW("Batch simulator stopped");
+
+      queue.push_back(job);
+      outstanding++;
+      broadcast();
+    }
+
+
+    bool isRunning() {
+      SmartLock lock(this);
+      return outstanding;
+    }
+
+
+    void wait() {
+      Py_BEGIN_ALLOW_THREADS;
+      lock();
+      while (outstanding) Condition::wait();
+      unlock();
+      Py_END_ALLOW_THREADS;
+    }
+
+
+    // Queued jobs are dropped and reported as failed
+    void interrupt() {
+      deque<SmartPointer<Job> > dropped;
+
+      lock();
+      dropped.swap(queue);
+      for (auto it = running.begin(); it != running.end(); it++)
+        (*it)->interrupt();
+      unlock();
+
+      for (unsigned i = 0; i < dropped.size(); i++)
+        callDone(dropped[i]->getSimulation(), false);
+
+      SmartLock lock(this);
+      outstanding -= dropped.size();
+      broadcast();
+    }
+
+
+    void stop() {
+      interrupt();
+
+      lock();
+      shutdown = true;
+      broadcast();
+      unlock();
+
+      Py_BEGIN_ALLOW_THREADS;
+      for (unsigned i = 0; i < runners.size(); i++) runners[i]->join();
+      Py_END_ALLOW_THREADS;
+    }
+
+
+  protected:
+    void work() {
+      while (true) {
+        SmartPointer<Job> job;
+
+        lock();
+        while (queue.empty() && !shutdown) Condition::wait();
+
+        if (!queue.empty()) {
+          job = queue.front();
+          queue.pop_front();
+          running.insert(job.get());
+        }
+        unlock();
+
+        if (job.isNull()) break; // Shutdown
+
+        bool success = false;
+        try {
+          success = job->compute();
+        } CATCH_ERROR;
+
+        SmartPyGIL gil;
+        job->finish(success);
+        callDone(job->getSimulation(), success);
+
+        SmartLock lock(this);
+        running.erase(job.get());
+        job.release(); // Releases the Simulation, needs the GIL
+        outstanding--;
+        broadcast();
+      }
+    }
+
+
+    void callDone(PyObject *sim, bool success) {
+      if (!done) return;
+
+      PyObject *result = PyObject_CallFunction
+        (done.get(), "OO", sim, success ? Py_True : Py_False);
+
+      if (result) Py_DECREF(result);
+      else PyErr_Print();
+    }
+  };
+
+
+  typedef struct {
+    PyObject_HEAD;
+    Batch *batch;
+  } PyBatchSimulator;
+
+
+  void _dealloc(PyBatchSimulator *self) {
+    if (self->batch) {
+      TRY_CATCH_ERROR(self->batch->stop());
+      delete self->batch;
+    }
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+  }
+
+
+  PyObject *_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    return type->tp_alloc(type, 0);
+  }
+
+
+  int _init(PyBatchSimulator *self, PyObject *args, PyObject *kwds) {
+    try {
+      const char *kwlist[] = {"jobs", "done", 0};
+      unsigned jobs = 0;
+      PyObject *done = 0;
+
+      if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IO", (char **)kwlist,
+                                       &jobs, &done))
+        return -1;
+
+      if (done == Py_None) done = 0;
+      if (done && !PyCallable_Check(done))
+        THROW("``done`` object not callable");
+
+      // One job in flight per pool worker by default
+      if (!jobs) jobs = ThreadPool::instance().getThreads();
+
+      self->batch = new Batch(jobs, done);
+      return 0;
+    } CATCH_PYTHON;
+
+    return -1;
+  }
+
+
+  PyObject *_add(PyBatchSimulator *self, PyObject *args, PyObject *kwds) {
+    try {
+      const char *kwlist[] = {"simulation", "time", "reduce", "cache", 0};
+      PyObject *sim = 0;
+      double time = 0;
+      int reduce = false;
+      int cache = true;
+
+      if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|dpp", (char **)kwlist,
+                                       &sim, &time, &reduce, &cache))
+        return 0;
+
+      if (!time) time = numeric_limits<double>::max();
+
+      self->batch->add(sim, time, reduce, cache);
+
+      Py_RETURN_NONE;
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
+  PyObject *_is_running(PyBatchSimulator *self) {
+    try {
+      if (self->batch->isRunning()) Py_RETURN_TRUE;
+      else Py_RETURN_FALSE;
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
+  PyObject *_wait(PyBatchSimulator *self) {
+    try {
+      self->batch->wait();
+      Py_RETURN_NONE;
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
+  PyObject *_interrupt(PyBatchSimulator *self) {
+    try {
+      self->batch->interrupt();
+      Py_RETURN_NONE;
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
+  PyMethodDef _methods[] = {
+    {"add", (PyCFunction)_add, METH_VARARGS | METH_KEYWORDS,
+     "Queue a Simulation.  The tool path is computed first if not set.  On "
+     "success the Simulation's path and surface are replaced."},
+    {"is_running", (PyCFunction)_is_running, METH_NOARGS,
+     "Returns true if any jobs are queued or running."},
+    {"wait", (PyCFunction)_wait, METH_NOARGS, "Wait for all jobs."},
+    {"interrupt", (PyCFunction)_interrupt, METH_NOARGS,
+     "Interrupt running jobs and drop queued jobs."},
+    {0}
+  };
+}
+
+
+PyTypeObject BatchSimulatorType = {
+  PyVarObject_HEAD_INIT(0, 0)
+  "BatchSimulator",          // tp_name
+  sizeof(PyBatchSimulator),  // tp_basicsize
+  0,                         // tp_itemsize
+  (destructor)_dealloc,      // tp_dealloc
+  0,                         // tp_print
+  0,                         // tp_getattr
+  0,                         // tp_setattr
+  0,                         // tp_reserved
+  0,                         // tp_repr
+  0,                         // tp_as_number
+  0,                         // tp_as_sequence
+  0,                         // tp_as_mapping
+  0,                         // tp_hash
+  0,                         // tp_call
+  0,                         // tp_str
+  0,                         // tp_getattro
+  0,                         // tp_setattro
+  0,                         // tp_as_buffer
+  Py_TPFLAGS_DEFAULT |
+  Py_TPFLAGS_BASETYPE,       // tp_flags
+  "Runs many simulations on a shared thread pool",  // tp_doc
+  0,                         // tp_traverse
+  0,                         // tp_clear
+  0,                         // tp_richcompare
+  0,                         // tp_weaklistoffset
+  0,                         // tp_iter
+  0,                         // tp_iternext
+  _methods,                  // tp_methods
+  0,                         // tp_members
+  0,                         // tp_getset
+  0,                         // tp_base
+  0,                         // tp_dict
+  0,                         // tp_descr_get
+  0,                         // tp_descr_set
+  0,                         // tp_dictoffset
+  (initproc)_init,           // tp_init
+  0,                         // tp_alloc
+  _new,                      // tp_new
+};
@@ -0,0 +1,126 @@
+/******************************************************************************\
+
+             CAMotics is an Open-Source simulation and CAM software.
+     Copyright (C) 2011-2021 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+       This program is free software: you can redistribute it and/or modify
+       it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 2 of the License, or
+                       (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+                   GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "PyBuffer.h"
+
+
+namespace {
+  typedef struct {
+    PyObject_HEAD;
+    BufferOwner *owner;
+    const void *data;
+    const char *format;
+    Py_ssize_t itemSize;
+    int ndim;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+  } PyBuffer;
+
+
+  void _dealloc(PyBuffer *self) {
+    if (self->owner) delete self->owner;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+  }
+
+
+  int _getbuffer(PyBuffer *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+      PyErr_SetString(PyExc_BufferError, "Buffer is read-only");
+      view->obj = 0;
+      return -1;
+    }
+
+    // Empty vectors may not have any storage
+    static char empty = 0;
+
+    view->obj = (PyObject *)self;
+    view->buf = (void *)(self->data ? self->data : &empty);
+    view->len = self->shape[0] * self->strides[0];
+    view->readonly = 1;
+    view->itemsize = self->itemSize;
+    view->format = (flags & PyBUF_FORMAT) ? (char *)self->format : 0;
+    view->ndim = self->ndim;
+    view->shape = (flags & PyBUF_ND) ? self->shape : 0;
+    view->strides =
+      (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : 0;
+    view->suboffsets = 0;
+    view->internal = 0;
+
+    Py_INCREF(self);
+
+    return 0;
+  }
+
+
+  Py_ssize_t _length(PyBuffer *self) {return self->shape[0];}
+
+
+  PyBufferProcs _buffer = {(getbufferproc)_getbuffer, 0};
+  PySequenceMethods _sequence = {(lenfunc)_length};
+}
+
+
+PyObject *createBuffer(BufferOwner *owner, const void *data,
+                       const char *format, Py_ssize_t itemSize,
+                       Py_ssize_t rows, Py_ssize_t cols) {
+  PyBuffer *self = (PyBuffer *)BufferType.tp_alloc(&BufferType, 0);
+  if (!self) {
+    delete owner;
+    return 0;
+  }
+
+  self->owner = owner;
+  self->data = data;
+  self->format = format;
+  self->itemSize = itemSize;
+  self->ndim = cols ? 2 : 1;
+  self->shape[0] = rows;
+  self->shape[1] = cols;
+  self->strides[0] = cols ? cols * itemSize : itemSize;
+  self->strides[1] = itemSize;
+
+  return (PyObject *)self;
+}
+
+
+PyTypeObject BufferType = {
+  PyVarObject_HEAD_INIT(0, 0)
+  "Buffer",                  // tp_name
+  sizeof(PyBuffer),          // tp_basicsize
+  0,                         // tp_itemsize
+  (destructor)_dealloc,      // tp_dealloc
+  0,                         // tp_print
+  0,                         // tp_getattr
+  0,                         // tp_setattr
+  0,                         // tp_reserved
+  0,                         // tp_repr
+  0,                         // tp_as_number
+  &_sequence,                // tp_as_sequence
+  0,                         // tp_as_mapping
+  0,                         // tp_hash
+  0,                         // tp_call
+  0,                         // tp_str
+  0,                         // tp_getattro
+  0,                         // tp_setattro
+  &_buffer,                  // tp_as_buffer
+  Py_TPFLAGS_DEFAULT,        // tp_flags
+  "Read-only view of CAMotics array data, use with memoryview() or "
+  "numpy.asarray()",         // tp_doc
+};
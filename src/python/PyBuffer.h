@@ -0,0 +1,69 @@
+/******************************************************************************\
+
+             CAMotics is an Open-Source simulation and CAM software.
+     Copyright (C) 2011-2021 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+       This program is free software: you can redistribute it and/or modify
+       it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 2 of the License, or
+                       (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+                   GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <Python.h>
+
+#include <cbang/SmartPointer.h>
+
+#include <vector>
+
+
+extern PyTypeObject BufferType;
+
+
+// Keeps the memory behind a Buffer alive
+class BufferOwner {
+public:
+  virtual ~BufferOwner() {}
+};
+
+
+template <typename T>
+class SmartBufferOwner : public BufferOwner {
+  cb::SmartPointer<T> ptr;
+
+public:
+  SmartBufferOwner(const cb::SmartPointer<T> &ptr) : ptr(ptr) {}
+};
+
+
+template <typename T>
+class VectorBufferOwner : public BufferOwner {
+public:
+  std::vector<T> data;
+};
+
+
+// Create a read-only buffer of rows x cols items, or a one dimensional buffer
+// if cols is zero.  format is a struct module format character.  The buffer
+// takes ownership of owner, even on error.
+PyObject *createBuffer(BufferOwner *owner, const void *data,
+                       const char *format, Py_ssize_t itemSize,
+                       Py_ssize_t rows, Py_ssize_t cols = 0);
+
+
+template <typename T>
+PyObject *createBuffer(BufferOwner *owner, const std::vector<T> &data,
+                       const char *format, Py_ssize_t cols = 0) {
+  Py_ssize_t rows = cols ? data.size() / cols : data.size();
+  return createBuffer(owner, data.data(), format, sizeof(T), rows, cols);
+}
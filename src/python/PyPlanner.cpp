@@ -117,6 +117,21 @@ namespace {
   }
 
 
+  PyObject *_set_batch(PyPlanner *self, PyObject *args) {
+    try {
+      int batch = true;
+
+      if (!PyArg_ParseTuple(args, "|p", &batch)) return 0;
+
+      self->planner->setBatch(batch);
+      Py_RETURN_NONE;
+
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
   PyObject *_load_string(PyPlanner *self, PyObject *args, PyObject *kwds) {
     try {
       GCode::PlannerConfig config;
@@ -273,6 +288,8 @@ namespace {
      "Set name resolver callback"},
     {"set_position", (PyCFunction)_set_position, METH_VARARGS,
      "Set planner position"},
+    {"set_batch", (PyCFunction)_set_batch, METH_VARARGS,
+     "Plan whole programs in parallel batches, for offline use"},
     {"load_string", (PyCFunction)_load_string, METH_VARARGS | METH_KEYWORDS,
      "Load GCode or TPL string"},
     {"load", (PyCFunction)_load, METH_VARARGS | METH_KEYWORDS,
@@ -20,18 +20,18 @@
 
 #include "PyPtr.h"
 #include "PySimulation.h"
+#include "PyBuffer.h"
 #include "PyJSON.h"
 #include "PyJSONSink.h"
 #include "PyLogger.h"
 #include "PyTask.h"
 #include "SmartPyGIL.h"
+#include "Throw.h"
 #include "Catch.h"
 
 #include <camotics/sim/Simulation.h>
 #include <camotics/sim/SimulationRun.h>
 #include <camotics/sim/ToolPathTask.h>
-#include <camotics/project/Project.h>
-#include <camotics/contour/Surface.h>
 
 #include <cbang/Catch.h>
 #include <cbang/os/SystemUtilities.h>
@@ -47,12 +47,7 @@ using namespace std;
 
 
 namespace {
-  struct Simulation {
-    Project::Project project;
-    SmartPointer<GCode::ToolPath> path;
-    SmartPointer<Surface> surface;
-    SmartPointer<PyTask> task;
-  };
+  typedef SimulationState Simulation;
 
 
   typedef struct {
@@ -89,6 +84,7 @@ namespace {
 
   void set_task(PySimulation *self, const SmartPointer<PyTask> &task) {
     if (self->s->task.isSet()) THROW("A task is already active");
+    if (self->s->batched) THROW("Simulation is in a BatchSimulator");
     self->s->task = task;
   }
 
@@ -318,8 +314,9 @@ namespace {
 
       public:
         Runner(PySimulation *self, const string &gcode, const string &tpl,
-               GCode::PlannerConfig *config) :
+               GCode::PlannerConfig *config, bool cache) :
           s(*self->s), gcode(gcode), tpl(tpl), task(s.project, config) {
+          task.setCache(cache);
           start();
         }
 
@@ -334,13 +331,15 @@ namespace {
         }
       };
 
-      const char *kwlist[] = {"gcode", "tpl", "config", 0};
+      const char *kwlist[] = {"gcode", "tpl", "config", "cache", 0};
       const char *gcode = 0;
       const char *tpl = 0;
       PyObject *config = 0;
+      int cache = false;
 
       if (!PyArg_ParseTupleAndKeywords
-          (args, kwds, "|ssO", (char **)kwlist, &gcode, &tpl, &config))
+          (args, kwds, "|ssOp", (char **)kwlist, &gcode, &tpl, &config,
+           &cache))
         return 0;
 
       if (gcode && tpl) THROW("Cannot set both ``gcode`` and ``tpl``");
@@ -349,7 +348,7 @@ namespace {
       if (config) planConfig.read(*PyJSON(config).toJSON());
 
       set_task(self, new Runner(self, gcode ? gcode : "", tpl ? tpl : "",
-                                config ? &planConfig : 0));
+                                config ? &planConfig : 0, cache));
 
       Py_RETURN_NONE;
     } CATCH_PYTHON;
@@ -366,7 +365,11 @@ namespace {
       if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", (char **)kwlist, &path))
         return 0;
 
-      self->s->path->read(*PyJSON(path).toJSON());
+      // Replace rather than modify the path, buffers may still refer to it
+      SmartPointer<GCode::ToolPath> p =
+        new GCode::ToolPath(self->s->project.getTools());
+      p->read(*PyJSON(path).toJSON());
+      self->s->path = p;
 
       Py_RETURN_NONE;
     } CATCH_PYTHON;
@@ -388,6 +391,147 @@ namespace {
   }
 
 
+  // Steals a reference to value
+  void set_item(PyObject *dict, const char *key, PyObject *value) {
+    if (!value) {
+      PyThrowIfError(string("Failed to create ") + key + ": ");
+      THROW("Failed to create " << key);
+    }
+
+    int err = PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+    if (err) PyThrowIfError(string("Failed to set ") + key + ": ");
+  }
+
+
+  PyObject *_get_path_arrays(PySimulation *self) {
+    try {
+      const SmartPointer<GCode::ToolPath> &path = self->s->path;
+      if (path.isNull()) THROW("Tool path not set");
+
+      static_assert(sizeof(Vector3D) == 3 * sizeof(double),
+                    "Vector3D is not packed");
+
+      PyObject *dict = PyDict_New();
+      if (!dict) return 0;
+
+      try {
+        typedef SmartBufferOwner<GCode::ToolPath> Owner;
+
+        const vector<Vector3D> &ends = path->getEndPts();
+        set_item(dict, "positions",
+                 createBuffer(new Owner(path), ends.data(), "d",
+                              sizeof(double), ends.size(), 3));
+        set_item(dict, "start_times",
+                 createBuffer(new Owner(path), path->getStartTimes(), "d"));
+        set_item(dict, "times",
+                 createBuffer(new Owner(path), path->getTimes(), "d"));
+        set_item(dict, "lines",
+                 createBuffer(new Owner(path), path->getLines(), "I"));
+
+        // Tools and feeds are run length encoded in the path
+        auto tools = new VectorBufferOwner<int32_t>;
+        path->getToolColumn(tools->data);
+        set_item(dict, "tools", createBuffer(tools, tools->data, "i"));
+
+        auto feeds = new VectorBufferOwner<double>;
+        path->getFeedColumn(feeds->data);
+        set_item(dict, "feeds", createBuffer(feeds, feeds->data, "d"));
+
+        return dict;
+
+      } catch (...) {
+        Py_DECREF(dict);
+        throw;
+      }
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
+  struct Mesh {
+    vector<float> vertices;
+    vector<float> normals;
+    vector<uint32_t> indices;
+  };
+
+
+  PyObject *_get_surface_arrays(PySimulation *self) {
+    try {
+      const SmartPointer<Surface> &surface = self->s->surface;
+      if (surface.isNull()) Py_RETURN_NONE;
+
+      // A single mesh is shared with the surface, composite surfaces are
+      // merged into a copy
+      const vector<float> *vertices = 0;
+      const vector<float> *normals = 0;
+      const vector<uint32_t> *indices = 0;
+      SmartPointer<Mesh> merged;
+
+      surface->getVertices(
+        [&] (const vector<float> &v, const vector<float> &n,
+             const vector<uint32_t> &i) {
+          if (v.size() != n.size())
+            THROW("Surface vertex and normal counts differ");
+
+          if (!vertices) {
+            vertices = &v;
+            normals = &n;
+            indices = &i;
+            return;
+          }
+
+          if (merged.isNull()) {
+            merged = new Mesh;
+            merged->vertices = *vertices;
+            merged->normals = *normals;
+            merged->indices = *indices;
+          }
+
+          uint32_t offset = merged->vertices.size() / 3;
+          merged->vertices.insert(merged->vertices.end(), v.begin(), v.end());
+          merged->normals.insert(merged->normals.end(), n.begin(), n.end());
+          for (unsigned j = 0; j < i.size(); j++)
+            merged->indices.push_back(offset + i[j]);
+        });
+
+      static const Mesh empty;
+      if (merged.isSet()) {
+        vertices = &merged->vertices;
+        normals = &merged->normals;
+        indices = &merged->indices;
+
+      } else if (!vertices) {
+        vertices = normals = &empty.vertices;
+        indices = &empty.indices;
+      }
+
+      auto owner = [&] () -> BufferOwner * {
+        if (merged.isSet()) return new SmartBufferOwner<Mesh>(merged);
+        return new SmartBufferOwner<Surface>(surface);
+      };
+
+      PyObject *dict = PyDict_New();
+      if (!dict) return 0;
+
+      try {
+        set_item(dict, "vertices", createBuffer(owner(), *vertices, "f", 3));
+        set_item(dict, "normals", createBuffer(owner(), *normals, "f", 3));
+        set_item(dict, "indices", createBuffer(owner(), *indices, "I", 3));
+
+        return dict;
+
+      } catch (...) {
+        Py_DECREF(dict);
+        throw;
+      }
+    } CATCH_PYTHON;
+
+    return 0;
+  }
+
+
   void call_done(PyPtr &done, bool success) {
     if (!done) return;
 
@@ -410,6 +554,7 @@ namespace {
         double time = 0;
         unsigned threads = 0;
         int reduce = false;
+        int cache = true;
         PyPtr done;
 
         SmartPointer<GCode::ToolPath> path;
@@ -421,13 +566,13 @@ namespace {
           s(*self->s) {
           try {
             const char *kwlist[] =
-              {"callback", "time", "threads", "reduce", "done", 0};
+              {"callback", "time", "threads", "reduce", "done", "cache", 0};
             PyObject *cb = 0;
             PyObject *done = 0;
 
             if (!PyArg_ParseTupleAndKeywords(
-                  args, kwds, "|OdIpO", (char **)kwlist, &cb, &time, &threads,
-                  &reduce, &done))
+                  args, kwds, "|OdIpOp", (char **)kwlist, &cb, &time,
+                  &threads, &reduce, &done, &cache))
               THROW("Invalid arguments");
 
             this->done = done;
@@ -457,6 +602,7 @@ namespace {
           try {
             CAMotics::Simulation
               sim(path, 0, 0, bounds, resolution, time, RenderMode(), threads);
+            sim.cache = cache;
 
             auto surface = SimulationRun(sim).compute(*this);
             if (reduce) surface->reduce(*this);
@@ -609,16 +755,22 @@ namespace {
     {"set_workpiece", (PyCFunction)_set_workpiece,
      METH_VARARGS | METH_KEYWORDS, "Set workpiece dimensions."},
     {"compute_path", (PyCFunction)_compute_path, METH_VARARGS | METH_KEYWORDS,
-     "Compute tool path"},
+     "Compute tool path.  With ``cache`` the project's GCode files are looked "
+     "up in and added to the tool path cache."},
     {"set_path", (PyCFunction)_set_path, METH_VARARGS | METH_KEYWORDS,
      "Set tool path."},
     {"get_path", (PyCFunction)_get_path, METH_NOARGS, ""},
+    {"get_path_arrays", (PyCFunction)_get_path_arrays, METH_NOARGS,
+     "Get tool path columns as read-only buffers, without copying."},
     {"start", (PyCFunction)_start, METH_VARARGS | METH_KEYWORDS,
      "Start a simulation run."},
     {"write_surface", (PyCFunction)_write_surface, METH_VARARGS | METH_KEYWORDS,
      "Write surface STL to named file."},
     {"get_surface", (PyCFunction)_get_surface, METH_VARARGS | METH_KEYWORDS,
      "Get surface as STL data or Python object."},
+    {"get_surface_arrays", (PyCFunction)_get_surface_arrays, METH_NOARGS,
+     "Get surface vertex, normal and index arrays as read-only buffers, "
+     "without copying."},
     {"is_running", (PyCFunction)_is_running, METH_NOARGS,
      "Returns true if a task is running."},
     {"wait", (PyCFunction)_wait, METH_NOARGS, "Wait on running task."},
@@ -670,3 +822,9 @@ PyTypeObject SimulationType = {
   0,                         // tp_alloc
   _new,                      // tp_new
 };
+
+
+SimulationState *getSimulationState(PyObject *obj) {
+  if (!PyObject_TypeCheck(obj, &SimulationType)) return 0;
+  return ((PySimulation *)obj)->s;
+}
@@ -20,6 +20,28 @@
 
 #pragma once
 
+#include "PyTask.h"
+
+#include <camotics/project/Project.h>
+#include <camotics/contour/Surface.h>
+
+#include <gcode/ToolPath.h>
+
+#include <cbang/SmartPointer.h>
+
 #include <Python.h>
 
 extern PyTypeObject SimulationType;
+
+
+struct SimulationState {
+  CAMotics::Project::Project project;
+  cb::SmartPointer<GCode::ToolPath> path;
+  cb::SmartPointer<CAMotics::Surface> surface;
+  cb::SmartPointer<PyTask> task;
+  bool batched = false; // Queued or running in a BatchSimulator, needs the GIL
+};
+
+
+// Returns null if obj is not a Simulation
+SimulationState *getSimulationState(PyObject *obj);
@@ -20,10 +20,19 @@
 
 #include "ClipperModule.h"
 
+#include <camotics/ThreadPool.h>
+
 #include <cbang/json/JSON.h>
+#include <cbang/os/Condition.h>
+#include <cbang/util/SmartLock.h>
 
 #include <clipper/Clipper.h>
 
+#include <vector>
+#include <string>
+#include <exception>
+
+using namespace std;
 using namespace cb;
 using namespace ClipperLib;
 using namespace tplang;
@@ -31,7 +40,9 @@ using namespace tplang;
 
 void ClipperModule::define(js::Sink &exports) {
   exports.insert("offset(polys, delta, join, limit=1000, autoFix=true, "
-                 "scale=1000000)", this, &ClipperModule::offsetCB);
+                 "scale=1000000, flat=false)", this, &ClipperModule::offsetCB);
+  exports.insert("offsets(polys, deltas, join, limit=1000, autoFix=true, "
+                 "scale=1000000, flat=false)", this, &ClipperModule::offsetsCB);
 
   exports.insert("JOIN_SQUARE", jtSquare);
   exports.insert("JOIN_ROUND", jtRound);
@@ -44,13 +55,132 @@ void ClipperModule::offsetCB(const js::Value &args, js::Sink &sink) {
 
   // Convert JavaScript polys to Clipper polys
   Polygons polys;
-  SmartPointer<js::Value> jsPolys = args.get("polys");
+  format_t format =
+    readPolys(*args.get("polys"), scale, args.getBoolean("flat"), polys);
+
+  double delta = args.getNumber("delta") * scale;
+  JoinType join =
+    args.has("join") ? (JoinType)args.getInteger("join") : jtRound;
+  double limit = args.getNumber("limit") * scale;
+  bool autoFix = args.getBoolean("autoFix");
+
+  polys.Offset(delta, join, limit, autoFix);
+
+  // Convert Clipper result back to JavaScript
+  writePolys(sink, polys, scale, format);
+}
+
+
+// Offsets the same polys by each delta in parallel.  Returns a list of
+// results, one per delta, in the format of the input polys.
+void ClipperModule::offsetsCB(const js::Value &args, js::Sink &sink) {
+  int scale = args.getInteger("scale");
+
+  Polygons polys;
+  format_t format =
+    readPolys(*args.get("polys"), scale, args.getBoolean("flat"), polys);
+
+  SmartPointer<js::Value> jsDeltas = args.get("deltas");
+  vector<double> deltas;
+  for (unsigned i = 0; i < jsDeltas->length(); i++)
+    deltas.push_back(jsDeltas->getNumber(i) * scale);
+
+  JoinType join =
+    args.has("join") ? (JoinType)args.getInteger("join") : jtRound;
+  double limit = args.getNumber("limit") * scale;
+  bool autoFix = args.getBoolean("autoFix");
+
+  vector<Polygons> results(deltas.size());
+
+  if (deltas.size() == 1)
+    polys.Offset(results[0], deltas[0], join, limit, autoFix);
+
+  else if (1 < deltas.size()) {
+    CAMotics::ThreadPool &pool = CAMotics::ThreadPool::instance();
+
+    Condition done;
+    unsigned outstanding = 0;
+    string error;
+
+    // The jobs reference locals so every queued job must finish first
+    auto wait = [&] () {
+      done.lock();
+      while (outstanding) done.timedWait(0.25);
+      done.unlock();
+    };
+
+    try {
+      for (unsigned i = 0; i < deltas.size(); i++) {
+        SmartLock lock(&done);
+
+        pool.add([&, i] (unsigned worker) {
+            string msg;
+
+            try {
+              polys.Offset(results[i], deltas[i], join, limit, autoFix);
+            } catch (const std::exception &e) {
+              msg = e.what();
+              if (msg.empty()) msg = "Offset failed";
+            } catch (...) {
+              msg = "Offset failed";
+            }
+
+            SmartLock lock(&done);
+            if (error.empty()) error = msg;
+            outstanding--;
+            done.signal();
+          });
+
+        // Counted only once queued, the lock keeps the job from finishing
+        outstanding++;
+      }
+    } catch (...) {
+      wait();
+      throw;
+    }
+
+    wait();
+
+    if (!error.empty()) THROW(error);
+  }
+
+  sink.beginList();
+  for (unsigned i = 0; i < results.size(); i++) {
+    sink.beginAppend();
+    writePolys(sink, results[i], scale, format);
+  }
+  sink.endList();
+}
+
+
+ClipperModule::format_t
+ClipperModule::readPolys(const js::Value &jsPolys, double scale, bool flat,
+                         Polygons &polys) {
+  // Two numbers per point instead of a list or dict holding them
+  if (flat) {
+    for (unsigned i = 0; i < jsPolys.length(); i++) {
+      SmartPointer<js::Value> jsPoly = jsPolys.get(i);
+      unsigned length = jsPoly->length();
+      if (length & 1) THROW("Flat poly has an odd number of coordinates");
+
+      polys.push_back(Polygon());
+      Polygon &poly = polys.back();
+      poly.reserve(length / 2);
+
+      for (unsigned j = 0; j < length; j += 2)
+        poly.push_back(IntPoint(jsPoly->getNumber(j) * scale,
+                                jsPoly->getNumber(j + 1) * scale));
+    }
+
+    return FLAT_FORMAT;
+  }
+
   bool dict = false;
 
-  for (unsigned i = 0; i < jsPolys->length(); i++) {
+  for (unsigned i = 0; i < jsPolys.length(); i++) {
     polys.push_back(Polygon());
     Polygon &poly = polys.back();
-    SmartPointer<js::Value> jsPoly = jsPolys->get(i);
+    SmartPointer<js::Value> jsPoly = jsPolys.get(i);
 
     for (unsigned j = 0; j < jsPoly->length(); j++) {
       SmartPointer<js::Value> jsPoint = jsPoly->get(j);
@@ -68,24 +198,25 @@ void ClipperModule::offsetCB(const js::Value &args, js::Sink &sink) {
     }
   }
 
-  double delta = args.getNumber("delta") * scale;
-  JoinType join =
-    args.has("join") ? (JoinType)args.getInteger("join") : jtRound;
-  double limit = args.getNumber("limit") * scale;
-  bool autoFix = args.getBoolean("autoFix");
+  return dict ? DICT_FORMAT : LIST_FORMAT;
+}
 
-  polys.Offset(delta, join, limit, autoFix);
 
-  // Convert Clipper result back to JavaScript
+void ClipperModule::writePolys(js::Sink &sink, const Polygons &polys,
+                               double scale, format_t format) {
   sink.beginList();
   for (unsigned i = 0; i < polys.size(); i++) {
-    Polygon &poly = polys[i];
+    const Polygon &poly = polys[i];
     sink.appendList();
 
     for (unsigned j = 0; j < poly.size(); j++) {
-      IntPoint &point = poly[j];
+      const IntPoint &point = poly[j];
+
+      if (format == FLAT_FORMAT) {
+        sink.append((double)point.X / scale);
+        sink.append((double)point.Y / scale);
 
-      if (dict) {
+      } else if (format == DICT_FORMAT) {
         sink.appendDict();
         sink.insert("x", (double)point.X / scale);
         sink.insert("y", (double)point.Y / scale);
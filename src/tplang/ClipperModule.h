@@ -23,6 +23,8 @@
 
 #include <cbang/js/NativeModule.h>
 
+#include <clipper/Polygons.h>
+
 
 namespace tplang {
   class ClipperModule : public cb::js::NativeModule {
@@ -34,5 +36,16 @@ namespace tplang {
 
     // Javascript call backs
     void offsetCB(const cb::js::Value &args, cb::js::Sink &sink);
+    void offsetsCB(const cb::js::Value &args, cb::js::Sink &sink);
+
+  protected:
+    // Points are {x, y} dicts or [x, y] lists, or if flat each poly is a
+    // single list of numbers [x0, y0, x1, y1, ...] like stl.contour() returns
+    enum format_t {LIST_FORMAT, DICT_FORMAT, FLAT_FORMAT};
+
+    format_t readPolys(const cb::js::Value &polys, double scale, bool flat,
+                       ClipperLib::Polygons &out);
+    void writePolys(cb::js::Sink &sink, const ClipperLib::Polygons &polys,
+                    double scale, format_t format);
   };
 }
@@ -26,14 +26,10 @@
 
 #include <cbang/io/InputSource.h>
 #include <cbang/os/SystemUtilities.h>
-#include <cbang/geom/Segment.h>
 #include <cbang/geom/Rectangle.h>
 #include <cbang/log/Logger.h>
 
-#include <limits>
-#include <list>
 #include <vector>
-#include <cmath>
 
 using namespace tplang;
 using namespace cb;
@@ -41,98 +37,6 @@ using namespace std;
 
 
 namespace {
-  bool isBetween(float level, float z1, float z2) {
-    return (z1 <= level && level <= z2) || (z2 <= level && level <= z1);
-  }
-
-
-  float distanceBetweenPoints(const Vector2F &p1, const Vector2F &p2) {
-    float distance = p1.distance(p2);
-    return distance < 0.001 ? 0 : distance;
-  }
-
-
-  bool findSegment(float level, const STL::Facet &f, Vector2F &p1,
-                   Vector2F &p2) {
-    // skip facets that lay on the "level" plane
-    if (f[0].z() == level && f[1].z() == level && f[2].z() == level)
-      return false;
-
-    // skip faces with an edge on the "level" plane and hang down
-    if ((f[0].z() == level && f[1].z() == level && f[2].z() < level) ||
-        (f[0].z() == level && f[2].z() == level && f[1].z() < level) ||
-        (f[1].z() == level && f[2].z() == level && f[0].z() < level))
-      return false;
-
-    bool p1Taken = false;
-    bool p2Taken = false;
-
-    if (isBetween(level, f[0].z(), f[1].z())) {
-      if (f[0].z() == f[1].z()) { // edge is on the plane
-        if (f[2].y() > level) return false;
-
-        p1 = f[0].slice<2>();
-        p2 = f[1].slice<2>();
-
-        return true;
-      }
-
-      float ratio = (level - f[1].z()) / (f[0].z() - f[1].z());
-      p1 = (f[1] + (f[0] - f[1]) * ratio).slice<2>();
-      p1Taken = true;
-    }
-
-    if (isBetween(level, f[1].z(), f[2].z())) {
-      if (f[1].z() == f[2].z()) { // edge is on the plane
-        if (f[0].y() > level) return false;
-
-        p1 = f[1].slice<2>();
-        p2 = f[2].slice<2>();
-
-        return true;
-      }
-
-      float ratio = (level - f[2].z()) / (f[1].z() - f[2].z());
-
-      if (!p1Taken) {
-        p1 = (f[2] + (f[1] - f[2]) * ratio).slice<2>();
-        p1Taken = true;
-
-      } else {
-        p2 = (f[2] + (f[1] - f[2]) * ratio).slice<2>();
-        p2Taken = true;
-      }
-    }
-
-    if (!p1Taken) return false;
-
-    if (isBetween(level, f[2].z(), f[0].z())) {
-      float ratio = (level - f[0].z()) / (f[2].z() - f[0].z());
-
-      if (!p2Taken) {
-        p2 = (f[0] + (f[2] - f[0]) * ratio).slice<2>();
-        p2Taken = true;
-      }
-    }
-
-    if (!p2Taken) return false;
-    return distanceBetweenPoints(p1, p2); // don't return single point segs
-  }
-
-
-  void swap(Vector2F &p1, Vector2F &p2) {
-    Vector2F temp = p1;
-    p1 = p2;
-    p2 = temp;
-  }
-
-
-  bool isEqual(float x, float y) {
-    if (y) return fabs((x - y) / y) < 0.00001;
-    return fabs(x) < 0.00001;
-  }
-
-
   void append(js::Sink &sink, const Vector2F &v) {
     sink.appendDict();
     sink.insert("X", v.x());
@@ -153,112 +57,54 @@ namespace {
   }
 
 
-  void readFacets(vector<STL::Facet> &out, const js::Value &in) {
+  // Facets are lists of three vertices and a normal, or flat lists of the
+  // same 12 numbers
+  void readFacets(STLSlicer &out, const js::Value &in) {
     unsigned length = in.length();
     STL::Facet f;
 
     for (unsigned i = 0; i < length; i++) {
       SmartPointer<js::Value> facet = in.get(i);
 
-      for (unsigned j = 0; j < 3; j++)
-        f[j] = toVector3F(*facet->get(j));
-
-      f.getNormal() = toVector3F(*facet->get(3));
-
-      out.push_back(f);
-    }
-  }
-
-
-  void contourLevel(js::Sink &sink, const vector<STL::Facet> &facets,
-                    float level) {
-    // Find segments
-    typedef list<Segment2F> segments_t;
-    segments_t segments;
-
-    for (unsigned i = 0; i < facets.size(); i++) {
-      const STL::Facet &f = facets[i];
-      Vector2F p1, p2;
-
-      if ((level < f[0].z() && level < f[1].z() && level < f[2].z()) ||
-          (f[0].z() < level && f[1].z() < level && f[2].z() < level))
-        continue;
-
-      if (findSegment(level, f, p1, p2)) {
-        if (isEqual(p1.x(), p2.x())) {
-          if (p1.y() < p2.y()) {
-            if (f.getNormal().x() < 0) swap(p1, p2);
-          } else if (0 < f.getNormal().x()) swap(p1, p2);
-
-        } else if (isEqual(p1.y(), p2.y())) {
-          if (p1.x() < p2.x()) {
-            if (0 < f.getNormal().y()) swap(p1, p2);
-          } else if (f.getNormal().y() < 0) swap(p1, p2);
-
-        } else if (p1.x() < p2.x() && p1.y() < p2.y()) {
-          if (f.getNormal().x() < 0) swap(p1, p2);
+      if (facet->get(0)->isNumber()) {
+        if (facet->length() != 12) THROW("Flat facet must have 12 numbers");
 
-        } else if (p2.x() < p1.x() && p2.y() < p1.y()) {
-          if (0 < f.getNormal().x()) swap(p1, p2);
-
-        } else if (p1.x() < p2.x() && p2.y() < p1.y()) {
-          if (0 < f.getNormal().x()) swap(p1, p2);
+        for (unsigned j = 0; j < 4; j++) {
+          Vector3F &v = j < 3 ? f[j] : f.getNormal();
+          for (unsigned k = 0; k < 3; k++) v[k] = facet->getNumber(j * 3 + k);
+        }
 
-        } else if (f.getNormal().x() < 0) swap(p1, p2);
+      } else {
+        for (unsigned j = 0; j < 3; j++)
+          f[j] = toVector3F(*facet->get(j));
 
-        Segment2F seg(p1, p2);
-        segments.push_back(seg);
+        f.getNormal() = toVector3F(*facet->get(3));
       }
+
+      out.add(f);
     }
+  }
 
-    // Link segments
-    bool inLoop = false;
-    Vector2F first;
-    Vector2F last;
 
+  // Flat contours are lists of numbers, x0, y0, x1, y1, ..., the flat poly
+  // form clipper's offset() takes
+  void writeContours(js::Sink &sink, const STLSlicer::contours_t &contours,
+                     bool flat) {
     sink.beginList();
 
-    while (!segments.empty()) {
-      // Start new loop
-      if (!inLoop) {
-        inLoop = true;
-        first = segments.begin()->getStart();
-        last = segments.begin()->getEnd();
-
-        sink.appendList();
-
-        append(sink, first);
-        append(sink, last);
+    for (unsigned i = 0; i < contours.size(); i++) {
+      const STLSlicer::loop_t &loop = contours[i];
 
-        segments.erase(segments.begin());
-      }
-
-      // Find next closest segment
-      float best = numeric_limits<float>::max();
-      segments_t::iterator closestIt = segments.end();
+      sink.appendList();
 
-      segments_t::iterator it;
-      for (it = segments.begin(); it != segments.end(); it++) {
-        float dist = distanceBetweenPoints(last, it->getStart());
-
-        if (dist < best) {
-          closestIt = it;
-          best = dist;
-        }
-      }
+      for (unsigned j = 0; j < loop.size(); j++)
+        if (flat) {
+          sink.append(loop[j].x());
+          sink.append(loop[j].y());
 
-      // Add it
-      if (closestIt != segments.end()) {
-        last = closestIt->getEnd();
-        append(sink, last);
-        segments.erase(closestIt);
-      }
+        } else append(sink, loop[j]);
 
-      // Detect end of loop
-      if (segments.empty() || !distanceBetweenPoints(last, first)) {
-        sink.endList();
-        inLoop = false;
-      }
+      sink.endList();
     }
 
     sink.endList();
@@ -270,13 +116,26 @@ STLModule::STLModule(TPLContext &ctx) : js::NativeModule("stl"), ctx(ctx) {}
 
 
 void STLModule::define(js::Sink &exports) {
-  exports.insert("open(path)", this, &STLModule::open);
+  exports.insert("open(path, facets=false, flat=false)", this,
+                 &STLModule::open);
   exports.insert("bounds(stl)", this, &STLModule::bounds);
-  exports.insert("contour(stl, level, start, end, steps)", this,
+  exports.insert("contour(stl, level, start, end, steps, flat=false)", this,
                  &STLModule::contour);
+  exports.insert("close(stl)", this, &STLModule::close);
 }
 
 
+/***
+ * Reads an STL file.  The facets are kept in native memory and referenced
+ * by the returned handle:
+ *
+ *   {name: name, hash: hash, handle: n, count: facets}
+ *
+ * If "facets" is true the facets are also returned as a list of
+ * [[x, y, z], [x, y, z], [x, y, z], [nx, ny, nz]], or if "flat" is true as
+ * a list of [x1, y1, z1, x2, y2, z2, x3, y3, z3, nx, ny, nz].  Facets built
+ * by a script may use either form.  close() frees the mesh.
+ */
 void STLModule::open(const js::Value &args, js::Sink &sink) {
   // Read STL
   STL::Reader reader(ctx.relativePath(args.getString("path")));
@@ -286,40 +145,53 @@ void STLModule::open(const js::Value &args, js::Sink &sink) {
   string hash;
   reader.readHeader(name, hash);
 
+  SmartPointer<STLSlicer> slicer = new STLSlicer;
+
+  while (reader.hasMore()) {
+    Vector3F v[3];
+    Vector3F normal;
+    reader.readFacet(v[0], v[1], v[2], normal);
+    slicer->add(STL::Facet(v[0], v[1], v[2], normal));
+  }
+
+  slicer->finalize();
+
+  unsigned handle = nextHandle++;
+  slicers[handle] = slicer;
+
   sink.beginDict();
   sink.insert("name", name);
   sink.insert("hash", hash);
+  sink.insert("handle", (int)handle);
+  sink.insert("count", (int)slicer->getFacetCount());
 
   // Facets
-  sink.insertList("facets");
+  if (args.getBoolean("facets")) {
+    bool flat = args.getBoolean("flat");
+    sink.insertList("facets");
 
-  while (reader.hasMore()) {
-    Vector3F v[3];
-    Vector3F normal;
-    reader.readFacet(v[0], v[1], v[2], normal);
+    for (unsigned i = 0; i < slicer->getFacetCount(); i++) {
+      const STL::Facet &f = slicer->getFacet(i);
+
+      sink.appendList();
+      for (int j = 0; j < 4; j++) {
+        const Vector3F &v = j < 3 ? f[j] : f.getNormal();
+
+        if (flat) for (int k = 0; k < 3; k++) sink.append(v[k]);
+        else append(sink, v);
+      }
+      sink.endList();
+    }
 
-    sink.appendList();
-    for (int i = 0; i < 3; i++) append(sink, v[i]);
-    append(sink, normal);
     sink.endList();
   }
 
-  sink.endList();
   sink.endDict();
 }
 
 
 void STLModule::bounds(const js::Value &args, js::Sink &sink) {
-  SmartPointer<js::Value> facets = args.get("stl")->get("facets");
-  Rectangle3F bounds;
-
-  unsigned length = facets->length();
-  for (unsigned i = 0; i < length; i++) {
-    SmartPointer<js::Value> facet = facets->get(i);
-
-    for (unsigned j = 0; j < 3; j++)
-      bounds.add(toVector3F(*facet->get(j)));
-  }
+  const Rectangle3F &bounds = getSlicer(*args.get("stl"))->getBounds();
 
   sink.beginList();
   append(sink, bounds.getMin());
@@ -331,24 +203,8 @@ void STLModule::bounds(const js::Value &args, js::Sink &sink) {
 /***
  * Creates a list of all contours at the level given by "level".
  *
- * It starts by loading each facet and looking at each edge of the triangle
- * to determine whether the facet crosses "level".
- *
- * If so, it determines the line segment that is formed by the intersection
- * of z = level and the facet.
- *
- * It uses normal to determine the direction of the line segment (i.e. which
- * is x1,y1 and which is x2,y2).  When traveling from x1,y1 to x2,y2, the normal
- * vector must always lean to the right to ensure that the polygon progresses
- * counterclockwise direction.
- *
- * After all line segments have been recorder, they are sorted to form closed
- * polygons.args.
- *
- * Each time a polygon closes, it is recorded into the return string
- * and a new polygon is started.
- *
- * If any polygons fail to close (within tolerance), an error is generated.
+ * See STLSlicer::slice() for how the contours are found.  Multiple levels
+ * are sliced in parallel.
  *
  * The returned data is of the form:
  *
@@ -357,15 +213,26 @@ void STLModule::bounds(const js::Value &args, js::Sink &sink) {
  *    . . .
  *    [{X: x1, Y: y1}, . . ., {X: xn, Y: yn}]
  *  ]
+ *
+ * or if "flat" is true:
+ *
+ *  [
+ *    [x1, y1, . . ., xn, yn],
+ *    . . .
+ *  ]
+ *
+ * Flat contours can be passed to clipper's offset() with flat=true.
  */
 void STLModule::contour(const js::Value &args, js::Sink &sink) {
-  // Read facets
-  vector<STL::Facet> facets;
-  readFacets(facets, *args.get("stl")->get("facets"));
+  SmartPointer<STLSlicer> slicer = getSlicer(*args.get("stl"));
+  bool flat = args.getBoolean("flat");
 
   // Process one level
-  if (args.get("level")->isNumber())
-    contourLevel(sink, facets, args.getNumber("level"));
+  if (args.get("level")->isNumber()) {
+    STLSlicer::contours_t contours;
+    slicer->slice(args.getNumber("level"), contours);
+    writeContours(sink, contours, flat);
+  }
 
   // Process multiple levels
   if (args.get("start")->isNumber() && args.get("end")->isNumber() &&
@@ -378,16 +245,42 @@ void STLModule::contour(const js::Value &args, js::Sink &sink) {
 
     float delta = (end - start) / (steps - 1);
 
-    sink.beginList();
-    for (int i = 0; i < steps; i++) {
-      float level = start + delta * i;
+    vector<float> levels;
+    for (int i = 0; i < steps; i++) levels.push_back(start + delta * i);
+
+    vector<STLSlicer::contours_t> contours;
+    slicer->slice(levels, contours);
 
+    sink.beginList();
+    for (unsigned i = 0; i < levels.size(); i++) {
       sink.appendDict();
-      sink.insert("Z", level);
+      sink.insert("Z", levels[i]);
       sink.beginInsert("contours");
-      contourLevel(sink, facets, level);
+      writeContours(sink, contours[i], flat);
       sink.endDict();
     }
     sink.endList();
   }
 }
+
+
+void STLModule::close(const js::Value &args, js::Sink &sink) {
+  SmartPointer<js::Value> stl = args.get("stl");
+  if (stl->has("handle")) slicers.erase(stl->getInteger("handle"));
+}
+
+
+SmartPointer<STLSlicer> STLModule::getSlicer(const js::Value &stl) {
+  if (stl.has("handle")) {
+    auto it = slicers.find(stl.getInteger("handle"));
+    if (it == slicers.end()) THROW("Invalid or closed STL handle");
+    return it->second;
+  }
+
+  // Facets built by the script
+  SmartPointer<STLSlicer> slicer = new STLSlicer;
+  readFacets(*slicer, *stl.get("facets"));
+  slicer->finalize();
+
+  return slicer;
+}
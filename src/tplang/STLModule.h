@@ -21,7 +21,12 @@
 #pragma once
 
 
+#include "STLSlicer.h"
+
 #include <cbang/js/NativeModule.h>
+#include <cbang/SmartPointer.h>
+
+#include <map>
 
 
 namespace tplang {
@@ -30,6 +35,10 @@ namespace tplang {
   class STLModule : public cb::js::NativeModule {
     TPLContext &ctx;
 
+    // Meshes opened by open(), by handle
+    std::map<unsigned, cb::SmartPointer<STLSlicer> > slicers;
+    unsigned nextHandle = 1;
+
   public:
     STLModule(TPLContext &ctx);
 
@@ -40,5 +49,9 @@ namespace tplang {
     void open(const cb::js::Value &args, cb::js::Sink &sink);
     void bounds(const cb::js::Value &args, cb::js::Sink &sink);
     void contour(const cb::js::Value &args, cb::js::Sink &sink);
+    void close(const cb::js::Value &args, cb::js::Sink &sink);
+
+  protected:
+    cb::SmartPointer<STLSlicer> getSlicer(const cb::js::Value &stl);
   };
 }
@@ -0,0 +1,464 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#include "STLSlicer.h"
+
+#include <camotics/ThreadPool.h>
+
+#include <cbang/Exception.h>
+#include <cbang/geom/Segment.h>
+#include <cbang/os/Condition.h>
+#include <cbang/util/SmartLock.h>
+
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace tplang;
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  const unsigned jobsPerThread = 4;
+
+  // Points closer than this are considered equal
+  const double tolerance = 0.001;
+
+
+  bool isBetween(float level, float z1, float z2) {
+    return (z1 <= level && level <= z2) || (z2 <= level && level <= z1);
+  }
+
+
+  float distanceBetweenPoints(const Vector2F &p1, const Vector2F &p2) {
+    float distance = p1.distance(p2);
+    return distance < tolerance ? 0 : distance;
+  }
+
+
+  bool findSegment(float level, const STL::Facet &f, Vector2F &p1,
+                   Vector2F &p2) {
+    // skip facets that lay on the "level" plane
+    if (f[0].z() == level && f[1].z() == level && f[2].z() == level)
+      return false;
+
+    // skip faces with an edge on the "level" plane and hang down
+    if ((f[0].z() == level && f[1].z() == level && f[2].z() < level) ||
+        (f[0].z() == level && f[2].z() == level && f[1].z() < level) ||
+        (f[1].z() == level && f[2].z() == level && f[0].z() < level))
+      return false;
+
+    bool p1Taken = false;
+    bool p2Taken = false;
+
+    if (isBetween(level, f[0].z(), f[1].z())) {
+      if (f[0].z() == f[1].z()) { // edge is on the plane
+        if (f[2].y() > level) return false;
+
+        p1 = f[0].slice<2>();
+        p2 = f[1].slice<2>();
+
+        return true;
+      }
+
+      float ratio = (level - f[1].z()) / (f[0].z() - f[1].z());
+      p1 = (f[1] + (f[0] - f[1]) * ratio).slice<2>();
+      p1Taken = true;
+    }
+
+    if (isBetween(level, f[1].z(), f[2].z())) {
+      if (f[1].z() == f[2].z()) { // edge is on the plane
+        if (f[0].y() > level) return false;
+
+        p1 = f[1].slice<2>();
+        p2 = f[2].slice<2>();
+
+        return true;
+      }
+
+      float ratio = (level - f[2].z()) / (f[1].z() - f[2].z());
+
+      if (!p1Taken) {
+        p1 = (f[2] + (f[1] - f[2]) * ratio).slice<2>();
+        p1Taken = true;
+
+      } else {
+        p2 = (f[2] + (f[1] - f[2]) * ratio).slice<2>();
+        p2Taken = true;
+      }
+    }
+
+    if (!p1Taken) return false;
+
+    if (isBetween(level, f[2].z(), f[0].z())) {
+      float ratio = (level - f[0].z()) / (f[2].z() - f[0].z());
+
+      if (!p2Taken) {
+        p2 = (f[0] + (f[2] - f[0]) * ratio).slice<2>();
+        p2Taken = true;
+      }
+    }
+
+    if (!p2Taken) return false;
+    return distanceBetweenPoints(p1, p2); // don't return single point segs
+  }
+
+
+  bool isEqual(float x, float y) {
+    if (y) return fabs((x - y) / y) < 0.00001;
+    return fabs(x) < 0.00001;
+  }
+
+
+  // Orient the segment so the facet normal points to its right
+  void orient(const STL::Facet &f, Vector2F &p1, Vector2F &p2) {
+    if (isEqual(p1.x(), p2.x())) {
+      if (p1.y() < p2.y()) {
+        if (f.getNormal().x() < 0) swap(p1, p2);
+      } else if (0 < f.getNormal().x()) swap(p1, p2);
+
+    } else if (isEqual(p1.y(), p2.y())) {
+      if (p1.x() < p2.x()) {
+        if (0 < f.getNormal().y()) swap(p1, p2);
+      } else if (f.getNormal().y() < 0) swap(p1, p2);
+
+    } else if (p1.x() < p2.x() && p1.y() < p2.y()) {
+      if (f.getNormal().x() < 0) swap(p1, p2);
+
+    } else if (p2.x() < p1.x() && p2.y() < p1.y()) {
+      if (0 < f.getNormal().x()) swap(p1, p2);
+
+    } else if (p1.x() < p2.x() && p2.y() < p1.y()) {
+      if (0 < f.getNormal().x()) swap(p1, p2);
+
+    } else if (f.getNormal().x() < 0) swap(p1, p2);
+  }
+
+
+  int64_t cellOf(float x) {return (int64_t)floor(x / tolerance);}
+
+
+  uint64_t cellKey(int64_t x, int64_t y) {
+    return (uint64_t)(uint32_t)x << 32 | (uint32_t)y;
+  }
+
+
+  // Links segments end to start into loops.  Starting with the first unused
+  // segment, the unused segment whose start is closest to the end of the
+  // loop is appended until the loop closes or the segments run out.
+  class Chainer {
+    const vector<Segment2F> &segments;
+    vector<bool> used;
+
+    // Segment starts by tolerance sized cells.  Points closer than the
+    // tolerance are in the same or a neighboring cell.
+    unordered_multimap<uint64_t, uint32_t> starts;
+
+  public:
+    Chainer(const vector<Segment2F> &segments) :
+      segments(segments), used(segments.size()), starts(segments.size()) {
+      for (unsigned i = 0; i < segments.size(); i++) {
+        const Vector2F &p = segments[i].getStart();
+        starts.emplace(cellKey(cellOf(p.x()), cellOf(p.y())), i);
+      }
+    }
+
+
+    int findNext(const Vector2F &p) const {
+      int64_t x = cellOf(p.x());
+      int64_t y = cellOf(p.y());
+      int best = -1;
+
+      // Coincident starts, lowest index first
+      for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++) {
+          auto range = starts.equal_range(cellKey(x + dx, y + dy));
+
+          for (auto it = range.first; it != range.second; it++) {
+            int i = it->second;
+
+            if (!used[i] && (best < 0 || i < best) &&
+                !distanceBetweenPoints(p, segments[i].getStart()))
+              best = i;
+          }
+        }
+
+      if (0 <= best) return best;
+
+      // The mesh is not closed here, jump to the closest start
+      float bestDist = numeric_limits<float>::max();
+
+      for (unsigned i = 0; i < segments.size(); i++)
+        if (!used[i]) {
+          float dist = distanceBetweenPoints(p, segments[i].getStart());
+
+          if (dist < bestDist) {
+            best = i;
+            bestDist = dist;
+          }
+        }
+
+      return best;
+    }
+
+
+    void chain(STLSlicer::contours_t &contours) {
+      unsigned remaining = segments.size();
+      unsigned next = 0;
+      bool inLoop = false;
+      Vector2F first;
+      Vector2F last;
+
+      while (remaining) {
+        // Start new loop
+        if (!inLoop) {
+          while (used[next]) next++;
+
+          inLoop = true;
+          first = segments[next].getStart();
+          last = segments[next].getEnd();
+
+          contours.push_back(STLSlicer::loop_t());
+          contours.back().push_back(first);
+          contours.back().push_back(last);
+
+          used[next] = true;
+          remaining--;
+        }
+
+        // Add the next closest segment
+        int closest = remaining ? findNext(last) : -1;
+
+        if (0 <= closest) {
+          last = segments[closest].getEnd();
+          contours.back().push_back(last);
+          used[closest] = true;
+          remaining--;
+        }
+
+        // Detect end of loop
+        if (!remaining || !distanceBetweenPoints(last, first)) inLoop = false;
+      }
+    }
+  };
+}
+
+
+void STLSlicer::add(const STL::Facet &facet) {
+  if (finalized) THROW("Cannot add facets after finalize");
+
+  float z0 = facet[0].z(), z1 = facet[1].z(), z2 = facet[2].z();
+
+  facets.push_back(facet);
+  zMin.push_back(std::min(z0, std::min(z1, z2)));
+  zMax.push_back(std::max(z0, std::max(z1, z2)));
+
+  for (unsigned i = 0; i < 3; i++) bounds.add(facet[i]);
+}
+
+
+void STLSlicer::finalize() {
+  if (finalized) return;
+  finalized = true;
+
+  vector<uint32_t> items(facets.size());
+  for (unsigned i = 0; i < items.size(); i++) items[i] = i;
+
+  byMin.reserve(items.size());
+  byMax.reserve(items.size());
+  build(items);
+}
+
+
+void STLSlicer::find(float level, vector<uint32_t> &result) const {
+  if (!finalized) THROW("STL slicer not finalized");
+
+  result.clear();
+  int32_t i = nodes.empty() ? -1 : 0;
+
+  while (0 <= i) {
+    const Node &node = nodes[i];
+    uint32_t end = node.first + node.count;
+
+    if (level < node.center) {
+      for (uint32_t j = node.first; j < end && zMin[byMin[j]] <= level; j++)
+        result.push_back(byMin[j]);
+      i = node.left;
+
+    } else if (node.center < level) {
+      for (uint32_t j = node.first; j < end && level <= zMax[byMax[j]]; j++)
+        result.push_back(byMax[j]);
+      i = node.right;
+
+    } else {
+      result.insert(result.end(), byMin.begin() + node.first,
+                    byMin.begin() + end);
+      break;
+    }
+  }
+
+  // Facet order makes the result independent of the tree
+  sort(result.begin(), result.end());
+}
+
+
+/***
+ * Each facet which crosses the level contributes the line segment where it
+ * intersects the plane z = level.  The facet normal is used to orient the
+ * segment so that when traveling from its start to its end the normal
+ * leans to the right and the polygons progress counterclockwise.
+ *
+ * Segments are then linked into loops by matching end points.
+ */
+void STLSlicer::slice(float level, contours_t &contours) const {
+  vector<uint32_t> candidates;
+  find(level, candidates);
+
+  vector<Segment2F> segments;
+
+  for (unsigned i = 0; i < candidates.size(); i++) {
+    const STL::Facet &f = facets[candidates[i]];
+    Vector2F p1, p2;
+
+    if (findSegment(level, f, p1, p2)) {
+      orient(f, p1, p2);
+      segments.push_back(Segment2F(p1, p2));
+    }
+  }
+
+  Chainer(segments).chain(contours);
+}
+
+
+void STLSlicer::slice(const vector<float> &levels,
+                      vector<contours_t> &contours) const {
+  contours.clear();
+  contours.resize(levels.size());
+
+  if (levels.size() < 2) {
+    for (unsigned i = 0; i < levels.size(); i++) slice(levels[i], contours[i]);
+    return;
+  }
+
+  CAMotics::ThreadPool &pool = CAMotics::ThreadPool::instance();
+
+  const unsigned jobs =
+    std::min((unsigned)levels.size(), pool.getThreads() * jobsPerThread);
+
+  Condition done;
+  unsigned outstanding = 0;
+  string error;
+
+  // The jobs reference locals so every queued job must finish before return
+  auto wait = [&] () {
+    done.lock();
+    while (outstanding) done.timedWait(0.25);
+    done.unlock();
+  };
+
+  try {
+    for (unsigned job = 0; job < jobs; job++) {
+      SmartLock lock(&done);
+
+      pool.add([&, job] (unsigned worker) {
+          string msg;
+
+          // Interleave the levels, neighboring levels cost about the same
+          for (unsigned i = job; i < levels.size() && msg.empty(); i += jobs)
+            try {
+              slice(levels[i], contours[i]);
+            } catch (const std::exception &e) {
+              msg = e.what();
+              if (msg.empty()) msg = "Slice failed";
+            } catch (...) {
+              msg = "Slice failed";
+            }
+
+          SmartLock lock(&done);
+          if (error.empty()) error = msg;
+          outstanding--;
+          done.signal();
+        });
+
+      // Counted only once queued, the lock keeps the job from finishing first
+      outstanding++;
+    }
+  } catch (...) {
+    wait();
+    throw;
+  }
+
+  wait();
+
+  if (!error.empty()) THROW(error);
+}
+
+
+int32_t STLSlicer::build(vector<uint32_t> &items) {
+  if (items.empty()) return -1;
+
+  // Split at the median interval midpoint
+  auto midpoint = [this] (uint32_t i) {return (zMin[i] + zMax[i]) / 2;};
+  auto median = items.begin() + items.size() / 2;
+
+  nth_element(items.begin(), median, items.end(),
+              [&] (uint32_t a, uint32_t b) {
+                return midpoint(a) < midpoint(b);
+              });
+
+  float center = midpoint(*median);
+
+  vector<uint32_t> left;
+  vector<uint32_t> right;
+  vector<uint32_t> spanning;
+
+  for (unsigned i = 0; i < items.size(); i++) {
+    uint32_t item = items[i];
+
+    if (zMax[item] < center) left.push_back(item);
+    else if (center < zMin[item]) right.push_back(item);
+    else spanning.push_back(item);
+  }
+
+  vector<uint32_t>().swap(items);
+
+  Node node = {center, (uint32_t)byMin.size(), (uint32_t)spanning.size(),
+               -1, -1};
+
+  sort(spanning.begin(), spanning.end(),
+       [this] (uint32_t a, uint32_t b) {return zMin[a] < zMin[b];});
+  byMin.insert(byMin.end(), spanning.begin(), spanning.end());
+
+  sort(spanning.begin(), spanning.end(),
+       [this] (uint32_t a, uint32_t b) {return zMax[b] < zMax[a];});
+  byMax.insert(byMax.end(), spanning.begin(), spanning.end());
+
+  int32_t index = nodes.size();
+  nodes.push_back(node);
+
+  int32_t leftIndex = build(left);
+  int32_t rightIndex = build(right);
+  nodes[index].left = leftIndex;
+  nodes[index].right = rightIndex;
+
+  return index;
+}
@@ -0,0 +1,81 @@
+/******************************************************************************\
+
+  CAMotics is an Open-Source simulation and CAM software.
+  Copyright (C) 2011-2019 Joseph Coffland <joseph@cauldrondevelopment.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+\******************************************************************************/
+
+#pragma once
+
+#include <stl/Facet.h>
+
+#include <cbang/geom/Rectangle.h>
+
+#include <vector>
+#include <cinttypes>
+
+
+namespace tplang {
+  // Slices a triangle mesh with horizontal planes.  The facets' z intervals
+  // are kept in a static interval tree so each level only visits the facets
+  // which span it.
+  class STLSlicer {
+    std::vector<STL::Facet> facets;
+    std::vector<float> zMin;
+    std::vector<float> zMax;
+    cb::Rectangle3F bounds;
+
+    // Facets spanning a node's center are stored at [first, first + count)
+    // in both byMin, sorted by ascending zMin, and byMax, sorted by
+    // descending zMax.
+    struct Node {
+      float center;
+      uint32_t first;
+      uint32_t count;
+      int32_t left;
+      int32_t right;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> byMin;
+    std::vector<uint32_t> byMax;
+    bool finalized = false;
+
+  public:
+    // Closed loops are ordered so the material is on the left
+    typedef std::vector<cb::Vector2F> loop_t;
+    typedef std::vector<loop_t> contours_t;
+
+    void add(const STL::Facet &facet);
+    void finalize();
+
+    unsigned getFacetCount() const {return facets.size();}
+    const STL::Facet &getFacet(unsigned i) const {return facets.at(i);}
+    const cb::Rectangle3F &getBounds() const {return bounds;}
+
+    // Indices of the facets which span level, in facet order
+    void find(float level, std::vector<uint32_t> &facets) const;
+
+    void slice(float level, contours_t &contours) const;
+
+    // Slices the levels in parallel on the shared ThreadPool
+    void slice(const std::vector<float> &levels,
+               std::vector<contours_t> &contours) const;
+
+  protected:
+    int32_t build(std::vector<uint32_t> &items);
+  };
+}